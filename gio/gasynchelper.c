@@ -24,6 +24,11 @@
 
 #include "gasynchelper.h"
 
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
 #include "gioalias.h"
 
 /**
@@ -173,3 +178,40 @@ _g_fd_source_new (int           fd,
   
   return source;
 }
+
+#ifdef G_OS_UNIX
+/* Returns %TRUE if @fd is in non-blocking mode and refers to something
+ * whose poll() readiness is meaningful, so an operation on it can be
+ * driven by a #GSource from _g_fd_source_new() instead of a thread.
+ * Regular files and block devices always poll as ready, even though a
+ * read from them may still have to wait for the disk.
+ */
+gboolean
+_g_fd_is_pollable (int fd)
+{
+  struct stat statbuf;
+  int flags;
+
+  flags = fcntl (fd, F_GETFL);
+  if (flags == -1 || (flags & O_NONBLOCK) == 0)
+    return FALSE;
+
+  if (fstat (fd, &statbuf) == -1)
+    return FALSE;
+
+  return !S_ISREG (statbuf.st_mode) &&
+	 !S_ISBLK (statbuf.st_mode) &&
+	 !S_ISDIR (statbuf.st_mode);
+}
+
+/* Returns %TRUE if @fd refers to a regular file, where a read or
+ * write always finishes after a bounded wait for the disk.
+ */
+gboolean
+_g_fd_is_regular (int fd)
+{
+  struct stat statbuf;
+
+  return fstat (fd, &statbuf) == 0 && S_ISREG (statbuf.st_mode);
+}
+#endif
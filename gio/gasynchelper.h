@@ -48,6 +48,11 @@ GSource *_g_fd_source_new      (int              fd,
 				gushort          events,
 				GCancellable    *cancellable);
 
+#ifdef G_OS_UNIX
+gboolean _g_fd_is_pollable     (int              fd);
+gboolean _g_fd_is_regular      (int              fd);
+#endif
+
 G_END_DECLS
 
 #endif /* __G_ASYNC_HELPER_H__ */
@@ -28,6 +28,7 @@
 #include "gasyncresult.h"
 #include "gsimpleasyncresult.h"
 #include "gioerror.h"
+#include "gbufferedstream-priv.h"
 #include <string.h>
 #include "glibintl.h"
 
@@ -54,6 +55,15 @@
  * g_buffered_input_stream_set_buffer_size(). Note that the buffer's size 
  * cannot be reduced below the size of the data within the buffer.
  *
+ * Instead of picking a size up front, the buffer can be sized
+ * adaptively, see g_buffered_input_stream_set_adaptive(). The buffer
+ * then grows while the base stream keeps filling it completely,
+ * shrinks to fit when it only delivers small amounts, goes back to
+ * the default size after the stream has been idle for a while, and
+ * is freed whenever everything in it has been read. This suits
+ * streams that see both bulk transfers and long idle periods, such
+ * as network connections. g_buffered_input_stream_get_stats() tells
+ * how well the buffering works for a given stream.
  **/
 
 
@@ -66,11 +76,15 @@ struct _GBufferedInputStreamPrivate {
   gsize   pos;
   gsize   end;
   GAsyncReadyCallback outstanding_callback;
+
+  GBufferedStreamAdaptive adaptive;
+  GBufferedStreamStats stats;
 };
 
 enum {
   PROP_0,
-  PROP_BUFSIZE
+  PROP_BUFSIZE,
+  PROP_ADAPTIVE
 };
 
 static void g_buffered_input_stream_set_property  (GObject      *object,
@@ -127,8 +141,6 @@ static gssize g_buffered_input_stream_real_fill_finish (GBufferedInputStream  *s
 							GAsyncResult          *result,
 							GError               **error);
 
-static void compact_buffer (GBufferedInputStream *stream);
-
 G_DEFINE_TYPE (GBufferedInputStream,
                g_buffered_input_stream,
                G_TYPE_FILTER_INPUT_STREAM)
@@ -172,6 +184,22 @@ g_buffered_input_stream_class_init (GBufferedInputStreamClass *klass)
                                                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
                                                       G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
 
+  /**
+   * GBufferedInputStream:adaptive:
+   *
+   * Whether the size of the buffer adapts to the data read.
+   * See g_buffered_input_stream_set_adaptive().
+   *
+   * Since: 2.22
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_ADAPTIVE,
+                                   g_param_spec_boolean ("adaptive",
+                                                         P_("Adaptive"),
+                                                         P_("Whether the buffer size adapts to the data read"),
+                                                         FALSE,
+                                                         G_PARAM_READWRITE|
+                                                         G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
 
 }
 
@@ -235,12 +263,104 @@ g_buffered_input_stream_set_buffer_size (GBufferedInputStream  *stream,
       priv->len = size;
       priv->pos = 0;
       priv->end = 0;
-      priv->buffer = g_malloc (size);
+
+      /* Adaptive buffers are allocated when they are filled */
+      if (!priv->adaptive.enabled)
+        priv->buffer = g_malloc (size);
     }
 
+  priv->stats.peak_size = MAX (priv->stats.peak_size, priv->len);
+
   g_object_notify (G_OBJECT (stream), "buffer-size");
 }
 
+/**
+ * g_buffered_input_stream_get_adaptive:
+ * @stream: a #GBufferedInputStream.
+ *
+ * Checks whether the size of the buffer of @stream adapts to the
+ * data read.
+ *
+ * Returns: %TRUE if the buffer size of @stream is adaptive,
+ * %FALSE otherwise.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_buffered_input_stream_get_adaptive (GBufferedInputStream *stream)
+{
+  g_return_val_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream), FALSE);
+
+  return stream->priv->adaptive.enabled;
+}
+
+/**
+ * g_buffered_input_stream_set_adaptive:
+ * @stream: a #GBufferedInputStream.
+ * @adaptive: whether the buffer size should adapt to the data read.
+ *
+ * Sets whether the size of the buffer of @stream adapts to the data
+ * read. If @adaptive is %TRUE, the buffer size set with
+ * g_buffered_input_stream_set_buffer_size() is only a starting point:
+ * the buffer doubles, up to 256 kilobytes, as long as reads from the
+ * base stream fill it completely, and shrinks, down to 1 kilobyte,
+ * when they only fill part of it. After 5 seconds without reading
+ * from the base stream, the buffer goes back to the default size.
+ *
+ * With an adaptive buffer, the memory for the buffer is also freed
+ * whenever all the data in it has been read with g_input_stream_read(),
+ * g_input_stream_skip(), g_buffered_input_stream_read_byte() or their
+ * asynchronous versions, and allocated again when the buffer is filled.
+ * An idle stream therefore holds no buffer at all.
+ *
+ * Since: 2.22
+ **/
+void
+g_buffered_input_stream_set_adaptive (GBufferedInputStream *stream,
+                                      gboolean              adaptive)
+{
+  GBufferedInputStreamPrivate *priv;
+
+  g_return_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream));
+
+  priv = stream->priv;
+  adaptive = adaptive != FALSE;
+
+  if (priv->adaptive.enabled == adaptive)
+    return;
+
+  _g_buffered_stream_adaptive_enable (&priv->adaptive, adaptive);
+
+  if (adaptive && priv->buffer && priv->pos == priv->end)
+    {
+      g_free (priv->buffer);
+      priv->buffer = NULL;
+      priv->pos = priv->end = 0;
+    }
+
+  g_object_notify (G_OBJECT (stream), "adaptive");
+}
+
+/**
+ * g_buffered_input_stream_get_stats:
+ * @stream: a #GBufferedInputStream.
+ * @stats: a #GBufferedStreamStats to fill in.
+ *
+ * Fills in @stats with statistics about the reads done on @stream
+ * and on its base stream since @stream was created.
+ *
+ * Since: 2.22
+ **/
+void
+g_buffered_input_stream_get_stats (GBufferedInputStream *stream,
+                                   GBufferedStreamStats *stats)
+{
+  g_return_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream));
+  g_return_if_fail (stats != NULL);
+
+  *stats = stream->priv->stats;
+}
+
 static void
 g_buffered_input_stream_set_property (GObject      *object,
                                       guint         prop_id,
@@ -259,6 +379,10 @@ g_buffered_input_stream_set_property (GObject      *object,
       g_buffered_input_stream_set_buffer_size (bstream, g_value_get_uint (value));
       break;
 
+    case PROP_ADAPTIVE:
+      g_buffered_input_stream_set_adaptive (bstream, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -284,6 +408,10 @@ g_buffered_input_stream_get_property (GObject    *object,
       g_value_set_uint (value, priv->len);
       break;
 
+    case PROP_ADAPTIVE:
+      g_value_set_boolean (value, priv->adaptive.enabled);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -615,6 +743,9 @@ g_buffered_input_stream_peek (GBufferedInputStream *stream,
  * buffer must not be modified and will become invalid when reading from
  * the stream or filling the buffer.
  *
+ * Together with g_buffered_input_stream_consume() this allows parsing
+ * data in place, without copying it out of the buffer first.
+ *
  * Returns: read-only buffer
  **/
 const void*
@@ -633,6 +764,40 @@ g_buffered_input_stream_peek_buffer (GBufferedInputStream *stream,
   return priv->buffer + priv->pos;
 }
 
+/**
+ * g_buffered_input_stream_consume:
+ * @stream: a #GBufferedInputStream.
+ * @count: the number of bytes to consume.
+ *
+ * Marks @count bytes at the start of the buffer as read, without copying
+ * them anywhere. This is meant to be used after inspecting the data
+ * returned by g_buffered_input_stream_peek_buffer() in place; if more
+ * data is needed before the bytes can be consumed, use
+ * g_buffered_input_stream_fill() and peek again.
+ *
+ * At most the number of bytes available in the buffer is consumed; no
+ * data is ever read from the base stream.
+ *
+ * Returns: the number of bytes consumed.
+ *
+ * Since: 2.22
+ **/
+gsize
+g_buffered_input_stream_consume (GBufferedInputStream *stream,
+                                 gsize                 count)
+{
+  GBufferedInputStreamPrivate *priv;
+
+  g_return_val_if_fail (G_IS_BUFFERED_INPUT_STREAM (stream), 0);
+
+  priv = stream->priv;
+
+  count = MIN (count, priv->end - priv->pos);
+  priv->pos += count;
+
+  return count;
+}
+
 static void
 compact_buffer (GBufferedInputStream *stream)
 {
@@ -649,30 +814,243 @@ compact_buffer (GBufferedInputStream *stream)
   priv->end = current_size;
 }
 
-static gssize
-g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
-                                   gssize                 count,
-                                   GCancellable          *cancellable,
-                                   GError               **error)
+/* The adaptive sizing below is shared with GBufferedOutputStream,
+ * see gbufferedstream-priv.h.
+ */
+void
+_g_buffered_stream_adaptive_enable (GBufferedStreamAdaptive *adaptive,
+                                    gboolean                 enabled)
+{
+  adaptive->enabled = enabled != FALSE;
+  adaptive->pending = FALSE;
+  adaptive->last_use = g_thread_gettime ();
+}
+
+/* Records a transfer of @transferred bytes between the buffer and
+ * the base stream.
+ */
+void
+_g_buffered_stream_adaptive_record (GBufferedStreamAdaptive *adaptive,
+                                    gsize                    transferred,
+                                    gboolean                 saturated)
+{
+  adaptive->average = (adaptive->average * 3 + transferred) / 4;
+  adaptive->saturated = saturated != FALSE;
+  adaptive->pending = TRUE;
+}
+
+/* Returns %TRUE if the stream was not used for ADAPTIVE_IDLE_TIME
+ * seconds, and marks it as used now. g_thread_gettime() is monotonic
+ * where the system allows, so changes of the wall clock don't count.
+ */
+gboolean
+_g_buffered_stream_adaptive_idle (GBufferedStreamAdaptive *adaptive)
+{
+  guint64 now;
+  gboolean idle;
+
+  now = g_thread_gettime ();
+  idle = now - adaptive->last_use >= ADAPTIVE_IDLE_TIME * G_GUINT64_CONSTANT (1000000000);
+  adaptive->last_use = now;
+
+  return idle;
+}
+
+/* Picks the size of the next buffer from how the last transfers went:
+ * one that used the whole buffer means the base stream had more to
+ * give or take, so the buffer doubles; transfers that only used a
+ * fraction of it shrink the buffer to fit.
+ */
+gsize
+_g_buffered_stream_adaptive_next_size (GBufferedStreamAdaptive *adaptive,
+                                       gsize                    len)
+{
+  gsize size;
+
+  adaptive->pending = FALSE;
+
+  if (adaptive->saturated)
+    size = MAX (len, MIN (len * 2, ADAPTIVE_MAX_SIZE));
+  else if (adaptive->average < len / 2)
+    {
+      size = MAX (adaptive->average, ADAPTIVE_MIN_SIZE);
+      size = MIN ((gsize) 1 << g_bit_storage (size - 1), len);
+    }
+  else
+    size = len;
+
+  return size;
+}
+
+/* Only called on an empty buffer, so there is nothing to keep */
+void
+_g_buffered_stream_set_adaptive_size (GObject               *stream,
+                                      guint8               **buffer,
+                                      gsize                 *len,
+                                      GBufferedStreamStats  *stats,
+                                      gsize                  size)
+{
+  if (size == *len)
+    return;
+
+  if (*buffer)
+    {
+      g_free (*buffer);
+      *buffer = NULL;
+      stats->releases++;
+    }
+  *len = size;
+  stats->resizes++;
+
+  g_object_notify (stream, "buffer-size");
+}
+
+/* Picks the size of the next buffer once the data from the last fill
+ * has all been used up.
+ */
+static void
+adapt_buffer_size (GBufferedInputStream *stream)
+{
+  GBufferedInputStreamPrivate *priv;
+  gsize size;
+
+  priv = stream->priv;
+
+  if (!priv->adaptive.pending)
+    return;
+
+  size = _g_buffered_stream_adaptive_next_size (&priv->adaptive, priv->len);
+  _g_buffered_stream_set_adaptive_size (G_OBJECT (stream),
+                                        &priv->buffer, &priv->len,
+                                        &priv->stats, size);
+}
+
+/* Called when all the data in the buffer has been read */
+static void
+buffer_drained (GBufferedInputStream *stream)
+{
+  GBufferedInputStreamPrivate *priv;
+
+  priv = stream->priv;
+
+  priv->pos = 0;
+  priv->end = 0;
+
+  if (!priv->adaptive.enabled)
+    return;
+
+  if (priv->buffer)
+    {
+      g_free (priv->buffer);
+      priv->buffer = NULL;
+      priv->stats.releases++;
+    }
+
+  adapt_buffer_size (stream);
+}
+
+static void
+account_base_read (GBufferedInputStreamPrivate *priv,
+                   gssize                       nread)
+{
+  priv->stats.base_calls++;
+  if (nread > 0)
+    priv->stats.bytes += nread;
+}
+
+/* Records the result of a fill of @count bytes */
+static void
+fill_done (GBufferedInputStream *stream,
+           gsize                 count,
+           gssize                nread)
+{
+  GBufferedInputStreamPrivate *priv;
+
+  priv = stream->priv;
+
+  account_base_read (priv, nread);
+
+  if (nread <= 0)
+    return;
+
+  priv->end += nread;
+
+  _g_buffered_stream_adaptive_record (&priv->adaptive, nread,
+                                      (gsize) nread == count && count >= priv->len / 2);
+}
+
+/* Makes room for a fill of up to @count bytes at priv->end and returns
+ * the number of bytes to actually read.
+ */
+static gsize
+prepare_fill (GBufferedInputStream *stream,
+              gssize                count)
 {
   GBufferedInputStreamPrivate *priv;
-  GInputStream *base_stream;
-  gssize nread;
   gsize in_buffer;
 
   priv = stream->priv;
 
+  in_buffer = priv->end - priv->pos;
+
+  /* An empty buffer can be rewound for free */
+  if (in_buffer == 0)
+    {
+      priv->pos = priv->end = 0;
+
+      if (priv->adaptive.enabled)
+        {
+          adapt_buffer_size (stream);
+
+          if (_g_buffered_stream_adaptive_idle (&priv->adaptive))
+            _g_buffered_stream_set_adaptive_size (G_OBJECT (stream),
+                                                  &priv->buffer, &priv->len,
+                                                  &priv->stats,
+                                                  DEFAULT_BUFFER_SIZE);
+        }
+    }
+
+  if (priv->buffer == NULL)
+    {
+      priv->buffer = g_malloc (priv->len);
+      priv->stats.peak_size = MAX (priv->stats.peak_size, priv->len);
+    }
+
   if (count == -1)
     count = priv->len;
-  
-  in_buffer = priv->end - priv->pos;
 
   /* Never fill more than can fit in the buffer */
   count = MIN (count, priv->len - in_buffer);
 
-  /* If requested length does not fit at end, compact */
+  /* If requested length does not fit at end, compact; but only move the
+   * data when that frees up at least as much room as it copies, so that
+   * compacting never costs more than the reading it makes room for.
+   * Otherwise just use the room left at the end.
+   */
   if (priv->len - priv->end < count)
-    compact_buffer (stream);
+    {
+      if (in_buffer <= priv->pos || priv->end == priv->len)
+        compact_buffer (stream);
+      else
+        count = priv->len - priv->end;
+    }
+
+  return count;
+}
+
+static gssize
+g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
+                                   gssize                 count,
+                                   GCancellable          *cancellable,
+                                   GError               **error)
+{
+  GBufferedInputStreamPrivate *priv;
+  GInputStream *base_stream;
+  gssize nread;
+
+  priv = stream->priv;
+
+  count = prepare_fill (stream, count);
 
   base_stream = G_FILTER_INPUT_STREAM (stream)->base_stream;
   nread = g_input_stream_read (base_stream,
@@ -681,8 +1059,7 @@ g_buffered_input_stream_real_fill (GBufferedInputStream  *stream,
                                cancellable,
                                error);
 
-  if (nread > 0)
-    priv->end += nread;
+  fill_done (stream, count, nread);
   
   return nread;
 }
@@ -703,11 +1080,15 @@ g_buffered_input_stream_skip (GInputStream  *stream,
   bstream = G_BUFFERED_INPUT_STREAM (stream);
   priv = bstream->priv;
 
+  priv->stats.calls++;
+
   available = priv->end - priv->pos;
 
   if (count <= available)
     {
       priv->pos += count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
       return count;
     }
 
@@ -715,8 +1096,7 @@ g_buffered_input_stream_skip (GInputStream  *stream,
    * request refill for more 
    */
   
-  priv->pos = 0;
-  priv->end = 0;
+  buffer_drained (bstream);
   bytes_skipped = available;
   count -= available;
 
@@ -733,6 +1113,7 @@ g_buffered_input_stream_skip (GInputStream  *stream,
                                    count,
                                    cancellable,
                                    error);
+      account_base_read (priv, nread);
       
       if (nread < 0 && bytes_skipped == 0)
         return -1;
@@ -759,6 +1140,8 @@ g_buffered_input_stream_skip (GInputStream  *stream,
   
   bytes_skipped += count;
   priv->pos += count;
+  if (priv->pos == priv->end)
+    buffer_drained (bstream);
   
   return bytes_skipped;
 }
@@ -780,20 +1163,23 @@ g_buffered_input_stream_read (GInputStream *stream,
   bstream = G_BUFFERED_INPUT_STREAM (stream);
   priv = bstream->priv;
 
+  priv->stats.calls++;
+
   available = priv->end - priv->pos;
 
   if (count <= available)
     {
       memcpy (buffer, priv->buffer + priv->pos, count);
       priv->pos += count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
       return count;
     }
   
   /* Full request not available, read all currently availbile and request refill for more */
   
   memcpy (buffer, priv->buffer + priv->pos, available);
-  priv->pos = 0;
-  priv->end = 0;
+  buffer_drained (bstream);
   bytes_read = available;
   count -= available;
 
@@ -811,6 +1197,7 @@ g_buffered_input_stream_read (GInputStream *stream,
 				   count,
 				   cancellable,
 				   error);
+      account_base_read (priv, nread);
       
       if (nread < 0 && bytes_read == 0)
         return -1;
@@ -837,10 +1224,27 @@ g_buffered_input_stream_read (GInputStream *stream,
   memcpy ((char *)buffer + bytes_read, (char *)priv->buffer + priv->pos, count);
   bytes_read += count;
   priv->pos += count;
+  if (priv->pos == priv->end)
+    buffer_drained (bstream);
   
   return bytes_read;
 }
 
+static int
+read_buffered_byte (GBufferedInputStream *stream)
+{
+  GBufferedInputStreamPrivate *priv;
+  int c;
+
+  priv = stream->priv;
+
+  c = priv->buffer[priv->pos++];
+  if (priv->pos == priv->end)
+    buffer_drained (stream);
+
+  return c;
+}
+
 /**
  * g_buffered_input_stream_read_byte:
  * @stream: #GBufferedInputStream.
@@ -889,12 +1293,14 @@ g_buffered_input_stream_read_byte (GBufferedInputStream  *stream,
   if (!g_input_stream_set_pending (input_stream, error))
     return -1;
 
+  priv->stats.calls++;
+
   available = priv->end - priv->pos;
 
   if (available != 0)
     {
       g_input_stream_clear_pending (input_stream);
-      return priv->buffer[priv->pos++];
+      return read_buffered_byte (stream);
     }
 
   /* Byte not available, request refill for more */
@@ -902,8 +1308,7 @@ g_buffered_input_stream_read_byte (GBufferedInputStream  *stream,
   if (cancellable)
     g_cancellable_push_current (cancellable);
 
-  priv->pos = 0;
-  priv->end = 0;
+  buffer_drained (stream);
 
   class = G_BUFFERED_INPUT_STREAM_GET_CLASS (stream);
   nread = class->fill (stream, priv->len, cancellable, error);
@@ -916,7 +1321,7 @@ g_buffered_input_stream_read_byte (GBufferedInputStream  *stream,
   if (nread <= 0)
     return -1; /* error or end of stream */
 
-  return priv->buffer[priv->pos++];
+  return read_buffered_byte (stream);
 }
 
 /* ************************** */
@@ -928,35 +1333,32 @@ fill_async_callback (GObject      *source_object,
                      GAsyncResult *result,
                      gpointer      user_data)
 {
+  GBufferedInputStream *stream;
+  GSimpleAsyncResult *simple;
   GError *error;
   gssize res;
-  GSimpleAsyncResult *simple;
+  gsize count;
 
   simple = user_data;
+
+  /* Until the read finishes, the result holds the requested size */
+  count = g_simple_async_result_get_op_res_gssize (simple);
   
   error = NULL;
   res = g_input_stream_read_finish (G_INPUT_STREAM (source_object),
 				    result, &error);
 
+  stream = G_BUFFERED_INPUT_STREAM (g_async_result_get_source_object (G_ASYNC_RESULT (simple)));
+  g_assert_cmpint (res, <=, (gssize) count);
+  fill_done (stream, count, res);
+  g_object_unref (stream);
+
   g_simple_async_result_set_op_res_gssize (simple, res);
   if (res == -1)
     {
       g_simple_async_result_set_from_error (simple, error);
       g_error_free (error);
     }
-  else
-    {
-      GBufferedInputStreamPrivate *priv;
-      GObject *object;
-
-      object = g_async_result_get_source_object (G_ASYNC_RESULT (simple));
-      priv = G_BUFFERED_INPUT_STREAM (object)->priv;
-
-      g_assert_cmpint (priv->end + res, <=, priv->len);
-      priv->end += res;
-
-      g_object_unref (object);
-    }
   
   /* Complete immediately, not in idle, since we're already in a mainloop callout */
   g_simple_async_result_complete (simple);
@@ -974,25 +1376,15 @@ g_buffered_input_stream_real_fill_async (GBufferedInputStream *stream,
   GBufferedInputStreamPrivate *priv;
   GInputStream *base_stream;
   GSimpleAsyncResult *simple;
-  gsize in_buffer;
 
   priv = stream->priv;
 
-  if (count == -1)
-    count = priv->len;
-  
-  in_buffer = priv->end - priv->pos;
-
-  /* Never fill more than can fit in the buffer */
-  count = MIN (count, priv->len - in_buffer);
-
-  /* If requested length does not fit at end, compact */
-  if (priv->len - priv->end < count)
-    compact_buffer (stream);
+  count = prepare_fill (stream, count);
 
   simple = g_simple_async_result_new (G_OBJECT (stream),
 				      callback, user_data,
 				      g_buffered_input_stream_real_fill_async);
+  g_simple_async_result_set_op_res_gssize (simple, count);
   
   base_stream = G_FILTER_INPUT_STREAM (stream)->base_stream;
   g_input_stream_read_async (base_stream,
@@ -1038,6 +1430,7 @@ large_read_callback (GObject *source_object,
 		     gpointer user_data)
 {
   GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  GBufferedInputStream *bstream;
   ReadAsyncData *data;
   GError *error;
   gssize nread;
@@ -1048,6 +1441,10 @@ large_read_callback (GObject *source_object,
   nread = g_input_stream_read_finish (G_INPUT_STREAM (source_object),
 				      result, &error);
 
+  bstream = G_BUFFERED_INPUT_STREAM (g_async_result_get_source_object (G_ASYNC_RESULT (simple)));
+  account_base_read (bstream->priv, nread);
+  g_object_unref (bstream);
+
   /* Only report the error if we've not already read some data */
   if (nread < 0 && data->bytes_read == 0)
     g_simple_async_result_set_from_error (simple, error);
@@ -1097,6 +1494,8 @@ read_fill_buffer_callback (GObject *source_object,
       memcpy ((char *)data->buffer + data->bytes_read, (char *)priv->buffer + priv->pos, data->count);
       data->bytes_read += data->count;
       priv->pos += data->count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
     }
 
   if (error)
@@ -1134,6 +1533,8 @@ g_buffered_input_stream_read_async (GInputStream              *stream,
 				      callback, user_data,
 				      g_buffered_input_stream_read_async);
   g_simple_async_result_set_op_res_gpointer (simple, data, free_read_async_data);
+
+  priv->stats.calls++;
   
   available = priv->end - priv->pos;
   
@@ -1141,6 +1542,8 @@ g_buffered_input_stream_read_async (GInputStream              *stream,
     {
       memcpy (buffer, priv->buffer + priv->pos, count);
       priv->pos += count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
       data->bytes_read = count;
       
       g_simple_async_result_complete_in_idle (simple);
@@ -1152,8 +1555,7 @@ g_buffered_input_stream_read_async (GInputStream              *stream,
   /* Full request not available, read all currently availbile and request refill for more */
   
   memcpy (buffer, priv->buffer + priv->pos, available);
-  priv->pos = 0;
-  priv->end = 0;
+  buffer_drained (bstream);
   
   count -= available;
   
@@ -1216,6 +1618,7 @@ large_skip_callback (GObject *source_object,
 		     gpointer user_data)
 {
   GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  GBufferedInputStream *bstream;
   SkipAsyncData *data;
   GError *error;
   gssize nread;
@@ -1226,6 +1629,10 @@ large_skip_callback (GObject *source_object,
   nread = g_input_stream_skip_finish (G_INPUT_STREAM (source_object),
 				      result, &error);
 
+  bstream = G_BUFFERED_INPUT_STREAM (g_async_result_get_source_object (G_ASYNC_RESULT (simple)));
+  account_base_read (bstream->priv, nread);
+  g_object_unref (bstream);
+
   /* Only report the error if we've not already read some data */
   if (nread < 0 && data->bytes_skipped == 0)
     g_simple_async_result_set_from_error (simple, error);
@@ -1274,6 +1681,8 @@ skip_fill_buffer_callback (GObject *source_object,
       
       data->bytes_skipped += data->count;
       priv->pos += data->count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
     }
 
   if (error)
@@ -1309,12 +1718,16 @@ g_buffered_input_stream_skip_async (GInputStream              *stream,
 				      callback, user_data,
 				      g_buffered_input_stream_skip_async);
   g_simple_async_result_set_op_res_gpointer (simple, data, free_skip_async_data);
+
+  priv->stats.calls++;
   
   available = priv->end - priv->pos;
   
   if (count <= available)
     {
       priv->pos += count;
+      if (priv->pos == priv->end)
+        buffer_drained (bstream);
       data->bytes_skipped = count;
       
       g_simple_async_result_complete_in_idle (simple);
@@ -1325,8 +1738,7 @@ g_buffered_input_stream_skip_async (GInputStream              *stream,
 
   /* Full request not available, skip all currently availbile and request refill for more */
   
-  priv->pos = 0;
-  priv->end = 0;
+  buffer_drained (bstream);
   
   count -= available;
   
@@ -92,6 +92,11 @@ GInputStream* g_buffered_input_stream_new_sized       (GInputStream          *ba
 gsize         g_buffered_input_stream_get_buffer_size (GBufferedInputStream  *stream);
 void          g_buffered_input_stream_set_buffer_size (GBufferedInputStream  *stream,
 						       gsize                  size);
+gboolean      g_buffered_input_stream_get_adaptive    (GBufferedInputStream  *stream);
+void          g_buffered_input_stream_set_adaptive    (GBufferedInputStream  *stream,
+						       gboolean               adaptive);
+void          g_buffered_input_stream_get_stats       (GBufferedInputStream  *stream,
+						       GBufferedStreamStats  *stats);
 gsize         g_buffered_input_stream_get_available   (GBufferedInputStream  *stream);
 gsize         g_buffered_input_stream_peek            (GBufferedInputStream  *stream,
 						       void                  *buffer,
@@ -99,6 +104,8 @@ gsize         g_buffered_input_stream_peek            (GBufferedInputStream  *st
 						       gsize                  count);
 const void*   g_buffered_input_stream_peek_buffer     (GBufferedInputStream  *stream,
 						       gsize                 *count);
+gsize         g_buffered_input_stream_consume         (GBufferedInputStream  *stream,
+						       gsize                  count);
 
 gssize        g_buffered_input_stream_fill            (GBufferedInputStream  *stream,
 						       gssize                 count,
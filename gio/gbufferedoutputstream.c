@@ -24,6 +24,8 @@
 #include "gbufferedoutputstream.h"
 #include "goutputstream.h"
 #include "gsimpleasyncresult.h"
+#include "gioerror.h"
+#include "gbufferedstream-priv.h"
 #include "string.h"
 #include "glibintl.h"
 
@@ -49,6 +51,11 @@
  * buffered output stream's buffer, use 
  * g_buffered_output_stream_set_buffer_size(). Note that the buffer's 
  * size cannot be reduced below the size of the data within the buffer.
+ *
+ * As with #GBufferedInputStream, the buffer can be sized adaptively
+ * instead, see g_buffered_output_stream_set_adaptive(), and
+ * g_buffered_output_stream_get_stats() reports how well the buffering
+ * works for a given stream.
  **/
 
 #define DEFAULT_BUFFER_SIZE 4096
@@ -58,12 +65,16 @@ struct _GBufferedOutputStreamPrivate {
   gsize   len;
   goffset pos;
   gboolean auto_grow;
+
+  GBufferedStreamAdaptive adaptive;
+  GBufferedStreamStats stats;
 };
 
 enum {
   PROP_0,
   PROP_BUFSIZE,
-  PROP_AUTO_GROW
+  PROP_AUTO_GROW,
+  PROP_ADAPTIVE
 };
 
 static void     g_buffered_output_stream_set_property (GObject      *object,
@@ -166,6 +177,23 @@ g_buffered_output_stream_class_init (GBufferedOutputStreamClass *klass)
                                                          G_PARAM_READWRITE|
                                                          G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
 
+  /**
+   * GBufferedOutputStream:adaptive:
+   *
+   * Whether the size of the buffer adapts to the data written.
+   * See g_buffered_output_stream_set_adaptive().
+   *
+   * Since: 2.22
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_ADAPTIVE,
+                                   g_param_spec_boolean ("adaptive",
+                                                         P_("Adaptive"),
+                                                         P_("Whether the buffer size adapts to the data written"),
+                                                         FALSE,
+                                                         G_PARAM_READWRITE|
+                                                         G_PARAM_STATIC_NAME|G_PARAM_STATIC_NICK|G_PARAM_STATIC_BLURB));
+
 }
 
 /**
@@ -218,11 +246,15 @@ g_buffered_output_stream_set_buffer_size (GBufferedOutputStream *stream,
     }
   else
     {
-      priv->buffer = g_malloc (size);
+      /* Adaptive buffers are allocated when they are written to */
+      if (!priv->adaptive.enabled)
+        priv->buffer = g_malloc (size);
       priv->len = size;
       priv->pos = 0;
     }
 
+  priv->stats.peak_size = MAX (priv->stats.peak_size, priv->len);
+
   g_object_notify (G_OBJECT (stream), "buffer-size");
 }
 
@@ -252,6 +284,10 @@ g_buffered_output_stream_get_auto_grow (GBufferedOutputStream *stream)
  * If @auto_grow is true, then each write will just make the buffer
  * larger, and you must manually flush the buffer to actually write out
  * the data to the underlying stream.
+ *
+ * If the buffer size is also adaptive, the buffer does not grow
+ * beyond the largest adaptive size; once it is reached, the buffer
+ * is written out as if @auto_grow was %FALSE.
  **/
 void
 g_buffered_output_stream_set_auto_grow (GBufferedOutputStream *stream,
@@ -268,6 +304,91 @@ g_buffered_output_stream_set_auto_grow (GBufferedOutputStream *stream,
     }
 }
 
+/**
+ * g_buffered_output_stream_get_adaptive:
+ * @stream: a #GBufferedOutputStream.
+ *
+ * Checks whether the size of the buffer of @stream adapts to the
+ * data written.
+ *
+ * Returns: %TRUE if the buffer size of @stream is adaptive,
+ * %FALSE otherwise.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_buffered_output_stream_get_adaptive (GBufferedOutputStream *stream)
+{
+  g_return_val_if_fail (G_IS_BUFFERED_OUTPUT_STREAM (stream), FALSE);
+
+  return stream->priv->adaptive.enabled;
+}
+
+/**
+ * g_buffered_output_stream_set_adaptive:
+ * @stream: a #GBufferedOutputStream.
+ * @adaptive: whether the buffer size should adapt to the data written.
+ *
+ * Sets whether the size of the buffer of @stream adapts to the data
+ * written. If @adaptive is %TRUE, the buffer size set with
+ * g_buffered_output_stream_set_buffer_size() is only a starting point:
+ * the buffer doubles, up to 256 kilobytes, each time small writes fill
+ * it up, and shrinks, down to 1 kilobyte, when flushes only find a
+ * fraction of it in use. After 5 seconds without writes, the buffer
+ * goes back to the default size.
+ *
+ * With an adaptive buffer, the memory for the buffer is also freed
+ * each time the buffer has been written out to the base stream, and
+ * allocated again by the next write that needs it. An idle stream
+ * therefore holds no buffer at all.
+ *
+ * Since: 2.22
+ **/
+void
+g_buffered_output_stream_set_adaptive (GBufferedOutputStream *stream,
+                                       gboolean               adaptive)
+{
+  GBufferedOutputStreamPrivate *priv;
+
+  g_return_if_fail (G_IS_BUFFERED_OUTPUT_STREAM (stream));
+
+  priv = stream->priv;
+  adaptive = adaptive != FALSE;
+
+  if (priv->adaptive.enabled == adaptive)
+    return;
+
+  _g_buffered_stream_adaptive_enable (&priv->adaptive, adaptive);
+
+  if (adaptive && priv->pos == 0)
+    {
+      g_free (priv->buffer);
+      priv->buffer = NULL;
+    }
+
+  g_object_notify (G_OBJECT (stream), "adaptive");
+}
+
+/**
+ * g_buffered_output_stream_get_stats:
+ * @stream: a #GBufferedOutputStream.
+ * @stats: a #GBufferedStreamStats to fill in.
+ *
+ * Fills in @stats with statistics about the writes done on @stream
+ * and on its base stream since @stream was created.
+ *
+ * Since: 2.22
+ **/
+void
+g_buffered_output_stream_get_stats (GBufferedOutputStream *stream,
+                                    GBufferedStreamStats  *stats)
+{
+  g_return_if_fail (G_IS_BUFFERED_OUTPUT_STREAM (stream));
+  g_return_if_fail (stats != NULL);
+
+  *stats = stream->priv->stats;
+}
+
 static void
 g_buffered_output_stream_set_property (GObject      *object,
                                        guint         prop_id,
@@ -288,6 +409,10 @@ g_buffered_output_stream_set_property (GObject      *object,
       g_buffered_output_stream_set_auto_grow (stream, g_value_get_boolean (value));
       break;
 
+    case PROP_ADAPTIVE:
+      g_buffered_output_stream_set_adaptive (stream, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -317,6 +442,10 @@ g_buffered_output_stream_get_property (GObject    *object,
       g_value_set_boolean (value, priv->auto_grow);
       break;
 
+    case PROP_ADAPTIVE:
+      g_value_set_boolean (value, priv->adaptive.enabled);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -394,6 +523,62 @@ g_buffered_output_stream_new_sized (GOutputStream *base_stream,
   return stream;
 }
 
+/* Makes sure there is a buffer to copy data into, first going back
+ * to the default size if nothing was written for a while.
+ */
+static void
+prepare_buffer (GBufferedOutputStream *stream)
+{
+  GBufferedOutputStreamPrivate *priv;
+
+  priv = stream->priv;
+
+  if (priv->adaptive.enabled && priv->pos == 0 &&
+      _g_buffered_stream_adaptive_idle (&priv->adaptive))
+    _g_buffered_stream_set_adaptive_size (G_OBJECT (stream),
+                                          &priv->buffer, &priv->len,
+                                          &priv->stats, DEFAULT_BUFFER_SIZE);
+
+  if (priv->buffer == NULL)
+    {
+      priv->buffer = g_malloc (priv->len);
+      priv->stats.peak_size = MAX (priv->stats.peak_size, priv->len);
+    }
+}
+
+/* Called after @flushed bytes from the buffer have been written to the
+ * base stream. Once the buffer is empty, an adaptive buffer is freed
+ * and the size of the next one is picked, see
+ * _g_buffered_stream_adaptive_next_size().
+ */
+static void
+buffer_flushed (GBufferedOutputStream *stream,
+                gsize                  flushed,
+                gboolean               full)
+{
+  GBufferedOutputStreamPrivate *priv;
+  gsize size;
+
+  priv = stream->priv;
+
+  _g_buffered_stream_adaptive_record (&priv->adaptive, flushed, full);
+
+  if (!priv->adaptive.enabled || priv->pos > 0)
+    return;
+
+  if (priv->buffer)
+    {
+      g_free (priv->buffer);
+      priv->buffer = NULL;
+      priv->stats.releases++;
+    }
+
+  size = _g_buffered_stream_adaptive_next_size (&priv->adaptive, priv->len);
+  _g_buffered_stream_set_adaptive_size (G_OBJECT (stream),
+                                        &priv->buffer, &priv->len,
+                                        &priv->stats, size);
+}
+
 static gboolean
 flush_buffer (GBufferedOutputStream  *stream,
               GCancellable           *cancellable,
@@ -411,6 +596,9 @@ flush_buffer (GBufferedOutputStream  *stream,
 
   g_return_val_if_fail (G_IS_OUTPUT_STREAM (base_stream), FALSE);
 
+  if (priv->pos == 0)
+    return TRUE;
+
   res = g_output_stream_write_all (base_stream,
                                    priv->buffer,
                                    priv->pos,
@@ -418,6 +606,9 @@ flush_buffer (GBufferedOutputStream  *stream,
                                    cancellable,
                                    error);
 
+  priv->stats.base_calls++;
+  priv->stats.bytes += bytes_written;
+
   count = priv->pos - bytes_written;
 
   if (count > 0)
@@ -425,6 +616,8 @@ flush_buffer (GBufferedOutputStream  *stream,
   
   priv->pos -= bytes_written;
 
+  buffer_flushed (stream, bytes_written, bytes_written == priv->len);
+
   return res;
 }
 
@@ -437,28 +630,83 @@ g_buffered_output_stream_write  (GOutputStream *stream,
 {
   GBufferedOutputStream        *bstream;
   GBufferedOutputStreamPrivate *priv;
+  GOutputStream                *base_stream;
+  GOutputVector vectors[2];
   gboolean res;
   gsize    n;
   gsize new_size;
+  gsize bytes_written;
+  gsize flushed;
+  gsize buffered;
 
   bstream = G_BUFFERED_OUTPUT_STREAM (stream);
   priv = bstream->priv;
 
+  priv->stats.calls++;
+
   n = priv->len - priv->pos;
 
-  if (priv->auto_grow && n < count)
+  if (priv->auto_grow && n < count &&
+      !(priv->adaptive.enabled && priv->len >= ADAPTIVE_MAX_SIZE))
     {
       new_size = MAX (priv->len * 2, priv->len + count);
+      if (priv->adaptive.enabled)
+        new_size = MIN (new_size, ADAPTIVE_MAX_SIZE);
       g_buffered_output_stream_set_buffer_size (bstream, new_size);
     }
-  else if (n == 0)
+  else if (n < count)
     {
-      res = flush_buffer (bstream, cancellable, error);
-      
-      if (res == FALSE)
-	return -1;
+      /* The data doesn't fit, so write out the buffer together with
+       * the data, without copying it into the buffer first.
+       */
+      base_stream = G_FILTER_OUTPUT_STREAM (stream)->base_stream;
+      buffered = priv->pos;
+
+      do
+	{
+	  vectors[0].buffer = priv->buffer;
+	  vectors[0].size = priv->pos;
+	  vectors[1].buffer = buffer;
+	  vectors[1].size = count;
+
+	  res = g_output_stream_writev (base_stream, vectors, 2,
+					&bytes_written, cancellable, error);
+	  if (res == FALSE)
+	    return -1;
+
+	  priv->stats.base_calls++;
+	  priv->stats.bytes += bytes_written;
+
+	  /* Looping would not get anywhere, and returning 0 would look
+	   * as if there was nothing to write.
+	   */
+	  if (bytes_written == 0)
+	    {
+	      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				   _("Writev returned zero without error"));
+	      return -1;
+	    }
+
+	  flushed = MIN (bytes_written, priv->pos);
+	  if (flushed < priv->pos)
+	    g_memmove (priv->buffer, priv->buffer + flushed, priv->pos - flushed);
+	  priv->pos -= flushed;
+	  bytes_written -= flushed;
+	}
+      while (priv->pos > 0);
+
+      /* Small writes filling up the buffer are what it is there for;
+       * large ones go past it anyway.
+       */
+      if (buffered > 0)
+	buffer_flushed (bstream, buffered - priv->pos, count < priv->len);
+
+      if (bytes_written > 0)
+	return bytes_written;
     }
 
+  prepare_buffer (bstream);
+
   n = priv->len - priv->pos;
   
   count = MIN (count, n);
@@ -673,6 +921,9 @@ g_buffered_output_stream_write_finish (GOutputStream        *stream,
 
   wdata = g_simple_async_result_get_op_res_gpointer (simple);
 
+  priv->stats.calls++;
+  prepare_buffer (buffered_stream);
+
   /* Now do the real copying of data to the buffer */
   count = priv->len - priv->pos; 
   count = MIN (wdata->count, count);
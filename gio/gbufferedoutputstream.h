@@ -76,6 +76,11 @@ void           g_buffered_output_stream_set_buffer_size (GBufferedOutputStream *
 gboolean       g_buffered_output_stream_get_auto_grow   (GBufferedOutputStream *stream);
 void           g_buffered_output_stream_set_auto_grow   (GBufferedOutputStream *stream,
 							 gboolean               auto_grow);
+gboolean       g_buffered_output_stream_get_adaptive    (GBufferedOutputStream *stream);
+void           g_buffered_output_stream_set_adaptive    (GBufferedOutputStream *stream,
+							 gboolean               adaptive);
+void           g_buffered_output_stream_get_stats       (GBufferedOutputStream *stream,
+							 GBufferedStreamStats  *stats);
 
 G_END_DECLS
 
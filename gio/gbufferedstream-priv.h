@@ -0,0 +1,64 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_BUFFERED_STREAM_PRIV_H__
+#define __G_BUFFERED_STREAM_PRIV_H__
+
+#include "giotypes.h"
+
+G_BEGIN_DECLS
+
+/* Bounds of the adaptive buffer size, and the number of seconds
+ * without fills or writes after which an adaptive buffer returns to
+ * the default size.
+ */
+#define ADAPTIVE_MIN_SIZE   1024
+#define ADAPTIVE_MAX_SIZE   (256 * 1024)
+#define ADAPTIVE_IDLE_TIME  5
+
+/* Adaptive sizing state shared by GBufferedInputStream and
+ * GBufferedOutputStream. "Transfers" are fills of an input buffer
+ * and flushes of an output buffer.
+ */
+typedef struct {
+  guint   enabled : 1;
+  guint   pending : 1;    /* a transfer happened since the last resize */
+  guint   saturated : 1;  /* the last transfer used the whole buffer */
+  gsize   average;        /* running average of the transfer sizes */
+  guint64 last_use;       /* g_thread_gettime() of the last use */
+} GBufferedStreamAdaptive;
+
+void     _g_buffered_stream_adaptive_enable    (GBufferedStreamAdaptive *adaptive,
+                                                gboolean                 enabled);
+void     _g_buffered_stream_adaptive_record    (GBufferedStreamAdaptive *adaptive,
+                                                gsize                    transferred,
+                                                gboolean                 saturated);
+gboolean _g_buffered_stream_adaptive_idle      (GBufferedStreamAdaptive *adaptive);
+gsize    _g_buffered_stream_adaptive_next_size (GBufferedStreamAdaptive *adaptive,
+                                                gsize                    len);
+void     _g_buffered_stream_set_adaptive_size  (GObject                 *stream,
+                                                guint8                 **buffer,
+                                                gsize                   *len,
+                                                GBufferedStreamStats    *stats,
+                                                gsize                    size);
+
+G_END_DECLS
+
+#endif /* __G_BUFFERED_STREAM_PRIV_H__ */
@@ -25,6 +25,9 @@
 #include <unistd.h>
 #endif
 #include <fcntl.h>
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
 #include <gioerror.h>
 #ifdef G_OS_WIN32
 #include <io.h>
@@ -45,6 +48,10 @@
  * GCancellable is a thread-safe operation cancellation stack used 
  * throughout GIO to allow for cancellation of synchronous and
  * asynchronous operations.
+ *
+ * Code that needs to react to cancellation can poll the file
+ * descriptor returned by g_cancellable_get_fd(), or register a
+ * callback with g_cancellable_connect().
  */
 
 enum {
@@ -52,13 +59,47 @@ enum {
   LAST_SIGNAL
 };
 
+/* Cancellation state.  CANCELLING covers the window in which
+ * g_cancellable_cancel() has claimed the cancellable but not yet
+ * signalled the fd, so that a concurrent reset can wait it out.
+ */
+enum {
+  STATE_IDLE,
+  STATE_CANCELLING,
+  STATE_CANCELLED
+};
+
+typedef struct
+{
+  int read_fd;
+  int write_fd;  /* same as read_fd for an eventfd */
+} CancelFds;
+
+typedef struct _CancelCallback CancelCallback;
+
+struct _CancelCallback
+{
+  CancelCallback *next;
+  gulong          id;
+  GCancellableCallback callback;  /* NULL once disconnected */
+  gpointer        data;
+  GDestroyNotify  data_destroy_func;
+  guint           running;        /* calls in progress */
+};
+
 struct _GCancellable
 {
   GObject parent_instance;
 
-  guint cancelled : 1;
-  guint allocated_pipe : 1;
-  int cancel_pipe[2];
+  volatile gint state;
+  CancelFds * volatile fds;
+
+  /* Protects the callback list; not held while callbacks run */
+  GStaticMutex callback_lock;
+  CancelCallback *callbacks;
+  gulong last_callback_id;
+  guint running_callbacks;  /* g_cancellable_cancel() calls walking the list */
+  guint dead_callbacks;     /* disconnected meanwhile, left for them to unlink */
 
 #ifdef G_OS_WIN32
   GIOChannel *read_channel;
@@ -70,18 +111,42 @@ static guint signals[LAST_SIGNAL] = { 0 };
 G_DEFINE_TYPE (GCancellable, g_cancellable, G_TYPE_OBJECT);
 
 static GStaticPrivate current_cancellable = G_STATIC_PRIVATE_INIT;
-G_LOCK_DEFINE_STATIC(cancellable);
-  
+
+/* Broadcast whenever a callback returns, so that a disconnect from
+ * another thread can wait for it. The CancelCallback the current thread
+ * is running, if any, lets a callback disconnect itself without waiting.
+ */
+static GCond *callback_cond = NULL;
+static GStaticPrivate running_callback = G_STATIC_PRIVATE_INIT;
+
+static void
+free_callback (CancelCallback *cb)
+{
+  if (cb->data_destroy_func)
+    cb->data_destroy_func (cb->data);
+  g_slice_free (CancelCallback, cb);
+}
+
 static void
 g_cancellable_finalize (GObject *object)
 {
   GCancellable *cancellable = G_CANCELLABLE (object);
+  CancelCallback *cb, *next;
 
-  if (cancellable->cancel_pipe[0] != -1)
-    close (cancellable->cancel_pipe[0]);
-  
-  if (cancellable->cancel_pipe[1] != -1)
-    close (cancellable->cancel_pipe[1]);
+  if (cancellable->fds)
+    {
+      close (cancellable->fds->read_fd);
+      if (cancellable->fds->write_fd != cancellable->fds->read_fd)
+	close (cancellable->fds->write_fd);
+      g_slice_free (CancelFds, cancellable->fds);
+    }
+
+  for (cb = cancellable->callbacks; cb != NULL; cb = next)
+    {
+      next = cb->next;
+      free_callback (cb);
+    }
+  g_static_mutex_free (&cancellable->callback_lock);
 
 #ifdef G_OS_WIN32
   if (cancellable->read_channel)
@@ -98,6 +163,9 @@ g_cancellable_class_init (GCancellableClass *klass)
   
   gobject_class->finalize = g_cancellable_finalize;
 
+  if (g_thread_supported ())
+    callback_cond = g_cond_new ();
+
   /**
    * GCancellable::cancelled:
    * @cancellable: a #GCancellable.
@@ -190,25 +258,89 @@ set_fd_nonblocking (int fd)
 }
 
 static void
-g_cancellable_open_pipe (GCancellable *cancellable)
+g_cancellable_signal_fd (CancelFds *fds)
 {
-  if (pipe (cancellable->cancel_pipe) == 0)
+#ifdef HAVE_EVENTFD
+  if (fds->read_fd == fds->write_fd)
     {
-      /* Make them nonblocking, just to be sure we don't block
-       * on errors and stuff
-       */
-      set_fd_nonblocking (cancellable->cancel_pipe[0]);
-      set_fd_nonblocking (cancellable->cancel_pipe[1]);
+      guint64 one = 1;
+      write (fds->write_fd, &one, sizeof (one));
+      return;
+    }
+#endif
+  {
+    char ch = 'x';
+    write (fds->write_fd, &ch, 1);
+  }
+}
+
+static void
+g_cancellable_drain_fd (CancelFds *fds)
+{
+#ifdef HAVE_EVENTFD
+  if (fds->read_fd == fds->write_fd)
+    {
+      guint64 count;
+      read (fds->read_fd, &count, sizeof (count));
+      return;
+    }
+#endif
+  {
+    char buf[16];
+#ifdef G_OS_WIN32
+    read (fds->read_fd, buf, 1);
+#else
+    /* The fd may have been signalled twice if it was created while
+     * the cancellable was being cancelled, so read until it is empty.
+     */
+    while (read (fds->read_fd, buf, sizeof (buf)) > 0)
+      ;
+#endif
+  }
+}
+
+static CancelFds *
+g_cancellable_open_fds (void)
+{
+  CancelFds *fds;
+  int pipe_fds[2];
+
+#ifdef HAVE_EVENTFD
+  {
+    int fd;
+
+    fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd != -1)
+      {
+	fds = g_slice_new (CancelFds);
+	fds->read_fd = fds->write_fd = fd;
+	return fds;
+      }
+  }
+#endif
+
+  if (pipe (pipe_fds) != 0)
+    {
+      g_warning ("Failed to create pipe for GCancellable. Out of file descriptors?");
+      return NULL;
     }
-  else
-    g_warning ("Failed to create pipe for GCancellable. Out of file descriptors?");
+
+  /* Make them nonblocking, just to be sure we don't block
+   * on errors and stuff
+   */
+  set_fd_nonblocking (pipe_fds[0]);
+  set_fd_nonblocking (pipe_fds[1]);
+
+  fds = g_slice_new (CancelFds);
+  fds->read_fd = pipe_fds[0];
+  fds->write_fd = pipe_fds[1];
+  return fds;
 }
 
 static void
 g_cancellable_init (GCancellable *cancellable)
 {
-  cancellable->cancel_pipe[0] = -1;
-  cancellable->cancel_pipe[1] = -1;
+  g_static_mutex_init (&cancellable->callback_lock);
 }
 
 /**
@@ -231,6 +363,12 @@ g_cancellable_new (void)
   return g_object_new (G_TYPE_CANCELLABLE, NULL);
 }
 
+static void
+free_cancellable_stack (gpointer data)
+{
+  g_ptr_array_free (data, TRUE);
+}
+
 /**
  * g_cancellable_push_current:
  * @cancellable: optional #GCancellable object, %NULL to ignore.
@@ -247,13 +385,18 @@ g_cancellable_new (void)
 void
 g_cancellable_push_current (GCancellable *cancellable)
 {
-  GSList *l;
+  GPtrArray *stack;
 
   g_return_if_fail (cancellable != NULL);
-  
-  l = g_static_private_get (&current_cancellable);
-  l = g_slist_prepend (l, cancellable);
-  g_static_private_set (&current_cancellable, l, NULL);
+
+  stack = g_static_private_get (&current_cancellable);
+  if (stack == NULL)
+    {
+      stack = g_ptr_array_new ();
+      g_static_private_set (&current_cancellable, stack,
+			    free_cancellable_stack);
+    }
+  g_ptr_array_add (stack, cancellable);
 }
 
 /**
@@ -266,15 +409,14 @@ g_cancellable_push_current (GCancellable *cancellable)
 void
 g_cancellable_pop_current (GCancellable *cancellable)
 {
-  GSList *l;
-  
-  l = g_static_private_get (&current_cancellable);
-  
-  g_return_if_fail (l != NULL);
-  g_return_if_fail (l->data == cancellable);
+  GPtrArray *stack;
+
+  stack = g_static_private_get (&current_cancellable);
+
+  g_return_if_fail (stack != NULL && stack->len > 0);
+  g_return_if_fail (g_ptr_array_index (stack, stack->len - 1) == cancellable);
 
-  l = g_slist_delete_link (l, l);
-  g_static_private_set (&current_cancellable, l, NULL);
+  g_ptr_array_remove_index (stack, stack->len - 1);
 }
 
 /**
@@ -288,13 +430,13 @@ g_cancellable_pop_current (GCancellable *cancellable)
 GCancellable *
 g_cancellable_get_current  (void)
 {
-  GSList *l;
-  
-  l = g_static_private_get (&current_cancellable);
-  if (l == NULL)
+  GPtrArray *stack;
+
+  stack = g_static_private_get (&current_cancellable);
+  if (stack == NULL || stack->len == 0)
     return NULL;
 
-  return G_CANCELLABLE (l->data);
+  return G_CANCELLABLE (g_ptr_array_index (stack, stack->len - 1));
 }
 
 /**
@@ -302,31 +444,42 @@ g_cancellable_get_current  (void)
  * @cancellable: a #GCancellable object.
  * 
  * Resets @cancellable to its uncancelled state. 
+ *
+ * If @cancellable is currently in use by any cancellable operation
+ * then the behavior of this function is undefined.
  **/
 void 
 g_cancellable_reset (GCancellable *cancellable)
 {
+  CancelFds *fds;
+
   g_return_if_fail (G_IS_CANCELLABLE (cancellable));
 
-  G_LOCK(cancellable);
-  /* Make sure we're not leaving old cancel state around */
-  if (cancellable->cancelled)
+  /* Wait out a cancel that is still signalling the fd, so we don't
+   * leave old cancel state around.
+   */
+  while (!g_atomic_int_compare_and_exchange (&cancellable->state,
+					     STATE_CANCELLED, STATE_IDLE))
     {
-      char ch;
+      if (g_atomic_int_get (&cancellable->state) == STATE_IDLE)
+	return;
+      g_thread_yield ();
+    }
+
 #ifdef G_OS_WIN32
-      if (cancellable->read_channel)
-	{
-	  gsize bytes_read;
-	  g_io_channel_read_chars (cancellable->read_channel, &ch, 1,
-				   &bytes_read, NULL);
-	}
-      else
-#endif
-      if (cancellable->cancel_pipe[0] != -1)
-	read (cancellable->cancel_pipe[0], &ch, 1);
-      cancellable->cancelled = FALSE;
+  if (cancellable->read_channel)
+    {
+      char ch;
+      gsize bytes_read;
+      g_io_channel_read_chars (cancellable->read_channel, &ch, 1,
+			       &bytes_read, NULL);
+      return;
     }
-  G_UNLOCK(cancellable);
+#endif
+
+  fds = g_atomic_pointer_get (&cancellable->fds);
+  if (fds != NULL)
+    g_cancellable_drain_fd (fds);
 }
 
 /**
@@ -341,7 +494,8 @@ g_cancellable_reset (GCancellable *cancellable)
 gboolean
 g_cancellable_is_cancelled (GCancellable *cancellable)
 {
-  return cancellable != NULL && cancellable->cancelled;
+  return cancellable != NULL &&
+    g_atomic_int_get (&cancellable->state) != STATE_IDLE;
 }
 
 /**
@@ -378,6 +532,10 @@ g_cancellable_set_error_if_cancelled (GCancellable  *cancellable,
  * implement cancellable operations on Unix systems. The returned fd will
  * turn readable when @cancellable is cancelled.
  *
+ * The file descriptor is created the first time this is called; where
+ * available it is an eventfd rather than a pipe. Cancellables whose fd
+ * is never asked for don't use any file descriptors.
+ *
  * See also g_cancellable_make_pollfd().
  *
  * Returns: A valid file descriptor. %-1 if the file descriptor 
@@ -386,23 +544,40 @@ g_cancellable_set_error_if_cancelled (GCancellable  *cancellable,
 int
 g_cancellable_get_fd (GCancellable *cancellable)
 {
-  int fd;
+  CancelFds *fds;
+
   if (cancellable == NULL)
     return -1;
-  
-  G_LOCK(cancellable);
-  if (!cancellable->allocated_pipe)
+
+  fds = g_atomic_pointer_get (&cancellable->fds);
+  if (fds == NULL)
     {
-      cancellable->allocated_pipe = TRUE;
-      g_cancellable_open_pipe (cancellable);
+      fds = g_cancellable_open_fds ();
+      if (fds == NULL)
+	return -1;
+
+      if (!g_atomic_pointer_compare_and_exchange ((gpointer *) &cancellable->fds,
+						  NULL, fds))
+	{
+	  /* Another thread got there first */
+	  close (fds->read_fd);
+	  if (fds->write_fd != fds->read_fd)
+	    close (fds->write_fd);
+	  g_slice_free (CancelFds, fds);
+	  fds = g_atomic_pointer_get (&cancellable->fds);
+	}
+      else if (g_atomic_int_get (&cancellable->state) != STATE_IDLE)
+	{
+	  /* A cancel that ran before the fd existed could not signal it.
+	   * If the cancel did see the fd, this signals it a second time,
+	   * which g_cancellable_drain_fd() copes with.
+	   */
+	  g_cancellable_signal_fd (fds);
+	}
     }
-  
-  fd = cancellable->cancel_pipe[0];
-  G_UNLOCK(cancellable);
-  
-  return fd;
-}
 
+  return fds->read_fd;
+}
 /**
  * g_cancellable_make_pollfd:
  * @cancellable: a #GCancellable.
@@ -442,10 +617,10 @@ g_cancellable_make_pollfd (GCancellable *cancellable, GPollFD *pollfd)
  * g_cancellable_cancel:
  * @cancellable: a #GCancellable object.
  * 
- * Will set @cancellable to cancelled, and will emit the
- * #GCancellable::cancelled signal. (However, see the warning about
- * race conditions in the documentation for that signal if you are
- * planning to connect to it.)
+ * Will set @cancellable to cancelled, run the callbacks added with
+ * g_cancellable_connect() and emit the #GCancellable::cancelled
+ * signal. (However, see the warning about race conditions in the
+ * documentation for that signal if you are planning to connect to it.)
  *
  * This function is thread-safe. In other words, you can safely call
  * it from a thread other than the one running the operation that was
@@ -460,28 +635,232 @@ g_cancellable_make_pollfd (GCancellable *cancellable, GPollFD *pollfd)
 void
 g_cancellable_cancel (GCancellable *cancellable)
 {
-  gboolean cancel;
+  CancelFds *fds;
+  CancelCallback *cb, *dead, **prev, *outer;
+  GCancellableCallback callback;
 
-  cancel = FALSE;
-  
-  G_LOCK(cancellable);
-  if (cancellable != NULL &&
-      !cancellable->cancelled)
+  if (cancellable == NULL ||
+      !g_atomic_int_compare_and_exchange (&cancellable->state,
+					  STATE_IDLE, STATE_CANCELLING))
+    return;
+
+  fds = g_atomic_pointer_get (&cancellable->fds);
+  if (fds != NULL)
+    g_cancellable_signal_fd (fds);
+  g_atomic_int_set (&cancellable->state, STATE_CANCELLED);
+
+  g_object_ref (cancellable);
+
+  dead = NULL;
+  g_static_mutex_lock (&cancellable->callback_lock);
+  if (cancellable->callbacks != NULL)
     {
-      char ch = 'x';
-      cancel = TRUE;
-      cancellable->cancelled = TRUE;
-      if (cancellable->cancel_pipe[1] != -1)
-	write (cancellable->cancel_pipe[1], &ch, 1);
+      /* Nodes are not unlinked while running_callbacks is set, so the
+       * list can be walked with the lock dropped around each call.
+       */
+      cancellable->running_callbacks++;
+      for (cb = cancellable->callbacks; cb != NULL; cb = cb->next)
+	{
+	  callback = cb->callback;
+	  if (callback == NULL)
+	    continue;
+
+	  cb->running++;
+	  g_static_mutex_unlock (&cancellable->callback_lock);
+
+	  outer = g_static_private_get (&running_callback);
+	  g_static_private_set (&running_callback, cb, NULL);
+	  callback (cancellable, cb->data);
+	  g_static_private_set (&running_callback, outer, NULL);
+
+	  g_static_mutex_lock (&cancellable->callback_lock);
+	  cb->running--;
+	  if (callback_cond)
+	    g_cond_broadcast (callback_cond);
+	}
+      cancellable->running_callbacks--;
+
+      /* Unlink callbacks that were disconnected while running */
+      if (cancellable->running_callbacks == 0 &&
+	  cancellable->dead_callbacks > 0)
+	{
+	  prev = &cancellable->callbacks;
+	  while ((cb = *prev) != NULL)
+	    {
+	      if (cb->callback == NULL)
+		{
+		  *prev = cb->next;
+		  cb->next = dead;
+		  dead = cb;
+		}
+	      else
+		prev = &cb->next;
+	    }
+	  cancellable->dead_callbacks = 0;
+	}
     }
-  G_UNLOCK(cancellable);
+  g_static_mutex_unlock (&cancellable->callback_lock);
 
-  if (cancel)
+  while (dead != NULL)
     {
-      g_object_ref (cancellable);
-      g_signal_emit (cancellable, signals[CANCELLED], 0);
-      g_object_unref (cancellable);
+      cb = dead;
+      dead = cb->next;
+      free_callback (cb);
     }
+
+  /* Emitting a signal nobody listens to is comparatively expensive */
+  if (G_CANCELLABLE_GET_CLASS (cancellable)->cancelled != NULL ||
+      g_signal_has_handler_pending (cancellable, signals[CANCELLED], 0, TRUE))
+    g_signal_emit (cancellable, signals[CANCELLED], 0);
+
+  g_object_unref (cancellable);
+}
+
+/**
+ * g_cancellable_connect:
+ * @cancellable: a #GCancellable.
+ * @callback: the function to call when @cancellable is cancelled.
+ * @data: data to pass to @callback.
+ * @data_destroy_func: free function for @data or %NULL.
+ *
+ * Arranges for @callback to be called when @cancellable is cancelled,
+ * from the thread that calls g_cancellable_cancel(). This is cheaper
+ * than connecting to the #GCancellable::cancelled signal and, unlike
+ * the signal, does not race with disconnection: once
+ * g_cancellable_disconnect() returns, @callback is not running and
+ * will not be called again.
+ *
+ * If @cancellable is already cancelled, @callback is called
+ * immediately and 0 is returned; @data_destroy_func (if given) is
+ * called right after it.
+ *
+ * @callback is called without any lock held, and may call
+ * g_cancellable_disconnect() on itself or on other callbacks connected
+ * to @cancellable.
+ *
+ * Returns: the id of the connected callback for
+ * g_cancellable_disconnect(), or 0 if @cancellable was already
+ * cancelled.
+ *
+ * Since: 2.22
+ **/
+gulong
+g_cancellable_connect (GCancellable         *cancellable,
+		       GCancellableCallback  callback,
+		       gpointer              data,
+		       GDestroyNotify        data_destroy_func)
+{
+  CancelCallback *cb, **last;
+  gulong id;
+
+  g_return_val_if_fail (G_IS_CANCELLABLE (cancellable), 0);
+  g_return_val_if_fail (callback != NULL, 0);
+
+  g_static_mutex_lock (&cancellable->callback_lock);
+
+  /* Checked under the lock, so that a concurrent cancel either sees
+   * the callback in the list or we see the cancellable as cancelled.
+   */
+  if (g_atomic_int_get (&cancellable->state) != STATE_IDLE)
+    {
+      g_static_mutex_unlock (&cancellable->callback_lock);
+
+      callback (cancellable, data);
+      if (data_destroy_func)
+	data_destroy_func (data);
+      return 0;
+    }
+
+  cb = g_slice_new (CancelCallback);
+  cb->next = NULL;
+  cb->id = id = ++cancellable->last_callback_id;
+  cb->callback = callback;
+  cb->data = data;
+  cb->data_destroy_func = data_destroy_func;
+  cb->running = 0;
+
+  /* Callbacks run in the order they were connected */
+  for (last = &cancellable->callbacks; *last != NULL; last = &(*last)->next)
+    ;
+  *last = cb;
+
+  g_static_mutex_unlock (&cancellable->callback_lock);
+
+  return id;
+}
+
+/**
+ * g_cancellable_disconnect:
+ * @cancellable: a #GCancellable or %NULL.
+ * @handler_id: the id returned by g_cancellable_connect(), or 0.
+ *
+ * Disconnects a callback added with g_cancellable_connect() and calls
+ * its @data_destroy_func.
+ *
+ * If g_cancellable_cancel() is running this callback in another
+ * thread, this blocks until the callback returns, so after this
+ * returns the callback is guaranteed not to be running. It does not
+ * wait for the other callbacks, and does not block when called from
+ * the callback itself.
+ *
+ * If @cancellable is %NULL or @handler_id is 0 this does nothing.
+ *
+ * Since: 2.22
+ **/
+void
+g_cancellable_disconnect (GCancellable *cancellable,
+			  gulong        handler_id)
+{
+  CancelCallback *cb, **prev;
+  GDestroyNotify destroy;
+
+  if (cancellable == NULL || handler_id == 0)
+    return;
+
+  g_return_if_fail (G_IS_CANCELLABLE (cancellable));
+
+  g_static_mutex_lock (&cancellable->callback_lock);
+
+  for (prev = &cancellable->callbacks; (cb = *prev) != NULL; prev = &cb->next)
+    if (cb->id == handler_id && cb->callback != NULL)
+      break;
+
+  if (cb == NULL)
+    {
+      g_static_mutex_unlock (&cancellable->callback_lock);
+      g_warning ("%s: invalid handler id %lu for cancellable %p",
+		 G_STRLOC, handler_id, cancellable);
+      return;
+    }
+
+  /* Wait if another thread is running this callback. The node stays
+   * in the list meanwhile, as only disconnected nodes get unlinked.
+   */
+  while (cb->running > 0 && callback_cond != NULL &&
+	 g_static_private_get (&running_callback) != cb)
+    g_cond_wait (callback_cond,
+		 g_static_mutex_get_mutex (&cancellable->callback_lock));
+
+  if (cancellable->running_callbacks > 0)
+    {
+      /* g_cancellable_cancel() is walking the list, so leave the node
+       * for it to unlink.
+       */
+      cb->callback = NULL;
+      cancellable->dead_callbacks++;
+      destroy = cb->data_destroy_func;
+      cb->data_destroy_func = NULL;
+      g_static_mutex_unlock (&cancellable->callback_lock);
+
+      if (destroy)
+	destroy (cb->data);
+      return;
+    }
+
+  *prev = cb->next;
+  g_static_mutex_unlock (&cancellable->callback_lock);
+
+  free_callback (cb);
 }
 
 #define __G_CANCELLABLE_C__
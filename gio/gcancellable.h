@@ -60,6 +60,18 @@ struct _GCancellableClass
   void (*_g_reserved5) (void);
 };
 
+/**
+ * GCancellableCallback:
+ * @cancellable: the #GCancellable that was cancelled.
+ * @data: the data passed to g_cancellable_connect().
+ *
+ * The type of callbacks added with g_cancellable_connect().
+ *
+ * Since: 2.22
+ */
+typedef void (*GCancellableCallback) (GCancellable *cancellable,
+				      gpointer      data);
+
 GType         g_cancellable_get_type               (void) G_GNUC_CONST;
 
 GCancellable *g_cancellable_new                    (void);
@@ -82,6 +94,13 @@ void          g_cancellable_reset                  (GCancellable  *cancellable);
 /* This is safe to call from another thread */
 void          g_cancellable_cancel       (GCancellable  *cancellable);
 
+gulong        g_cancellable_connect                (GCancellable         *cancellable,
+						    GCancellableCallback  callback,
+						    gpointer              data,
+						    GDestroyNotify        data_destroy_func);
+void          g_cancellable_disconnect             (GCancellable         *cancellable,
+						    gulong                handler_id);
+
 G_END_DECLS
 
 #endif /* __G_CANCELLABLE_H__ */
@@ -24,12 +24,16 @@
 
 #include "config.h"
 #include "gdatainputstream.h"
+#include "gdatastream-priv.h"
+#include "gasyncresult.h"
 #include "gsimpleasyncresult.h"
 #include "gcancellable.h"
 #include "gioenumtypes.h"
 #include "gioerror.h"
 #include "glibintl.h"
 
+#include <string.h>
+
 #include "gioalias.h"
 
 /**
@@ -630,6 +634,347 @@ g_data_input_stream_read_uint64 (GDataInputStream  *stream,
   return 0;
 }
 
+/* Shared with GDataOutputStream */
+gboolean
+_g_data_stream_byte_order_needs_swap (GDataStreamByteOrder byte_order)
+{
+  switch (byte_order)
+    {
+    case G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN:
+      return G_BYTE_ORDER != G_BIG_ENDIAN;
+    case G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN:
+      return G_BYTE_ORDER != G_LITTLE_ENDIAN;
+    case G_DATA_STREAM_BYTE_ORDER_HOST_ENDIAN:
+    default:
+      return FALSE;
+    }
+}
+
+/* Unlike read_data(), this is not limited to the size of the buffer;
+ * large reads go straight to the base stream.
+ */
+static gboolean
+read_bulk (GDataInputStream  *stream,
+           void              *buffer,
+           gsize              size,
+           GCancellable      *cancellable,
+           GError           **error)
+{
+  gsize bytes_read;
+
+  if (!g_input_stream_read_all (G_INPUT_STREAM (stream),
+                                buffer, size, &bytes_read,
+                                cancellable, error))
+    return FALSE;
+
+  if (bytes_read != size)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                           _("Unexpected early end-of-stream"));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+read_array (GDataInputStream  *stream,
+            void              *data,
+            gsize              element_size,
+            gsize              n_elements,
+            GCancellable      *cancellable,
+            GError           **error)
+{
+  gsize i;
+
+  g_return_val_if_fail (n_elements <= G_MAXSIZE / element_size, FALSE);
+
+  if (!read_bulk (stream, data, n_elements * element_size, cancellable, error))
+    return FALSE;
+
+  if (_g_data_stream_byte_order_needs_swap (stream->priv->byte_order))
+    {
+      switch (element_size)
+        {
+        case 2:
+          {
+            guint16 *v = data;
+            for (i = 0; i < n_elements; i++)
+              v[i] = GUINT16_SWAP_LE_BE (v[i]);
+          }
+          break;
+        case 4:
+          {
+            guint32 *v = data;
+            for (i = 0; i < n_elements; i++)
+              v[i] = GUINT32_SWAP_LE_BE (v[i]);
+          }
+          break;
+        case 8:
+          {
+            guint64 *v = data;
+            for (i = 0; i < n_elements; i++)
+              v[i] = GUINT64_SWAP_LE_BE (v[i]);
+          }
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  return TRUE;
+}
+
+/**
+ * g_data_input_stream_read_int16_array:
+ * @stream: a given #GDataInputStream.
+ * @data: an array of at least @n_elements 16-bit integers.
+ * @n_elements: the number of integers to read.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads @n_elements 16-bit integers from @stream into @data, converting
+ * them from the byte order set with g_data_input_stream_set_byte_order().
+ * This is the same as calling g_data_input_stream_read_int16() @n_elements
+ * times, but the data is read with a single operation on the stream.
+ * It can also be used for unsigned integers.
+ *
+ * If the end of the stream is reached before @n_elements integers have
+ * been read, %G_IO_ERROR_FAILED is returned. On error, the contents of
+ * @data are undefined.
+ *
+ * If @cancellable is not %NULL, then the operation can be cancelled by
+ * triggering the cancellable object from another thread. If the operation
+ * was cancelled, the error %G_IO_ERROR_CANCELLED will be returned.
+ *
+ * Returns: %TRUE on success, %FALSE if there was an error.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_input_stream_read_int16_array (GDataInputStream  *stream,
+                                      gint16            *data,
+                                      gsize              n_elements,
+                                      GCancellable      *cancellable,
+                                      GError           **error)
+{
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return read_array (stream, data, 2, n_elements, cancellable, error);
+}
+
+/**
+ * g_data_input_stream_read_int32_array:
+ * @stream: a given #GDataInputStream.
+ * @data: an array of at least @n_elements 32-bit integers.
+ * @n_elements: the number of integers to read.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads @n_elements 32-bit integers from @stream into @data. See
+ * g_data_input_stream_read_int16_array() for details.
+ *
+ * Returns: %TRUE on success, %FALSE if there was an error.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_input_stream_read_int32_array (GDataInputStream  *stream,
+                                      gint32            *data,
+                                      gsize              n_elements,
+                                      GCancellable      *cancellable,
+                                      GError           **error)
+{
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return read_array (stream, data, 4, n_elements, cancellable, error);
+}
+
+/**
+ * g_data_input_stream_read_int64_array:
+ * @stream: a given #GDataInputStream.
+ * @data: an array of at least @n_elements 64-bit integers.
+ * @n_elements: the number of integers to read.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads @n_elements 64-bit integers from @stream into @data. See
+ * g_data_input_stream_read_int16_array() for details.
+ *
+ * Returns: %TRUE on success, %FALSE if there was an error.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_input_stream_read_int64_array (GDataInputStream  *stream,
+                                      gint64            *data,
+                                      gsize              n_elements,
+                                      GCancellable      *cancellable,
+                                      GError           **error)
+{
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return read_array (stream, data, 8, n_elements, cancellable, error);
+}
+
+/* Shared with GDataOutputStream */
+gsize
+_g_data_stream_field_size (GDataStreamFieldType type)
+{
+  switch (type)
+    {
+    case G_DATA_STREAM_FIELD_BYTE:
+      return 1;
+    case G_DATA_STREAM_FIELD_INT16:
+      return 2;
+    case G_DATA_STREAM_FIELD_INT32:
+      return 4;
+    case G_DATA_STREAM_FIELD_INT64:
+      return 8;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * g_data_input_stream_read_struct:
+ * @stream: a given #GDataInputStream.
+ * @fields: an array of #GDataStreamField describing the record.
+ * @n_fields: the length of @fields.
+ * @data: the structure to store the fields in.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads a record made of the fields described by @fields from @stream,
+ * and stores each field at its offset in @data, converting integers from
+ * the byte order set with g_data_input_stream_set_byte_order().
+ *
+ * The whole record is read with a single operation on the stream, so
+ * this is cheaper than reading each field separately.
+ * For example:
+ * |[
+ * typedef struct { guint32 magic; guint16 version; guint64 size; } Header;
+ *
+ * static const GDataStreamField header_fields[] = {
+ *   { G_DATA_STREAM_FIELD_INT32, G_STRUCT_OFFSET (Header, magic) },
+ *   { G_DATA_STREAM_FIELD_INT16, G_STRUCT_OFFSET (Header, version) },
+ *   { G_DATA_STREAM_FIELD_INT64, G_STRUCT_OFFSET (Header, size) }
+ * };
+ *
+ * Header header;
+ *
+ * if (!g_data_input_stream_read_struct (stream, header_fields,
+ *                                       G_N_ELEMENTS (header_fields),
+ *                                       &header, NULL, &error))
+ *   ...
+ * ]|
+ *
+ * If the end of the stream is reached before the whole record has been
+ * read, %G_IO_ERROR_FAILED is returned. On error, the contents of @data
+ * are undefined.
+ *
+ * Returns: %TRUE on success, %FALSE if there was an error.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_input_stream_read_struct (GDataInputStream        *stream,
+                                 const GDataStreamField  *fields,
+                                 guint                    n_fields,
+                                 gpointer                 data,
+                                 GCancellable            *cancellable,
+                                 GError                 **error)
+{
+  guchar stack_buffer[256];
+  guchar *buffer, *p, *dest;
+  gboolean swap, res;
+  gsize size, n;
+  guint i;
+
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (fields != NULL || n_fields == 0, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  size = 0;
+  for (i = 0; i < n_fields; i++)
+    {
+      n = _g_data_stream_field_size (fields[i].type);
+      g_return_val_if_fail (n != 0, FALSE);
+      size += n;
+    }
+
+  if (size <= sizeof (stack_buffer))
+    buffer = stack_buffer;
+  else
+    buffer = g_malloc (size);
+
+  res = read_bulk (stream, buffer, size, cancellable, error);
+  if (res)
+    {
+      swap = _g_data_stream_byte_order_needs_swap (stream->priv->byte_order);
+      p = buffer;
+
+      /* memcpy() since neither the buffer nor a packed
+       * structure need to be aligned for the field type
+       */
+      for (i = 0; i < n_fields; i++)
+        {
+          dest = (guchar *)data + fields[i].offset;
+          switch (fields[i].type)
+            {
+            case G_DATA_STREAM_FIELD_BYTE:
+              *dest = *p;
+              p += 1;
+              break;
+            case G_DATA_STREAM_FIELD_INT16:
+              {
+                guint16 v;
+                memcpy (&v, p, 2);
+                if (swap)
+                  v = GUINT16_SWAP_LE_BE (v);
+                memcpy (dest, &v, 2);
+                p += 2;
+              }
+              break;
+            case G_DATA_STREAM_FIELD_INT32:
+              {
+                guint32 v;
+                memcpy (&v, p, 4);
+                if (swap)
+                  v = GUINT32_SWAP_LE_BE (v);
+                memcpy (dest, &v, 4);
+                p += 4;
+              }
+              break;
+            case G_DATA_STREAM_FIELD_INT64:
+              {
+                guint64 v;
+                memcpy (&v, p, 8);
+                if (swap)
+                  v = GUINT64_SWAP_LE_BE (v);
+                memcpy (dest, &v, 8);
+                p += 8;
+              }
+              break;
+            }
+        }
+    }
+
+  if (buffer != stack_buffer)
+    g_free (buffer);
+
+  return res;
+}
+
+/* Scans the buffered data from *checked_out onwards for a newline,
+ * using memchr() to skip over the bytes in between. The bytes before
+ * *checked_out have been looked at by a previous call and are still
+ * in the buffer; *last_saw_cr_out is set when the last of them was a
+ * CR that may turn out to be the start of a CR LF pair.
+ */
 static gssize
 scan_for_newline (GDataInputStream *stream,
 		  gsize            *checked_out,
@@ -638,11 +983,7 @@ scan_for_newline (GDataInputStream *stream,
 {
   GBufferedInputStream *bstream;
   GDataInputStreamPrivate *priv;
-  const char *buffer;
-  gsize start, end, peeked;
-  int i;
-  gssize found_pos;
-  int newline_len;
+  const char *buffer, *lf, *cr;
   gsize available, checked;
   gboolean last_saw_cr;
 
@@ -652,82 +993,211 @@ scan_for_newline (GDataInputStream *stream,
 
   checked = *checked_out;
   last_saw_cr = *last_saw_cr_out;
-  found_pos = -1;
-  newline_len = 0;
   
-  start = checked;
-  buffer = (const char*)g_buffered_input_stream_peek_buffer (bstream, &available) + start;
-  end = available;
-  peeked = end - start;
+  buffer = (const char*)g_buffered_input_stream_peek_buffer (bstream, &available);
 
-  for (i = 0; checked < available && i < peeked; i++)
+  if (checked < available)
     {
       switch (priv->newline_type)
 	{
 	case G_DATA_STREAM_NEWLINE_TYPE_LF:
-	  if (buffer[i] == 10)
+	  lf = memchr (buffer + checked, 10, available - checked);
+	  if (lf)
 	    {
-	      found_pos = start + i;
-	      newline_len = 1;
+	      *newline_len_out = 1;
+	      return lf - buffer;
 	    }
 	  break;
+
 	case G_DATA_STREAM_NEWLINE_TYPE_CR:
-	  if (buffer[i] == 13)
+	  cr = memchr (buffer + checked, 13, available - checked);
+	  if (cr)
 	    {
-	      found_pos = start + i;
-	      newline_len = 1;
+	      *newline_len_out = 1;
+	      return cr - buffer;
 	    }
 	  break;
+
 	case G_DATA_STREAM_NEWLINE_TYPE_CR_LF:
-	  if (last_saw_cr && buffer[i] == 10)
+	  lf = buffer + checked;
+	  while ((lf = memchr (lf, 10, available - (lf - buffer))) != NULL)
 	    {
-	      found_pos = start + i - 1;
-	      newline_len = 2;
+	      if (lf > buffer && lf[-1] == 13)
+		{
+		  *newline_len_out = 2;
+		  return lf - buffer - 1;
+		}
+	      lf++;
 	    }
 	  break;
+
 	default:
 	case G_DATA_STREAM_NEWLINE_TYPE_ANY:
-	  if (buffer[i] == 10) /* LF */
+	  if (last_saw_cr)
 	    {
-	      if (last_saw_cr)
-		{
-		  /* CR LF */
-		  found_pos = start + i - 1;
-		  newline_len = 2;
-		}
-	      else
+	      /* CR at the end of the previous scan, either CR or CR LF */
+	      *newline_len_out = buffer[checked] == 10 ? 2 : 1;
+	      return checked - 1;
+	    }
+
+	  /* find the first of LF and CR; never looks for a CR further
+	   * than the first LF, so each byte is still only looked at once
+	   */
+	  lf = memchr (buffer + checked, 10, available - checked);
+	  cr = memchr (buffer + checked, 13, (lf ? lf : buffer + available) - (buffer + checked));
+	  if (cr)
+	    {
+	      if (cr + 1 < buffer + available)
 		{
-		  /* LF */
-		  found_pos = start + i;
-		  newline_len = 1;
+		  *newline_len_out = cr[1] == 10 ? 2 : 1;
+		  return cr - buffer;
 		}
+	      /* need to see the next byte to tell CR from CR LF */
+	      last_saw_cr = TRUE;
 	    }
-	  else if (last_saw_cr)
+	  else if (lf)
 	    {
-	      /* Last was cr, this is not LF, end is CR */
-	      found_pos = start + i - 1;
-	      newline_len = 1;
+	      *newline_len_out = 1;
+	      return lf - buffer;
 	    }
-	  /* Don't check for CR here, instead look at last_saw_cr on next byte */
 	  break;
 	}
-	
-      last_saw_cr = (buffer[i] == 13);
+    }
+
+  *checked_out = available;
+  *last_saw_cr_out = last_saw_cr;
+  return -1;
+}
+		  
+
+/* Scans the buffered data from *checked_out onwards for any of
+ * @stop_chars. A single stop char is searched for with memchr(),
+ * otherwise each byte is looked up in a bitmap of the stop chars.
+ */
+static gssize
+scan_for_chars (GDataInputStream *stream,
+		gsize            *checked_out,
+		const char       *stop_chars)
+{
+  GBufferedInputStream *bstream;
+  const guchar *buffer, *found;
+  gsize available, checked, i;
+  guint32 stop_table[256 / 32] = { 0, };
+  const guchar *stop_char;
+
+  bstream = G_BUFFERED_INPUT_STREAM (stream);
+
+  checked = *checked_out;
+  
+  buffer = (const guchar *)g_buffered_input_stream_peek_buffer (bstream, &available);
+
+  if (checked < available && stop_chars[0] != '\0')
+    {
+      if (stop_chars[1] == '\0')
+	{
+	  found = memchr (buffer + checked, stop_chars[0], available - checked);
+	  if (found)
+	    return found - buffer;
+	}
+      else
+	{
+	  for (stop_char = (const guchar *)stop_chars; *stop_char != '\0'; stop_char++)
+	    stop_table[*stop_char >> 5] |= 1u << (*stop_char & 31);
+
+	  for (i = checked; i < available; i++)
+	    if (stop_table[buffer[i] >> 5] & (1u << (buffer[i] & 31)))
+	      return i;
+	}
+    }
+
+  *checked_out = available;
+  return -1;
+}
+
+/* Finds the next record in the buffered data, filling the buffer as
+ * needed, and consumes it including its separator. The returned data
+ * stays in place until the next operation on the stream.
+ */
+static const char *
+read_record (GDataInputStream  *stream,
+	     const gchar       *stop_chars,
+	     gsize             *length,
+	     GCancellable      *cancellable,
+	     GError           **error)
+{
+  GBufferedInputStream *bstream;
+  GBufferedInputStreamClass *class;
+  gsize checked;
+  gboolean last_saw_cr;
+  gssize found_pos;
+  gssize res;
+  int separator_len;
+  const char *record;
+  
+  bstream = G_BUFFERED_INPUT_STREAM (stream);
+  class = G_BUFFERED_INPUT_STREAM_GET_CLASS (bstream);
+
+  if (length)
+    *length = 0;
+
+  /* fails if the stream is closed or has an outstanding operation */
+  if (!g_input_stream_set_pending (G_INPUT_STREAM (stream), error))
+    return NULL;
+
+  record = NULL;
+  separator_len = 0;
+  checked = 0;
+  last_saw_cr = FALSE;
+
+  while (TRUE)
+    {
+      if (stop_chars)
+	{
+	  found_pos = scan_for_chars (stream, &checked, stop_chars);
+	  separator_len = 1;
+	}
+      else
+	found_pos = scan_for_newline (stream, &checked, &last_saw_cr, &separator_len);
 
       if (found_pos != -1)
+	break;
+
+      if (g_buffered_input_stream_get_available (bstream) ==
+	  g_buffered_input_stream_get_buffer_size (bstream))
+	g_buffered_input_stream_set_buffer_size (bstream,
+						 2 * g_buffered_input_stream_get_buffer_size (bstream));
+
+      /* the stream is pending already, so bypass g_buffered_input_stream_fill() */
+      if (cancellable)
+	g_cancellable_push_current (cancellable);
+      res = class->fill (bstream, -1, cancellable, error);
+      if (cancellable)
+	g_cancellable_pop_current (cancellable);
+
+      if (res < 0)
+	goto out;
+      if (res == 0)
 	{
-	  *newline_len_out = newline_len;
-	  return found_pos;
+	  /* End of stream */
+	  if (g_buffered_input_stream_get_available (bstream) == 0)
+	    goto out;
+
+	  found_pos = checked;
+	  separator_len = 0;
+	  break;
 	}
     }
 
-  checked = end;
+  record = g_buffered_input_stream_peek_buffer (bstream, NULL);
+  g_buffered_input_stream_consume (bstream, found_pos + separator_len);
+  if (length)
+    *length = (gsize)found_pos;
 
-  *checked_out = checked;
-  *last_saw_cr_out = last_saw_cr;
-  return -1;
+ out:
+  g_input_stream_clear_pending (G_INPUT_STREAM (stream));
+
+  return record;
 }
-		  
 
 /**
  * g_data_input_stream_read_line:
@@ -753,103 +1223,61 @@ g_data_input_stream_read_line (GDataInputStream  *stream,
 			       GCancellable      *cancellable,
 			       GError           **error)
 {
-  GBufferedInputStream *bstream;
-  gsize checked;
-  gboolean last_saw_cr;
-  gssize found_pos;
-  gssize res;
-  int newline_len;
+  const char *record;
+  gsize record_len;
   char *line;
   
   g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
 
-  bstream = G_BUFFERED_INPUT_STREAM (stream);
-
-  newline_len = 0;
-  checked = 0;
-  last_saw_cr = FALSE;
-
-  while ((found_pos = scan_for_newline (stream, &checked, &last_saw_cr, &newline_len)) == -1)
+  record = read_record (stream, NULL, &record_len, cancellable, error);
+  if (!record)
     {
-      if (g_buffered_input_stream_get_available (bstream) ==
-	  g_buffered_input_stream_get_buffer_size (bstream))
-	g_buffered_input_stream_set_buffer_size (bstream,
-						 2 * g_buffered_input_stream_get_buffer_size (bstream));
-
-      res = g_buffered_input_stream_fill (bstream, -1, cancellable, error);
-      if (res < 0)
-	return NULL;
-      if (res == 0)
-	{
-	  /* End of stream */
-	  if (g_buffered_input_stream_get_available (bstream) == 0)
-	    {
-	      if (length)
-		*length = 0;
-	      return NULL;
-	    }
-	  else
-	    {
-	      found_pos = checked;
-	      newline_len = 0;
-	      break;
-	    }
-	}
+      if (length)
+	*length = 0;
+      return NULL;
     }
 
-  line = g_malloc (found_pos + newline_len + 1);
-
-  res = g_input_stream_read (G_INPUT_STREAM (stream),
-			     line,
-			     found_pos + newline_len,
-			     NULL, NULL);
+  line = g_malloc (record_len + 1);
+  memcpy (line, record, record_len);
+  line[record_len] = 0;
   if (length)
-    *length = (gsize)found_pos;
-  g_warn_if_fail (res == found_pos + newline_len);
-  line[found_pos] = 0;
+    *length = record_len;
   
   return line;
 }
 
-static gssize
-scan_for_chars (GDataInputStream *stream,
-		gsize            *checked_out,
-		const char       *stop_chars)
+/**
+ * g_data_input_stream_peek_line:
+ * @stream: a given #GDataInputStream.
+ * @length: return location for the length of the line.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads a line from the data input stream like
+ * g_data_input_stream_read_line(), but instead of returning a newly
+ * allocated copy of the line, returns a pointer to the line within the
+ * stream's buffer.
+ *
+ * The returned line is not nul-terminated, and is only valid until
+ * the next operation on @stream. This allows iterating over the lines
+ * of a stream without allocating or copying each of them.
+ *
+ * Returns: a pointer to the line that was read in (without the newlines),
+ *     or %NULL on an error or if there's no content to read, like
+ *     g_data_input_stream_read_line().
+ *
+ * Since: 2.22
+ **/
+const char *
+g_data_input_stream_peek_line (GDataInputStream  *stream,
+			       gsize             *length,
+			       GCancellable      *cancellable,
+			       GError           **error)
 {
-  GBufferedInputStream *bstream;
-  GDataInputStreamPrivate *priv;
-  const char *buffer;
-  gsize start, end, peeked;
-  int i;
-  gssize found_pos;
-  gsize available, checked;
-  const char *stop_char;
-
-  priv = stream->priv;
-  
-  bstream = G_BUFFERED_INPUT_STREAM (stream);
-
-  checked = *checked_out;
-  found_pos = -1;
-  
-  start = checked;
-  buffer = (const char *)g_buffered_input_stream_peek_buffer (bstream, &available) + start;
-  end = available;
-  peeked = end - start;
-
-  for (i = 0; checked < available && i < peeked; i++)
-    {
-      for (stop_char = stop_chars; *stop_char != '\0'; stop_char++)
-	{
-	  if (buffer[i] == *stop_char)
-	    return (start + i);
-	}
-    }
-
-  checked = end;
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
+  g_return_val_if_fail (length != NULL, NULL);
 
-  *checked_out = checked;
-  return -1;
+  return read_record (stream, NULL, length, cancellable, error);
 }
 
 /**
@@ -874,62 +1302,64 @@ g_data_input_stream_read_until (GDataInputStream  *stream,
 			       GCancellable       *cancellable,
 			       GError            **error)
 {
-  GBufferedInputStream *bstream;
-  gsize checked;
-  gssize found_pos;
-  gssize res;
-  int stop_char_len;
+  const char *record;
+  gsize record_len;
   char *data_until;
   
   g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
 
-  bstream = G_BUFFERED_INPUT_STREAM (stream);
-
-  stop_char_len = 1;
-  checked = 0;
-
-  while ((found_pos = scan_for_chars (stream, &checked, stop_chars)) == -1)
+  record = read_record (stream, stop_chars, &record_len, cancellable, error);
+  if (!record)
     {
-      if (g_buffered_input_stream_get_available (bstream) ==
-	  g_buffered_input_stream_get_buffer_size (bstream))
-	g_buffered_input_stream_set_buffer_size (bstream,
-						 2 * g_buffered_input_stream_get_buffer_size (bstream));
-
-      res = g_buffered_input_stream_fill (bstream, -1, cancellable, error);
-      if (res < 0)
-	return NULL;
-      if (res == 0)
-	{
-	  /* End of stream */
-	  if (g_buffered_input_stream_get_available (bstream) == 0)
-	    {
-	      if (length)
-		*length = 0;
-	      return NULL;
-	    }
-	  else
-	    {
-	      found_pos = checked;
-	      stop_char_len = 0;
-	      break;
-	    }
-	}
+      if (length)
+	*length = 0;
+      return NULL;
     }
 
-  data_until = g_malloc (found_pos + stop_char_len + 1);
-
-  res = g_input_stream_read (G_INPUT_STREAM (stream),
-			     data_until,
-			     found_pos + stop_char_len,
-			     NULL, NULL);
+  data_until = g_malloc (record_len + 1);
+  memcpy (data_until, record, record_len);
+  data_until[record_len] = 0;
   if (length)
-    *length = (gsize)found_pos;
-  g_warn_if_fail (res == found_pos + stop_char_len);
-  data_until[found_pos] = 0;
+    *length = record_len;
   
   return data_until;
 }
 
+/**
+ * g_data_input_stream_peek_until:
+ * @stream: a given #GDataInputStream.
+ * @stop_chars: characters to terminate the read.
+ * @length: return location for the length of the data.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: #GError for error reporting.
+ *
+ * Reads data up to the first occurrence of any of the stop characters
+ * like g_data_input_stream_read_until(), but returns a pointer into
+ * the stream's buffer instead of a newly allocated copy.
+ *
+ * The returned data is not nul-terminated, and is only valid until
+ * the next operation on @stream.
+ *
+ * Returns: a pointer to the data that was read before encountering
+ *     any of the stop characters, or %NULL on an error or if there's
+ *     no content to read.
+ *
+ * Since: 2.22
+ */
+const char *
+g_data_input_stream_peek_until (GDataInputStream  *stream,
+			        const gchar       *stop_chars,
+			        gsize             *length,
+			        GCancellable      *cancellable,
+			        GError           **error)
+{
+  g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), NULL);  
+  g_return_val_if_fail (stop_chars != NULL, NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+
+  return read_record (stream, stop_chars, length, cancellable, error);
+}
+
 typedef struct
 {
   GDataInputStream *stream;
@@ -1248,5 +1678,271 @@ g_data_input_stream_read_until_finish (GDataInputStream  *stream,
 }
 
 
+typedef struct
+{
+  GSimpleAsyncResult *simple;
+  GDataInputStreamLineCallback line_callback;
+  gpointer line_data;
+  gboolean last_saw_cr;
+  gsize checked;
+  gint io_priority;
+  GCancellable *cancellable;
+} GDataInputStreamReadLinesData;
+
+static void
+g_data_input_stream_read_lines_data_free (gpointer user_data)
+{
+  GDataInputStreamReadLinesData *data = user_data;
+
+  if (data->cancellable)
+    g_object_unref (data->cancellable);
+  g_slice_free (GDataInputStreamReadLinesData, data);
+}
+
+/* Hands every complete line in the buffer to the line callback.
+ * Returns %FALSE if the callback asked to stop.
+ */
+static gboolean
+g_data_input_stream_read_lines_dispatch (GDataInputStream              *stream,
+                                         GDataInputStreamReadLinesData *data,
+                                         gboolean                       at_end)
+{
+  GBufferedInputStream *bstream = G_BUFFERED_INPUT_STREAM (stream);
+  const char *line;
+  gssize found_pos;
+  gint newline_len;
+  gboolean proceed;
+
+  while (TRUE)
+    {
+      found_pos = scan_for_newline (stream, &data->checked,
+                                    &data->last_saw_cr, &newline_len);
+      if (found_pos == -1)
+        {
+          if (!at_end || g_buffered_input_stream_get_available (bstream) == 0)
+            return TRUE;
+
+          /* the last line has no newline */
+          found_pos = data->checked;
+          newline_len = 0;
+        }
+
+      line = g_buffered_input_stream_peek_buffer (bstream, NULL);
+      g_buffered_input_stream_consume (bstream, found_pos + newline_len);
+      data->checked = 0;
+      data->last_saw_cr = FALSE;
+
+      proceed = data->line_callback (stream, line, found_pos, data->line_data);
+      if (!proceed)
+        return FALSE;
+    }
+}
+
+static void g_data_input_stream_read_lines_ready (GObject      *object,
+                                                  GAsyncResult *result,
+                                                  gpointer      user_data);
+
+/* The stream stays pending for the whole operation, so the buffer is
+ * filled through the class directly rather than through
+ * g_buffered_input_stream_fill_async().
+ */
+static void
+g_data_input_stream_read_lines_fill (GDataInputStream              *stream,
+                                     GDataInputStreamReadLinesData *data)
+{
+  GBufferedInputStream *bstream = G_BUFFERED_INPUT_STREAM (stream);
+
+  G_BUFFERED_INPUT_STREAM_GET_CLASS (bstream)->fill_async (bstream, -1,
+                                                           data->io_priority,
+                                                           data->cancellable,
+                                                           g_data_input_stream_read_lines_ready,
+                                                           data);
+}
+
+static void
+g_data_input_stream_read_lines_complete (GDataInputStream              *stream,
+                                         GDataInputStreamReadLinesData *data)
+{
+  GSimpleAsyncResult *simple = data->simple;
+
+  g_input_stream_clear_pending (G_INPUT_STREAM (stream));
+
+  /* Complete immediately, not in idle, since we're already in a mainloop callout */
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+static void
+g_data_input_stream_read_lines_ready (GObject      *object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  GDataInputStreamReadLinesData *data = user_data;
+  GDataInputStream *stream = G_DATA_INPUT_STREAM (object);
+  GBufferedInputStream *bstream = G_BUFFERED_INPUT_STREAM (object);
+  GError *error = NULL;
+  gssize bytes;
+  gsize size;
+
+  bytes = g_buffered_input_stream_fill_finish (bstream, result, &error);
+  if (bytes < 0)
+    {
+      g_simple_async_result_set_from_error (data->simple, error);
+      g_error_free (error);
+    }
+  else if (g_data_input_stream_read_lines_dispatch (stream, data, bytes == 0) &&
+           bytes > 0)
+    {
+      size = g_buffered_input_stream_get_buffer_size (bstream);
+      if (g_buffered_input_stream_get_available (bstream) == size)
+        /* need to grow the buffer */
+        g_buffered_input_stream_set_buffer_size (bstream, size * 2);
+
+      g_data_input_stream_read_lines_fill (stream, data);
+      return;
+    }
+
+  g_data_input_stream_read_lines_complete (stream, data);
+}
+
+static gboolean
+g_data_input_stream_read_lines_idle (gpointer user_data)
+{
+  GDataInputStreamReadLinesData *data = user_data;
+  GDataInputStream *stream;
+
+  /* start with the lines that are already buffered */
+  stream = G_DATA_INPUT_STREAM (g_async_result_get_source_object (G_ASYNC_RESULT (data->simple)));
+  if (g_data_input_stream_read_lines_dispatch (stream, data, FALSE))
+    g_data_input_stream_read_lines_fill (stream, data);
+  else
+    g_data_input_stream_read_lines_complete (stream, data);
+  g_object_unref (stream);
+
+  return FALSE;
+}
+
+/**
+ * GDataInputStreamLineCallback:
+ * @stream: the #GDataInputStream the line was read from.
+ * @line: the line, without the newline. It is not nul-terminated.
+ * @length: the length of @line.
+ * @user_data: the data passed to g_data_input_stream_read_lines_async().
+ *
+ * The type of the function called for each line read by
+ * g_data_input_stream_read_lines_async(). @line points into the
+ * stream's buffer, and is only valid until the function returns.
+ *
+ * Returns: %TRUE to continue reading lines, %FALSE to stop.
+ *
+ * Since: 2.22
+ */
+
+/**
+ * g_data_input_stream_read_lines_async:
+ * @stream: a given #GDataInputStream.
+ * @line_callback: function to call for every line.
+ * @line_data: the data to pass to @line_callback.
+ * @io_priority: the <link linkend="io-priority">I/O priority</link>
+ *     of the request.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @callback: callback to call when the request is satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously reads lines from @stream until the end of the stream
+ * is reached, an error occurs, or @line_callback returns %FALSE.
+ *
+ * Unlike calling g_data_input_stream_read_line_async() repeatedly, all
+ * the lines available in the buffer are passed to @line_callback in a
+ * single main loop dispatch, and the lines are not copied out of the
+ * buffer. The buffer is only refilled once all of them have been
+ * processed.
+ *
+ * When the operation is finished, @callback will be called. You
+ * can then call g_data_input_stream_read_lines_finish() to get
+ * the result of the operation. It is an error to have two outstanding
+ * calls to this function.
+ *
+ * Since: 2.22
+ */
+void
+g_data_input_stream_read_lines_async (GDataInputStream             *stream,
+                                      GDataInputStreamLineCallback  line_callback,
+                                      gpointer                      line_data,
+                                      gint                          io_priority,
+                                      GCancellable                 *cancellable,
+                                      GAsyncReadyCallback           callback,
+                                      gpointer                      user_data)
+{
+  GDataInputStreamReadLinesData *data;
+  GError *error = NULL;
+
+  g_return_if_fail (G_IS_DATA_INPUT_STREAM (stream));
+  g_return_if_fail (line_callback != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  if (!g_input_stream_set_pending (G_INPUT_STREAM (stream), &error))
+    {
+      GSimpleAsyncResult *simple;
+
+      /* keep the source tag, so that _finish() accepts the result */
+      simple = g_simple_async_result_new (G_OBJECT (stream), callback,
+                                          user_data,
+                                          g_data_input_stream_read_lines_async);
+      g_simple_async_result_set_from_error (simple, error);
+      g_simple_async_result_complete_in_idle (simple);
+      g_object_unref (simple);
+      g_error_free (error);
+      return;
+    }
+
+  data = g_slice_new (GDataInputStreamReadLinesData);
+  data->line_callback = line_callback;
+  data->line_data = line_data;
+  if (cancellable)
+    g_object_ref (cancellable);
+  data->cancellable = cancellable;
+  data->io_priority = io_priority;
+  data->last_saw_cr = FALSE;
+  data->checked = 0;
+
+  data->simple = g_simple_async_result_new (G_OBJECT (stream), callback,
+                                            user_data,
+                                            g_data_input_stream_read_lines_async);
+  g_simple_async_result_set_op_res_gpointer (data->simple, data,
+                                             g_data_input_stream_read_lines_data_free);
+
+  if (g_buffered_input_stream_get_available (G_BUFFERED_INPUT_STREAM (stream)) > 0)
+    g_idle_add_full (io_priority, g_data_input_stream_read_lines_idle, data, NULL);
+  else
+    g_data_input_stream_read_lines_fill (stream, data);
+}
+
+/**
+ * g_data_input_stream_read_lines_finish:
+ * @stream: a given #GDataInputStream.
+ * @result: the #GAsyncResult that was provided to the callback.
+ * @error: #GError for error reporting.
+ *
+ * Finish an asynchronous call started by
+ * g_data_input_stream_read_lines_async().
+ *
+ * Returns: %TRUE if all lines were read, or the line callback
+ *     stopped the operation; %FALSE on error.
+ *
+ * Since: 2.22
+ */
+gboolean
+g_data_input_stream_read_lines_finish (GDataInputStream  *stream,
+                                       GAsyncResult      *result,
+                                       GError           **error)
+{
+  g_return_val_if_fail (
+    g_simple_async_result_is_valid (result, G_OBJECT (stream),
+      g_data_input_stream_read_lines_async), FALSE);
+
+  return !g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), error);
+}
+
 #define __G_DATA_INPUT_STREAM_C__
 #include "gioaliasdef.c"
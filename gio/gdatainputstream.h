@@ -69,6 +69,11 @@ struct _GDataInputStreamClass
   void (*_g_reserved5) (void);
 };
 
+typedef gboolean (*GDataInputStreamLineCallback) (GDataInputStream *stream,
+                                                  const char       *line,
+                                                  gsize             length,
+                                                  gpointer          user_data);
+
 GType                  g_data_input_stream_get_type             (void) G_GNUC_CONST;
 GDataInputStream *     g_data_input_stream_new                  (GInputStream            *base_stream);
 
@@ -99,6 +104,27 @@ gint64                 g_data_input_stream_read_int64           (GDataInputStrea
 guint64                g_data_input_stream_read_uint64          (GDataInputStream        *stream,
 							         GCancellable            *cancellable,
 							         GError                 **error);
+gboolean               g_data_input_stream_read_int16_array     (GDataInputStream        *stream,
+                                                                 gint16                  *data,
+                                                                 gsize                    n_elements,
+                                                                 GCancellable            *cancellable,
+                                                                 GError                 **error);
+gboolean               g_data_input_stream_read_int32_array     (GDataInputStream        *stream,
+                                                                 gint32                  *data,
+                                                                 gsize                    n_elements,
+                                                                 GCancellable            *cancellable,
+                                                                 GError                 **error);
+gboolean               g_data_input_stream_read_int64_array     (GDataInputStream        *stream,
+                                                                 gint64                  *data,
+                                                                 gsize                    n_elements,
+                                                                 GCancellable            *cancellable,
+                                                                 GError                 **error);
+gboolean               g_data_input_stream_read_struct          (GDataInputStream        *stream,
+                                                                 const GDataStreamField  *fields,
+                                                                 guint                    n_fields,
+                                                                 gpointer                 data,
+                                                                 GCancellable            *cancellable,
+                                                                 GError                 **error);
 char *                 g_data_input_stream_read_line            (GDataInputStream        *stream,
 							         gsize                   *length,
 							         GCancellable            *cancellable,
@@ -112,6 +138,20 @@ char *                 g_data_input_stream_read_line_finish     (GDataInputStrea
                                                                  GAsyncResult            *result,
                                                                  gsize                   *length,
                                                                  GError                 **error);
+const char *           g_data_input_stream_peek_line            (GDataInputStream        *stream,
+							         gsize                   *length,
+							         GCancellable            *cancellable,
+							         GError                 **error);
+void                   g_data_input_stream_read_lines_async     (GDataInputStream        *stream,
+                                                                 GDataInputStreamLineCallback line_callback,
+                                                                 gpointer                 line_data,
+                                                                 gint                     io_priority,
+                                                                 GCancellable            *cancellable,
+                                                                 GAsyncReadyCallback      callback,
+                                                                 gpointer                 user_data);
+gboolean               g_data_input_stream_read_lines_finish    (GDataInputStream        *stream,
+                                                                 GAsyncResult            *result,
+                                                                 GError                 **error);
 char *                 g_data_input_stream_read_until           (GDataInputStream        *stream,
 							         const gchar             *stop_chars,
 							         gsize                   *length,
@@ -127,6 +167,11 @@ char *                 g_data_input_stream_read_until_finish    (GDataInputStrea
                                                                  GAsyncResult            *result,
                                                                  gsize                   *length,
                                                                  GError                 **error);
+const char *           g_data_input_stream_peek_until           (GDataInputStream        *stream,
+							         const gchar             *stop_chars,
+							         gsize                   *length,
+							         GCancellable            *cancellable,
+							         GError                 **error);
 
 G_END_DECLS
 
@@ -23,6 +23,7 @@
 #include "config.h"
 #include <string.h>
 #include "gdataoutputstream.h"
+#include "gdatastream-priv.h"
 #include "gioenumtypes.h"
 #include "glibintl.h"
 
@@ -474,6 +475,266 @@ g_data_output_stream_put_uint64 (GDataOutputStream  *stream,
 				    cancellable, error);
 }
 
+static gboolean
+put_array (GDataOutputStream  *stream,
+           const void         *data,
+           gsize               element_size,
+           gsize               n_elements,
+           GCancellable       *cancellable,
+           GError            **error)
+{
+  guint64 chunk[512];
+  gsize bytes_written;
+  gsize i, n;
+
+  g_return_val_if_fail (n_elements <= G_MAXSIZE / element_size, FALSE);
+
+  if (!_g_data_stream_byte_order_needs_swap (stream->priv->byte_order))
+    return g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+				      data, n_elements * element_size,
+				      &bytes_written,
+				      cancellable, error);
+
+  /* @data is const, so convert it a chunk at a time */
+  while (n_elements > 0)
+    {
+      n = MIN (n_elements, sizeof (chunk) / element_size);
+
+      switch (element_size)
+        {
+        case 2:
+          {
+            const guint16 *src = data;
+            guint16 *dest = (guint16 *)chunk;
+            for (i = 0; i < n; i++)
+              dest[i] = GUINT16_SWAP_LE_BE (src[i]);
+          }
+          break;
+        case 4:
+          {
+            const guint32 *src = data;
+            guint32 *dest = (guint32 *)chunk;
+            for (i = 0; i < n; i++)
+              dest[i] = GUINT32_SWAP_LE_BE (src[i]);
+          }
+          break;
+        case 8:
+          {
+            const guint64 *src = data;
+            for (i = 0; i < n; i++)
+              chunk[i] = GUINT64_SWAP_LE_BE (src[i]);
+          }
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+
+      if (!g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+				      chunk, n * element_size,
+				      &bytes_written,
+				      cancellable, error))
+        return FALSE;
+
+      data = (const guchar *)data + n * element_size;
+      n_elements -= n;
+    }
+
+  return TRUE;
+}
+
+/**
+ * g_data_output_stream_put_int16_array:
+ * @stream: a #GDataOutputStream.
+ * @data: an array of 16-bit integers.
+ * @n_elements: the number of integers in @data.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: a #GError, %NULL to ignore.
+ * 
+ * Puts @n_elements 16-bit integers into the stream, converting them to
+ * the byte order set with g_data_output_stream_set_byte_order(). This
+ * is the same as calling g_data_output_stream_put_int16() for each
+ * element, but uses far fewer write operations. It can also be used for
+ * unsigned integers.
+ * 
+ * Returns: %TRUE if @data was successfully added to the @stream.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_output_stream_put_int16_array (GDataOutputStream  *stream,
+				      const gint16       *data,
+				      gsize               n_elements,
+				      GCancellable       *cancellable,
+				      GError            **error)
+{
+  g_return_val_if_fail (G_IS_DATA_OUTPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return put_array (stream, data, 2, n_elements, cancellable, error);
+}
+
+/**
+ * g_data_output_stream_put_int32_array:
+ * @stream: a #GDataOutputStream.
+ * @data: an array of 32-bit integers.
+ * @n_elements: the number of integers in @data.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: a #GError, %NULL to ignore.
+ * 
+ * Puts @n_elements 32-bit integers into the stream. See
+ * g_data_output_stream_put_int16_array() for details.
+ * 
+ * Returns: %TRUE if @data was successfully added to the @stream.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_output_stream_put_int32_array (GDataOutputStream  *stream,
+				      const gint32       *data,
+				      gsize               n_elements,
+				      GCancellable       *cancellable,
+				      GError            **error)
+{
+  g_return_val_if_fail (G_IS_DATA_OUTPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return put_array (stream, data, 4, n_elements, cancellable, error);
+}
+
+/**
+ * g_data_output_stream_put_int64_array:
+ * @stream: a #GDataOutputStream.
+ * @data: an array of 64-bit integers.
+ * @n_elements: the number of integers in @data.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: a #GError, %NULL to ignore.
+ * 
+ * Puts @n_elements 64-bit integers into the stream. See
+ * g_data_output_stream_put_int16_array() for details.
+ * 
+ * Returns: %TRUE if @data was successfully added to the @stream.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_output_stream_put_int64_array (GDataOutputStream  *stream,
+				      const gint64       *data,
+				      gsize               n_elements,
+				      GCancellable       *cancellable,
+				      GError            **error)
+{
+  g_return_val_if_fail (G_IS_DATA_OUTPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (data != NULL || n_elements == 0, FALSE);
+
+  return put_array (stream, data, 8, n_elements, cancellable, error);
+}
+
+/**
+ * g_data_output_stream_put_struct:
+ * @stream: a #GDataOutputStream.
+ * @fields: an array of #GDataStreamField describing the record.
+ * @n_fields: the length of @fields.
+ * @data: the structure to take the fields from.
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: a #GError, %NULL to ignore.
+ * 
+ * Puts the fields of @data described by @fields into the stream as a
+ * single record, converting integers to the byte order set with
+ * g_data_output_stream_set_byte_order(). The record can be read back
+ * with g_data_input_stream_read_struct().
+ * 
+ * Returns: %TRUE if @data was successfully added to the @stream.
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_data_output_stream_put_struct (GDataOutputStream       *stream,
+				 const GDataStreamField  *fields,
+				 guint                    n_fields,
+				 gconstpointer            data,
+				 GCancellable            *cancellable,
+				 GError                 **error)
+{
+  guchar stack_buffer[256];
+  guchar *buffer, *p;
+  const guchar *src;
+  gsize bytes_written;
+  gboolean swap, res;
+  gsize size, n;
+  guint i;
+
+  g_return_val_if_fail (G_IS_DATA_OUTPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (fields != NULL || n_fields == 0, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  size = 0;
+  for (i = 0; i < n_fields; i++)
+    {
+      n = _g_data_stream_field_size (fields[i].type);
+      g_return_val_if_fail (n != 0, FALSE);
+      size += n;
+    }
+
+  if (size <= sizeof (stack_buffer))
+    buffer = stack_buffer;
+  else
+    buffer = g_malloc (size);
+
+  swap = _g_data_stream_byte_order_needs_swap (stream->priv->byte_order);
+  p = buffer;
+  for (i = 0; i < n_fields; i++)
+    {
+      src = (const guchar *)data + fields[i].offset;
+      switch (fields[i].type)
+        {
+        case G_DATA_STREAM_FIELD_BYTE:
+          *p = *src;
+          p += 1;
+          break;
+        case G_DATA_STREAM_FIELD_INT16:
+          {
+            guint16 v;
+            memcpy (&v, src, 2);
+            if (swap)
+              v = GUINT16_SWAP_LE_BE (v);
+            memcpy (p, &v, 2);
+            p += 2;
+          }
+          break;
+        case G_DATA_STREAM_FIELD_INT32:
+          {
+            guint32 v;
+            memcpy (&v, src, 4);
+            if (swap)
+              v = GUINT32_SWAP_LE_BE (v);
+            memcpy (p, &v, 4);
+            p += 4;
+          }
+          break;
+        case G_DATA_STREAM_FIELD_INT64:
+          {
+            guint64 v;
+            memcpy (&v, src, 8);
+            if (swap)
+              v = GUINT64_SWAP_LE_BE (v);
+            memcpy (p, &v, 8);
+            p += 8;
+          }
+          break;
+        }
+    }
+
+  res = g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+				   buffer, size,
+				   &bytes_written,
+				   cancellable, error);
+
+  if (buffer != stack_buffer)
+    g_free (buffer);
+
+  return res;
+}
+
 /**
  * g_data_output_stream_put_string:
  * @stream: a #GDataOutputStream.
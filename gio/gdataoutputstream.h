@@ -106,6 +106,27 @@ gboolean             g_data_output_stream_put_uint64     (GDataOutputStream
 							  guint64                data,
 							  GCancellable          *cancellable,
 							  GError               **error);
+gboolean             g_data_output_stream_put_int16_array (GDataOutputStream    *stream,
+							   const gint16         *data,
+							   gsize                 n_elements,
+							   GCancellable         *cancellable,
+							   GError              **error);
+gboolean             g_data_output_stream_put_int32_array (GDataOutputStream    *stream,
+							   const gint32         *data,
+							   gsize                 n_elements,
+							   GCancellable         *cancellable,
+							   GError              **error);
+gboolean             g_data_output_stream_put_int64_array (GDataOutputStream    *stream,
+							   const gint64         *data,
+							   gsize                 n_elements,
+							   GCancellable         *cancellable,
+							   GError              **error);
+gboolean             g_data_output_stream_put_struct      (GDataOutputStream    *stream,
+							   const GDataStreamField *fields,
+							   guint                 n_fields,
+							   gconstpointer         data,
+							   GCancellable         *cancellable,
+							   GError              **error);
 gboolean             g_data_output_stream_put_string     (GDataOutputStream     *stream,
 							  const char            *str,
 							  GCancellable          *cancellable,
@@ -86,4 +86,7 @@ void                 _g_file_attribute_value_set_object      (GFileAttributeValu
 GFileAttributeValue *_g_file_info_get_attribute_value (GFileInfo  *info,
 						       const char *attribute);
 
+gboolean _g_file_attribute_matcher_is_subset (GFileAttributeMatcher *matcher,
+					      const char * const    *attributes);
+
 #endif /* __G_FILE_ATTRIBUTE_PRIV_H__ */
@@ -0,0 +1,111 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "gfiledescriptorbased.h"
+#include "glibintl.h"
+
+#include "gioalias.h"
+
+/**
+ * SECTION:gfiledescriptorbased
+ * @short_description: Interface for file descriptor based IO
+ * @include: gio/gfiledescriptorbased.h
+ * @see_also: #GInputStream, #GOutputStream
+ *
+ * GFileDescriptorBased is implemented by streams (implementations of
+ * #GInputStream or #GOutputStream) that are based on file descriptors.
+ *
+ * g_output_stream_splice() uses it to move data between two such
+ * streams inside the kernel, without copying it through userspace.
+ * The default implementations of g_input_stream_read_async() and
+ * g_output_stream_write_async() use it to avoid a thread: a
+ * non-blocking file descriptor is waited on in the main loop, and a
+ * regular file is first read or written with %RWF_NOWAIT.
+ *
+ * Note that <filename>&lt;gio/gfiledescriptorbased.h&gt;</filename> belongs to
+ * the UNIX-specific GIO interfaces, thus you have to use the
+ * <filename>gio-unix-2.0.pc</filename> pkg-config file when using it.
+ *
+ * Since: 2.22
+ **/
+
+static void g_file_descriptor_based_base_init (gpointer g_class);
+
+GType
+g_file_descriptor_based_get_type (void)
+{
+  static volatile gsize g_define_type_id__volatile = 0;
+
+  if (g_once_init_enter (&g_define_type_id__volatile))
+    {
+      const GTypeInfo file_descriptor_based_info =
+      {
+        sizeof (GFileDescriptorBasedIface), /* class_size */
+	g_file_descriptor_based_base_init,   /* base_init */
+	NULL,		/* base_finalize */
+	NULL,
+	NULL,		/* class_finalize */
+	NULL,		/* class_data */
+	0,
+	0,              /* n_preallocs */
+	NULL
+      };
+      GType g_define_type_id =
+	g_type_register_static (G_TYPE_INTERFACE, I_("GFileDescriptorBased"),
+				&file_descriptor_based_info, 0);
+
+      g_type_interface_add_prerequisite (g_define_type_id, G_TYPE_OBJECT);
+
+      g_once_init_leave (&g_define_type_id__volatile, g_define_type_id);
+    }
+
+  return g_define_type_id__volatile;
+}
+
+static void
+g_file_descriptor_based_base_init (gpointer g_class)
+{
+}
+
+/**
+ * g_file_descriptor_based_get_fd:
+ * @fd_based: a #GFileDescriptorBased.
+ *
+ * Gets the underlying file descriptor.
+ *
+ * Returns: The file descriptor
+ *
+ * Since: 2.22
+ **/
+int
+g_file_descriptor_based_get_fd (GFileDescriptorBased *fd_based)
+{
+  GFileDescriptorBasedIface *iface;
+
+  g_return_val_if_fail (G_IS_FILE_DESCRIPTOR_BASED (fd_based), 0);
+
+  iface = G_FILE_DESCRIPTOR_BASED_GET_IFACE (fd_based);
+
+  return (* iface->get_fd) (fd_based);
+}
+
+#define __G_FILE_DESCRIPTOR_BASED_C__
+#include "gioaliasdef.c"
@@ -64,8 +64,11 @@ struct _GFileEnumeratorPrivate {
   guint pending : 1;
   GAsyncReadyCallback outstanding_callback;
   GError *outstanding_error;
+  guint parallelism;
 };
 
+#define DEFAULT_PARALLELISM 4
+
 enum {
   PROP_0,
   PROP_CONTAINER
@@ -169,6 +172,7 @@ g_file_enumerator_init (GFileEnumerator *enumerator)
   enumerator->priv = G_TYPE_INSTANCE_GET_PRIVATE (enumerator,
 						  G_TYPE_FILE_ENUMERATOR,
 						  GFileEnumeratorPrivate);
+  enumerator->priv->parallelism = DEFAULT_PARALLELISM;
 }
 
 /**
@@ -599,6 +603,52 @@ g_file_enumerator_get_container (GFileEnumerator *enumerator)
   return enumerator->priv->container;
 }
 
+/**
+ * g_file_enumerator_set_parallelism:
+ * @enumerator: a #GFileEnumerator.
+ * @n_threads: the number of threads to use, at least 1.
+ *
+ * Sets how many threads g_file_enumerator_next_files_async() may use
+ * at once to gather information about the files it returns. This
+ * helps when querying each file is slow, e.g. when sniffing content
+ * types on slow storage. The files are still returned in the order
+ * the enumerator reads them.
+ *
+ * This is only a hint; enumerators that cannot query files in
+ * parallel ignore it. The default is 4.
+ *
+ * Since: 2.22
+ **/
+void
+g_file_enumerator_set_parallelism (GFileEnumerator *enumerator,
+				   guint            n_threads)
+{
+  g_return_if_fail (G_IS_FILE_ENUMERATOR (enumerator));
+  g_return_if_fail (n_threads > 0);
+
+  enumerator->priv->parallelism = n_threads;
+}
+
+/**
+ * g_file_enumerator_get_parallelism:
+ * @enumerator: a #GFileEnumerator.
+ *
+ * Gets the number of threads set with
+ * g_file_enumerator_set_parallelism().
+ *
+ * Returns: the number of threads g_file_enumerator_next_files_async()
+ * may use.
+ *
+ * Since: 2.22
+ **/
+guint
+g_file_enumerator_get_parallelism (GFileEnumerator *enumerator)
+{
+  g_return_val_if_fail (G_IS_FILE_ENUMERATOR (enumerator), 1);
+
+  return enumerator->priv->parallelism;
+}
+
 typedef struct {
   int                num_files;
   GList             *files;
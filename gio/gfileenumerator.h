@@ -127,6 +127,9 @@ gboolean   g_file_enumerator_has_pending       (GFileEnumerator      *enumerator
 void       g_file_enumerator_set_pending       (GFileEnumerator      *enumerator,
 						gboolean              pending);
 GFile *    g_file_enumerator_get_container     (GFileEnumerator *enumerator);
+void       g_file_enumerator_set_parallelism   (GFileEnumerator      *enumerator,
+						guint                 n_threads);
+guint      g_file_enumerator_get_parallelism   (GFileEnumerator      *enumerator);
 
 G_END_DECLS
 
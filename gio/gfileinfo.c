@@ -71,10 +71,22 @@ typedef struct  {
   GFileAttributeValue value;
 } GFileAttribute;
 
+/* The attributes nearly every file info has, e.g. the ones a file
+ * manager shows in a listing. They are stored in fixed slots of the
+ * GFileInfo instead of in the attribute array. They must come first
+ * in known_attributes[] and be grouped by namespace, see
+ * init_attribute_hash().
+ */
+#define N_FIXED_ATTRIBUTES 13
+
 struct _GFileInfo
 {
   GObject parent_instance;
 
+  guint32 fixed_set;	/* bit n is set if fixed[n] holds a value */
+  GFileAttributeValue fixed[N_FIXED_ATTRIBUTES];
+
+  /* The other attributes, sorted by id; %NULL until there is one */
   GArray *attributes;
   GFileAttributeMatcher *mask;
 };
@@ -101,6 +113,92 @@ static GHashTable *ns_hash = NULL;
 static GHashTable *attribute_hash = NULL;
 static char ***attributes = NULL;
 
+/* The ids of these are assigned up front, in this order, and looked up
+ * in known_attribute_hash, which never changes afterwards and so needs
+ * no lock.
+ */
+static const char * const known_attributes[] = {
+  /* Fixed slots */
+  G_FILE_ATTRIBUTE_STANDARD_TYPE,
+  G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+  G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP,
+  G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK,
+  G_FILE_ATTRIBUTE_STANDARD_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_ICON,
+  G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+  G_FILE_ATTRIBUTE_TIME_MODIFIED,
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+  G_FILE_ATTRIBUTE_UNIX_MODE,
+
+  G_FILE_ATTRIBUTE_STANDARD_IS_VIRTUAL,
+  G_FILE_ATTRIBUTE_STANDARD_COPY_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_DESCRIPTION,
+  G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
+  G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE,
+  G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET,
+  G_FILE_ATTRIBUTE_STANDARD_TARGET_URI,
+  G_FILE_ATTRIBUTE_STANDARD_SORT_ORDER,
+  G_FILE_ATTRIBUTE_TIME_ACCESS,
+  G_FILE_ATTRIBUTE_TIME_ACCESS_USEC,
+  G_FILE_ATTRIBUTE_TIME_CHANGED,
+  G_FILE_ATTRIBUTE_TIME_CHANGED_USEC,
+  G_FILE_ATTRIBUTE_TIME_CREATED,
+  G_FILE_ATTRIBUTE_TIME_CREATED_USEC,
+  G_FILE_ATTRIBUTE_UNIX_DEVICE,
+  G_FILE_ATTRIBUTE_UNIX_INODE,
+  G_FILE_ATTRIBUTE_UNIX_NLINK,
+  G_FILE_ATTRIBUTE_UNIX_UID,
+  G_FILE_ATTRIBUTE_UNIX_GID,
+  G_FILE_ATTRIBUTE_UNIX_RDEV,
+  G_FILE_ATTRIBUTE_UNIX_BLOCK_SIZE,
+  G_FILE_ATTRIBUTE_UNIX_BLOCKS,
+  G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT,
+  G_FILE_ATTRIBUTE_ETAG_VALUE,
+  G_FILE_ATTRIBUTE_ID_FILE,
+  G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_READ,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
+  G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME,
+  G_FILE_ATTRIBUTE_MOUNTABLE_CAN_MOUNT,
+  G_FILE_ATTRIBUTE_MOUNTABLE_CAN_UNMOUNT,
+  G_FILE_ATTRIBUTE_MOUNTABLE_CAN_EJECT,
+  G_FILE_ATTRIBUTE_MOUNTABLE_UNIX_DEVICE,
+  G_FILE_ATTRIBUTE_MOUNTABLE_HAL_UDI,
+  G_FILE_ATTRIBUTE_DOS_IS_ARCHIVE,
+  G_FILE_ATTRIBUTE_DOS_IS_SYSTEM,
+  G_FILE_ATTRIBUTE_OWNER_USER,
+  G_FILE_ATTRIBUTE_OWNER_USER_REAL,
+  G_FILE_ATTRIBUTE_OWNER_GROUP,
+  G_FILE_ATTRIBUTE_THUMBNAIL_PATH,
+  G_FILE_ATTRIBUTE_THUMBNAILING_FAILED,
+  G_FILE_ATTRIBUTE_PREVIEW_ICON,
+  G_FILE_ATTRIBUTE_FILESYSTEM_SIZE,
+  G_FILE_ATTRIBUTE_FILESYSTEM_FREE,
+  G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
+  G_FILE_ATTRIBUTE_FILESYSTEM_READONLY,
+  G_FILE_ATTRIBUTE_FILESYSTEM_USE_PREVIEW,
+  G_FILE_ATTRIBUTE_GVFS_BACKEND,
+  G_FILE_ATTRIBUTE_SELINUX_CONTEXT,
+  G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT
+};
+
+static GHashTable *known_attribute_hash = NULL;
+
+/* The fixed slots of each namespace, indexed by namespace id. As the
+ * fixed attributes get the first ids of their namespace, the slot of
+ * an attribute is first_slot + attribute id - 1.
+ */
+static struct {
+  guint first_slot;
+  guint n_slots;
+} fixed_slots[4];
+
 /* Attribute ids are 32bit, we split it up like this:
  * |------------|--------------------|
  *   12 bit          20 bit       
@@ -140,6 +238,45 @@ _lookup_namespace (const char *namespace)
   return ns_info;
 }
 
+static guint32     _lookup_attribute  (const char *attribute);
+static const char *get_attribute_name (guint32     attribute);
+
+/* Called with the attribute_hash lock held */
+static void
+init_attribute_hash (void)
+{
+  GHashTable *known;
+  guint32 attr_id, ns, id;
+  int i;
+
+  if (attribute_hash != NULL)
+    return;
+
+  ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
+  attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+  known = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < G_N_ELEMENTS (known_attributes); i++)
+    {
+      attr_id = _lookup_attribute (known_attributes[i]);
+      g_hash_table_insert (known, (char *)get_attribute_name (attr_id),
+			   GUINT_TO_POINTER (attr_id));
+
+      if (i < N_FIXED_ATTRIBUTES)
+	{
+	  ns = GET_NS (attr_id);
+	  id = GET_ID (attr_id);
+	  g_assert (ns < G_N_ELEMENTS (fixed_slots));
+	  if (fixed_slots[ns].n_slots == 0)
+	    fixed_slots[ns].first_slot = i;
+	  g_assert (fixed_slots[ns].first_slot + id - 1 == i);
+	  fixed_slots[ns].n_slots = id;
+	}
+    }
+
+  g_atomic_pointer_set (&known_attribute_hash, known);
+}
+
 static guint32
 lookup_namespace (const char *namespace)
 {
@@ -148,11 +285,7 @@ lookup_namespace (const char *namespace)
   
   G_LOCK (attribute_hash);
   
-  if (attribute_hash == NULL)
-    {
-      ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
-      attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
-    }
+  init_attribute_hash ();
 
   ns_info = _lookup_namespace (namespace);
   id = 0;
@@ -164,6 +297,13 @@ lookup_namespace (const char *namespace)
   return id;
 }
 
+/* Called with the attribute_hash lock held */
+static const char *
+get_attribute_name (guint32 attribute)
+{
+  return attributes[GET_NS(attribute)][GET_ID(attribute)];
+}
+
 static char *
 get_attribute_for_id (int attribute)
 {
@@ -174,28 +314,19 @@ get_attribute_for_id (int attribute)
   return s;
 }
 
+/* Called with the attribute_hash lock held */
 static guint32
-lookup_attribute (const char *attribute)
+_lookup_attribute (const char *attribute)
 {
   guint32 attr_id, id;
   char *ns;
   const char *colon;
   NSInfo *ns_info;
-  
-  G_LOCK (attribute_hash);
-  if (attribute_hash == NULL)
-    {
-      ns_hash = g_hash_table_new (g_str_hash, g_str_equal);
-      attribute_hash = g_hash_table_new (g_str_hash, g_str_equal);
-    }
 
   attr_id = GPOINTER_TO_UINT (g_hash_table_lookup (attribute_hash, attribute));
 
   if (attr_id != 0)
-    {
-      G_UNLOCK (attribute_hash);
-      return attr_id;
-    }
+    return attr_id;
 
   colon = strstr (attribute, "::");
   if (colon)
@@ -214,11 +345,63 @@ lookup_attribute (const char *attribute)
 
   g_hash_table_insert (attribute_hash, attributes[ns_info->id][id], GUINT_TO_POINTER (attr_id));
   
+  return attr_id;
+}
+
+static guint32
+lookup_attribute (const char *attribute)
+{
+  GHashTable *known;
+  guint32 attr_id;
+
+  known = g_atomic_pointer_get (&known_attribute_hash);
+  if (G_LIKELY (known != NULL))
+    {
+      attr_id = GPOINTER_TO_UINT (g_hash_table_lookup (known, attribute));
+      if (attr_id != 0)
+	return attr_id;
+    }
+
+  G_LOCK (attribute_hash);
+  init_attribute_hash ();
+  attr_id = _lookup_attribute (attribute);
   G_UNLOCK (attribute_hash);
-  
+
   return attr_id;
 }
 
+/* Returns the fixed slot of @attr_id in a GFileInfo, or -1 if it
+ * lives in the attribute array.
+ */
+static inline int
+get_fixed_slot (guint32 attr_id)
+{
+  guint32 ns, id;
+
+  ns = GET_NS (attr_id);
+  id = GET_ID (attr_id);
+  if (ns < G_N_ELEMENTS (fixed_slots) &&
+      id - 1 < fixed_slots[ns].n_slots)
+    return fixed_slots[ns].first_slot + id - 1;
+
+  return -1;
+}
+
+/* The id of fixed slot @slot */
+static guint32
+get_fixed_slot_id (int slot)
+{
+  guint32 ns;
+
+  for (ns = 0; ns < G_N_ELEMENTS (fixed_slots); ns++)
+    if (fixed_slots[ns].n_slots > 0 &&
+	slot - fixed_slots[ns].first_slot < fixed_slots[ns].n_slots)
+      return MAKE_ATTR_ID (ns, slot - fixed_slots[ns].first_slot + 1);
+
+  g_assert_not_reached ();
+  return 0;
+}
+
 static void
 g_file_info_finalize (GObject *object)
 {
@@ -228,10 +411,17 @@ g_file_info_finalize (GObject *object)
 
   info = G_FILE_INFO (object);
 
-  attrs = (GFileAttribute *)info->attributes->data;
-  for (i = 0; i < info->attributes->len; i++)
-    _g_file_attribute_value_clear (&attrs[i].value);
-  g_array_free (info->attributes, TRUE);  
+  for (i = 0; i < N_FIXED_ATTRIBUTES; i++)
+    if (info->fixed_set & (1 << i))
+      _g_file_attribute_value_clear (&info->fixed[i]);
+
+  if (info->attributes)
+    {
+      attrs = (GFileAttribute *)info->attributes->data;
+      for (i = 0; i < info->attributes->len; i++)
+	_g_file_attribute_value_clear (&attrs[i].value);
+      g_array_free (info->attributes, TRUE);  
+    }
 
   if (info->mask != NO_ATTRIBUTE_MASK)
     g_file_attribute_matcher_unref (info->mask);
@@ -251,8 +441,35 @@ static void
 g_file_info_init (GFileInfo *info)
 {
   info->mask = NO_ATTRIBUTE_MASK;
-  info->attributes = g_array_new (FALSE, FALSE,
-				  sizeof (GFileAttribute));
+}
+
+static GArray *
+ensure_attributes (GFileInfo *info)
+{
+  if (info->attributes == NULL)
+    info->attributes = g_array_new (FALSE, FALSE,
+				    sizeof (GFileAttribute));
+  return info->attributes;
+}
+
+static void
+clear_attributes (GFileInfo *info)
+{
+  GFileAttribute *attrs;
+  int i;
+
+  for (i = 0; i < N_FIXED_ATTRIBUTES; i++)
+    if (info->fixed_set & (1 << i))
+      _g_file_attribute_value_clear (&info->fixed[i]);
+  info->fixed_set = 0;
+
+  if (info->attributes)
+    {
+      attrs = (GFileAttribute *)info->attributes->data;
+      for (i = 0; i < info->attributes->len; i++)
+	_g_file_attribute_value_clear (&attrs[i].value);
+      g_array_set_size (info->attributes, 0);
+    }
 }
 
 /**
@@ -285,21 +502,27 @@ g_file_info_copy_into (GFileInfo *src_info,
   g_return_if_fail (G_IS_FILE_INFO (src_info));
   g_return_if_fail (G_IS_FILE_INFO (dest_info));
 
-  dest = (GFileAttribute *)dest_info->attributes->data;
-  for (i = 0; i < dest_info->attributes->len; i++)
-    _g_file_attribute_value_clear (&dest[i].value);
-  
-  g_array_set_size (dest_info->attributes,
-		    src_info->attributes->len);
+  clear_attributes (dest_info);
 
-  source = (GFileAttribute *)src_info->attributes->data;
-  dest = (GFileAttribute *)dest_info->attributes->data;
-  
-  for (i = 0; i < src_info->attributes->len; i++)
+  for (i = 0; i < N_FIXED_ATTRIBUTES; i++)
+    if (src_info->fixed_set & (1 << i))
+      _g_file_attribute_value_set (&dest_info->fixed[i], &src_info->fixed[i]);
+  dest_info->fixed_set = src_info->fixed_set;
+
+  if (src_info->attributes && src_info->attributes->len > 0)
     {
-      dest[i].attribute = source[i].attribute;
-      dest[i].value.type = G_FILE_ATTRIBUTE_TYPE_INVALID;
-      _g_file_attribute_value_set (&dest[i].value, &source[i].value);
+      g_array_set_size (ensure_attributes (dest_info),
+			src_info->attributes->len);
+
+      source = (GFileAttribute *)src_info->attributes->data;
+      dest = (GFileAttribute *)dest_info->attributes->data;
+  
+      for (i = 0; i < src_info->attributes->len; i++)
+	{
+	  dest[i].attribute = source[i].attribute;
+	  dest[i].value.type = G_FILE_ATTRIBUTE_TYPE_INVALID;
+	  _g_file_attribute_value_set (&dest[i].value, &source[i].value);
+	}
     }
 
   if (dest_info->mask != NO_ATTRIBUTE_MASK)
@@ -354,7 +577,16 @@ g_file_info_set_attribute_mask (GFileInfo             *info,
       info->mask = g_file_attribute_matcher_ref (mask);
 
       /* Remove non-matching attributes */
-      for (i = 0; i < info->attributes->len; i++)
+      for (i = 0; i < N_FIXED_ATTRIBUTES; i++)
+	if ((info->fixed_set & (1 << i)) &&
+	    !g_file_attribute_matcher_matches_id (mask,
+						  get_fixed_slot_id (i)))
+	  {
+	    _g_file_attribute_value_clear (&info->fixed[i]);
+	    info->fixed_set &= ~(1 << i);
+	  }
+
+      for (i = 0; info->attributes && i < info->attributes->len; i++)
 	{
 	  attr = &g_array_index (info->attributes, GFileAttribute, i);
 	  if (!g_file_attribute_matcher_matches_id (mask,
@@ -399,6 +631,12 @@ g_file_info_clear_status (GFileInfo  *info)
   
   g_return_if_fail (G_IS_FILE_INFO (info));
 
+  for (i = 0; i < N_FIXED_ATTRIBUTES; i++)
+    info->fixed[i].status = G_FILE_ATTRIBUTE_STATUS_UNSET;
+
+  if (info->attributes == NULL)
+    return;
+
   attrs = (GFileAttribute *)info->attributes->data;
   for (i = 0; i < info->attributes->len; i++)
     attrs[i].value.status = G_FILE_ATTRIBUTE_STATUS_UNSET;
@@ -442,6 +680,17 @@ g_file_info_find_value (GFileInfo *info,
   GFileAttribute *attrs;
   int i;
 
+  i = get_fixed_slot (attr_id);
+  if (i != -1)
+    {
+      if (info->fixed_set & (1 << i))
+	return &info->fixed[i];
+      return NULL;
+    }
+
+  if (info->attributes == NULL)
+    return NULL;
+
   i = g_file_info_find_place (info, attr_id);
   attrs = (GFileAttribute *)info->attributes->data;
   if (i < info->attributes->len &&
@@ -501,17 +750,42 @@ g_file_info_list_attributes (GFileInfo  *info,
 {
   GPtrArray *names;
   GFileAttribute *attrs;
-  guint32 attribute;
+  guint32 attribute, fixed_attribute;
   guint32 ns_id = (name_space) ? lookup_namespace (name_space) : 0;
-  int i;
+  int i, n_attrs, slot;
  
   g_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
 
   names = g_ptr_array_new ();
-  attrs = (GFileAttribute *)info->attributes->data;
-  for (i = 0; i < info->attributes->len; i++)
+
+  attrs = NULL;
+  n_attrs = 0;
+  if (info->attributes)
     {
-      attribute = attrs[i].attribute;
+      attrs = (GFileAttribute *)info->attributes->data;
+      n_attrs = info->attributes->len;
+    }
+
+  /* Merge the fixed slots, which are in id order too, with the array */
+  slot = 0;
+  i = 0;
+  while (TRUE)
+    {
+      while (slot < N_FIXED_ATTRIBUTES && !(info->fixed_set & (1 << slot)))
+	slot++;
+      fixed_attribute = slot < N_FIXED_ATTRIBUTES ? get_fixed_slot_id (slot) : 0;
+
+      if (i < n_attrs &&
+	  (fixed_attribute == 0 || attrs[i].attribute < fixed_attribute))
+	attribute = attrs[i++].attribute;
+      else if (fixed_attribute != 0)
+	{
+	  attribute = fixed_attribute;
+	  slot++;
+	}
+      else
+	break;
+
       if (ns_id == 0 || GET_NS (attribute) == ns_id)
         g_ptr_array_add (names, g_strdup (get_attribute_for_id (attribute)));
     }
@@ -567,6 +841,20 @@ g_file_info_remove_attribute (GFileInfo  *info,
   g_return_if_fail (attribute != NULL && *attribute != '\0');
 
   attr_id = lookup_attribute (attribute);
+
+  i = get_fixed_slot (attr_id);
+  if (i != -1)
+    {
+      if (info->fixed_set & (1 << i))
+	{
+	  _g_file_attribute_value_clear (&info->fixed[i]);
+	  info->fixed_set &= ~(1 << i);
+	}
+      return;
+    }
+
+  if (info->attributes == NULL)
+    return;
   
   i = g_file_info_find_place (info, attr_id);
   attrs = (GFileAttribute *)info->attributes->data;
@@ -880,6 +1168,19 @@ g_file_info_create_value (GFileInfo *info,
   if (info->mask != NO_ATTRIBUTE_MASK &&
       !g_file_attribute_matcher_matches_id (info->mask, attr_id))
     return NULL;
+
+  i = get_fixed_slot (attr_id);
+  if (i != -1)
+    {
+      if (!(info->fixed_set & (1 << i)))
+	{
+	  memset (&info->fixed[i], 0, sizeof (GFileAttributeValue));
+	  info->fixed_set |= 1 << i;
+	}
+      return &info->fixed[i];
+    }
+
+  ensure_attributes (info);
   
   i = g_file_info_find_place (info, attr_id);
   
@@ -2074,6 +2375,53 @@ g_file_attribute_matcher_matches (GFileAttributeMatcher *matcher,
   return matcher_matches_id (matcher, lookup_attribute (attribute));
 }
 
+/* Returns TRUE if every attribute @matcher can match is one of the
+ * %NULL-terminated @attributes, i.e. it has no wildcards and asks for
+ * nothing else. A %NULL matcher matches nothing, so it is a subset. */
+gboolean
+_g_file_attribute_matcher_is_subset (GFileAttributeMatcher *matcher,
+				     const char * const    *attributes)
+{
+  SubMatcher *sub_matcher;
+  int i, j;
+
+  if (matcher == NULL)
+    return TRUE;
+
+  if (matcher->all)
+    return FALSE;
+
+  for (i = 0; ; i++)
+    {
+      if (i < ON_STACK_MATCHERS)
+	{
+	  if (matcher->sub_matchers[i].id == 0)
+	    break;
+	  sub_matcher = &matcher->sub_matchers[i];
+	}
+      else
+	{
+	  if (matcher->more_sub_matchers == NULL ||
+	      i - ON_STACK_MATCHERS >= matcher->more_sub_matchers->len)
+	    break;
+	  sub_matcher = &g_array_index (matcher->more_sub_matchers, SubMatcher,
+					i - ON_STACK_MATCHERS);
+	}
+
+      if (sub_matcher->mask != 0xffffffff)
+	return FALSE;
+
+      for (j = 0; attributes[j] != NULL; j++)
+	if (sub_matcher->id == lookup_attribute (attributes[j]))
+	  break;
+
+      if (attributes[j] == NULL)
+	return FALSE;
+    }
+
+  return TRUE;
+}
+
 /* return TRUE -> all */
 /**
  * g_file_attribute_matcher_enumerate_namespace:
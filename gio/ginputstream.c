@@ -20,6 +20,7 @@
  * Author: Alexander Larsson <alexl@redhat.com>
  */
 
+#define _GNU_SOURCE		/* For preadv2 */
 #include "config.h"
 #include <glib.h>
 #include "glibintl.h"
@@ -31,6 +32,14 @@
 #include "gsimpleasyncresult.h"
 #include "gioerror.h"
 
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <sys/uio.h>
+#include "gasynchelper.h"
+#include "gfiledescriptorbased.h"
+#include "giouring.h"
+#endif
+
 #include "gioalias.h"
 
 /**
@@ -53,6 +62,7 @@ G_DEFINE_TYPE (GInputStream, g_input_stream, G_TYPE_OBJECT);
 struct _GInputStreamPrivate {
   guint closed : 1;
   guint pending : 1;
+  guint nowait_unsupported : 1;
   GAsyncReadyCallback outstanding_callback;
 };
 
@@ -938,6 +948,7 @@ typedef struct {
   void              *buffer;
   gsize              count_requested;
   gssize             count_read;
+  GCancellable      *cancellable;
 } ReadData;
 
 static void
@@ -963,6 +974,128 @@ read_async_thread (GSimpleAsyncResult *res,
     }
 }
 
+#ifdef G_OS_UNIX
+static gboolean
+read_async_ready (GSimpleAsyncResult *res,
+		  GIOCondition        condition,
+		  int                 fd)
+{
+  ReadData *op;
+  GObject *object;
+  GInputStreamClass *class;
+  GError *error = NULL;
+
+  op = g_simple_async_result_get_op_res_gpointer (res);
+  object = g_async_result_get_source_object (G_ASYNC_RESULT (res));
+  class = G_INPUT_STREAM_GET_CLASS (object);
+
+  /* The fd polled readable, so read_fn won't block on it */
+  if (g_cancellable_set_error_if_cancelled (op->cancellable, &error))
+    op->count_read = -1;
+  else
+    op->count_read = class->read_fn (G_INPUT_STREAM (object),
+				     op->buffer, op->count_requested,
+				     op->cancellable, &error);
+  g_object_unref (object);
+
+  if (op->count_read == -1)
+    {
+      /* Spurious wakeup, keep waiting */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+	{
+	  g_error_free (error);
+	  return TRUE;
+	}
+
+      g_simple_async_result_set_from_error (res, error);
+      g_error_free (error);
+    }
+
+  /* Complete immediately, not in idle, since we're already in a mainloop callout */
+  g_simple_async_result_complete (res);
+
+  return FALSE;
+}
+
+/* Reads whatever is available from @fd without waiting for the disk,
+ * e.g. data already in the page cache. Returns %FALSE if the read
+ * would have to wait, in which case it must be done in a thread.
+ */
+static gboolean
+read_nowait (GInputStream *stream,
+	     int           fd,
+	     ReadData     *op)
+{
+#if defined (HAVE_PREADV2) && defined (RWF_NOWAIT)
+  struct iovec iov;
+  gssize res;
+  int errsv;
+
+  if (stream->priv->nowait_unsupported)
+    return FALSE;
+
+  iov.iov_base = op->buffer;
+  iov.iov_len = op->count_requested;
+
+  do
+    res = preadv2 (fd, &iov, 1, -1, RWF_NOWAIT);
+  while (res == -1 && errno == EINTR);
+
+  if (res == -1)
+    {
+      errsv = errno;
+
+      if (errsv == EOPNOTSUPP || errsv == ENOSYS || errsv == EINVAL)
+	stream->priv->nowait_unsupported = TRUE;
+
+      return FALSE;
+    }
+
+  op->count_read = res;
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static void
+read_async_uring_done (int      result,
+		       gpointer user_data)
+{
+  GSimpleAsyncResult *res = user_data;
+  GError *error = NULL;
+  ReadData *op;
+
+  op = g_simple_async_result_get_op_res_gpointer (res);
+
+  if (result < 0)
+    {
+      op->count_read = -1;
+      g_simple_async_result_set_error (res, G_IO_ERROR,
+				       g_io_error_from_errno (-result),
+				       _("Error reading from file: %s"),
+				       g_strerror (-result));
+    }
+  else if (g_cancellable_set_error_if_cancelled (op->cancellable, &error))
+    {
+      /* Same as the thread path: a cancelled read reports
+       * G_IO_ERROR_CANCELLED, even if the kernel already did it.
+       */
+      op->count_read = -1;
+      g_simple_async_result_set_from_error (res, error);
+      g_error_free (error);
+    }
+  else
+    op->count_read = result;
+
+  if (op->cancellable)
+    g_object_unref (op->cancellable);
+
+  g_simple_async_result_complete (res);
+  g_object_unref (res);
+}
+#endif
+
 static void
 g_input_stream_real_read_async (GInputStream        *stream,
 				void                *buffer,
@@ -980,7 +1113,57 @@ g_input_stream_real_read_async (GInputStream        *stream,
   g_simple_async_result_set_op_res_gpointer (res, op, g_free);
   op->buffer = buffer;
   op->count_requested = count;
-  
+  op->cancellable = cancellable;
+
+#ifdef G_OS_UNIX
+  /* File descriptor based streams don't need a thread if the fd can
+   * tell the main loop when it is readable, if the data is already in
+   * memory, or if io_uring can do the read.
+   */
+  if (G_IS_FILE_DESCRIPTOR_BASED (stream) &&
+      !g_cancellable_is_cancelled (cancellable))
+    {
+      GSource *source;
+      int fd;
+
+      fd = g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream));
+
+      if (_g_fd_is_pollable (fd))
+	{
+	  source = _g_fd_source_new (fd, G_IO_IN, cancellable);
+	  g_source_set_priority (source, io_priority);
+	  g_source_set_callback (source, (GSourceFunc)read_async_ready,
+				 res, g_object_unref);
+	  g_source_attach (source, NULL);
+	  g_source_unref (source);
+	  return;
+	}
+
+      if (read_nowait (stream, fd, op))
+	{
+	  g_simple_async_result_complete_in_idle (res);
+	  g_object_unref (res);
+	  return;
+	}
+
+      /* Reads from regular files always finish, so they can be left
+       * to the kernel without a way to cancel them. Cancellation is
+       * checked again when the read completes.
+       */
+      if (_g_fd_is_regular (fd))
+	{
+	  if (cancellable)
+	    g_object_ref (cancellable);
+
+	  if (_g_io_uring_read (fd, buffer, count, read_async_uring_done, res))
+	    return;
+
+	  if (cancellable)
+	    g_object_unref (cancellable);
+	}
+    }
+#endif
+
   g_simple_async_result_run_in_thread (res, read_async_thread, io_priority, cancellable);
   g_object_unref (res);
 }
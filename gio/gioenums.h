@@ -81,6 +81,26 @@ typedef enum {
 } GDataStreamNewlineType;
 
 
+/**
+ * GDataStreamFieldType:
+ * @G_DATA_STREAM_FIELD_BYTE: a single byte.
+ * @G_DATA_STREAM_FIELD_INT16: a signed or unsigned 16-bit integer.
+ * @G_DATA_STREAM_FIELD_INT32: a signed or unsigned 32-bit integer.
+ * @G_DATA_STREAM_FIELD_INT64: a signed or unsigned 64-bit integer.
+ *
+ * The type of a field in a #GDataStreamField description. Integers
+ * are converted using the byte order of the stream.
+ *
+ * Since: 2.22
+ **/
+typedef enum {
+  G_DATA_STREAM_FIELD_BYTE,
+  G_DATA_STREAM_FIELD_INT16,
+  G_DATA_STREAM_FIELD_INT32,
+  G_DATA_STREAM_FIELD_INT64
+} GDataStreamFieldType;
+
+
 /**
  * GFileAttributeType:
  * @G_FILE_ATTRIBUTE_TYPE_INVALID: indicates an invalid or uninitalized type.
@@ -38,6 +38,7 @@ typedef struct _GBufferedInputStream          GBufferedInputStream;
 typedef struct _GBufferedOutputStream         GBufferedOutputStream;
 typedef struct _GCancellable                  GCancellable;
 typedef struct _GDataInputStream              GDataInputStream;
+typedef struct _GDataStreamField              GDataStreamField;
 
 /**
  * GDrive:
@@ -49,6 +50,8 @@ typedef struct _GFileEnumerator               GFileEnumerator;
 typedef struct _GFileMonitor                  GFileMonitor;
 typedef struct _GFilterInputStream            GFilterInputStream;
 typedef struct _GFilterOutputStream           GFilterOutputStream;
+typedef struct _GOutputVector                 GOutputVector;
+typedef struct _GBufferedStreamStats          GBufferedStreamStats;
 
 /**
  * GFile:
@@ -191,6 +194,69 @@ typedef void (*GSimpleAsyncThreadFunc) (GSimpleAsyncResult *res,
                                         GObject *object,
                                         GCancellable *cancellable);
 
+/**
+ * GDataStreamField:
+ * @type: the type of the field in the stream.
+ * @offset: the offset of the field in the structure, as given by
+ *     G_STRUCT_OFFSET().
+ *
+ * Describes one field of a structure read with
+ * g_data_input_stream_read_struct() or written with
+ * g_data_output_stream_put_struct(). The fields are stored in the
+ * stream in the order they are described, without padding.
+ *
+ * Since: 2.22
+ **/
+struct _GDataStreamField
+{
+  GDataStreamFieldType type;
+  gsize                offset;
+};
+
+/**
+ * GOutputVector:
+ * @buffer: Pointer to a buffer of data to write.
+ * @size: the size of @buffer.
+ *
+ * Structure used for scatter/gather data output.
+ * You generally pass in an array of #GOutputVector<!-- -->s
+ * and the operation will use all the buffers as if they were
+ * one buffer.
+ *
+ * Since: 2.22
+ **/
+struct _GOutputVector
+{
+  gconstpointer buffer;
+  gsize         size;
+};
+
+/**
+ * GBufferedStreamStats:
+ * @calls: the number of reads, skips or writes done on the buffered stream.
+ * @base_calls: the number of reads, skips or writes done on the base stream.
+ * @bytes: the number of bytes transferred to or from the base stream.
+ * @resizes: the number of times the adaptive buffer size changed.
+ * @releases: the number of times an empty adaptive buffer was freed.
+ * @peak_size: the largest buffer size used so far.
+ *
+ * Statistics about a #GBufferedInputStream or #GBufferedOutputStream.
+ * Comparing @calls with @base_calls shows how many calls the buffer
+ * saves. See g_buffered_input_stream_get_stats() and
+ * g_buffered_output_stream_get_stats().
+ *
+ * Since: 2.22
+ **/
+struct _GBufferedStreamStats
+{
+  guint64 calls;
+  guint64 base_calls;
+  guint64 bytes;
+  guint   resizes;
+  guint   releases;
+  gsize   peak_size;
+};
+
 G_END_DECLS
 
 #endif /* __GIO_TYPES_H__ */
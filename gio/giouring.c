@@ -0,0 +1,513 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include "giouring.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "gioalias.h"
+
+/* An engine that runs file operations through io_uring instead of
+ * the GIOScheduler thread pool.
+ *
+ * Operations are put on the submission ring as they are requested,
+ * and handed to the kernel in a single io_uring_enter() call when the
+ * main loop is about to poll, so everything started during one main
+ * loop iteration costs one syscall. The kernel signals completions on
+ * an eventfd watched by a source in the default main context, whose
+ * dispatch reaps all finished entries and calls their callbacks.
+ *
+ * The functions return %FALSE, without ever calling @func, if the
+ * operation can't be queued: io_uring or the opcode is missing, the
+ * rings are full, or GIO_USE_IO_URING is set to "0". The caller
+ * should then do the operation in a thread, as before.
+ *
+ * Any buffer or filename passed in must stay valid until @func is
+ * called.
+ */
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+#define RING_ENTRIES 256
+#define RING_POLL_INTERVAL 10 /* ms */
+
+typedef struct {
+  GIOUringFunc func;
+  gpointer     user_data;
+} Request;
+
+typedef struct {
+  GSource source;
+  GPollFD pollfd;
+
+  int ring_fd;
+  gboolean supported[IORING_OP_LAST];
+
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned sq_entries;
+  struct io_uring_sqe *sqes;
+  unsigned to_submit;
+
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  unsigned cq_entries;
+  struct io_uring_cqe *cqes;
+  unsigned in_flight;
+} Ring;
+
+/* Protects the rings, operations may be started from any thread */
+G_LOCK_DEFINE_STATIC (uring);
+
+/* Called with the lock held */
+static void
+ring_submit (Ring *ring)
+{
+  int res;
+
+  while (ring->to_submit > 0)
+    {
+      res = syscall (__NR_io_uring_enter, ring->ring_fd,
+		     ring->to_submit, 0, 0, NULL, 0);
+      if (res == -1 && errno == EINTR)
+	continue;
+
+      /* On EAGAIN or EBUSY the entries stay queued and are
+       * submitted again the next time the main loop polls.
+       */
+      if (res <= 0)
+	break;
+
+      ring->to_submit -= res;
+    }
+}
+
+static gboolean
+ring_has_completions (Ring *ring)
+{
+  return *ring->cq_head != __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE);
+}
+
+static gboolean
+ring_source_prepare (GSource *source,
+		     gint    *timeout)
+{
+  Ring *ring = (Ring *)source;
+  gboolean ready;
+
+  G_LOCK (uring);
+  ring_submit (ring);
+  ready = ring_has_completions (ring);
+  /* Without the eventfd, nothing wakes the main loop on completion */
+  if (ring->pollfd.fd < 0 && ring->in_flight > 0)
+    *timeout = RING_POLL_INTERVAL;
+  else
+    *timeout = -1;
+  G_UNLOCK (uring);
+
+  return ready;
+}
+
+static gboolean
+ring_source_check (GSource *source)
+{
+  Ring *ring = (Ring *)source;
+  gboolean ready;
+
+  G_LOCK (uring);
+  ready = ring->pollfd.revents != 0 || ring_has_completions (ring);
+  G_UNLOCK (uring);
+
+  return ready;
+}
+
+static gboolean
+ring_source_dispatch (GSource     *source,
+		      GSourceFunc  callback,
+		      gpointer     user_data)
+{
+  Ring *ring = (Ring *)source;
+  struct io_uring_cqe *cqe;
+  Request *request;
+  guint64 counter;
+  gssize n_read;
+  unsigned head;
+  int res;
+
+  if (ring->pollfd.revents != 0)
+    {
+      /* Clear the eventfd counter. EAGAIN just means another wakeup
+       * already cleared it; the rings themselves are checked below.
+       */
+      do
+	n_read = read (ring->pollfd.fd, &counter, sizeof (counter));
+      while (n_read == -1 && errno == EINTR);
+
+      if (n_read == -1 && errno != EAGAIN)
+	{
+	  /* The fd would stay readable and make the main loop spin,
+	   * so stop watching it and poll for completions instead.
+	   */
+	  g_warning ("Error reading from io_uring eventfd: %s",
+		     g_strerror (errno));
+	  g_source_remove_poll (source, &ring->pollfd);
+	  ring->pollfd.fd = -1;
+	  ring->pollfd.revents = 0;
+	}
+    }
+
+  while (TRUE)
+    {
+      G_LOCK (uring);
+
+      if (!ring_has_completions (ring))
+	{
+	  G_UNLOCK (uring);
+	  break;
+	}
+
+      head = *ring->cq_head;
+      cqe = &ring->cqes[head & *ring->cq_mask];
+      request = (Request *)(gsize)cqe->user_data;
+      res = cqe->res;
+      __atomic_store_n (ring->cq_head, head + 1, __ATOMIC_RELEASE);
+      ring->in_flight--;
+
+      G_UNLOCK (uring);
+
+      request->func (res, request->user_data);
+      g_slice_free (Request, request);
+    }
+
+  return TRUE;
+}
+
+static GSourceFuncs ring_source_funcs = {
+  ring_source_prepare,
+  ring_source_check,
+  ring_source_dispatch,
+  NULL
+};
+
+static Ring *
+ring_new (void)
+{
+  struct io_uring_params params;
+  struct io_uring_probe *probe;
+  GSource *source;
+  Ring *ring;
+  const char *use;
+  gsize ring_size, probe_size;
+  char *ring_mem;
+  struct io_uring_sqe *sqes;
+  int ring_fd, event_fd, i;
+
+  use = g_getenv ("GIO_USE_IO_URING");
+  if (use != NULL && strcmp (use, "0") == 0)
+    return NULL;
+
+  memset (&params, 0, sizeof (params));
+  ring_fd = syscall (__NR_io_uring_setup, RING_ENTRIES, &params);
+  if (ring_fd == -1)
+    return NULL;
+
+  /* Reads and writes use the file position, like read() and write() */
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 ||
+      (params.features & IORING_FEAT_RW_CUR_POS) == 0)
+    {
+      close (ring_fd);
+      return NULL;
+    }
+
+  ring_size = MAX (params.sq_off.array + params.sq_entries * sizeof (unsigned),
+		   params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe));
+  ring_mem = mmap (NULL, ring_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (ring_mem == MAP_FAILED)
+    {
+      close (ring_fd);
+      return NULL;
+    }
+
+  sqes = mmap (NULL, params.sq_entries * sizeof (struct io_uring_sqe),
+	       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	       ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    {
+      munmap (ring_mem, ring_size);
+      close (ring_fd);
+      return NULL;
+    }
+
+  event_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd == -1 ||
+      syscall (__NR_io_uring_register, ring_fd,
+	       IORING_REGISTER_EVENTFD, &event_fd, 1) == -1)
+    {
+      if (event_fd != -1)
+	close (event_fd);
+      munmap (sqes, params.sq_entries * sizeof (struct io_uring_sqe));
+      munmap (ring_mem, ring_size);
+      close (ring_fd);
+      return NULL;
+    }
+
+  source = g_source_new (&ring_source_funcs, sizeof (Ring));
+  ring = (Ring *)source;
+
+  ring->ring_fd = ring_fd;
+
+  probe_size = sizeof (struct io_uring_probe) +
+    IORING_OP_LAST * sizeof (struct io_uring_probe_op);
+  probe = g_malloc0 (probe_size);
+  if (syscall (__NR_io_uring_register, ring_fd,
+	       IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0)
+    {
+      for (i = 0; i < probe->ops_len && i < IORING_OP_LAST; i++)
+	ring->supported[i] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+  g_free (probe);
+
+  ring->sq_head = (unsigned *)(ring_mem + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(ring_mem + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(ring_mem + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(ring_mem + params.sq_off.array);
+  ring->sq_entries = params.sq_entries;
+  ring->sqes = sqes;
+
+  ring->cq_head = (unsigned *)(ring_mem + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(ring_mem + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(ring_mem + params.cq_off.ring_mask);
+  ring->cq_entries = params.cq_entries;
+  ring->cqes = (struct io_uring_cqe *)(ring_mem + params.cq_off.cqes);
+
+  ring->pollfd.fd = event_fd;
+  ring->pollfd.events = G_IO_IN;
+  g_source_add_poll (source, &ring->pollfd);
+
+  /* Lives as long as the process */
+  g_source_attach (source, NULL);
+
+  return ring;
+}
+
+static Ring *
+get_ring (void)
+{
+  static volatile gsize ring_initialized = 0;
+  static Ring *ring = NULL;
+
+  if (g_once_init_enter (&ring_initialized))
+    {
+      ring = ring_new ();
+      g_once_init_leave (&ring_initialized, 1);
+    }
+
+  return ring;
+}
+
+/* Returns a cleared submission entry for @opcode with the lock held,
+ * or %NULL without it.
+ */
+static struct io_uring_sqe *
+ring_begin (Ring         **ring_out,
+	    guint8         opcode,
+	    GIOUringFunc   func,
+	    gpointer       user_data)
+{
+  struct io_uring_sqe *sqe;
+  Request *request;
+  Ring *ring;
+  unsigned tail, index;
+
+  ring = get_ring ();
+  if (ring == NULL || !ring->supported[opcode])
+    return NULL;
+
+  G_LOCK (uring);
+
+  tail = *ring->sq_tail;
+  if (tail - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+    ring_submit (ring);
+
+  /* Never have more operations in flight than the completion ring
+   * holds, so no completion can be dropped.
+   */
+  if (tail - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries ||
+      ring->in_flight >= ring->cq_entries)
+    {
+      G_UNLOCK (uring);
+      return NULL;
+    }
+
+  index = tail & *ring->sq_mask;
+  sqe = &ring->sqes[index];
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = opcode;
+
+  request = g_slice_new (Request);
+  request->func = func;
+  request->user_data = user_data;
+  sqe->user_data = (guint64)(gsize)request;
+
+  ring->sq_array[index] = index;
+
+  *ring_out = ring;
+  return sqe;
+}
+
+/* Queues the entry from ring_begin() and drops the lock */
+static void
+ring_commit (Ring *ring)
+{
+  __atomic_store_n (ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+  ring->to_submit++;
+  ring->in_flight++;
+
+  /* Queued entries are submitted when the main loop prepares to poll.
+   * If another thread owns the main context it may be sleeping in
+   * poll() already, so submit right away.
+   */
+  if (g_main_context_acquire (NULL))
+    g_main_context_release (NULL);
+  else
+    ring_submit (ring);
+
+  G_UNLOCK (uring);
+}
+
+#endif
+
+gboolean
+_g_io_uring_read (int           fd,
+		  void         *buffer,
+		  gsize         count,
+		  GIOUringFunc  func,
+		  gpointer      user_data)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  struct io_uring_sqe *sqe;
+  Ring *ring;
+
+  sqe = ring_begin (&ring, IORING_OP_READ, func, user_data);
+  if (sqe == NULL)
+    return FALSE;
+
+  sqe->fd = fd;
+  sqe->addr = (guint64)(gsize)buffer;
+  sqe->len = MIN (count, G_MAXINT);
+  sqe->off = (guint64)-1;
+  ring_commit (ring);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+gboolean
+_g_io_uring_write (int           fd,
+		   const void   *buffer,
+		   gsize         count,
+		   GIOUringFunc  func,
+		   gpointer      user_data)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  struct io_uring_sqe *sqe;
+  Ring *ring;
+
+  sqe = ring_begin (&ring, IORING_OP_WRITE, func, user_data);
+  if (sqe == NULL)
+    return FALSE;
+
+  sqe->fd = fd;
+  sqe->addr = (guint64)(gsize)buffer;
+  sqe->len = MIN (count, G_MAXINT);
+  sqe->off = (guint64)-1;
+  ring_commit (ring);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+gboolean
+_g_io_uring_openat (const char   *filename,
+		    int           flags,
+		    int           mode,
+		    GIOUringFunc  func,
+		    gpointer      user_data)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  struct io_uring_sqe *sqe;
+  Ring *ring;
+
+  sqe = ring_begin (&ring, IORING_OP_OPENAT, func, user_data);
+  if (sqe == NULL)
+    return FALSE;
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (guint64)(gsize)filename;
+  sqe->len = mode;
+  sqe->open_flags = flags;
+  ring_commit (ring);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+gboolean
+_g_io_uring_close (int           fd,
+		   GIOUringFunc  func,
+		   gpointer      user_data)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+  struct io_uring_sqe *sqe;
+  Ring *ring;
+
+  sqe = ring_begin (&ring, IORING_OP_CLOSE, func, user_data);
+  if (sqe == NULL)
+    return FALSE;
+
+  sqe->fd = fd;
+  ring_commit (ring);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
@@ -0,0 +1,53 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_IO_URING_H__
+#define __G_IO_URING_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* @result is what the syscall would have returned, or -errno */
+typedef void (*GIOUringFunc) (int      result,
+			      gpointer user_data);
+
+gboolean _g_io_uring_read   (int           fd,
+			     void         *buffer,
+			     gsize         count,
+			     GIOUringFunc  func,
+			     gpointer      user_data);
+gboolean _g_io_uring_write  (int           fd,
+			     const void   *buffer,
+			     gsize         count,
+			     GIOUringFunc  func,
+			     gpointer      user_data);
+gboolean _g_io_uring_openat (const char   *filename,
+			     int           flags,
+			     int           mode,
+			     GIOUringFunc  func,
+			     gpointer      user_data);
+gboolean _g_io_uring_close  (int           fd,
+			     GIOUringFunc  func,
+			     gpointer      user_data);
+
+G_END_DECLS
+
+#endif /* __G_IO_URING_H__ */
@@ -20,6 +20,7 @@
  * Author: Alexander Larsson <alexl@redhat.com>
  */
 
+#define _GNU_SOURCE		/* For copy_file_range */
 #include "config.h"
 
 #include <sys/types.h>
@@ -46,6 +47,14 @@
 #include <sys/mount.h>
 #endif
 
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 #ifndef O_BINARY
 #define O_BINARY 0
 #endif
@@ -83,6 +92,7 @@
 #include "gmountprivate.h"
 #include "gunixmounts.h"
 #include "gioerror.h"
+#include "giouring.h"
 #include <glib/gstdio.h>
 #include "glibintl.h"
 
@@ -1305,6 +1315,99 @@ g_local_file_read (GFile         *file,
   return _g_local_file_input_stream_new (fd);
 }
 
+typedef struct {
+  GSimpleAsyncResult *res;
+  GCancellable       *cancellable;
+} ReadAsyncData;
+
+static void
+read_async_open_done (int      result,
+		      gpointer user_data)
+{
+  ReadAsyncData *data = user_data;
+  GError *error = NULL;
+  struct stat buf;
+  int fd = result;
+
+  if (fd < 0)
+    g_simple_async_result_set_error (data->res, G_IO_ERROR,
+				     g_io_error_from_errno (-fd),
+				     _("Error opening file: %s"),
+				     g_strerror (-fd));
+  else if (g_cancellable_set_error_if_cancelled (data->cancellable, &error))
+    {
+      close (fd);
+      g_simple_async_result_set_from_error (data->res, error);
+      g_error_free (error);
+    }
+  else if (fstat (fd, &buf) == 0 && S_ISDIR (buf.st_mode))
+    {
+      close (fd);
+      g_simple_async_result_set_error (data->res, G_IO_ERROR,
+				       G_IO_ERROR_IS_DIRECTORY,
+				       "%s", _("Can't open directory"));
+    }
+  else
+    g_simple_async_result_set_op_res_gpointer (data->res,
+					       _g_local_file_input_stream_new (fd),
+					       g_object_unref);
+
+  g_simple_async_result_complete (data->res);
+  g_object_unref (data->res);
+  if (data->cancellable)
+    g_object_unref (data->cancellable);
+  g_slice_free (ReadAsyncData, data);
+}
+
+static void
+g_local_file_read_async (GFile               *file,
+			 int                  io_priority,
+			 GCancellable        *cancellable,
+			 GAsyncReadyCallback  callback,
+			 gpointer             user_data)
+{
+  GLocalFile *local = G_LOCAL_FILE (file);
+  GFileIface *default_iface;
+  ReadAsyncData *data;
+
+  if (!g_cancellable_is_cancelled (cancellable))
+    {
+      data = g_slice_new (ReadAsyncData);
+      data->res = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+					     g_local_file_read_async);
+      data->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+
+      if (_g_io_uring_openat (local->filename, O_RDONLY|O_BINARY, 0,
+			      read_async_open_done, data))
+	return;
+
+      g_object_unref (data->res);
+      if (data->cancellable)
+	g_object_unref (data->cancellable);
+      g_slice_free (ReadAsyncData, data);
+    }
+
+  default_iface = g_type_default_interface_peek (G_TYPE_FILE);
+  (default_iface->read_async) (file, io_priority, cancellable, callback, user_data);
+}
+
+static GFileInputStream *
+g_local_file_read_finish (GFile         *file,
+			  GAsyncResult  *res,
+			  GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (res);
+  GFileIface *default_iface;
+
+  if (g_simple_async_result_get_source_tag (simple) != g_local_file_read_async)
+    {
+      default_iface = g_type_default_interface_peek (G_TYPE_FILE);
+      return (default_iface->read_finish) (file, res, error);
+    }
+
+  return g_object_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
 static GFileOutputStream *
 g_local_file_append_to (GFile             *file,
 			GFileCreateFlags   flags,
@@ -2083,6 +2186,185 @@ g_local_file_make_symbolic_link (GFile         *file,
 }
 
 
+/* The size of each transfer between progress callbacks and
+ * cancellation checks
+ */
+#define COPY_CHUNK_SIZE (1024 * 1024)
+
+typedef enum {
+  COPY_METHOD_COPY_FILE_RANGE,
+  COPY_METHOD_SENDFILE,
+  COPY_METHOD_READ_WRITE
+} CopyMethod;
+
+/* Returns TRUE if @errsv from a kernel copy means that the method is
+ * not available for these files, rather than that the copy failed.
+ */
+static gboolean
+copy_method_unsupported (int errsv)
+{
+  return errsv == ENOSYS || errsv == EINVAL || errsv == EXDEV ||
+#ifdef EOPNOTSUPP
+         errsv == EOPNOTSUPP ||
+#endif
+         errsv == EBADF;
+}
+
+static gboolean
+copy_fd_with_progress (int                     in_fd,
+                       int                     out_fd,
+                       goffset                 total_size,
+                       GCancellable           *cancellable,
+                       GFileProgressCallback   progress_callback,
+                       gpointer                progress_callback_data,
+                       GError                **error)
+{
+  CopyMethod method;
+  goffset current_size;
+  gssize n_read, n_written;
+  char *buffer, *p;
+  int errsv;
+
+#if defined(HAVE_LINUX_FS_H) && defined(FICLONE)
+  /* Sharing the extents is the cheapest copy of all, if the
+   * filesystem can do it
+   */
+  if (ioctl (out_fd, FICLONE, in_fd) == 0)
+    {
+      if (progress_callback)
+        progress_callback (total_size, total_size, progress_callback_data);
+      return TRUE;
+    }
+#endif
+
+#if defined(HAVE_COPY_FILE_RANGE)
+  method = COPY_METHOD_COPY_FILE_RANGE;
+#elif defined(HAVE_SENDFILE)
+  method = COPY_METHOD_SENDFILE;
+#else
+  method = COPY_METHOD_READ_WRITE;
+#endif
+
+  buffer = NULL;
+  current_size = 0;
+  while (TRUE)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        goto err;
+
+      switch (method)
+        {
+#ifdef HAVE_COPY_FILE_RANGE
+        case COPY_METHOD_COPY_FILE_RANGE:
+          n_written = copy_file_range (in_fd, NULL, out_fd, NULL,
+                                       COPY_CHUNK_SIZE, 0);
+          break;
+#endif
+#ifdef HAVE_SENDFILE
+        case COPY_METHOD_SENDFILE:
+          n_written = sendfile (out_fd, in_fd, NULL, COPY_CHUNK_SIZE);
+          break;
+#endif
+        case COPY_METHOD_READ_WRITE:
+        default:
+          if (buffer == NULL)
+            buffer = g_malloc (1024 * 64);
+
+          n_read = read (in_fd, buffer, 1024 * 64);
+          if (n_read == -1)
+            {
+              errsv = errno;
+              if (errsv == EINTR)
+                continue;
+
+              g_set_error (error, G_IO_ERROR,
+                           g_io_error_from_errno (errsv),
+                           _("Error reading from file: %s"),
+                           g_strerror (errsv));
+              goto err;
+            }
+
+          p = buffer;
+          n_written = n_read;
+          while (n_read > 0)
+            {
+              gssize res;
+
+              res = write (out_fd, p, n_read);
+              if (res == -1)
+                {
+                  errsv = errno;
+                  if (errsv == EINTR)
+                    continue;
+
+                  g_set_error (error, G_IO_ERROR,
+                               g_io_error_from_errno (errsv),
+                               _("Error writing to file: %s"),
+                               g_strerror (errsv));
+                  goto err;
+                }
+              p += res;
+              n_read -= res;
+            }
+          break;
+        }
+
+      if (n_written == -1)
+        {
+          errsv = errno;
+          if (errsv == EINTR)
+            continue;
+
+          if (copy_method_unsupported (errsv))
+            {
+              /* The file offsets are where the kernel left them,
+               * so the next method carries on from there
+               */
+              method++;
+              continue;
+            }
+
+          g_set_error (error, G_IO_ERROR,
+                       g_io_error_from_errno (errsv),
+                       _("Error copying file: %s"),
+                       g_strerror (errsv));
+          goto err;
+        }
+
+      if (n_written == 0)
+        {
+          /* Some files, like the ones in /proc, claim to be empty
+           * to the kernel copy methods; make sure with a real read
+           */
+          if (current_size == 0 && method != COPY_METHOD_READ_WRITE)
+            {
+              method = COPY_METHOD_READ_WRITE;
+              continue;
+            }
+          break;
+        }
+
+      current_size += n_written;
+
+      if (progress_callback)
+        progress_callback (current_size, MAX (total_size, current_size),
+                           progress_callback_data);
+    }
+
+  g_free (buffer);
+
+  /* Make sure we send full copied size */
+  if (progress_callback)
+    progress_callback (current_size, MAX (total_size, current_size),
+                       progress_callback_data);
+
+  return TRUE;
+
+ err:
+  g_free (buffer);
+  return FALSE;
+}
+
 static gboolean
 g_local_file_copy (GFile                  *source,
 		   GFile                  *destination,
@@ -2092,9 +2374,86 @@ g_local_file_copy (GFile                  *source,
 		   gpointer                progress_callback_data,
 		   GError                **error)
 {
-  /* Fall back to default copy */
-  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Copy not supported");
-  return FALSE;
+  GLocalFile *local_source, *local_destination;
+  GFileInputStream *in;
+  GFileOutputStream *out;
+  struct stat statbuf;
+  gboolean res;
+  int stat_res;
+
+  if (!G_IS_LOCAL_FILE (source) ||
+      !G_IS_LOCAL_FILE (destination))
+    {
+      /* Fall back to default copy */
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Copy not supported");
+      return FALSE;
+    }
+
+  local_source = G_LOCAL_FILE (source);
+  local_destination = G_LOCAL_FILE (destination);
+
+  if (flags & G_FILE_COPY_NOFOLLOW_SYMLINKS)
+    stat_res = g_lstat (local_source->filename, &statbuf);
+  else
+    stat_res = g_stat (local_source->filename, &statbuf);
+
+  /* Only regular files are copied here. Symlinks, directories, special
+   * files and missing sources are left to the default copy, which also
+   * knows which error to report for them.
+   */
+  if (stat_res != 0 || !S_ISREG (statbuf.st_mode))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Copy not supported");
+      return FALSE;
+    }
+
+  in = g_local_file_read (source, cancellable, error);
+  if (in == NULL)
+    return FALSE;
+
+  if (flags & G_FILE_COPY_OVERWRITE)
+    out = _g_local_file_output_stream_replace (local_destination->filename,
+                                               NULL,
+                                               flags & G_FILE_COPY_BACKUP,
+                                               G_FILE_CREATE_REPLACE_DESTINATION,
+                                               cancellable, error);
+  else
+    out = _g_local_file_output_stream_create (local_destination->filename,
+                                              0, cancellable, error);
+
+  if (out == NULL)
+    {
+      g_object_unref (in);
+      return FALSE;
+    }
+
+  res = copy_fd_with_progress (_g_local_file_input_stream_get_fd (G_LOCAL_FILE_INPUT_STREAM (in)),
+                               _g_local_file_output_stream_get_fd (G_LOCAL_FILE_OUTPUT_STREAM (out)),
+                               statbuf.st_size,
+                               cancellable,
+                               progress_callback, progress_callback_data,
+                               error);
+  if (!res)
+    error = NULL; /* Ignore further errors */
+
+  /* Don't care about errors in source here */
+  g_input_stream_close (G_INPUT_STREAM (in), cancellable, NULL);
+
+  /* But write errors on close are bad! */
+  if (!g_output_stream_close (G_OUTPUT_STREAM (out), cancellable, error))
+    res = FALSE;
+
+  g_object_unref (in);
+  g_object_unref (out);
+
+  if (!res)
+    return FALSE;
+
+  /* Ignore errors here. Failure to copy metadata is not a hard error */
+  g_file_copy_attributes (source, destination,
+			  flags, cancellable, NULL);
+
+  return TRUE;
 }
 
 static gboolean
@@ -2285,6 +2644,8 @@ g_local_file_file_iface_init (GFileIface *iface)
   iface->set_attribute = g_local_file_set_attribute;
   iface->set_attributes_from_info = g_local_file_set_attributes_from_info;
   iface->read_fn = g_local_file_read;
+  iface->read_async = g_local_file_read_async;
+  iface->read_finish = g_local_file_read_finish;
   iface->append_to = g_local_file_append_to;
   iface->create = g_local_file_create;
   iface->replace = g_local_file_replace;
@@ -20,6 +20,7 @@
  * Author: Alexander Larsson <alexl@redhat.com>
  */
 
+#define _GNU_SOURCE		/* For getdents64 */
 #include "config.h"
 
 #include <glib.h>
@@ -27,6 +28,8 @@
 #include <glocalfileinfo.h>
 #include <glocalfile.h>
 #include <gioerror.h>
+#include <gcancellable.h>
+#include <gsimpleasyncresult.h>
 #include <string.h>
 #include <stdlib.h>
 #include "glibintl.h"
@@ -35,12 +38,6 @@
 
 #define CHUNK_SIZE 1000
 
-  /* TODO:
-   *  It would be nice to use the dirent->d_type to check file type without
-   *  needing to stat each files on linux and other systems that support it.
-   *  (question: does that following symlink or not?)
-   */
-
 #ifdef G_OS_WIN32
 #define USE_GDIR
 #endif
@@ -50,10 +47,26 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_GETDENTS64
+/* Read the directory with getdents64() straight into a large buffer.
+ * The entry names are used in place rather than copied out.
+ */
+#define USE_GETDENTS
+#define GETDENTS_BUFFER_SIZE (64 * 1024)
+/* Every record holds at least the header, a one byte name and a nul */
+#define GETDENTS_MAX_ENTRIES \
+  (GETDENTS_BUFFER_SIZE / (G_STRUCT_OFFSET (struct dirent64, d_name) + 2))
+#endif
 
 typedef struct {
   char *name;
   long inode;
+  GFileType type;  /* from d_type, G_FILE_TYPE_UNKNOWN if not known */
 } DirEntry;
 
 #endif
@@ -66,17 +79,29 @@ struct _GLocalFileEnumerator
   char *filename;
   char *attributes;
   GFileQueryInfoFlags flags;
+  GLocalFileInfoPlan *plan;
 
   gboolean got_parent_info;
   GLocalParentFileInfo parent_info;
   
 #ifdef USE_GDIR
   GDir *dir;
+#else
+#ifdef USE_GETDENTS
+  int dir_fd;
+  char *dents;
 #else
   DIR *dir;
+#endif
   DirEntry *entries;
   int entries_pos;
   gboolean at_end;
+
+  /* If set, entries whose type is known from d_type need no stat */
+  gboolean file_type_is_enough;
+
+  /* PrefetchSlots left over from next_files_async(), in read order */
+  GQueue prefetched;
 #endif
   
   gboolean follow_symlinks;
@@ -91,12 +116,28 @@ static GFileInfo *g_local_file_enumerator_next_file (GFileEnumerator  *enumerato
 static gboolean   g_local_file_enumerator_close     (GFileEnumerator  *enumerator,
 						     GCancellable     *cancellable,
 						     GError          **error);
+#ifndef USE_GDIR
+static void       g_local_file_enumerator_next_files_async  (GFileEnumerator      *enumerator,
+							     int                   num_files,
+							     int                   io_priority,
+							     GCancellable         *cancellable,
+							     GAsyncReadyCallback   callback,
+							     gpointer              user_data);
+static GList *    g_local_file_enumerator_next_files_finish (GFileEnumerator      *enumerator,
+							     GAsyncResult         *result,
+							     GError              **error);
+#endif
 
 
 static void
 free_entries (GLocalFileEnumerator *local)
 {
 #ifndef USE_GDIR
+#ifdef USE_GETDENTS
+  /* The names point into local->dents */
+  g_free (local->entries);
+  g_free (local->dents);
+#else
   int i;
 
   if (local->entries != NULL)
@@ -107,29 +148,75 @@ free_entries (GLocalFileEnumerator *local)
       g_free (local->entries);
     }
 #endif
+#endif
 }
 
 static void
-g_local_file_enumerator_finalize (GObject *object)
+close_dir (GLocalFileEnumerator *local)
 {
-  GLocalFileEnumerator *local;
-
-  local = G_LOCAL_FILE_ENUMERATOR (object);
-
-  g_free (local->filename);
-  g_file_attribute_matcher_unref (local->matcher);
+#ifdef USE_GDIR
   if (local->dir)
     {
-#ifdef USE_GDIR
       g_dir_close (local->dir);
+      local->dir = NULL;
+    }
+#elif defined (USE_GETDENTS)
+  if (local->dir_fd != -1)
+    {
+      close (local->dir_fd);
+      local->dir_fd = -1;
+    }
 #else
+  if (local->dir)
+    {
       closedir (local->dir);
-#endif      
       local->dir = NULL;
     }
+#endif
+}
+
+#ifndef USE_GDIR
+/* The result for one directory entry of next_files_async(): an info
+ * or an error, or only the name if the entry was read but the query
+ * was cancelled.
+ */
+typedef struct {
+  char *name;
+  GFileInfo *info;
+  GError *error;
+} PrefetchSlot;
+
+static void
+prefetch_slot_free (PrefetchSlot *slot)
+{
+  g_free (slot->name);
+  if (slot->info)
+    g_object_unref (slot->info);
+  if (slot->error)
+    g_error_free (slot->error);
+  g_slice_free (PrefetchSlot, slot);
+}
+#endif
+
+static void
+g_local_file_enumerator_finalize (GObject *object)
+{
+  GLocalFileEnumerator *local;
+
+  local = G_LOCAL_FILE_ENUMERATOR (object);
+
+  g_free (local->filename);
+  g_file_attribute_matcher_unref (local->matcher);
+  _g_local_file_info_plan_free (local->plan);
+  close_dir (local);
 
   free_entries (local);
 
+#ifndef USE_GDIR
+  g_queue_foreach (&local->prefetched, (GFunc)prefetch_slot_free, NULL);
+  g_queue_clear (&local->prefetched);
+#endif
+
   G_OBJECT_CLASS (g_local_file_enumerator_parent_class)->finalize (object);
 }
 
@@ -144,11 +231,18 @@ g_local_file_enumerator_class_init (GLocalFileEnumeratorClass *klass)
 
   enumerator_class->next_file = g_local_file_enumerator_next_file;
   enumerator_class->close_fn = g_local_file_enumerator_close;
+#ifndef USE_GDIR
+  enumerator_class->next_files_async = g_local_file_enumerator_next_files_async;
+  enumerator_class->next_files_finish = g_local_file_enumerator_next_files_finish;
+#endif
 }
 
 static void
 g_local_file_enumerator_init (GLocalFileEnumerator *local)
 {
+#ifdef USE_GETDENTS
+  local->dir_fd = -1;
+#endif
 }
 
 #ifdef USE_GDIR
@@ -216,6 +310,21 @@ _g_local_file_enumerator_new (GLocalFile *file,
       g_free (filename);
       return NULL;
     }
+#elif defined (USE_GETDENTS)
+  int dir_fd;
+  int errsv;
+
+  dir_fd = open (filename, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd == -1)
+    {
+      errsv = errno;
+
+      g_set_error_literal (error, G_IO_ERROR,
+                           g_io_error_from_errno (errsv),
+                           g_strerror (errsv));
+      g_free (filename);
+      return NULL;
+    }
 #else
   DIR *dir;
   int errsv;
@@ -238,10 +347,18 @@ _g_local_file_enumerator_new (GLocalFile *file,
                         "container", file,
                         NULL);
 
+#ifdef USE_GETDENTS
+  local->dir_fd = dir_fd;
+#else
   local->dir = dir;
+#endif
   local->filename = filename;
   local->matcher = g_file_attribute_matcher_new (attributes);
   local->flags = flags;
+  local->plan = _g_local_file_info_plan_new (local->matcher);
+#ifndef USE_GDIR
+  local->file_type_is_enough = _g_local_file_info_file_type_is_enough (local->matcher);
+#endif
   
   return G_FILE_ENUMERATOR (local);
 }
@@ -257,57 +374,248 @@ sort_by_inode (const void *_a, const void *_b)
   return a->inode - b->inode;
 }
 
-static const char *
-next_file_helper (GLocalFileEnumerator *local)
+static GFileType
+file_type_from_dirent (unsigned char d_type)
+{
+#ifdef DT_UNKNOWN
+  switch (d_type)
+    {
+    case DT_REG:
+      return G_FILE_TYPE_REGULAR;
+    case DT_DIR:
+      return G_FILE_TYPE_DIRECTORY;
+    case DT_LNK:
+      return G_FILE_TYPE_SYMBOLIC_LINK;
+    case DT_CHR:
+    case DT_BLK:
+    case DT_FIFO:
+    case DT_SOCK:
+      return G_FILE_TYPE_SPECIAL;
+    default:
+      break;
+    }
+#endif
+  return G_FILE_TYPE_UNKNOWN;
+}
+
+#ifdef USE_GETDENTS
+
+static int
+read_entries (GLocalFileEnumerator *local)
+{
+  struct dirent64 *entry;
+  ssize_t len, pos;
+  int i;
+
+  if (local->entries == NULL)
+    {
+      local->entries = g_new (DirEntry, GETDENTS_MAX_ENTRIES + 1);
+      local->dents = g_malloc (GETDENTS_BUFFER_SIZE);
+    }
+
+  /* A buffer may hold nothing but "." and "..", so keep going until
+   * we have something or reach the end.
+   */
+  i = 0;
+  while (i == 0)
+    {
+      len = getdents64 (local->dir_fd, local->dents, GETDENTS_BUFFER_SIZE);
+      if (len <= 0)
+	break;
+
+      for (pos = 0; pos < len; pos += entry->d_reclen)
+	{
+	  entry = (struct dirent64 *) (local->dents + pos);
+
+	  if (0 == strcmp (entry->d_name, ".") ||
+	      0 == strcmp (entry->d_name, ".."))
+	    continue;
+
+	  local->entries[i].name = entry->d_name;
+	  local->entries[i].inode = entry->d_ino;
+	  local->entries[i].type = file_type_from_dirent (entry->d_type);
+	  i++;
+	}
+    }
+
+  return i;
+}
+
+#else
+
+static int
+read_entries (GLocalFileEnumerator *local)
 {
   struct dirent *entry;
-  const char *filename;
   int i;
 
+  if (local->entries == NULL)
+    local->entries = g_new (DirEntry, CHUNK_SIZE + 1);
+  else
+    {
+      /* Restart by clearing old names */
+      for (i = 0; local->entries[i].name != NULL; i++)
+	g_free (local->entries[i].name);
+    }
+      
+  for (i = 0; i < CHUNK_SIZE; i++)
+    {
+      entry = readdir (local->dir);
+      while (entry 
+	     && (0 == strcmp (entry->d_name, ".") ||
+		 0 == strcmp (entry->d_name, "..")))
+	entry = readdir (local->dir);
+
+      if (entry)
+	{
+	  local->entries[i].name = g_strdup (entry->d_name);
+	  local->entries[i].inode = entry->d_ino;
+#ifdef _DIRENT_HAVE_D_TYPE
+	  local->entries[i].type = file_type_from_dirent (entry->d_type);
+#else
+	  local->entries[i].type = G_FILE_TYPE_UNKNOWN;
+#endif
+	}
+      else
+	break;
+    }
+
+  return i;
+}
+
+#endif
+
+static DirEntry *
+next_file_helper (GLocalFileEnumerator *local)
+{
+  DirEntry *entry;
+  int n_entries;
+
   if (local->at_end)
     return NULL;
   
   if (local->entries == NULL ||
       (local->entries[local->entries_pos].name == NULL))
     {
-      if (local->entries == NULL)
-	local->entries = g_new (DirEntry, CHUNK_SIZE + 1);
-      else
-	{
-	  /* Restart by clearing old names */
-	  for (i = 0; local->entries[i].name != NULL; i++)
-	    g_free (local->entries[i].name);
-	}
+      n_entries = read_entries (local);
+      local->entries[n_entries].name = NULL;
+      local->entries_pos = 0;
       
-      for (i = 0; i < CHUNK_SIZE; i++)
-	{
-	  entry = readdir (local->dir);
-	  while (entry 
-		 && (0 == strcmp (entry->d_name, ".") ||
-		     0 == strcmp (entry->d_name, "..")))
-	    entry = readdir (local->dir);
+      /* Stating in inode order is faster on many filesystems; with
+       * nothing to stat the order doesn't matter.
+       */
+      if (!local->file_type_is_enough)
+	qsort (local->entries, n_entries, sizeof (DirEntry), sort_by_inode);
+    }
+
+  entry = &local->entries[local->entries_pos++];
+  if (entry->name == NULL)
+    {
+      local->at_end = TRUE;
+      return NULL;
+    }
+    
+  return entry;
+}
+
+#endif
+
+static void
+ensure_parent_info (GLocalFileEnumerator *local)
+{
+  if (!local->got_parent_info)
+    {
+      _g_local_file_info_get_parent_info (local->filename, local->matcher, &local->parent_info);
+      local->got_parent_info = TRUE;
+    }
+}
+
+/* Safe to call from several threads at once */
+static GFileInfo *
+query_file (GLocalFileEnumerator  *local,
+	    const char            *filename,
+	    GError               **error)
+{
+  GFileInfo *info;
+  char *path;
+  int dir_fd;
 
-	  if (entry)
+  path = g_build_filename (local->filename, filename, NULL);
+#if defined (USE_GETDENTS)
+  dir_fd = local->dir_fd;
+#elif !defined (USE_GDIR) && (defined (HAVE_FSTATAT) || defined (HAVE_STATX))
+  dir_fd = dirfd (local->dir);
+#else
+  dir_fd = -1;
+#endif
+  info = _g_local_file_info_get_at (dir_fd, local->plan,
+				    filename, path,
+				    local->flags,
+				    &local->parent_info,
+				    error);
+  g_free (path);
+
+  return info;
+}
+
+#ifndef USE_GDIR
+/* Returns %NULL if @entry has to be stated */
+static GFileInfo *
+query_entry_without_stat (GLocalFileEnumerator *local,
+			  DirEntry             *entry)
+{
+  /* Symlinks need a stat to find the type of their target */
+  if (local->file_type_is_enough &&
+      entry->type != G_FILE_TYPE_UNKNOWN &&
+      (entry->type != G_FILE_TYPE_SYMBOLIC_LINK ||
+       (local->flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS)))
+    return _g_local_file_info_get_from_file_type (entry->name, entry->type,
+						  entry->type == G_FILE_TYPE_SYMBOLIC_LINK,
+						  local->plan);
+  return NULL;
+}
+#endif
+
+#ifndef USE_GDIR
+/* Frees @slot and returns its result through @info or @error,
+ * querying the file first if that had been cancelled. Returns %FALSE
+ * if the file has vanished since, so there is no result.
+ */
+static gboolean
+take_prefetched (GLocalFileEnumerator  *local,
+		 PrefetchSlot          *slot,
+		 GFileInfo            **info,
+		 GError               **error)
+{
+  GError *my_error;
+
+  *info = NULL;
+
+  if (slot->name)
+    {
+      my_error = NULL;
+      slot->info = query_file (local, slot->name, &my_error);
+      if (slot->info == NULL)
+	{
+	  if (my_error->domain == G_IO_ERROR &&
+	      my_error->code == G_IO_ERROR_NOT_FOUND)
 	    {
-	      local->entries[i].name = g_strdup (entry->d_name);
-	      local->entries[i].inode = entry->d_ino;
+	      g_error_free (my_error);
+	      prefetch_slot_free (slot);
+	      return FALSE;
 	    }
-	  else
-	    break;
+	  slot->error = my_error;
 	}
-      local->entries[i].name = NULL;
-      local->entries_pos = 0;
-      
-      qsort (local->entries, i, sizeof (DirEntry), sort_by_inode);
     }
 
-  filename = local->entries[local->entries_pos++].name;
-  if (filename == NULL)
-    local->at_end = TRUE;
-    
-  return filename;
-}
+  *info = slot->info;
+  if (slot->error)
+    g_propagate_error (error, slot->error);
+  g_free (slot->name);
+  g_slice_free (PrefetchSlot, slot);
 
+  return TRUE;
+}
 #endif
 
 static GFileInfo *
@@ -317,35 +625,42 @@ g_local_file_enumerator_next_file (GFileEnumerator  *enumerator,
 {
   GLocalFileEnumerator *local = G_LOCAL_FILE_ENUMERATOR (enumerator);
   const char *filename;
-  char *path;
   GFileInfo *info;
   GError *my_error;
+#ifndef USE_GDIR
+  DirEntry *entry;
+  PrefetchSlot *slot;
+#endif
 
-  if (!local->got_parent_info)
-    {
-      _g_local_file_info_get_parent_info (local->filename, local->matcher, &local->parent_info);
-      local->got_parent_info = TRUE;
-    }
+  ensure_parent_info (local);
+
+#ifndef USE_GDIR
+  /* Left over from g_local_file_enumerator_next_files_async() */
+  while ((slot = g_queue_pop_head (&local->prefetched)) != NULL)
+    if (take_prefetched (local, slot, &info, error))
+      return info;
+#endif
   
  next_file:
 
 #ifdef USE_GDIR
   filename = g_dir_read_name (local->dir);
 #else
-  filename = next_file_helper (local);
+  entry = next_file_helper (local);
+  filename = entry ? entry->name : NULL;
 #endif
 
   if (filename == NULL)
     return NULL;
 
+#ifndef USE_GDIR
+  info = query_entry_without_stat (local, entry);
+  if (info != NULL)
+    return info;
+#endif
+
   my_error = NULL;
-  path = g_build_filename (local->filename, filename, NULL);
-  info = _g_local_file_info_get (filename, path,
-				 local->matcher,
-				 local->flags,
-				 &local->parent_info,
-				 &my_error); 
-  g_free (path);
+  info = query_file (local, filename, &my_error);
 
   if (info == NULL)
     {
@@ -366,6 +681,367 @@ g_local_file_enumerator_next_file (GFileEnumerator  *enumerator,
   return info;
 }
 
+#ifndef USE_GDIR
+
+/* g_file_enumerator_next_files_async() reads the directory in one
+ * thread and hands the entries that need stating to helper threads as
+ * it goes, so reading and querying overlap and several slow queries
+ * (content sniffing, xattrs...) can be in flight at once. Each entry
+ * has a slot in read order, so the results come back in that order no
+ * matter which thread finished first.
+ */
+
+#define MAX_PREFETCH_THREADS 16
+
+typedef struct {
+  volatile gint ref_count;
+  GLocalFileEnumerator *local;
+  GCancellable *cancellable;
+
+  /* Protects the fields below */
+  GMutex *lock;
+  GCond *cond;
+  PrefetchSlot *slots;
+  int *work;		/* slots to stat, in read order */
+  int n_work;
+  int next_work;
+  int n_done;
+  gboolean reading_done;
+} PrefetchBatch;
+
+G_LOCK_DEFINE_STATIC (prefetch_pool);
+static GThreadPool *prefetch_pool = NULL;
+
+static PrefetchBatch *
+prefetch_batch_new (GLocalFileEnumerator *local,
+		    GCancellable         *cancellable,
+		    int                   n_slots)
+{
+  PrefetchBatch *batch;
+
+  batch = g_slice_new0 (PrefetchBatch);
+  batch->ref_count = 1;
+  batch->local = local;
+  batch->cancellable = cancellable;
+  if (g_thread_supported ())
+    {
+      batch->lock = g_mutex_new ();
+      batch->cond = g_cond_new ();
+    }
+  batch->slots = g_new0 (PrefetchSlot, n_slots);
+  batch->work = g_new (int, n_slots);
+
+  return batch;
+}
+
+static void
+prefetch_batch_unref (PrefetchBatch *batch)
+{
+  if (!g_atomic_int_dec_and_test (&batch->ref_count))
+    return;
+
+  if (batch->lock)
+    {
+      g_mutex_free (batch->lock);
+      g_cond_free (batch->cond);
+    }
+  g_free (batch->slots);
+  g_free (batch->work);
+  g_slice_free (PrefetchBatch, batch);
+}
+
+/* Stats entries until there is no more work; run by the helpers and,
+ * once it has read the whole batch, by the reading thread too.
+ */
+static void
+prefetch_run (PrefetchBatch *batch)
+{
+  PrefetchSlot *slot;
+
+  g_mutex_lock (batch->lock);
+  while (TRUE)
+    {
+      while (batch->next_work == batch->n_work && !batch->reading_done)
+	g_cond_wait (batch->cond, batch->lock);
+
+      if (batch->next_work == batch->n_work)
+	break;
+
+      slot = &batch->slots[batch->work[batch->next_work++]];
+      g_mutex_unlock (batch->lock);
+
+      /* Once cancelled, the slot keeps its name for the next call */
+      if (!g_cancellable_is_cancelled (batch->cancellable))
+	{
+	  slot->info = query_file (batch->local, slot->name, &slot->error);
+	  g_free (slot->name);
+	  slot->name = NULL;
+	}
+
+      g_mutex_lock (batch->lock);
+      batch->n_done++;
+      g_cond_broadcast (batch->cond);
+    }
+  g_mutex_unlock (batch->lock);
+}
+
+static void
+prefetch_helper (gpointer data,
+		 gpointer user_data)
+{
+  PrefetchBatch *batch = data;
+
+  prefetch_run (batch);
+  prefetch_batch_unref (batch);
+}
+
+static void
+start_prefetch_helper (PrefetchBatch *batch)
+{
+  G_LOCK (prefetch_pool);
+  if (prefetch_pool == NULL)
+    prefetch_pool = g_thread_pool_new (prefetch_helper, NULL,
+				       MAX_PREFETCH_THREADS, FALSE, NULL);
+  G_UNLOCK (prefetch_pool);
+
+  g_atomic_int_inc (&batch->ref_count);
+  g_thread_pool_push (prefetch_pool, batch, NULL);
+}
+
+typedef struct {
+  int    num_files;
+  GList *files;
+} NextFilesOp;
+
+static void
+next_files_op_free (NextFilesOp *op)
+{
+  g_list_foreach (op->files, (GFunc)g_object_unref, NULL);
+  g_list_free (op->files);
+  g_slice_free (NextFilesOp, op);
+}
+
+static void
+next_files_thread (GSimpleAsyncResult *res,
+		   GObject            *object,
+		   GCancellable       *cancellable)
+{
+  GLocalFileEnumerator *local = G_LOCAL_FILE_ENUMERATOR (object);
+  NextFilesOp *op;
+  PrefetchBatch *batch;
+  PrefetchSlot *slot;
+  DirEntry *entry;
+  GFileInfo *info;
+  GError *error;
+  GList *l;
+  gboolean stop, failed;
+  int n_files, n_slots, n_helpers, max_helpers, i;
+
+  op = g_simple_async_result_get_op_res_gpointer (res);
+
+  ensure_parent_info (local);
+  failed = FALSE;
+
+  /* Results left over from the previous call come first. As with
+   * next_file(), an error is returned on its own: if files were
+   * collected before it, it stays queued for the next call.
+   */
+  n_files = 0;
+  error = NULL;
+  while (n_files < op->num_files &&
+	 (slot = g_queue_pop_head (&local->prefetched)) != NULL)
+    {
+      if (!take_prefetched (local, slot, &info, &error))
+	continue;
+
+      if (info != NULL)
+	{
+	  op->files = g_list_prepend (op->files, info);
+	  n_files++;
+	}
+      else if (n_files == 0)
+	{
+	  g_simple_async_result_set_from_error (res, error);
+	  g_error_free (error);
+	  failed = TRUE;
+	  goto out;
+	}
+      else
+	{
+	  slot = g_slice_new0 (PrefetchSlot);
+	  slot->error = error;
+	  g_queue_push_head (&local->prefetched, slot);
+	  goto out;
+	}
+    }
+
+  if (n_files == op->num_files)
+    goto out;
+
+  max_helpers = 0;
+  if (g_thread_supported ())
+    max_helpers = MIN (g_file_enumerator_get_parallelism (G_FILE_ENUMERATOR (local)),
+		       MAX_PREFETCH_THREADS) - 1;
+
+  batch = prefetch_batch_new (local, cancellable, op->num_files - n_files);
+  n_helpers = 0;
+
+  for (n_slots = 0; n_slots < op->num_files - n_files; n_slots++)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+	break;
+
+      entry = next_file_helper (local);
+      if (entry == NULL)
+	break;
+
+      slot = &batch->slots[n_slots];
+      slot->info = query_entry_without_stat (local, entry);
+      if (slot->info != NULL)
+	continue;
+
+      slot->name = g_strdup (entry->name);
+
+      g_mutex_lock (batch->lock);
+      batch->work[batch->n_work++] = n_slots;
+      g_cond_signal (batch->cond);
+      g_mutex_unlock (batch->lock);
+
+      if (n_helpers < max_helpers)
+	{
+	  start_prefetch_helper (batch);
+	  n_helpers++;
+	}
+    }
+
+  g_mutex_lock (batch->lock);
+  batch->reading_done = TRUE;
+  g_cond_broadcast (batch->cond);
+  g_mutex_unlock (batch->lock);
+
+  prefetch_run (batch);
+
+  g_mutex_lock (batch->lock);
+  while (batch->n_done < batch->n_work)
+    g_cond_wait (batch->cond, batch->lock);
+  g_mutex_unlock (batch->lock);
+
+  /* Files that vanished since the directory was read are skipped.
+   * The files up to the first error, or up to the first entry whose
+   * query was cancelled, are returned; everything after that is
+   * queued in order for the following calls, errors included, like
+   * g_local_file_enumerator_next_file() would have returned them.
+   */
+  stop = FALSE;
+  for (i = 0; i < n_slots; i++)
+    {
+      slot = &batch->slots[i];
+
+      if (slot->error &&
+	  slot->error->domain == G_IO_ERROR &&
+	  slot->error->code == G_IO_ERROR_NOT_FOUND)
+	{
+	  g_error_free (slot->error);
+	  continue;
+	}
+
+      if (!stop)
+	{
+	  if (slot->info)
+	    {
+	      op->files = g_list_prepend (op->files, slot->info);
+	      n_files++;
+	      continue;
+	    }
+
+	  stop = TRUE;
+	  if (slot->error && n_files == 0)
+	    {
+	      error = slot->error;
+	      continue;
+	    }
+	}
+
+      g_queue_push_tail (&local->prefetched,
+			 g_slice_dup (PrefetchSlot, slot));
+    }
+
+  prefetch_batch_unref (batch);
+
+  if (error != NULL)
+    {
+      g_simple_async_result_set_from_error (res, error);
+      g_error_free (error);
+      failed = TRUE;
+    }
+
+ out:
+  /* A cancelled call returns no files, but keeps them for the next
+   * one instead of losing entries that were read from the directory.
+   */
+  if (!failed && g_cancellable_is_cancelled (cancellable))
+    {
+      for (l = op->files; l != NULL; l = l->next)
+	{
+	  slot = g_slice_new0 (PrefetchSlot);
+	  slot->info = l->data;
+	  g_queue_push_head (&local->prefetched, slot);
+	}
+      g_list_free (op->files);
+      op->files = NULL;
+
+      g_simple_async_result_set_error (res, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+				       "%s", _("Operation was cancelled"));
+    }
+
+  op->files = g_list_reverse (op->files);
+}
+
+static void
+g_local_file_enumerator_next_files_async (GFileEnumerator     *enumerator,
+					  int                  num_files,
+					  int                  io_priority,
+					  GCancellable        *cancellable,
+					  GAsyncReadyCallback  callback,
+					  gpointer             user_data)
+{
+  GSimpleAsyncResult *res;
+  NextFilesOp *op;
+
+  op = g_slice_new0 (NextFilesOp);
+  op->num_files = num_files;
+
+  res = g_simple_async_result_new (G_OBJECT (enumerator), callback, user_data,
+				   g_local_file_enumerator_next_files_async);
+  g_simple_async_result_set_op_res_gpointer (res, op, (GDestroyNotify) next_files_op_free);
+  /* next_files_thread() handles it, so the files it read aren't lost */
+  g_simple_async_result_set_handle_cancellation (res, FALSE);
+
+  g_simple_async_result_run_in_thread (res, next_files_thread, io_priority, cancellable);
+  g_object_unref (res);
+}
+
+static GList *
+g_local_file_enumerator_next_files_finish (GFileEnumerator  *enumerator,
+					   GAsyncResult     *result,
+					   GError          **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+  NextFilesOp *op;
+  GList *files;
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) ==
+		  g_local_file_enumerator_next_files_async);
+
+  op = g_simple_async_result_get_op_res_gpointer (simple);
+
+  files = op->files;
+  op->files = NULL;
+  return files;
+}
+
+#endif /* !USE_GDIR */
+
 static gboolean
 g_local_file_enumerator_close (GFileEnumerator  *enumerator,
 			       GCancellable     *cancellable,
@@ -373,17 +1049,7 @@ g_local_file_enumerator_close (GFileEnumerator  *enumerator,
 {
   GLocalFileEnumerator *local = G_LOCAL_FILE_ENUMERATOR (enumerator);
 
-  if (local->dir)
-    {
-#ifdef USE_GDIR
-      g_dir_close (local->dir);
-#else
-      closedir (local->dir);
-#endif
-      local->dir = NULL;
-    }
+  close_dir (local);
 
   return TRUE;
 }
-
-
@@ -22,6 +22,7 @@
  * Author: Alexander Larsson <alexl@redhat.com>
  */
 
+#define _GNU_SOURCE		/* For O_NOATIME and statx */
 #include "config.h"
 
 #ifdef HAVE_SYS_TIME_H
@@ -29,11 +30,13 @@
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef HAVE_STATX
+#include <sys/sysmacros.h>
+#endif
 #include <string.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
-#define _GNU_SOURCE
 #include <fcntl.h>
 #include <errno.h>
 #ifdef HAVE_GRP_H
@@ -45,6 +48,9 @@
 #ifdef HAVE_SELINUX
 #include <selinux/selinux.h>
 #endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 
 #ifdef HAVE_XATTR
 
@@ -115,6 +121,47 @@ static GHashTable *gid_cache = NULL;
 
 #endif  /* !G_OS_WIN32 */
 
+/* Lookups beyond the stat that a GLocalFileInfoPlan asks for */
+typedef enum {
+  NEEDS_DISPLAY_NAME      = 1 << 0,
+  NEEDS_EDIT_NAME         = 1 << 1,
+  NEEDS_COPY_NAME         = 1 << 2,
+  NEEDS_SYMLINK_TARGET    = 1 << 3,
+  NEEDS_CONTENT_TYPE      = 1 << 4,
+  NEEDS_ICON              = 1 << 5,
+  NEEDS_FAST_CONTENT_TYPE = 1 << 6,
+  NEEDS_OWNER_USER        = 1 << 7,
+  NEEDS_OWNER_USER_REAL   = 1 << 8,
+  NEEDS_OWNER_GROUP       = 1 << 9,
+  NEEDS_IS_MOUNTPOINT     = 1 << 10,
+  NEEDS_CAN_READ          = 1 << 11,
+  NEEDS_CAN_WRITE         = 1 << 12,
+  NEEDS_CAN_EXECUTE       = 1 << 13,
+  NEEDS_CAN_RENAME        = 1 << 14,
+  NEEDS_CAN_DELETE        = 1 << 15,
+  NEEDS_CAN_TRASH         = 1 << 16,
+  NEEDS_SELINUX_CONTEXT   = 1 << 17,
+  NEEDS_ALL_XATTRS        = 1 << 18,
+  NEEDS_ALL_XATTRS_SYS    = 1 << 19,
+  NEEDS_THUMBNAIL         = 1 << 20,
+  NEEDS_ETAG              = 1 << 21,
+  NEEDS_ID_FILE           = 1 << 22,
+  NEEDS_ID_FILESYSTEM     = 1 << 23
+} LocalFileInfoNeeds;
+
+struct _GLocalFileInfoPlan
+{
+  GFileAttributeMatcher *matcher;
+  guint32 needs;
+  guint stat_mask;
+
+  /* Extended attributes asked for by name, as pairs of GIO attribute
+   * and xattr name; %NULL-terminated.
+   */
+  char **xattrs;
+  char **xattrs_sys;
+};
+
 char *
 _g_local_file_info_create_etag (GLocalFileStat *statbuf)
 {
@@ -190,12 +237,12 @@ read_link (const gchar *full_name)
 static void
 get_selinux_context (const char            *path,
 		     GFileInfo             *info,
-		     GFileAttributeMatcher *attribute_matcher,
+		     GLocalFileInfoPlan    *plan,
 		     gboolean               follow_symlinks)
 {
   char *context;
 
-  if (!g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_SELINUX_CONTEXT))
+  if (!(plan->needs & NEEDS_SELINUX_CONTEXT))
     return;
   
   if (is_selinux_enabled ())
@@ -441,23 +488,19 @@ static void
 get_xattrs (const char            *path,
 	    gboolean               user,
 	    GFileInfo             *info,
-	    GFileAttributeMatcher *matcher,
+	    GLocalFileInfoPlan    *plan,
 	    gboolean               follow_symlinks)
 {
 #ifdef HAVE_XATTR
-  gboolean all;
   gsize list_size;
   ssize_t list_res_size;
   size_t len;
   char *list;
-  const char *attr, *attr2;
-
-  if (user)
-    all = g_file_attribute_matcher_enumerate_namespace (matcher, "xattr");
-  else
-    all = g_file_attribute_matcher_enumerate_namespace (matcher, "xattr-sys");
+  const char *attr;
+  char **names;
+  int i;
 
-  if (all)
+  if (plan->needs & (user ? NEEDS_ALL_XATTRS : NEEDS_ALL_XATTRS_SYS))
     {
       list_res_size = g_listxattr (path, NULL, 0, follow_symlinks);
 
@@ -519,30 +562,9 @@ get_xattrs (const char            *path,
     }
   else
     {
-      while ((attr = g_file_attribute_matcher_enumerate_next (matcher)) != NULL)
-	{
-	  char *unescaped_attribute, *a;
-	  gboolean free_unescaped_attribute;
-
-	  attr2 = strchr (attr, ':');
-	  if (attr2)
-	    {
-	      attr2 += 2; /* Skip '::' */
-	      unescaped_attribute = hex_unescape_string (attr2, NULL, &free_unescaped_attribute);
-	      if (user)
-		a = g_strconcat ("user.", unescaped_attribute, NULL);
-	      else
-		a = unescaped_attribute;
-	      
-	      get_one_xattr (path, info, attr, a, follow_symlinks);
-
-	      if (user)
-		g_free (a);
-	      
-	      if (free_unescaped_attribute)
-		g_free (unescaped_attribute);
-	    }
-	}
+      names = user ? plan->xattrs : plan->xattrs_sys;
+      for (i = 0; names != NULL && names[i] != NULL; i += 2)
+	get_one_xattr (path, info, names[i], names[i + 1], follow_symlinks);
     }
 #endif /* defined HAVE_XATTR */
 }
@@ -597,22 +619,18 @@ static void
 get_xattrs_from_fd (int                    fd,
 		    gboolean               user,
 		    GFileInfo             *info,
-		    GFileAttributeMatcher *matcher)
+		    GLocalFileInfoPlan    *plan)
 {
 #ifdef HAVE_XATTR
-  gboolean all;
   gsize list_size;
   ssize_t list_res_size;
   size_t len;
   char *list;
-  const char *attr, *attr2;
-
-  if (user)
-    all = g_file_attribute_matcher_enumerate_namespace (matcher, "xattr");
-  else
-    all = g_file_attribute_matcher_enumerate_namespace (matcher, "xattr-sys");
+  const char *attr;
+  char **names;
+  int i;
 
-  if (all)
+  if (plan->needs & (user ? NEEDS_ALL_XATTRS : NEEDS_ALL_XATTRS_SYS))
     {
       list_res_size = g_flistxattr (fd, NULL, 0);
 
@@ -672,32 +690,163 @@ get_xattrs_from_fd (int                    fd,
     }
   else
     {
-      while ((attr = g_file_attribute_matcher_enumerate_next (matcher)) != NULL)
-	{
-	  char *unescaped_attribute, *a;
-	  gboolean free_unescaped_attribute;
+      names = user ? plan->xattrs : plan->xattrs_sys;
+      for (i = 0; names != NULL && names[i] != NULL; i += 2)
+	get_one_xattr_from_fd (fd, info, names[i], names[i + 1]);
+    }
+#endif /* defined HAVE_XATTR */
+}
 
-	  attr2 = strchr (attr, ':');
-	  if (attr2)
-	    {
-	      attr2++; /* Skip ':' */
-	      unescaped_attribute = hex_unescape_string (attr2, NULL, &free_unescaped_attribute);
-	      if (user)
-		a = g_strconcat ("user.", unescaped_attribute, NULL);
-	      else
-		a = unescaped_attribute;
-	      
-	      get_one_xattr_from_fd (fd, info, attr, a);
+#ifdef HAVE_XATTR
+/* Collects the "xattr::" (or "xattr-sys::") attributes that @matcher
+ * names explicitly, each followed by the xattr it maps to.
+ */
+static char **
+get_xattr_names (GFileAttributeMatcher *matcher,
+		 gboolean               user)
+{
+  GPtrArray *names;
+  const char *attr, *attr2;
+  char *unescaped_attribute;
+  gboolean free_unescaped_attribute;
 
-	      if (user)
-		g_free (a);
-	      
-	      if (free_unescaped_attribute)
-		g_free (unescaped_attribute);
-	    }
-	}
+  names = NULL;
+
+  g_file_attribute_matcher_enumerate_namespace (matcher, user ? "xattr" : "xattr-sys");
+  while ((attr = g_file_attribute_matcher_enumerate_next (matcher)) != NULL)
+    {
+      attr2 = strchr (attr, ':');
+      if (attr2 == NULL)
+	continue;
+
+      attr2 += 2; /* Skip '::' */
+      unescaped_attribute = hex_unescape_string (attr2, NULL, &free_unescaped_attribute);
+
+      if (names == NULL)
+	names = g_ptr_array_new ();
+      g_ptr_array_add (names, g_strdup (attr));
+      if (user)
+	g_ptr_array_add (names, g_strconcat ("user.", unescaped_attribute, NULL));
+      else
+	g_ptr_array_add (names, g_strdup (unescaped_attribute));
+
+      if (free_unescaped_attribute)
+	g_free (unescaped_attribute);
     }
+
+  if (names == NULL)
+    return NULL;
+
+  g_ptr_array_add (names, NULL);
+  return (char **) g_ptr_array_free (names, FALSE);
+}
 #endif /* defined HAVE_XATTR */
+
+/* Works out once which lookups and which stat fields the attributes
+ * in @attribute_matcher need, so that querying many files (e.g. when
+ * enumerating a directory) doesn't match attribute names again for
+ * each of them. The plan is read-only, so threads can share it.
+ */
+GLocalFileInfoPlan *
+_g_local_file_info_plan_new (GFileAttributeMatcher *attribute_matcher)
+{
+  static const struct {
+    const char *attribute;
+    guint32 needs;
+  } attribute_needs[] = {
+    { G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME, NEEDS_DISPLAY_NAME },
+    { G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME, NEEDS_EDIT_NAME },
+    { G_FILE_ATTRIBUTE_STANDARD_COPY_NAME, NEEDS_COPY_NAME },
+    { G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET, NEEDS_SYMLINK_TARGET },
+    { G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE, NEEDS_CONTENT_TYPE },
+    { G_FILE_ATTRIBUTE_STANDARD_ICON, NEEDS_CONTENT_TYPE | NEEDS_ICON },
+    { G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE, NEEDS_FAST_CONTENT_TYPE },
+    { G_FILE_ATTRIBUTE_OWNER_USER, NEEDS_OWNER_USER },
+    { G_FILE_ATTRIBUTE_OWNER_USER_REAL, NEEDS_OWNER_USER_REAL },
+    { G_FILE_ATTRIBUTE_OWNER_GROUP, NEEDS_OWNER_GROUP },
+    { G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT, NEEDS_IS_MOUNTPOINT },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_READ, NEEDS_CAN_READ },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE, NEEDS_CAN_WRITE },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE, NEEDS_CAN_EXECUTE },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME, NEEDS_CAN_RENAME },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE, NEEDS_CAN_DELETE },
+    { G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH, NEEDS_CAN_TRASH },
+    { G_FILE_ATTRIBUTE_SELINUX_CONTEXT, NEEDS_SELINUX_CONTEXT },
+    { G_FILE_ATTRIBUTE_THUMBNAIL_PATH, NEEDS_THUMBNAIL },
+    { G_FILE_ATTRIBUTE_ETAG_VALUE, NEEDS_ETAG },
+    { G_FILE_ATTRIBUTE_ID_FILE, NEEDS_ID_FILE },
+    { G_FILE_ATTRIBUTE_ID_FILESYSTEM, NEEDS_ID_FILESYSTEM }
+  };
+#ifdef HAVE_STATX
+  static const struct {
+    const char *attribute;
+    guint mask;
+  } attribute_stat_mask[] = {
+    { G_FILE_ATTRIBUTE_UNIX_NLINK, STATX_NLINK },
+    { G_FILE_ATTRIBUTE_STANDARD_SIZE, STATX_SIZE },
+    { G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE, STATX_BLOCKS },
+    { G_FILE_ATTRIBUTE_UNIX_BLOCKS, STATX_BLOCKS },
+    { G_FILE_ATTRIBUTE_TIME_ACCESS, STATX_ATIME },
+    { G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, STATX_ATIME },
+    { G_FILE_ATTRIBUTE_TIME_MODIFIED, STATX_MTIME },
+    { G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, STATX_MTIME },
+    { G_FILE_ATTRIBUTE_ETAG_VALUE, STATX_MTIME },
+    { G_FILE_ATTRIBUTE_TIME_CHANGED, STATX_CTIME },
+    { G_FILE_ATTRIBUTE_TIME_CHANGED_USEC, STATX_CTIME },
+    /* Cached content types and thumbnail states are keyed on these */
+    { G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE, STATX_MTIME | STATX_SIZE },
+    { G_FILE_ATTRIBUTE_STANDARD_ICON, STATX_MTIME | STATX_SIZE },
+    { G_FILE_ATTRIBUTE_THUMBNAIL_PATH, STATX_MTIME | STATX_SIZE }
+  };
+#endif
+  GLocalFileInfoPlan *plan;
+  int i;
+
+  plan = g_slice_new0 (GLocalFileInfoPlan);
+  plan->matcher = g_file_attribute_matcher_ref (attribute_matcher);
+
+  if (attribute_matcher == NULL)
+    return plan;
+
+  for (i = 0; i < G_N_ELEMENTS (attribute_needs); i++)
+    if (g_file_attribute_matcher_matches (attribute_matcher,
+					  attribute_needs[i].attribute))
+      plan->needs |= attribute_needs[i].needs;
+
+#ifdef HAVE_STATX
+  /* The type, mode and owner feed into many attributes: the file type,
+   * content type, access rights and so on.
+   */
+  plan->stat_mask = STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_INO;
+  for (i = 0; i < G_N_ELEMENTS (attribute_stat_mask); i++)
+    if (g_file_attribute_matcher_matches (attribute_matcher,
+					  attribute_stat_mask[i].attribute))
+      plan->stat_mask |= attribute_stat_mask[i].mask;
+#endif
+
+#ifdef HAVE_XATTR
+  if (g_file_attribute_matcher_enumerate_namespace (attribute_matcher, "xattr"))
+    plan->needs |= NEEDS_ALL_XATTRS;
+  else
+    plan->xattrs = get_xattr_names (attribute_matcher, TRUE);
+
+  if (g_file_attribute_matcher_enumerate_namespace (attribute_matcher, "xattr-sys"))
+    plan->needs |= NEEDS_ALL_XATTRS_SYS;
+  else
+    plan->xattrs_sys = get_xattr_names (attribute_matcher, FALSE);
+#endif
+
+  return plan;
+}
+
+void
+_g_local_file_info_plan_free (GLocalFileInfoPlan *plan)
+{
+  if (plan->matcher)
+    g_file_attribute_matcher_unref (plan->matcher);
+  g_strfreev (plan->xattrs);
+  g_strfreev (plan->xattrs_sys);
+  g_slice_free (GLocalFileInfoPlan, plan);
 }
 
 #ifdef HAVE_XATTR
@@ -834,30 +983,28 @@ _g_local_file_info_get_parent_info (const char            *dir,
 }
 
 static void
-get_access_rights (GFileAttributeMatcher *attribute_matcher,
+get_access_rights (GLocalFileInfoPlan    *plan,
 		   GFileInfo             *info,
 		   const gchar           *path,
 		   GLocalFileStat        *statbuf,
 		   GLocalParentFileInfo  *parent_info)
 {
   /* FIXME: Windows: The underlyin _waccess() is mostly pointless */
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
+  if (plan->needs & NEEDS_CAN_READ)
     g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ,
 				       g_access (path, R_OK) == 0);
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE))
+  if (plan->needs & NEEDS_CAN_WRITE)
     g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
 				       g_access (path, W_OK) == 0);
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE))
+  if (plan->needs & NEEDS_CAN_EXECUTE)
     g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE,
 				       g_access (path, X_OK) == 0);
 
 
-  if (parent_info)
+  if (parent_info &&
+      (plan->needs & (NEEDS_CAN_RENAME | NEEDS_CAN_DELETE | NEEDS_CAN_TRASH)))
     {
       gboolean writable;
 
@@ -879,15 +1026,15 @@ get_access_rights (GFileAttributeMatcher *attribute_matcher,
 	    writable = TRUE;
 	}
 
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME))
+      if (plan->needs & NEEDS_CAN_RENAME)
 	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME,
 					   writable);
       
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE))
+      if (plan->needs & NEEDS_CAN_DELETE)
 	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE,
 					   writable);
 
-      if (g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH))
+      if (plan->needs & NEEDS_CAN_TRASH)
         g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
                                            writable && parent_info->has_trash_dir);
     }
@@ -896,7 +1043,7 @@ get_access_rights (GFileAttributeMatcher *attribute_matcher,
 static void
 set_info_from_stat (GFileInfo             *info, 
                     GLocalFileStat        *statbuf,
-		    GFileAttributeMatcher *attribute_matcher)
+		    GLocalFileInfoPlan    *plan)
 {
   GFileType file_type;
 
@@ -965,24 +1112,21 @@ set_info_from_stat (GFileInfo             *info,
   g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC, statbuf->st_ctim.tv_nsec / 1000);
 #endif
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ETAG_VALUE))
+  if (plan->needs & NEEDS_ETAG)
     {
       char *etag = _g_local_file_info_create_etag (statbuf);
       g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ETAG_VALUE, etag);
       g_free (etag);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ID_FILE))
+  if (plan->needs & NEEDS_ID_FILE)
     {
       char *id = _g_local_file_info_create_file_id (statbuf);
       g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE, id);
       g_free (id);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_ID_FILESYSTEM))
+  if (plan->needs & NEEDS_ID_FILESYSTEM)
     {
       char *id = _g_local_file_info_create_fs_id (statbuf);
       g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM, id);
@@ -1194,6 +1338,152 @@ get_groupname_from_gid (gid_t gid)
   return res;
 }
 
+/* Directory views query the same files over and over, so the sniffed
+ * content types and the thumbnail states are cached for the process.
+ * Entries are keyed by the file's inode and modification time, and
+ * also keep the name they were looked up for, as both results depend
+ * on it.
+ */
+
+#define FILE_INFO_CACHE_SIZE 4096
+
+typedef struct {
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+  glong mtime_nsec;
+  goffset size;
+} CacheKey;
+
+typedef struct {
+  CacheKey key;
+  char *name;
+  char *value;
+  gboolean thumbnailing_failed;
+} CacheEntry;
+
+typedef struct {
+  GHashTable *entries;
+  GQueue order;		/* oldest first, for eviction */
+} FileInfoCache;
+
+G_LOCK_DEFINE_STATIC (content_type_cache);
+static FileInfoCache content_type_cache;
+
+G_LOCK_DEFINE_STATIC (thumbnail_cache);
+static FileInfoCache thumbnail_cache;
+
+static guint
+cache_key_hash (gconstpointer v)
+{
+  const CacheKey *key = v;
+
+  return (guint) key->ino ^ (guint) key->dev ^ (guint) key->mtime ^ (guint) key->mtime_nsec;
+}
+
+static gboolean
+cache_key_equal (gconstpointer v1,
+		 gconstpointer v2)
+{
+  const CacheKey *a = v1, *b = v2;
+
+  return a->ino == b->ino && a->dev == b->dev &&
+    a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec &&
+    a->size == b->size;
+}
+
+static void
+cache_key_init (CacheKey       *key,
+		GLocalFileStat *statbuf)
+{
+  memset (key, 0, sizeof (CacheKey));
+  key->dev = statbuf->st_dev;
+  key->ino = statbuf->st_ino;
+  key->mtime = statbuf->st_mtime;
+#if defined (HAVE_STRUCT_STAT_ST_MTIMENSEC)
+  key->mtime_nsec = statbuf->st_mtimensec;
+#elif defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+  key->mtime_nsec = statbuf->st_mtim.tv_nsec;
+#endif
+  key->size = statbuf->st_size;
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->name);
+  g_free (entry->value);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Called with the cache's lock held */
+static CacheEntry *
+cache_lookup (FileInfoCache  *cache,
+	      const CacheKey *key,
+	      const char     *name)
+{
+  CacheEntry *entry;
+
+  if (cache->entries == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (cache->entries, key);
+  if (entry != NULL && strcmp (entry->name, name) == 0)
+    return entry;
+
+  return NULL;
+}
+
+/* Called with the cache's lock held */
+static void
+cache_insert (FileInfoCache  *cache,
+	      const CacheKey *key,
+	      const char     *name,
+	      const char     *value,
+	      gboolean        thumbnailing_failed)
+{
+  CacheEntry *entry;
+
+  if (cache->entries == NULL)
+    cache->entries = g_hash_table_new (cache_key_hash, cache_key_equal);
+
+  entry = g_hash_table_lookup (cache->entries, key);
+  if (entry != NULL)
+    {
+      /* Same file under another name */
+      g_queue_remove (&cache->order, entry);
+      g_hash_table_remove (cache->entries, key);
+      cache_entry_free (entry);
+    }
+  else if (g_queue_get_length (&cache->order) >= FILE_INFO_CACHE_SIZE)
+    {
+      entry = g_queue_pop_head (&cache->order);
+      g_hash_table_remove (cache->entries, &entry->key);
+      cache_entry_free (entry);
+    }
+
+  entry = g_slice_new (CacheEntry);
+  entry->key = *key;
+  entry->name = g_strdup (name);
+  entry->value = g_strdup (value);
+  entry->thumbnailing_failed = thumbnailing_failed;
+
+  g_hash_table_insert (cache->entries, &entry->key, entry);
+  g_queue_push_tail (&cache->order, entry);
+}
+
+/* Called with the cache's lock held */
+static void
+cache_clear (FileInfoCache *cache)
+{
+  if (cache->entries == NULL)
+    return;
+
+  g_queue_foreach (&cache->order, (GFunc)cache_entry_free, NULL);
+  g_queue_clear (&cache->order);
+  g_hash_table_remove_all (cache->entries);
+}
+
 #endif /* !G_OS_WIN32 */
 
 static char *
@@ -1226,6 +1516,24 @@ get_content_type (const char          *basename,
     {
       char *content_type;
       gboolean result_uncertain;
+#ifndef G_OS_WIN32
+      CacheKey key;
+
+      if (!fast && path != NULL)
+	{
+	  CacheEntry *entry;
+
+	  cache_key_init (&key, statbuf);
+
+	  G_LOCK (content_type_cache);
+	  entry = cache_lookup (&content_type_cache, &key, basename);
+	  content_type = entry ? g_strdup (entry->value) : NULL;
+	  G_UNLOCK (content_type_cache);
+
+	  if (content_type != NULL)
+	    return content_type;
+	}
+#endif
       
       content_type = g_content_type_guess (basename, NULL, 0, &result_uncertain);
       
@@ -1259,6 +1567,13 @@ get_content_type (const char          *basename,
 		}
 	    }
 	}
+
+      if (!fast && path != NULL)
+	{
+	  G_LOCK (content_type_cache);
+	  cache_insert (&content_type_cache, &key, basename, content_type, FALSE);
+	  G_UNLOCK (content_type_cache);
+	}
 #endif
       
       return content_type;
@@ -1266,13 +1581,27 @@ get_content_type (const char          *basename,
   
 }
 
-static void
-get_thumbnail_attributes (const char *path,
-                          GFileInfo  *info)
+/* The thumbnail directories live in the home directory; the test
+ * suite points GIO_THUMBNAIL_BASE_DIR (private, undocumented) elsewhere
+ * since g_get_home_dir() ignores $HOME.
+ */
+static const char *
+get_thumbnail_base_dir (void)
+{
+  const char *base_dir;
+
+  base_dir = g_getenv ("GIO_THUMBNAIL_BASE_DIR");
+  if (base_dir == NULL || *base_dir == 0)
+    base_dir = g_get_home_dir ();
+
+  return base_dir;
+}
+
+static char *
+get_thumbnail_basename (const char *path)
 {
   GChecksum *checksum;
   char *uri;
-  char *filename;
   char *basename;
 
   uri = g_filename_to_uri (path, NULL, NULL);
@@ -1285,7 +1614,22 @@ get_thumbnail_attributes (const char *path,
   basename = g_strconcat (g_checksum_get_string (checksum), ".png", NULL);
   g_checksum_free (checksum);
 
-  filename = g_build_filename (g_get_home_dir (),
+  return basename;
+}
+
+#ifdef G_OS_WIN32
+
+static void
+get_thumbnail_attributes (const char     *path,
+                          GFileInfo      *info,
+                          GLocalFileStat *statbuf)
+{
+  char *filename;
+  char *basename;
+
+  basename = get_thumbnail_basename (path);
+
+  filename = g_build_filename (get_thumbnail_base_dir (),
                                ".thumbnails", "normal", basename,
                                NULL);
 
@@ -1294,7 +1638,7 @@ get_thumbnail_attributes (const char *path,
   else
     {
       g_free (filename);
-      filename = g_build_filename (g_get_home_dir (),
+      filename = g_build_filename (get_thumbnail_base_dir (),
                                    ".thumbnails", "fail",
                                    "gnome-thumbnail-factory",
                                    basename,
@@ -1307,6 +1651,267 @@ get_thumbnail_attributes (const char *path,
   g_free (filename);
 }
 
+#else /* !G_OS_WIN32 */
+
+/* The thumbnail directories are opened once so each check is a single
+ * lookup relative to them. Where inotify is available they are also
+ * watched, and the cached thumbnail states are dropped whenever a
+ * thumbnail is added or removed; without it nothing is cached.
+ * Protected by the thumbnail_cache lock.
+ */
+typedef struct {
+  const char *name;	/* relative to get_thumbnail_base_dir() */
+  char *path;
+  int fd;
+  int wd;
+} ThumbnailDir;
+
+enum {
+  THUMBNAIL_DIR_NORMAL,
+  THUMBNAIL_DIR_FAIL
+};
+
+static ThumbnailDir thumbnail_dirs[] = {
+  { ".thumbnails/normal", NULL, -1, -1 },
+  { ".thumbnails/fail/gnome-thumbnail-factory", NULL, -1, -1 }
+};
+
+/* The existence checks run without the lock, so the directory fds
+ * they use are only closed once no lookup is running, and results
+ * are only cached if the cache was not cleared in the meantime.
+ */
+static guint thumbnail_lookups;
+static GSList *retired_thumbnail_fds;
+static guint thumbnail_cache_generation;
+
+static void
+close_retired_thumbnail_fds (void)
+{
+  GSList *l;
+
+  for (l = retired_thumbnail_fds; l != NULL; l = l->next)
+    close (GPOINTER_TO_INT (l->data));
+  g_slist_free (retired_thumbnail_fds);
+  retired_thumbnail_fds = NULL;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int thumbnail_inotify_fd = -2;	/* -2 until set up */
+
+static void
+retire_thumbnail_dir_fd (int fd)
+{
+  if (thumbnail_lookups == 0)
+    close (fd);
+  else
+    retired_thumbnail_fds = g_slist_prepend (retired_thumbnail_fds,
+					     GINT_TO_POINTER (fd));
+}
+
+static void
+forget_thumbnail_dir (int wd)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (thumbnail_dirs); i++)
+    if (thumbnail_dirs[i].wd == wd)
+      {
+	thumbnail_dirs[i].wd = -1;
+	if (thumbnail_dirs[i].fd != -1)
+	  retire_thumbnail_dir_fd (thumbnail_dirs[i].fd);
+	thumbnail_dirs[i].fd = -1;
+      }
+}
+
+/* Returns %TRUE if anything changed since the last call */
+static gboolean
+read_thumbnail_dir_events (void)
+{
+  struct inotify_event *event;
+  char buffer[4096];
+  ssize_t len, pos;
+  gboolean changed;
+
+  if (thumbnail_inotify_fd == -2)
+    {
+      thumbnail_inotify_fd = inotify_init ();
+      /* A blocking fd would hang the reads below; rather not cache */
+      if (thumbnail_inotify_fd != -1 &&
+	  (fcntl (thumbnail_inotify_fd, F_SETFL, O_NONBLOCK) == -1 ||
+	   fcntl (thumbnail_inotify_fd, F_SETFD, FD_CLOEXEC) == -1))
+	{
+	  close (thumbnail_inotify_fd);
+	  thumbnail_inotify_fd = -1;
+	}
+    }
+
+  if (thumbnail_inotify_fd == -1)
+    return FALSE;
+
+  changed = FALSE;
+  while ((len = read (thumbnail_inotify_fd, buffer, sizeof (buffer))) > 0)
+    {
+      changed = TRUE;
+
+      for (pos = 0; pos < len; pos += sizeof (struct inotify_event) + event->len)
+	{
+	  event = (struct inotify_event *) (buffer + pos);
+
+	  /* The directory is gone or elsewhere; open it again by name */
+	  if (event->mask & IN_MOVE_SELF)
+	    {
+	      inotify_rm_watch (thumbnail_inotify_fd, event->wd);
+	      forget_thumbnail_dir (event->wd);
+	    }
+	  else if (event->mask & IN_IGNORED)
+	    forget_thumbnail_dir (event->wd);
+	}
+    }
+
+  return changed;
+}
+#endif
+
+/* Returns %TRUE if thumbnail states may be cached */
+static gboolean
+update_thumbnail_dirs (void)
+{
+  ThumbnailDir *dir;
+  gboolean can_cache;
+  int i;
+
+#ifdef HAVE_SYS_INOTIFY_H
+  if (read_thumbnail_dir_events ())
+    {
+      cache_clear (&thumbnail_cache);
+      thumbnail_cache_generation++;
+    }
+  can_cache = thumbnail_inotify_fd >= 0;
+#else
+  can_cache = FALSE;
+#endif
+
+  for (i = 0; i < G_N_ELEMENTS (thumbnail_dirs); i++)
+    {
+      dir = &thumbnail_dirs[i];
+
+      if (dir->path == NULL)
+	dir->path = g_build_filename (get_thumbnail_base_dir (), dir->name, NULL);
+
+#ifdef HAVE_SYS_INOTIFY_H
+      /* Watch before opening, so no change can be missed */
+      if (dir->wd == -1 && thumbnail_inotify_fd >= 0)
+	dir->wd = inotify_add_watch (thumbnail_inotify_fd, dir->path,
+				     IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+				     IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB |
+				     IN_DELETE_SELF | IN_MOVE_SELF);
+#endif
+      if (dir->wd == -1)
+	can_cache = FALSE;
+
+#ifdef HAVE_FSTATAT
+      if (dir->fd == -1)
+	{
+	  dir->fd = open (dir->path, O_RDONLY);
+	  /* Without the fd, thumbnail_exists() goes by path */
+	  if (dir->fd != -1 && fcntl (dir->fd, F_SETFD, FD_CLOEXEC) == -1)
+	    {
+	      close (dir->fd);
+	      dir->fd = -1;
+	    }
+	}
+#endif
+    }
+
+  return can_cache;
+}
+
+/* @dir is a copy taken under the lock; called without it */
+static gboolean
+thumbnail_exists (const ThumbnailDir *dir,
+		  const char         *basename)
+{
+  struct stat statbuf;
+  char *filename;
+  int res;
+
+#ifdef HAVE_FSTATAT
+  if (dir->fd != -1)
+    res = fstatat (dir->fd, basename, &statbuf, 0);
+  else
+#endif
+    {
+      filename = g_build_filename (dir->path, basename, NULL);
+      res = g_stat (filename, &statbuf);
+      g_free (filename);
+    }
+
+  return res == 0 && S_ISREG (statbuf.st_mode);
+}
+
+static void
+get_thumbnail_attributes (const char     *path,
+                          GFileInfo      *info,
+                          GLocalFileStat *statbuf)
+{
+  ThumbnailDir dirs[G_N_ELEMENTS (thumbnail_dirs)];
+  CacheEntry *entry;
+  CacheKey key;
+  char *basename;
+  char *filename;
+  gboolean failed, can_cache;
+  guint generation;
+
+  cache_key_init (&key, statbuf);
+  filename = NULL;
+  failed = FALSE;
+
+  G_LOCK (thumbnail_cache);
+
+  can_cache = update_thumbnail_dirs ();
+  entry = NULL;
+  if (can_cache)
+    entry = cache_lookup (&thumbnail_cache, &key, path);
+
+  if (entry != NULL)
+    {
+      filename = g_strdup (entry->value);
+      failed = entry->thumbnailing_failed;
+      G_UNLOCK (thumbnail_cache);
+    }
+  else
+    {
+      memcpy (dirs, thumbnail_dirs, sizeof (dirs));
+      generation = thumbnail_cache_generation;
+      thumbnail_lookups++;
+      G_UNLOCK (thumbnail_cache);
+
+      basename = get_thumbnail_basename (path);
+
+      if (thumbnail_exists (&dirs[THUMBNAIL_DIR_NORMAL], basename))
+	filename = g_build_filename (dirs[THUMBNAIL_DIR_NORMAL].path,
+				     basename, NULL);
+      else
+	failed = thumbnail_exists (&dirs[THUMBNAIL_DIR_FAIL], basename);
+      g_free (basename);
+
+      G_LOCK (thumbnail_cache);
+      if (--thumbnail_lookups == 0)
+	close_retired_thumbnail_fds ();
+      if (can_cache && generation == thumbnail_cache_generation)
+	cache_insert (&thumbnail_cache, &key, path, filename, failed);
+      G_UNLOCK (thumbnail_cache);
+    }
+
+  if (filename)
+    g_file_info_set_attribute_byte_string (info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH, filename);
+  else if (failed)
+    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAILING_FAILED, TRUE);
+  g_free (filename);
+}
+
+#endif /* !G_OS_WIN32 */
+
 #ifdef G_OS_WIN32
 static void
 win32_get_file_user_info (const gchar  *filename,
@@ -1399,6 +2004,189 @@ win32_get_file_user_info (const gchar  *filename,
 }
 #endif /* G_OS_WIN32 */
 
+/* @path may be %NULL if @basename is the last component of it */
+static void
+set_info_from_name (GFileInfo             *info,
+		    const char            *basename,
+		    const char            *path,
+		    GLocalFileInfoPlan    *plan)
+{
+  if (plan->needs & NEEDS_DISPLAY_NAME)
+    {
+      char *display_name;
+
+      if (path != NULL)
+	display_name = g_filename_display_basename (path);
+      else
+	display_name = g_filename_display_name (basename);
+     
+      /* look for U+FFFD REPLACEMENT CHARACTER */ 
+      if (strstr (display_name, "\357\277\275") != NULL)
+	{
+	  char *p = display_name;
+	  display_name = g_strconcat (display_name, _(" (invalid encoding)"), NULL);
+	  g_free (p);
+	}
+      g_file_info_set_display_name (info, display_name);
+      g_free (display_name);
+    }
+  
+  if (plan->needs & NEEDS_EDIT_NAME)
+    {
+      char *edit_name;
+
+      if (path != NULL)
+	edit_name = g_filename_display_basename (path);
+      else
+	edit_name = g_filename_display_name (basename);
+      g_file_info_set_edit_name (info, edit_name);
+      g_free (edit_name);
+    }
+
+  
+  if (plan->needs & NEEDS_COPY_NAME)
+    {
+      char *copy_name = g_filename_to_utf8 (basename, -1, NULL, NULL, NULL);
+      if (copy_name)
+	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME, copy_name);
+      g_free (copy_name);
+    }
+}
+
+/* Attributes that can be filled in from a directory entry's name and
+ * d_type alone, without stating the file.
+ */
+static const char * const file_type_attributes[] = {
+  G_FILE_ATTRIBUTE_STANDARD_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_TYPE,
+  G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+  G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP,
+  G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK,
+  G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME,
+  G_FILE_ATTRIBUTE_STANDARD_COPY_NAME,
+  NULL
+};
+
+gboolean
+_g_local_file_info_file_type_is_enough (GFileAttributeMatcher *attribute_matcher)
+{
+  return _g_file_attribute_matcher_is_subset (attribute_matcher,
+					      file_type_attributes);
+}
+
+/* Only valid if _g_local_file_info_file_type_is_enough() returned
+ * %TRUE for the matcher of @plan. @type is what lstat() (or stat(), when
+ * following symlinks) would have reported.
+ */
+GFileInfo *
+_g_local_file_info_get_from_file_type (const char            *basename,
+				       GFileType              type,
+				       gboolean               is_symlink,
+				       GLocalFileInfoPlan    *plan)
+{
+  GFileInfo *info;
+
+  info = g_file_info_new ();
+  g_file_info_set_attribute_mask (info, plan->matcher);
+
+  g_file_info_set_name (info, basename);
+
+  if (plan->matcher == NULL)
+    return info;
+
+  g_file_info_set_file_type (info, type);
+  if (is_symlink)
+    g_file_info_set_is_symlink (info, TRUE);
+
+  if (basename[0] == '.')
+    g_file_info_set_is_hidden (info, TRUE);
+
+  if (basename[strlen (basename) -1] == '~' &&
+      type == G_FILE_TYPE_REGULAR)
+    g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP, TRUE);
+
+  set_info_from_name (info, basename, NULL, plan);
+
+  g_file_info_unset_attribute_mask (info);
+
+  return info;
+}
+
+#ifndef G_OS_WIN32
+
+#ifdef HAVE_STATX
+static void
+stat_from_statx (GLocalFileStat     *statbuf,
+		 const struct statx *stx)
+{
+  /* Fields that weren't asked for are left zeroed */
+  memset (statbuf, 0, sizeof (*statbuf));
+
+  statbuf->st_dev = makedev (stx->stx_dev_major, stx->stx_dev_minor);
+  statbuf->st_ino = stx->stx_ino;
+  statbuf->st_mode = stx->stx_mode;
+  statbuf->st_nlink = stx->stx_nlink;
+  statbuf->st_uid = stx->stx_uid;
+  statbuf->st_gid = stx->stx_gid;
+  statbuf->st_rdev = makedev (stx->stx_rdev_major, stx->stx_rdev_minor);
+  statbuf->st_size = stx->stx_size;
+#if defined (HAVE_STRUCT_STAT_ST_BLKSIZE)
+  statbuf->st_blksize = stx->stx_blksize;
+#endif
+#if defined (HAVE_STRUCT_STAT_ST_BLOCKS)
+  statbuf->st_blocks = stx->stx_blocks;
+#endif
+  statbuf->st_atime = stx->stx_atime.tv_sec;
+  statbuf->st_mtime = stx->stx_mtime.tv_sec;
+  statbuf->st_ctime = stx->stx_ctime.tv_sec;
+#if defined (HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+  statbuf->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+  statbuf->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+  statbuf->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+#endif
+}
+#endif
+
+/* When enumerating a directory, @dirfd is the directory and @basename
+ * is looked up relative to it, which saves the kernel walking all of
+ * @path again for every entry. Otherwise @dirfd is -1 and @path is used.
+ */
+static int
+local_file_stat (int             dirfd,
+		 guint           stat_mask,
+		 const char     *basename,
+		 const char     *path,
+		 gboolean        follow_symlinks,
+		 GLocalFileStat *statbuf)
+{
+#if defined (HAVE_STATX)
+  if (dirfd != -1)
+    {
+      struct statx stx;
+
+      if (statx (dirfd, basename,
+		 follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW,
+		 stat_mask, &stx) == -1)
+	return -1;
+
+      stat_from_statx (statbuf, &stx);
+      return 0;
+    }
+#elif defined (HAVE_FSTATAT)
+  if (dirfd != -1)
+    return fstatat (dirfd, basename, statbuf,
+		    follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW);
+#endif
+
+  if (follow_symlinks)
+    return stat (path, statbuf);
+  else
+    return g_lstat (path, statbuf);
+}
+
+#endif /* !G_OS_WIN32 */
+
 GFileInfo *
 _g_local_file_info_get (const char             *basename,
 			const char             *path,
@@ -1406,6 +2194,27 @@ _g_local_file_info_get (const char             *basename,
 			GFileQueryInfoFlags     flags,
 			GLocalParentFileInfo   *parent_info,
 			GError                **error)
+{
+  GLocalFileInfoPlan *plan;
+  GFileInfo *info;
+
+  plan = _g_local_file_info_plan_new (attribute_matcher);
+  info = _g_local_file_info_get_at (-1, plan, basename, path,
+				    flags, parent_info, error);
+  _g_local_file_info_plan_free (plan);
+
+  return info;
+}
+
+/* @dirfd is only used on Unix; see local_file_stat() */
+GFileInfo *
+_g_local_file_info_get_at (int                     dirfd,
+			   GLocalFileInfoPlan     *plan,
+			   const char             *basename,
+			   const char             *path,
+			   GFileQueryInfoFlags     flags,
+			   GLocalParentFileInfo   *parent_info,
+			   GError                **error)
 {
   GFileInfo *info;
   GLocalFileStat statbuf;
@@ -1421,16 +2230,17 @@ _g_local_file_info_get (const char             *basename,
   info = g_file_info_new ();
 
   /* Make sure we don't set any unwanted attributes */
-  g_file_info_set_attribute_mask (info, attribute_matcher);
+  g_file_info_set_attribute_mask (info, plan->matcher);
   
   g_file_info_set_name (info, basename);
 
   /* Avoid stat in trivial case */
-  if (attribute_matcher == NULL)
+  if (plan->matcher == NULL)
     return info;
 
 #ifndef G_OS_WIN32
-  res = g_lstat (path, &statbuf);
+  res = local_file_stat (dirfd, plan->stat_mask, basename, path,
+			 FALSE, &statbuf);
 #else
   {
     wchar_t *wpath = g_utf8_to_utf16 (path, -1, NULL, NULL, error);
@@ -1483,7 +2293,8 @@ _g_local_file_info_get (const char             *basename,
       /* Unless NOFOLLOW was set we default to following symlinks */
       if (!(flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS))
 	{
-	  res = stat (path, &statbuf2);
+	  res = local_file_stat (dirfd, plan->stat_mask, basename, path,
+				 TRUE, &statbuf2);
 
 	    /* Report broken links as symlinks */
 	  if (res != -1)
@@ -1494,7 +2305,7 @@ _g_local_file_info_get (const char             *basename,
     }
 #endif
 
-  set_info_from_stat (info, &statbuf, attribute_matcher);
+  set_info_from_stat (info, &statbuf, plan);
   
 #ifndef G_OS_WIN32
   if (basename != NULL && basename[0] == '.')
@@ -1515,9 +2326,7 @@ _g_local_file_info_get (const char             *basename,
 #endif
 
 #ifdef S_ISLNK
-  if (is_symlink &&
-      g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET))
+  if (is_symlink && (plan->needs & NEEDS_SYMLINK_TARGET))
     {
       char *link = read_link (path);
       g_file_info_set_symlink_target (info, link);
@@ -1525,44 +2334,9 @@ _g_local_file_info_get (const char             *basename,
     }
 #endif
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME))
-    {
-      char *display_name = g_filename_display_basename (path);
-     
-      /* look for U+FFFD REPLACEMENT CHARACTER */ 
-      if (strstr (display_name, "\357\277\275") != NULL)
-	{
-	  char *p = display_name;
-	  display_name = g_strconcat (display_name, _(" (invalid encoding)"), NULL);
-	  g_free (p);
-	}
-      g_file_info_set_display_name (info, display_name);
-      g_free (display_name);
-    }
-  
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME))
-    {
-      char *edit_name = g_filename_display_basename (path);
-      g_file_info_set_edit_name (info, edit_name);
-      g_free (edit_name);
-    }
-
-  
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_COPY_NAME))
-    {
-      char *copy_name = g_filename_to_utf8 (basename, -1, NULL, NULL, NULL);
-      if (copy_name)
-	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME, copy_name);
-      g_free (copy_name);
-    }
+  set_info_from_name (info, basename, path, plan);
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE) ||
-      g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_ICON))
+  if (plan->needs & NEEDS_CONTENT_TYPE)
     {
       char *content_type = get_content_type (basename, path, &statbuf, is_symlink, symlink_broken, flags, FALSE);
 
@@ -1570,8 +2344,7 @@ _g_local_file_info_get (const char             *basename,
 	{
 	  g_file_info_set_content_type (info, content_type);
 
-	  if (g_file_attribute_matcher_matches (attribute_matcher,
-						G_FILE_ATTRIBUTE_STANDARD_ICON))
+	  if (plan->needs & NEEDS_ICON)
 	    {
 	      GIcon *icon;
 
@@ -1604,8 +2377,7 @@ _g_local_file_info_get (const char             *basename,
 	}
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE))
+  if (plan->needs & NEEDS_FAST_CONTENT_TYPE)
     {
       char *content_type = get_content_type (basename, path, &statbuf, is_symlink, symlink_broken, flags, TRUE);
       
@@ -1616,8 +2388,7 @@ _g_local_file_info_get (const char             *basename,
 	}
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_USER))
+  if (plan->needs & NEEDS_OWNER_USER)
     {
       char *name = NULL;
       
@@ -1631,8 +2402,7 @@ _g_local_file_info_get (const char             *basename,
       g_free (name);
     }
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_USER_REAL))
+  if (plan->needs & NEEDS_OWNER_USER_REAL)
     {
       char *name = NULL;
 #ifdef G_OS_WIN32
@@ -1645,8 +2415,7 @@ _g_local_file_info_get (const char             *basename,
       g_free (name);
     }
   
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_OWNER_GROUP))
+  if (plan->needs & NEEDS_OWNER_GROUP)
     {
       char *name = NULL;
 #ifdef G_OS_WIN32
@@ -1660,21 +2429,20 @@ _g_local_file_info_get (const char             *basename,
     }
 
   if (parent_info && parent_info->device != 0 &&
-      g_file_attribute_matcher_matches (attribute_matcher, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT) &&
+      (plan->needs & NEEDS_IS_MOUNTPOINT) &&
       statbuf.st_dev != parent_info->device) 
     g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT, TRUE);
   
-  get_access_rights (attribute_matcher, info, path, &statbuf, parent_info);
+  get_access_rights (plan, info, path, &statbuf, parent_info);
   
 #ifdef HAVE_SELINUX
-  get_selinux_context (path, info, attribute_matcher, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
+  get_selinux_context (path, info, plan, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
 #endif
-  get_xattrs (path, TRUE, info, attribute_matcher, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
-  get_xattrs (path, FALSE, info, attribute_matcher, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
+  get_xattrs (path, TRUE, info, plan, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
+  get_xattrs (path, FALSE, info, plan, (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0);
 
-  if (g_file_attribute_matcher_matches (attribute_matcher,
-					G_FILE_ATTRIBUTE_THUMBNAIL_PATH))
-    get_thumbnail_attributes (path, info);
+  if (plan->needs & NEEDS_THUMBNAIL)
+    get_thumbnail_attributes (path, info, &statbuf);
   
   g_file_info_unset_attribute_mask (info);
 
@@ -1688,6 +2456,7 @@ _g_local_file_info_get_from_fd (int         fd,
 {
   GLocalFileStat stat_buf;
   GFileAttributeMatcher *matcher;
+  GLocalFileInfoPlan *plan;
   GFileInfo *info;
   
 #ifdef G_OS_WIN32
@@ -1710,14 +2479,15 @@ _g_local_file_info_get_from_fd (int         fd,
   info = g_file_info_new ();
 
   matcher = g_file_attribute_matcher_new (attributes);
+  plan = _g_local_file_info_plan_new (matcher);
 
   /* Make sure we don't set any unwanted attributes */
   g_file_info_set_attribute_mask (info, matcher);
   
-  set_info_from_stat (info, &stat_buf, matcher);
+  set_info_from_stat (info, &stat_buf, plan);
   
 #ifdef HAVE_SELINUX
-  if (g_file_attribute_matcher_matches (matcher, G_FILE_ATTRIBUTE_SELINUX_CONTEXT) &&
+  if ((plan->needs & NEEDS_SELINUX_CONTEXT) &&
       is_selinux_enabled ())
     {
       char *context;
@@ -1729,9 +2499,10 @@ _g_local_file_info_get_from_fd (int         fd,
     }
 #endif
 
-  get_xattrs_from_fd (fd, TRUE, info, matcher);
-  get_xattrs_from_fd (fd, FALSE, info, matcher);
+  get_xattrs_from_fd (fd, TRUE, info, plan);
+  get_xattrs_from_fd (fd, FALSE, info, plan);
   
+  _g_local_file_info_plan_free (plan);
   g_file_attribute_matcher_unref (matcher);
 
   g_file_info_unset_attribute_mask (info);
@@ -41,6 +41,9 @@ typedef struct
   dev_t    device;
 } GLocalParentFileInfo;
 
+/* What to look up for a set of attributes, see _g_local_file_info_plan_new() */
+typedef struct _GLocalFileInfoPlan GLocalFileInfoPlan;
+
 #ifdef G_OS_WIN32
 /* We want 64-bit file size support */
 #define GLocalFileStat struct _stati64
@@ -59,6 +62,23 @@ GFileInfo *_g_local_file_info_get             (const char             *basename,
                                                GFileQueryInfoFlags     flags,
                                                GLocalParentFileInfo   *parent_info,
                                                GError                **error);
+GFileInfo *_g_local_file_info_get_at          (int                     dirfd,
+                                               GLocalFileInfoPlan     *plan,
+                                               const char             *basename,
+                                               const char             *path,
+                                               GFileQueryInfoFlags     flags,
+                                               GLocalParentFileInfo   *parent_info,
+                                               GError                **error);
+GLocalFileInfoPlan *
+           _g_local_file_info_plan_new        (GFileAttributeMatcher  *attribute_matcher);
+void       _g_local_file_info_plan_free       (GLocalFileInfoPlan     *plan);
+gboolean   _g_local_file_info_file_type_is_enough
+                                              (GFileAttributeMatcher  *attribute_matcher);
+GFileInfo *_g_local_file_info_get_from_file_type
+                                              (const char             *basename,
+                                               GFileType               type,
+                                               gboolean                is_symlink,
+                                               GLocalFileInfoPlan     *plan);
 GFileInfo *_g_local_file_info_get_from_fd     (int                     fd,
                                                const char             *attributes,
                                                GError                **error);
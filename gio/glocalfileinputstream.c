@@ -36,16 +36,32 @@
 #include "gioerror.h"
 #include "glocalfileinputstream.h"
 #include "glocalfileinfo.h"
+#include "gsimpleasyncresult.h"
+#include "giouring.h"
 #include "glibintl.h"
 
+#ifdef G_OS_UNIX
+#include "gfiledescriptorbased.h"
+#endif
+
 #ifdef G_OS_WIN32
 #include <io.h>
 #endif
 
 #include "gioalias.h"
 
+#ifdef G_OS_UNIX
+static void g_local_file_input_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface);
+#endif
+
 #define g_local_file_input_stream_get_type _g_local_file_input_stream_get_type
+#ifdef G_OS_UNIX
+G_DEFINE_TYPE_WITH_CODE (GLocalFileInputStream, g_local_file_input_stream, G_TYPE_FILE_INPUT_STREAM,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_FILE_DESCRIPTOR_BASED,
+						g_local_file_input_stream_file_descriptor_based_iface_init));
+#else
 G_DEFINE_TYPE (GLocalFileInputStream, g_local_file_input_stream, G_TYPE_FILE_INPUT_STREAM);
+#endif
 
 struct _GLocalFileInputStreamPrivate {
   int fd;
@@ -63,6 +79,14 @@ static gssize     g_local_file_input_stream_skip       (GInputStream      *strea
 static gboolean   g_local_file_input_stream_close      (GInputStream      *stream,
 							GCancellable      *cancellable,
 							GError           **error);
+static void       g_local_file_input_stream_close_async  (GInputStream         *stream,
+							  int                   io_priority,
+							  GCancellable         *cancellable,
+							  GAsyncReadyCallback   callback,
+							  gpointer              user_data);
+static gboolean   g_local_file_input_stream_close_finish (GInputStream         *stream,
+							  GAsyncResult         *result,
+							  GError              **error);
 static goffset    g_local_file_input_stream_tell       (GFileInputStream  *stream);
 static gboolean   g_local_file_input_stream_can_seek   (GFileInputStream  *stream);
 static gboolean   g_local_file_input_stream_seek       (GFileInputStream  *stream,
@@ -99,6 +123,8 @@ g_local_file_input_stream_class_init (GLocalFileInputStreamClass *klass)
   stream_class->read_fn = g_local_file_input_stream_read;
   stream_class->skip = g_local_file_input_stream_skip;
   stream_class->close_fn = g_local_file_input_stream_close;
+  stream_class->close_async = g_local_file_input_stream_close_async;
+  stream_class->close_finish = g_local_file_input_stream_close_finish;
   file_stream_class->tell = g_local_file_input_stream_tell;
   file_stream_class->can_seek = g_local_file_input_stream_can_seek;
   file_stream_class->seek = g_local_file_input_stream_seek;
@@ -113,6 +139,20 @@ g_local_file_input_stream_init (GLocalFileInputStream *info)
 					    GLocalFileInputStreamPrivate);
 }
 
+#ifdef G_OS_UNIX
+static int
+g_local_file_input_stream_get_fd_based (GFileDescriptorBased *fd_based)
+{
+  return G_LOCAL_FILE_INPUT_STREAM (fd_based)->priv->fd;
+}
+
+static void
+g_local_file_input_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface)
+{
+  iface->get_fd = g_local_file_input_stream_get_fd_based;
+}
+#endif
+
 /**
  * g_local_file_input_stream_new:
  * @fd: File Descriptor.
@@ -130,6 +170,12 @@ _g_local_file_input_stream_new (int fd)
   return G_FILE_INPUT_STREAM (stream);
 }
 
+int
+_g_local_file_input_stream_get_fd (GLocalFileInputStream *stream)
+{
+  return stream->priv->fd;
+}
+
 static gssize
 g_local_file_input_stream_read (GInputStream  *stream,
 				void          *buffer,
@@ -240,6 +286,72 @@ g_local_file_input_stream_close (GInputStream  *stream,
 }
 
 
+static void
+close_async_uring_done (int      result,
+			gpointer user_data)
+{
+  GSimpleAsyncResult *res = user_data;
+
+  if (result < 0)
+    g_simple_async_result_set_error (res, G_IO_ERROR,
+				     g_io_error_from_errno (-result),
+				     _("Error closing file: %s"),
+				     g_strerror (-result));
+
+  g_simple_async_result_complete (res);
+  g_object_unref (res);
+}
+
+static void
+g_local_file_input_stream_close_async (GInputStream        *stream,
+				       int                  io_priority,
+				       GCancellable        *cancellable,
+				       GAsyncReadyCallback  callback,
+				       gpointer             user_data)
+{
+  GLocalFileInputStream *file;
+  GSimpleAsyncResult *res;
+  int fd;
+
+  file = G_LOCAL_FILE_INPUT_STREAM (stream);
+
+  res = g_simple_async_result_new (G_OBJECT (stream),
+				   callback,
+				   user_data,
+				   g_local_file_input_stream_close_async);
+
+  /* Once the close is submitted the descriptor belongs to the ring;
+   * forget it so nothing else uses or closes it again.
+   */
+  fd = file->priv->fd;
+  if (fd != -1)
+    {
+      file->priv->fd = -1;
+      if (_g_io_uring_close (fd, close_async_uring_done, res))
+	return;
+      file->priv->fd = fd;
+    }
+
+  g_object_unref (res);
+
+  G_INPUT_STREAM_CLASS (g_local_file_input_stream_parent_class)->
+    close_async (stream, io_priority, cancellable, callback, user_data);
+}
+
+static gboolean
+g_local_file_input_stream_close_finish (GInputStream  *stream,
+					GAsyncResult  *result,
+					GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  if (g_simple_async_result_get_source_tag (simple) != g_local_file_input_stream_close_async)
+    return G_INPUT_STREAM_CLASS (g_local_file_input_stream_parent_class)->
+      close_finish (stream, result, error);
+
+  return TRUE;
+}
+
 static goffset
 g_local_file_input_stream_tell (GFileInputStream *stream)
 {
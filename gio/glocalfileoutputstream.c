@@ -39,6 +39,11 @@
 #include "glocalfileoutputstream.h"
 #include "glocalfileinfo.h"
 
+#ifdef G_OS_UNIX
+#include "gfiledescriptorbased.h"
+#include "goutputvector-priv.h"
+#endif
+
 #ifdef G_OS_WIN32
 #include <io.h>
 #ifndef S_ISDIR
@@ -55,8 +60,18 @@
 
 #include "gioalias.h"
 
+#ifdef G_OS_UNIX
+static void g_local_file_output_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface);
+#endif
+
 #define g_local_file_output_stream_get_type _g_local_file_output_stream_get_type
+#ifdef G_OS_UNIX
+G_DEFINE_TYPE_WITH_CODE (GLocalFileOutputStream, g_local_file_output_stream, G_TYPE_FILE_OUTPUT_STREAM,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_FILE_DESCRIPTOR_BASED,
+						g_local_file_output_stream_file_descriptor_based_iface_init));
+#else
 G_DEFINE_TYPE (GLocalFileOutputStream, g_local_file_output_stream, G_TYPE_FILE_OUTPUT_STREAM);
+#endif
 
 /* Some of the file replacement code was based on the code from gedit,
  * relicenced to LGPL with permissions from the authors.
@@ -78,6 +93,14 @@ static gssize     g_local_file_output_stream_write        (GOutputStream      *s
 							   gsize               count,
 							   GCancellable       *cancellable,
 							   GError            **error);
+#ifdef G_OS_UNIX
+static gboolean   g_local_file_output_stream_writev       (GOutputStream      *stream,
+							   const GOutputVector *vectors,
+							   gsize               n_vectors,
+							   gsize              *bytes_written,
+							   GCancellable       *cancellable,
+							   GError            **error);
+#endif
 static gboolean   g_local_file_output_stream_close        (GOutputStream      *stream,
 							   GCancellable       *cancellable,
 							   GError            **error);
@@ -126,6 +149,9 @@ g_local_file_output_stream_class_init (GLocalFileOutputStreamClass *klass)
   gobject_class->finalize = g_local_file_output_stream_finalize;
 
   stream_class->write_fn = g_local_file_output_stream_write;
+#ifdef G_OS_UNIX
+  stream_class->writev_fn = g_local_file_output_stream_writev;
+#endif
   stream_class->close_fn = g_local_file_output_stream_close;
   file_stream_class->query_info = g_local_file_output_stream_query_info;
   file_stream_class->get_etag = g_local_file_output_stream_get_etag;
@@ -144,6 +170,20 @@ g_local_file_output_stream_init (GLocalFileOutputStream *stream)
 					      GLocalFileOutputStreamPrivate);
 }
 
+#ifdef G_OS_UNIX
+static int
+g_local_file_output_stream_get_fd_based (GFileDescriptorBased *fd_based)
+{
+  return G_LOCAL_FILE_OUTPUT_STREAM (fd_based)->priv->fd;
+}
+
+static void
+g_local_file_output_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface)
+{
+  iface->get_fd = g_local_file_output_stream_get_fd_based;
+}
+#endif
+
 static gssize
 g_local_file_output_stream_write (GOutputStream  *stream,
 				  const void     *buffer,
@@ -180,6 +220,64 @@ g_local_file_output_stream_write (GOutputStream  *stream,
   return res;
 }
 
+#ifdef G_OS_UNIX
+static gboolean
+g_local_file_output_stream_writev (GOutputStream        *stream,
+				   const GOutputVector  *vectors,
+				   gsize                 n_vectors,
+				   gsize                *bytes_written,
+				   GCancellable         *cancellable,
+				   GError              **error)
+{
+  GLocalFileOutputStream *file;
+  struct iovec *iov;
+  gssize res;
+  gsize i;
+
+  file = G_LOCAL_FILE_OUTPUT_STREAM (stream);
+
+  /* A short write is fine, so just write the first IOV_MAX vectors */
+  n_vectors = MIN (n_vectors, IOV_MAX);
+
+  if (OUTPUT_VECTOR_IS_IOVEC)
+    iov = (struct iovec *) vectors;
+  else
+    {
+      iov = g_newa (struct iovec, n_vectors);
+      for (i = 0; i < n_vectors; i++)
+	{
+	  iov[i].iov_base = (void *) vectors[i].buffer;
+	  iov[i].iov_len = vectors[i].size;
+	}
+    }
+
+  while (1)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+	return FALSE;
+      res = writev (file->priv->fd, iov, n_vectors);
+      if (res == -1)
+	{
+          int errsv = errno;
+
+	  if (errsv == EINTR)
+	    continue;
+	  
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to file: %s"),
+		       g_strerror (errsv));
+	  return FALSE;
+	}
+      
+      break;
+    }
+
+  *bytes_written = res;
+  return TRUE;
+}
+#endif
+
 static gboolean
 g_local_file_output_stream_close (GOutputStream  *stream,
 				  GCancellable   *cancellable,
@@ -490,6 +588,12 @@ g_local_file_output_stream_query_info (GFileOutputStream  *stream,
 					 error);
 }
 
+int
+_g_local_file_output_stream_get_fd (GLocalFileOutputStream *stream)
+{
+  return stream->priv->fd;
+}
+
 GFileOutputStream *
 _g_local_file_output_stream_create  (const char        *filename,
 				     GFileCreateFlags   flags,
@@ -40,6 +40,10 @@
  * #GMemoryInputStream is a class for using arbitrary
  * memory chunks as input for GIO streaming input operations.
  *
+ * The chunks are kept in an array together with their offsets in the
+ * stream, so that finding the data at a given position does not
+ * depend on how many chunks were added before it. To read the data
+ * without copying it, use g_memory_input_stream_borrow_chunk().
  */
 
 typedef struct _Chunk Chunk;
@@ -47,13 +51,15 @@ typedef struct _Chunk Chunk;
 struct _Chunk {
   guint8         *data;
   gsize           len;
+  gsize           offset; /* the position of data in the stream */
   GDestroyNotify  destroy;
 };
 
 struct _GMemoryInputStreamPrivate {
-  GSList *chunks;
+  GArray *chunks;
   gsize   len;
   gsize   pos;
+  guint   cursor; /* the chunk last read from */
 };
 
 static gssize   g_memory_input_stream_read         (GInputStream         *stream,
@@ -140,29 +146,24 @@ g_memory_input_stream_class_init (GMemoryInputStreamClass *klass)
   istream_class->close_finish = g_memory_input_stream_close_finish;
 }
 
-static void
-free_chunk (gpointer data, 
-            gpointer user_data)
-{
-  Chunk *chunk = data;
-
-  if (chunk->destroy)
-    chunk->destroy (chunk->data);
-
-  g_slice_free (Chunk, chunk);
-}
-
 static void
 g_memory_input_stream_finalize (GObject *object)
 {
   GMemoryInputStream        *stream;
   GMemoryInputStreamPrivate *priv;
+  Chunk *chunk;
+  guint i;
 
   stream = G_MEMORY_INPUT_STREAM (object);
   priv = stream->priv;
 
-  g_slist_foreach (priv->chunks, free_chunk, NULL);
-  g_slist_free (priv->chunks);
+  for (i = 0; i < priv->chunks->len; i++)
+    {
+      chunk = &g_array_index (priv->chunks, Chunk, i);
+      if (chunk->destroy)
+        chunk->destroy (chunk->data);
+    }
+  g_array_free (priv->chunks, TRUE);
 
   G_OBJECT_CLASS (g_memory_input_stream_parent_class)->finalize (object);
 }
@@ -183,6 +184,7 @@ g_memory_input_stream_init (GMemoryInputStream *stream)
   stream->priv = G_TYPE_INSTANCE_GET_PRIVATE (stream,
                                               G_TYPE_MEMORY_INPUT_STREAM,
                                               GMemoryInputStreamPrivate);
+  stream->priv->chunks = g_array_new (FALSE, FALSE, sizeof (Chunk));
 }
 
 /**
@@ -243,7 +245,7 @@ g_memory_input_stream_add_data (GMemoryInputStream *stream,
                                 GDestroyNotify      destroy)
 {
   GMemoryInputStreamPrivate *priv;
-  Chunk *chunk;
+  Chunk chunk;
  
   g_return_if_fail (G_IS_MEMORY_INPUT_STREAM (stream));
   g_return_if_fail (data != NULL);
@@ -253,13 +255,53 @@ g_memory_input_stream_add_data (GMemoryInputStream *stream,
   if (len == -1)
     len = strlen (data);
   
-  chunk = g_slice_new (Chunk);
-  chunk->data = (guint8 *)data;
-  chunk->len = len;
-  chunk->destroy = destroy;
+  chunk.data = (guint8 *)data;
+  chunk.len = len;
+  chunk.offset = priv->len;
+  chunk.destroy = destroy;
+
+  g_array_append_val (priv->chunks, chunk);
+  priv->len += chunk.len;
+}
+
+/* Returns the index of the chunk holding the byte at @pos, which must
+ * be less than priv->len. Sequential reads are found at or right after
+ * the cursor; other positions are looked up by bisecting the offsets.
+ */
+static guint
+find_chunk (GMemoryInputStreamPrivate *priv,
+            gsize                      pos)
+{
+  Chunk *chunks;
+  guint n_chunks;
+  guint lo, hi, mid;
+
+  chunks = (Chunk *)priv->chunks->data;
+  n_chunks = priv->chunks->len;
+
+  for (lo = priv->cursor; lo < n_chunks && lo <= priv->cursor + 1; lo++)
+    {
+      if (chunks[lo].offset > pos)
+        break;
+      if (pos < chunks[lo].offset + chunks[lo].len)
+        return priv->cursor = lo;
+    }
 
-  priv->chunks = g_slist_append (priv->chunks, chunk);
-  priv->len += chunk->len;
+  /* Find the last chunk starting at or before pos; any chunks after
+   * it start after pos, so it must hold pos.
+   */
+  lo = 0;
+  hi = n_chunks;
+  while (hi - lo > 1)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (chunks[mid].offset <= pos)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  return priv->cursor = lo;
 }
 
 static gssize
@@ -271,32 +313,24 @@ g_memory_input_stream_read (GInputStream  *stream,
 {
   GMemoryInputStream *memory_stream;
   GMemoryInputStreamPrivate *priv;
-  GSList *l;
   Chunk *chunk;
-  gsize offset, start, rest, size;
+  gsize start, rest, size;
+  guint i;
 
   memory_stream = G_MEMORY_INPUT_STREAM (stream);
   priv = memory_stream->priv;
 
   count = MIN (count, priv->len - priv->pos);
+  if (count == 0)
+    return 0;
 
-  offset = 0;
-  for (l = priv->chunks; l; l = l->next) 
-    {
-      chunk = (Chunk *)l->data;
-
-      if (offset + chunk->len > priv->pos)
-        break;
-
-      offset += chunk->len;
-    }
-  
-  start = priv->pos - offset;
+  i = find_chunk (priv, priv->pos);
+  start = priv->pos - g_array_index (priv->chunks, Chunk, i).offset;
   rest = count;
 
-  for (; l && rest > 0; l = l->next)
+  for (; rest > 0; i++)
     {
-      chunk = (Chunk *)l->data;
+      chunk = &g_array_index (priv->chunks, Chunk, i);
       size = MIN (rest, chunk->len - start);
 
       memcpy ((guint8 *)buffer + (count - rest), chunk->data + start, size);
@@ -305,11 +339,72 @@ g_memory_input_stream_read (GInputStream  *stream,
       start = 0;
     }
 
+  priv->cursor = i - 1;
   priv->pos += count;
 
   return count;
 }
 
+/**
+ * g_memory_input_stream_borrow_chunk:
+ * @stream: a #GMemoryInputStream
+ * @max_count: the maximum number of bytes to read
+ * @count: location to store the number of bytes read
+ * @error: location to store the error occuring, or %NULL to ignore
+ *
+ * Reads up to @max_count bytes from @stream without copying them:
+ * instead of filling a buffer, a pointer to the data in the chunk
+ * holding the current position is returned, and the position moves
+ * past it. At most the rest of that chunk is returned, so reading
+ * past the end of a chunk takes another call.
+ *
+ * The data belongs to @stream and must not be modified. It stays
+ * valid until @stream is finalized.
+ *
+ * At the end of the stream %NULL is returned and @count is set to 0,
+ * without setting @error. On error, for instance if @stream is closed,
+ * %NULL is returned and @error is set.
+ *
+ * Returns: a pointer to the data read, or %NULL
+ *
+ * Since: 2.22
+ **/
+gconstpointer
+g_memory_input_stream_borrow_chunk (GMemoryInputStream  *stream,
+                                    gsize                max_count,
+                                    gsize               *count,
+                                    GError             **error)
+{
+  GMemoryInputStreamPrivate *priv;
+  GInputStream *input_stream;
+  Chunk *chunk;
+  gsize start;
+
+  g_return_val_if_fail (G_IS_MEMORY_INPUT_STREAM (stream), NULL);
+  g_return_val_if_fail (count != NULL, NULL);
+
+  priv = stream->priv;
+  input_stream = G_INPUT_STREAM (stream);
+
+  *count = 0;
+
+  /* Fails if the stream is closed or has an outstanding operation */
+  if (!g_input_stream_set_pending (input_stream, error))
+    return NULL;
+  g_input_stream_clear_pending (input_stream);
+
+  if (max_count == 0 || priv->pos >= priv->len)
+    return NULL;
+
+  chunk = &g_array_index (priv->chunks, Chunk, find_chunk (priv, priv->pos));
+  start = priv->pos - chunk->offset;
+
+  *count = MIN (max_count, chunk->len - start);
+  priv->pos += *count;
+
+  return chunk->data + start;
+}
+
 static gssize
 g_memory_input_stream_skip (GInputStream  *stream,
                             gsize          count,
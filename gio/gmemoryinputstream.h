@@ -76,6 +76,10 @@ void           g_memory_input_stream_add_data      (GMemoryInputStream *stream,
                                                     const void         *data,
                                                     gssize              len,
                                                     GDestroyNotify      destroy);
+gconstpointer  g_memory_input_stream_borrow_chunk  (GMemoryInputStream *stream,
+                                                    gsize               max_count,
+                                                    gsize              *count,
+                                                    GError            **error);
 
 G_END_DECLS
 
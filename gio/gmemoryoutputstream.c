@@ -40,9 +40,19 @@
  * #GMemoryOutputStream is a class for using arbitrary
  * memory chunks as output for GIO streaming output operations.
  *
+ * A stream created with g_memory_output_stream_new() keeps all the
+ * data in one contiguous block of memory, which has to be reallocated
+ * and copied as it grows. A stream created with
+ * g_memory_output_stream_new_chunked() instead appends the data to a
+ * list of separately allocated chunks, so that data written once is
+ * never moved again. The chunks can be looked at with
+ * g_memory_output_stream_get_vectors() or passed on to another stream
+ * with g_memory_output_stream_drain(); a contiguous copy of the data
+ * is only made when g_memory_output_stream_get_data() is called.
  */
 
 #define MIN_ARRAY_SIZE  16
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
 
 struct _GMemoryOutputStreamPrivate {
   
@@ -54,6 +64,15 @@ struct _GMemoryOutputStreamPrivate {
 
   GReallocFunc   realloc_fn;
   GDestroyNotify destroy;
+
+  /* Chunked streams keep their data in chunks instead of in data */
+  GArray        *chunks;      /* GOutputVector: the data in each chunk */
+  gpointer       first_chunk; /* The memory of the first chunk, whose
+                               * vector moves forward when draining */
+  gsize          chunk_size;
+  gsize          chunk_room;  /* The room left in the last chunk */
+
+  GOutputVector  vector;      /* For get_vectors() on contiguous streams */
 };
 
 static void     g_memory_output_stream_finalize     (GObject      *object);
@@ -127,6 +146,30 @@ g_memory_output_stream_class_init (GMemoryOutputStreamClass *klass)
   ostream_class->close_finish = g_memory_output_stream_close_finish;
 }
 
+static void
+drop_chunks (GMemoryOutputStreamPrivate *priv,
+             guint                       n_chunks)
+{
+  GOutputVector *vector;
+  guint i;
+
+  for (i = 0; i < n_chunks; i++)
+    {
+      vector = &g_array_index (priv->chunks, GOutputVector, i);
+      g_free (i == 0 ? priv->first_chunk : (gpointer) vector->buffer);
+    }
+
+  g_array_remove_range (priv->chunks, 0, n_chunks);
+
+  if (priv->chunks->len > 0)
+    priv->first_chunk = (gpointer) g_array_index (priv->chunks, GOutputVector, 0).buffer;
+  else
+    {
+      priv->first_chunk = NULL;
+      priv->chunk_room = 0;
+    }
+}
+
 static void
 g_memory_output_stream_finalize (GObject *object)
 {
@@ -139,6 +182,12 @@ g_memory_output_stream_finalize (GObject *object)
   if (priv->destroy)
     priv->destroy (priv->data);
 
+  if (priv->chunks)
+    {
+      drop_chunks (priv, priv->chunks->len);
+      g_array_free (priv->chunks, TRUE);
+    }
+
   G_OBJECT_CLASS (g_memory_output_stream_parent_class)->finalize (object);
 }
 
@@ -211,12 +260,96 @@ g_memory_output_stream_new (gpointer       data,
   return stream;
 }
 
+/**
+ * g_memory_output_stream_new_chunked:
+ * @chunk_size: the size of the chunks to allocate, or 0 for the default
+ *
+ * Creates a new #GMemoryOutputStream that stores the data written to
+ * it in a list of chunks of @chunk_size bytes, rather than in one
+ * contiguous block of memory. Growing such a stream never reallocates
+ * or copies the data already written, which makes it suitable for
+ * building large payloads.
+ *
+ * Use g_memory_output_stream_get_vectors() to access the data without
+ * copying it, or g_memory_output_stream_drain() to write it to another
+ * stream. The stream is not seekable.
+ *
+ * Return value: A newly created #GMemoryOutputStream object.
+ *
+ * Since: 2.22
+ **/
+GOutputStream *
+g_memory_output_stream_new_chunked (gsize chunk_size)
+{
+  GOutputStream *stream;
+  GMemoryOutputStreamPrivate *priv;
+
+  stream = g_object_new (G_TYPE_MEMORY_OUTPUT_STREAM, NULL);
+
+  priv = G_MEMORY_OUTPUT_STREAM (stream)->priv;
+
+  priv->chunks = g_array_new (FALSE, FALSE, sizeof (GOutputVector));
+  priv->chunk_size = chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE;
+
+  return stream;
+}
+
+static void
+add_chunk (GMemoryOutputStreamPrivate *priv,
+           gpointer                    data,
+           gsize                       size,
+           gsize                       room)
+{
+  GOutputVector vector;
+
+  if (priv->chunks->len == 0)
+    priv->first_chunk = data;
+
+  vector.buffer = data;
+  vector.size = size;
+  g_array_append_val (priv->chunks, vector);
+
+  priv->chunk_room = room;
+}
+
+/* Replaces the chunks with a single one holding all the data */
+static void
+coalesce_chunks (GMemoryOutputStreamPrivate *priv)
+{
+  GOutputVector *vector;
+  guint8 *data;
+  gsize offset;
+  guint i;
+
+  if (priv->chunks->len == 0 ||
+      (priv->chunks->len == 1 && priv->first_chunk == g_array_index (priv->chunks, GOutputVector, 0).buffer))
+    return;
+
+  data = g_malloc (priv->valid_len);
+
+  offset = 0;
+  for (i = 0; i < priv->chunks->len; i++)
+    {
+      vector = &g_array_index (priv->chunks, GOutputVector, i);
+      memcpy (data + offset, vector->buffer, vector->size);
+      offset += vector->size;
+    }
+
+  drop_chunks (priv, priv->chunks->len);
+  add_chunk (priv, data, priv->valid_len, 0);
+}
+
 /**
  * g_memory_output_stream_get_data:
  * @ostream: a #GMemoryOutputStream
  *
  * Gets any loaded data from the @ostream. 
  *
+ * For a stream created with g_memory_output_stream_new_chunked(), this
+ * first copies all the chunks into one contiguous block, which then
+ * replaces them. Use g_memory_output_stream_get_vectors() to avoid the
+ * copy.
+ *
  * Note that the returned pointer may become invalid on the next 
  * write or truncate operation on the stream. 
  * 
@@ -225,9 +358,173 @@ g_memory_output_stream_new (gpointer       data,
 gpointer
 g_memory_output_stream_get_data (GMemoryOutputStream *ostream)
 {
+  GMemoryOutputStreamPrivate *priv;
+
+  g_return_val_if_fail (G_IS_MEMORY_OUTPUT_STREAM (ostream), NULL);
+
+  priv = ostream->priv;
+
+  if (priv->chunks)
+    {
+      coalesce_chunks (priv);
+      return priv->first_chunk;
+    }
+
+  return priv->data;
+}
+
+/**
+ * g_memory_output_stream_get_vectors:
+ * @ostream: a #GMemoryOutputStream
+ * @n_vectors: location to store the number of vectors
+ *
+ * Gets the data written to @ostream as an array of #GOutputVector<!-- -->s,
+ * one for each chunk of a stream created with
+ * g_memory_output_stream_new_chunked(), or a single one for other
+ * streams. The array can be passed to g_output_stream_writev() as is.
+ *
+ * Note that the returned array and the data it points to may become
+ * invalid on the next write, drain or truncate operation on the stream,
+ * and on the next call to g_memory_output_stream_get_data().
+ *
+ * Returns: the vectors describing the stream's data
+ *
+ * Since: 2.22
+ **/
+const GOutputVector *
+g_memory_output_stream_get_vectors (GMemoryOutputStream *ostream,
+                                    guint               *n_vectors)
+{
+  GMemoryOutputStreamPrivate *priv;
+
   g_return_val_if_fail (G_IS_MEMORY_OUTPUT_STREAM (ostream), NULL);
+  g_return_val_if_fail (n_vectors != NULL, NULL);
 
-  return ostream->priv->data;
+  priv = ostream->priv;
+
+  if (priv->chunks)
+    {
+      *n_vectors = priv->chunks->len;
+      return (const GOutputVector *) priv->chunks->data;
+    }
+
+  priv->vector.buffer = priv->data;
+  priv->vector.size = priv->valid_len;
+  *n_vectors = priv->valid_len > 0 ? 1 : 0;
+
+  return &priv->vector;
+}
+
+/* Removes the first @count bytes of data from the stream */
+static void
+drop_data (GMemoryOutputStreamPrivate *priv,
+           gsize                       count)
+{
+  GOutputVector *vector;
+  guint n_chunks;
+
+  priv->valid_len -= count;
+
+  if (priv->chunks == NULL)
+    {
+      g_memmove (priv->data, (guint8 *)priv->data + count, priv->valid_len);
+      priv->pos = priv->pos > count ? priv->pos - count : 0;
+      return;
+    }
+
+  n_chunks = 0;
+  while (n_chunks < priv->chunks->len &&
+         g_array_index (priv->chunks, GOutputVector, n_chunks).size <= count)
+    {
+      count -= g_array_index (priv->chunks, GOutputVector, n_chunks).size;
+      n_chunks++;
+    }
+
+  /* Keep the last chunk while there is room left in it */
+  if (n_chunks == priv->chunks->len && priv->chunk_room > 0)
+    {
+      n_chunks--;
+      count += g_array_index (priv->chunks, GOutputVector, n_chunks).size;
+    }
+
+  if (n_chunks > 0)
+    drop_chunks (priv, n_chunks);
+
+  if (count > 0)
+    {
+      vector = &g_array_index (priv->chunks, GOutputVector, 0);
+      vector->buffer = (const guint8 *)vector->buffer + count;
+      vector->size -= count;
+    }
+}
+
+/**
+ * g_memory_output_stream_drain:
+ * @ostream: a #GMemoryOutputStream
+ * @target: a #GOutputStream to write the data to
+ * @bytes_written: location to store the number of bytes that were
+ *     written to @target, or %NULL
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: location to store the error occuring, or %NULL to ignore
+ *
+ * Writes all the data in @ostream to @target and removes it from
+ * @ostream, so that the memory it used can be reused or freed. The data
+ * is written with g_output_stream_writev(), so the chunks of a stream
+ * created with g_memory_output_stream_new_chunked() are written without
+ * first being copied together.
+ *
+ * On error %FALSE is returned and @error is set accordingly. The data
+ * written to @target before the error, whose size is stored in
+ * @bytes_written, has still been removed from @ostream.
+ *
+ * Returns: %TRUE on success, %FALSE if there was an error
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_memory_output_stream_drain (GMemoryOutputStream  *ostream,
+                              GOutputStream        *target,
+                              gsize                *bytes_written,
+                              GCancellable         *cancellable,
+                              GError              **error)
+{
+  GMemoryOutputStreamPrivate *priv;
+  const GOutputVector *vectors;
+  guint n_vectors;
+  gsize total;
+  gsize n;
+  gboolean res;
+
+  g_return_val_if_fail (G_IS_MEMORY_OUTPUT_STREAM (ostream), FALSE);
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (target), FALSE);
+
+  priv = ostream->priv;
+  total = 0;
+  res = TRUE;
+
+  while (priv->valid_len > 0)
+    {
+      vectors = g_memory_output_stream_get_vectors (ostream, &n_vectors);
+
+      res = g_output_stream_writev (target, vectors, n_vectors,
+                                    &n, cancellable, error);
+      if (!res)
+        break;
+
+      if (n == 0)
+        {
+          g_warning ("Writev returned zero without error");
+          break;
+        }
+
+      drop_data (priv, n);
+      total += n;
+    }
+
+  if (bytes_written)
+    *bytes_written = total;
+
+  return res;
 }
 
 /**
@@ -245,15 +542,25 @@ g_memory_output_stream_get_data (GMemoryOutputStream *ostream)
  *
  * If you want the number of bytes currently written to the stream, use
  * g_memory_output_stream_get_data_size().
+ *
+ * For a stream created with g_memory_output_stream_new_chunked(), this
+ * is the size of the data plus the room left in the last chunk.
  * 
  * Returns: the number of bytes allocated for the data buffer
  */
 gsize
 g_memory_output_stream_get_size (GMemoryOutputStream *ostream)
 {
+  GMemoryOutputStreamPrivate *priv;
+
   g_return_val_if_fail (G_IS_MEMORY_OUTPUT_STREAM (ostream), 0);
+
+  priv = ostream->priv;
+
+  if (priv->chunks)
+    return priv->valid_len + priv->chunk_room;
   
-  return ostream->priv->len;
+  return priv->len;
 }
 
 /**
@@ -365,6 +672,34 @@ g_nearest_pow (gint num)
   return n;
 }
 
+static gssize
+write_chunked (GMemoryOutputStreamPrivate *priv,
+               const guint8               *buffer,
+               gsize                       count)
+{
+  GOutputVector *last;
+  gsize written;
+  gsize n;
+
+  for (written = 0; written < count; written += n)
+    {
+      if (priv->chunk_room == 0)
+        add_chunk (priv, g_malloc (priv->chunk_size), 0, priv->chunk_size);
+
+      last = &g_array_index (priv->chunks, GOutputVector, priv->chunks->len - 1);
+      n = MIN (count - written, priv->chunk_room);
+
+      memcpy ((guint8 *)last->buffer + last->size, buffer + written, n);
+      last->size += n;
+      priv->chunk_room -= n;
+    }
+
+  priv->pos += count;
+  priv->valid_len += count;
+
+  return count;
+}
+
 static gssize
 g_memory_output_stream_write (GOutputStream  *stream,
                               const void     *buffer,
@@ -383,6 +718,9 @@ g_memory_output_stream_write (GOutputStream  *stream,
   if (count == 0)
     return 0;
 
+  if (priv->chunks)
+    return write_chunked (priv, buffer, count);
+
   if (priv->pos + count > priv->len) 
     {
       /* At least enought to fit the write, rounded up
@@ -515,7 +853,7 @@ g_memory_output_stream_tell (GSeekable *seekable)
 static gboolean
 g_memory_output_stream_can_seek (GSeekable *seekable)
 {
-  return TRUE;
+  return G_MEMORY_OUTPUT_STREAM (seekable)->priv->chunks == NULL;
 }
 
 static gboolean
@@ -532,6 +870,13 @@ g_memory_output_stream_seek (GSeekable    *seekable,
   stream = G_MEMORY_OUTPUT_STREAM (seekable);
   priv = stream->priv;
 
+  if (priv->chunks)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Seek not supported on stream"));
+      return FALSE;
+    }
+
   switch (type) 
     {
     case G_SEEK_CUR:
@@ -595,6 +940,13 @@ g_memory_output_stream_truncate (GSeekable     *seekable,
 
   ostream = G_MEMORY_OUTPUT_STREAM (seekable);
   priv = ostream->priv;
+
+  if (priv->chunks)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Truncate not supported on stream"));
+      return FALSE;
+    }
  
   if (!array_resize (ostream, offset, FALSE, error))
     return FALSE;
@@ -88,10 +88,19 @@ GOutputStream *g_memory_output_stream_new           (gpointer             data,
                                                      gsize                len,
                                                      GReallocFunc         realloc_fn,
                                                      GDestroyNotify       destroy);
+GOutputStream *g_memory_output_stream_new_chunked   (gsize                chunk_size);
 gpointer       g_memory_output_stream_get_data      (GMemoryOutputStream *ostream);
 gsize          g_memory_output_stream_get_size      (GMemoryOutputStream *ostream);
 gsize          g_memory_output_stream_get_data_size (GMemoryOutputStream *ostream);
 
+const GOutputVector *g_memory_output_stream_get_vectors (GMemoryOutputStream  *ostream,
+                                                         guint                *n_vectors);
+gboolean       g_memory_output_stream_drain         (GMemoryOutputStream *ostream,
+                                                     GOutputStream       *target,
+                                                     gsize               *bytes_written,
+                                                     GCancellable        *cancellable,
+                                                     GError             **error);
+
 G_END_DECLS
 
 #endif /* __G_MEMORY_OUTPUT_STREAM_H__ */
@@ -20,6 +20,7 @@
  * Author: Alexander Larsson <alexl@redhat.com>
  */
 
+#define _GNU_SOURCE		/* For copy_file_range, splice and pwritev2 */
 #include "config.h"
 #include "goutputstream.h"
 #include "gcancellable.h"
@@ -29,6 +30,19 @@
 #include "gioerror.h"
 #include "glibintl.h"
 
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#include "gasynchelper.h"
+#include "gfiledescriptorbased.h"
+#include "giouring.h"
+#endif
+
 #include "gioalias.h"
 
 /**
@@ -48,13 +62,23 @@
 
 G_DEFINE_TYPE (GOutputStream, g_output_stream, G_TYPE_OBJECT);
 
+#define DEFAULT_SPLICE_BUFFER_SIZE (64 * 1024)
+
 struct _GOutputStreamPrivate {
   guint closed : 1;
   guint pending : 1;
   guint cancelled : 1;
+  guint nowait_unsupported : 1;
   GAsyncReadyCallback outstanding_callback;
+  gsize splice_buffer_size;
 };
 
+static gboolean g_output_stream_real_writev        (GOutputStream             *stream,
+						    const GOutputVector       *vectors,
+						    gsize                      n_vectors,
+						    gsize                     *bytes_written,
+						    GCancellable              *cancellable,
+						    GError                   **error);
 static gssize   g_output_stream_real_splice        (GOutputStream             *stream,
 						    GInputStream              *source,
 						    GOutputStreamSpliceFlags   flags,
@@ -130,6 +154,7 @@ g_output_stream_class_init (GOutputStreamClass *klass)
   gobject_class->finalize = g_output_stream_finalize;
   gobject_class->dispose = g_output_stream_dispose;
 
+  klass->writev_fn = g_output_stream_real_writev;
   klass->splice = g_output_stream_real_splice;
   
   klass->write_async = g_output_stream_real_write_async;
@@ -148,6 +173,7 @@ g_output_stream_init (GOutputStream *stream)
   stream->priv = G_TYPE_INSTANCE_GET_PRIVATE (stream,
 					      G_TYPE_OUTPUT_STREAM,
 					      GOutputStreamPrivate);
+  stream->priv->splice_buffer_size = DEFAULT_SPLICE_BUFFER_SIZE;
 }
 
 /**
@@ -291,6 +317,89 @@ g_output_stream_write_all (GOutputStream  *stream,
   return TRUE;
 }
 
+/**
+ * g_output_stream_writev:
+ * @stream: a #GOutputStream.
+ * @vectors: the buffers containing the data to write.
+ * @n_vectors: the number of vectors to write
+ * @bytes_written: location to store the number of bytes that was
+ *     written to the stream
+ * @cancellable: optional #GCancellable object, %NULL to ignore.
+ * @error: location to store the error occuring, or %NULL to ignore
+ *
+ * Tries to write the data in the @n_vectors buffers of @vectors into
+ * the stream, in order, as if they were one buffer. Will block during
+ * the operation.
+ *
+ * Like g_output_stream_write(), this may write less than the total size
+ * of the vectors, and only writes nothing if all of them are empty.
+ * Streams based on file descriptors write all the vectors with a single
+ * writev() call, so this avoids copying the data into one buffer first.
+ *
+ * On success, %TRUE is returned and @bytes_written is set to the number
+ * of bytes written. If there is an error during the operation %FALSE is
+ * returned, @error is set to indicate the error status and
+ * @bytes_written is set to 0.
+ *
+ * Return value: %TRUE on success, %FALSE if there was an error
+ *
+ * Since: 2.22
+ **/
+gboolean
+g_output_stream_writev (GOutputStream        *stream,
+			const GOutputVector  *vectors,
+			gsize                 n_vectors,
+			gsize                *bytes_written,
+			GCancellable         *cancellable,
+			GError              **error)
+{
+  GOutputStreamClass *class;
+  gsize total, written, i;
+  gboolean res;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (vectors != NULL || n_vectors == 0, FALSE);
+
+  if (bytes_written)
+    *bytes_written = 0;
+
+  total = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      if (vectors[i].size > G_MAXSSIZE - total)
+	{
+	  g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		       _("Too large count value passed to %s"), G_STRFUNC);
+	  return FALSE;
+	}
+      total += vectors[i].size;
+    }
+
+  if (total == 0)
+    return TRUE;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  if (!g_output_stream_set_pending (stream, error))
+    return FALSE;
+
+  if (cancellable)
+    g_cancellable_push_current (cancellable);
+
+  written = 0;
+  res = class->writev_fn (stream, vectors, n_vectors, &written, cancellable, error);
+
+  if (cancellable)
+    g_cancellable_pop_current (cancellable);
+
+  g_output_stream_clear_pending (stream);
+
+  if (res && bytes_written)
+    *bytes_written = written;
+
+  return res;
+}
+
 /**
  * g_output_stream_flush:
  * @stream: a #GOutputStream.
@@ -392,6 +501,365 @@ g_output_stream_splice (GOutputStream             *stream,
   return res;
 }
 
+/**
+ * g_output_stream_set_splice_buffer_size:
+ * @stream: a #GOutputStream.
+ * @size: the size of the buffer, in bytes.
+ *
+ * Sets the size of the buffer that g_output_stream_splice() and
+ * g_output_stream_splice_async() use when they have to copy the data
+ * through memory. A larger buffer means fewer read and write calls.
+ * The default size is 64 kilobytes.
+ *
+ * This has no effect when the data is moved by the kernel, and on
+ * subclasses that implement splicing themselves.
+ *
+ * Since: 2.22
+ **/
+void
+g_output_stream_set_splice_buffer_size (GOutputStream *stream,
+					gsize          size)
+{
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+  g_return_if_fail (size > 0);
+
+  stream->priv->splice_buffer_size = size;
+}
+
+/**
+ * g_output_stream_get_splice_buffer_size:
+ * @stream: a #GOutputStream.
+ *
+ * Gets the size of the buffer used to splice data into @stream.
+ * See g_output_stream_set_splice_buffer_size().
+ *
+ * Returns: the size of the splice buffer, in bytes.
+ *
+ * Since: 2.22
+ **/
+gsize
+g_output_stream_get_splice_buffer_size (GOutputStream *stream)
+{
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), 0);
+
+  return stream->priv->splice_buffer_size;
+}
+
+#ifdef G_OS_UNIX
+
+/* The most that is moved by the kernel between cancellation checks */
+#define SPLICE_CHUNK_SIZE (1024 * 1024)
+
+typedef enum {
+  SPLICE_METHOD_COPY_FILE_RANGE,
+  SPLICE_METHOD_SENDFILE,
+  SPLICE_METHOD_SPLICE,
+  SPLICE_METHOD_NONE
+} SpliceMethod;
+
+/* Returns TRUE if @errsv means that a method can't be used for
+ * these file descriptors, rather than that the transfer failed.
+ */
+static gboolean
+splice_method_unsupported (int errsv)
+{
+  return errsv == ENOSYS || errsv == EINVAL || errsv == EXDEV ||
+#ifdef EOPNOTSUPP
+         errsv == EOPNOTSUPP ||
+#endif
+         errsv == EBADF;
+}
+
+static void
+set_splice_error (GError **error,
+                  int      errsv)
+{
+  g_set_error (error, G_IO_ERROR,
+               g_io_error_from_errno (errsv),
+               _("Error splicing file: %s"),
+               g_strerror (errsv));
+}
+
+/* Blocks until @fd is ready, so that the transfer itself does not
+ * block where @cancellable can't interrupt it.
+ */
+static gboolean
+splice_wait_fd (int            fd,
+                GIOCondition   condition,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+  GPollFD poll_fds[2];
+  int poll_ret;
+
+  if (cancellable == NULL)
+    return TRUE;
+
+  poll_fds[0].fd = fd;
+  poll_fds[0].events = condition;
+  g_cancellable_make_pollfd (cancellable, &poll_fds[1]);
+  do
+    poll_ret = g_poll (poll_fds, 2, -1);
+  while (poll_ret == -1 && errno == EINTR);
+
+  if (poll_ret == -1)
+    {
+      set_splice_error (error, errno);
+      return FALSE;
+    }
+
+  return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+#ifdef HAVE_SPLICE
+/* Moves @count bytes that are in the pipe on to @out_fd. If @out_fd
+ * can't be spliced to, *use_write is set and the data is copied out
+ * of the pipe with read() and write() instead.
+ */
+static gboolean
+splice_drain_pipe (int        pipe_fd,
+                   int        out_fd,
+                   gsize      count,
+                   gboolean  *use_write,
+                   GError   **error)
+{
+  char buffer[8192], *p;
+  gssize n_read, n_written;
+  int errsv;
+
+  while (count > 0)
+    {
+      if (!*use_write)
+        {
+          n_written = splice (pipe_fd, NULL, out_fd, NULL, count,
+                              SPLICE_F_MOVE | SPLICE_F_MORE);
+          if (n_written >= 0)
+            {
+              count -= n_written;
+              continue;
+            }
+
+          errsv = errno;
+          if (errsv == EINTR)
+            continue;
+          if (!splice_method_unsupported (errsv))
+            {
+              set_splice_error (error, errsv);
+              return FALSE;
+            }
+
+          *use_write = TRUE;
+        }
+
+      n_read = read (pipe_fd, buffer, MIN (count, sizeof (buffer)));
+      if (n_read == -1)
+        {
+          if (errno == EINTR)
+            continue;
+          set_splice_error (error, errno);
+          return FALSE;
+        }
+
+      count -= n_read;
+      p = buffer;
+      while (n_read > 0)
+        {
+          n_written = write (out_fd, p, n_read);
+          if (n_written == -1)
+            {
+              if (errno == EINTR)
+                continue;
+              set_splice_error (error, errno);
+              return FALSE;
+            }
+          p += n_written;
+          n_read -= n_written;
+        }
+    }
+
+  return TRUE;
+}
+#endif
+
+/* Moves the data from @in_fd to @out_fd without copying it through
+ * userspace, with copy_file_range(), sendfile() or splice() through
+ * a pipe, whichever works first. *done is left FALSE if the kernel
+ * can't move the data, and the caller should copy the rest, from
+ * the current file offsets, itself.
+ */
+static gboolean
+splice_fds (int            in_fd,
+            int            out_fd,
+            GCancellable  *cancellable,
+            gssize        *bytes_copied,
+            gboolean      *done,
+            GError       **error)
+{
+  SpliceMethod method;
+#ifdef HAVE_SPLICE
+  gboolean use_write = FALSE;
+#endif
+  int pipe_fds[2];
+  gssize n;
+  int errsv;
+
+#if defined(HAVE_COPY_FILE_RANGE)
+  method = SPLICE_METHOD_COPY_FILE_RANGE;
+#elif defined(HAVE_SENDFILE)
+  method = SPLICE_METHOD_SENDFILE;
+#elif defined(HAVE_SPLICE)
+  method = SPLICE_METHOD_SPLICE;
+#else
+  method = SPLICE_METHOD_NONE;
+#endif
+
+  *done = FALSE;
+  pipe_fds[0] = pipe_fds[1] = -1;
+
+  while (method != SPLICE_METHOD_NONE)
+    {
+      if (!splice_wait_fd (in_fd, G_IO_IN, cancellable, error) ||
+          !splice_wait_fd (out_fd, G_IO_OUT, cancellable, error))
+        goto err;
+
+      switch (method)
+        {
+#ifdef HAVE_COPY_FILE_RANGE
+        case SPLICE_METHOD_COPY_FILE_RANGE:
+          n = copy_file_range (in_fd, NULL, out_fd, NULL, SPLICE_CHUNK_SIZE, 0);
+          break;
+#endif
+#ifdef HAVE_SENDFILE
+        case SPLICE_METHOD_SENDFILE:
+          n = sendfile (out_fd, in_fd, NULL, SPLICE_CHUNK_SIZE);
+          break;
+#endif
+#ifdef HAVE_SPLICE
+        case SPLICE_METHOD_SPLICE:
+          if (pipe_fds[0] == -1)
+            {
+              if (pipe (pipe_fds) != 0)
+                {
+                  pipe_fds[0] = pipe_fds[1] = -1;
+                  method = SPLICE_METHOD_NONE;
+                  continue;
+                }
+              fcntl (pipe_fds[0], F_SETFD, FD_CLOEXEC);
+              fcntl (pipe_fds[1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+              /* Not fatal if the pipe can't be made this large */
+              fcntl (pipe_fds[1], F_SETPIPE_SZ, SPLICE_CHUNK_SIZE);
+#endif
+            }
+
+          n = splice (in_fd, NULL, pipe_fds[1], NULL, SPLICE_CHUNK_SIZE,
+                      SPLICE_F_MOVE | SPLICE_F_MORE);
+          if (n > 0 &&
+              !splice_drain_pipe (pipe_fds[0], out_fd, n, &use_write, error))
+            goto err;
+          break;
+#endif
+        default:
+          /* not available on this system */
+          method++;
+          continue;
+        }
+
+      if (n == -1)
+        {
+          errsv = errno;
+          if (errsv == EINTR)
+            continue;
+
+          if (splice_method_unsupported (errsv))
+            {
+              method++;
+              continue;
+            }
+
+          set_splice_error (error, errsv);
+          goto err;
+        }
+
+      if (n == 0)
+        {
+          /* Some files, like the ones in /proc, claim to be empty
+           * to the kernel; let the caller make sure with a real read
+           */
+          if (*bytes_copied > 0)
+            *done = TRUE;
+          break;
+        }
+
+      *bytes_copied += n;
+    }
+
+  if (pipe_fds[0] != -1)
+    {
+      close (pipe_fds[0]);
+      close (pipe_fds[1]);
+    }
+  return TRUE;
+
+ err:
+  if (pipe_fds[0] != -1)
+    {
+      close (pipe_fds[0]);
+      close (pipe_fds[1]);
+    }
+  return FALSE;
+}
+
+#endif /* G_OS_UNIX */
+
+static gboolean
+g_output_stream_real_writev (GOutputStream        *stream,
+			     const GOutputVector  *vectors,
+			     gsize                 n_vectors,
+			     gsize                *bytes_written,
+			     GCancellable         *cancellable,
+			     GError              **error)
+{
+  GOutputStreamClass *class;
+  gsize total, i;
+  gssize res;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  if (class->write_fn == NULL)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Output stream doesn't implement write"));
+      return FALSE;
+    }
+
+  total = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      if (vectors[i].size == 0)
+	continue;
+
+      /* Once something is written, report that and let the error
+       * come up again on the next write.
+       */
+      res = class->write_fn (stream, vectors[i].buffer, vectors[i].size,
+			     cancellable, total == 0 ? error : NULL);
+      if (res == -1)
+	{
+	  if (total == 0)
+	    return FALSE;
+	  break;
+	}
+
+      total += res;
+      if (res < vectors[i].size)
+	break;
+    }
+
+  *bytes_written = total;
+  return TRUE;
+}
+
 static gssize
 g_output_stream_real_splice (GOutputStream             *stream,
                              GInputStream              *source,
@@ -402,22 +870,49 @@ g_output_stream_real_splice (GOutputStream             *stream,
   GOutputStreamClass *class = G_OUTPUT_STREAM_GET_CLASS (stream);
   gssize n_read, n_written;
   gssize bytes_copied;
-  char buffer[8192], *p;
+  char *buffer, *p;
   gboolean res;
 
   bytes_copied = 0;
+  buffer = NULL;
   if (class->write_fn == NULL) 
     {
       g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
                            _("Output stream doesn't implement write"));
       res = FALSE;
-      goto notsupported;
+      goto out;
     }
-  
+
+#ifdef G_OS_UNIX
+  if (G_IS_FILE_DESCRIPTOR_BASED (source) &&
+      G_IS_FILE_DESCRIPTOR_BASED (stream))
+    {
+      gboolean done;
+
+      if (!g_input_stream_set_pending (source, error))
+        {
+          res = FALSE;
+          goto out;
+        }
+
+      res = splice_fds (g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (source)),
+                        g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream)),
+                        cancellable, &bytes_copied, &done, error);
+
+      g_input_stream_clear_pending (source);
+
+      if (!res || done)
+        goto out;
+    }
+#endif
+
+  buffer = g_malloc (stream->priv->splice_buffer_size);
+
   res = TRUE;
   do 
     {
-      n_read = g_input_stream_read (source, buffer, sizeof (buffer), cancellable, error);
+      n_read = g_input_stream_read (source, buffer, stream->priv->splice_buffer_size,
+                                    cancellable, error);
       if (n_read == -1)
 	{
 	  res = FALSE;
@@ -444,7 +939,9 @@ g_output_stream_real_splice (GOutputStream             *stream,
     }
   while (res);
 
- notsupported:
+ out:
+  g_free (buffer);
+
   if (!res)
     error = NULL; /* Ignore further errors */
 
@@ -613,6 +1110,11 @@ async_ready_close_callback_wrapper (GObject      *source_object,
  * value) will be executed before an outstanding request with lower 
  * priority. Default priority is %G_PRIORITY_DEFAULT.
  *
+ * Writes to local files may be handed to the kernel right away. Once
+ * that has happened the write can no longer be cancelled, and the
+ * number of bytes written is reported even if @cancellable is
+ * triggered before @callback runs.
+ *
  * The asyncronous methods have a default fallback that uses threads 
  * to implement asynchronicity, so they are optional for inheriting 
  * classes. However, if you override one you must override all.
@@ -1123,6 +1625,7 @@ typedef struct {
   const void         *buffer;
   gsize               count_requested;
   gssize              count_written;
+  GCancellable       *cancellable;
 } WriteData;
 
 static void
@@ -1145,6 +1648,121 @@ write_async_thread (GSimpleAsyncResult *res,
     }
 }
 
+#ifdef G_OS_UNIX
+static gboolean
+write_async_ready (GSimpleAsyncResult *res,
+		   GIOCondition        condition,
+		   int                 fd)
+{
+  WriteData *op;
+  GObject *object;
+  GOutputStreamClass *class;
+  GError *error = NULL;
+
+  op = g_simple_async_result_get_op_res_gpointer (res);
+  object = g_async_result_get_source_object (G_ASYNC_RESULT (res));
+  class = G_OUTPUT_STREAM_GET_CLASS (object);
+
+  /* The fd polled writable, so write_fn won't block on it */
+  if (g_cancellable_set_error_if_cancelled (op->cancellable, &error))
+    op->count_written = -1;
+  else
+    op->count_written = class->write_fn (G_OUTPUT_STREAM (object),
+					 op->buffer, op->count_requested,
+					 op->cancellable, &error);
+  g_object_unref (object);
+
+  if (op->count_written == -1)
+    {
+      /* Spurious wakeup, keep waiting */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+	{
+	  g_error_free (error);
+	  return TRUE;
+	}
+
+      g_simple_async_result_set_from_error (res, error);
+      g_error_free (error);
+    }
+
+  /* Complete immediately, not in idle, since we're already in a mainloop callout */
+  g_simple_async_result_complete (res);
+
+  return FALSE;
+}
+
+/* Writes as much as can be written to @fd without waiting for the
+ * disk. Returns %FALSE if the write would have to wait, in which case
+ * it must be done in a thread.
+ */
+static gboolean
+write_nowait (GOutputStream *stream,
+	      int            fd,
+	      WriteData     *op)
+{
+#if defined (HAVE_PWRITEV2) && defined (RWF_NOWAIT)
+  struct iovec iov;
+  gssize res;
+  int errsv;
+
+  if (stream->priv->nowait_unsupported)
+    return FALSE;
+
+  iov.iov_base = (void *) op->buffer;
+  iov.iov_len = op->count_requested;
+
+  do
+    res = pwritev2 (fd, &iov, 1, -1, RWF_NOWAIT);
+  while (res == -1 && errno == EINTR);
+
+  if (res == -1)
+    {
+      errsv = errno;
+
+      if (errsv == EOPNOTSUPP || errsv == ENOSYS || errsv == EINVAL)
+	stream->priv->nowait_unsupported = TRUE;
+
+      return FALSE;
+    }
+
+  op->count_written = res;
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static void
+write_async_uring_done (int      result,
+			gpointer user_data)
+{
+  GSimpleAsyncResult *res = user_data;
+  WriteData *op;
+
+  op = g_simple_async_result_get_op_res_gpointer (res);
+
+  if (result < 0)
+    {
+      op->count_written = -1;
+      g_simple_async_result_set_error (res, G_IO_ERROR,
+				       g_io_error_from_errno (-result),
+				       _("Error writing to file: %s"),
+				       g_strerror (-result));
+    }
+  else
+    {
+      /* The data is already written by now, so a cancellation that
+       * came in while the request was queued is ignored: reporting
+       * G_IO_ERROR_CANCELLED would hide a write that happened.
+       */
+      op->count_written = result;
+    }
+
+  g_simple_async_result_complete (res);
+  g_object_unref (res);
+}
+#endif
+
 static void
 g_output_stream_real_write_async (GOutputStream       *stream,
                                   const void          *buffer,
@@ -1162,7 +1780,48 @@ g_output_stream_real_write_async (GOutputStream       *stream,
   g_simple_async_result_set_op_res_gpointer (res, op, g_free);
   op->buffer = buffer;
   op->count_requested = count;
-  
+  op->cancellable = cancellable;
+
+#ifdef G_OS_UNIX
+  /* File descriptor based streams don't need a thread if the fd can
+   * tell the main loop when it is writable, if the write can go
+   * straight into the page cache, or if io_uring can do the write.
+   */
+  if (G_IS_FILE_DESCRIPTOR_BASED (stream) &&
+      !g_cancellable_is_cancelled (cancellable))
+    {
+      GSource *source;
+      int fd;
+
+      fd = g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream));
+
+      if (_g_fd_is_pollable (fd))
+	{
+	  source = _g_fd_source_new (fd, G_IO_OUT, cancellable);
+	  g_source_set_priority (source, io_priority);
+	  g_source_set_callback (source, (GSourceFunc)write_async_ready,
+				 res, g_object_unref);
+	  g_source_attach (source, NULL);
+	  g_source_unref (source);
+	  return;
+	}
+
+      if (write_nowait (stream, fd, op))
+	{
+	  g_simple_async_result_complete_in_idle (res);
+	  g_object_unref (res);
+	  return;
+	}
+
+      /* Writes to regular files always finish, so they can be left
+       * to the kernel without a way to cancel them.
+       */
+      if (_g_fd_is_regular (fd) &&
+	  _g_io_uring_write (fd, buffer, count, write_async_uring_done, res))
+	return;
+    }
+#endif
+
   g_simple_async_result_run_in_thread (res, write_async_thread, io_priority, cancellable);
   g_object_unref (res);
 }
@@ -121,9 +121,17 @@ struct _GOutputStreamClass
                                  GAsyncResult             *result,
                                  GError                  **error);
 
+  /* Sync ops: (optional in derived classes) */
+
+  gboolean    (* writev_fn)     (GOutputStream            *stream,
+                                 const GOutputVector      *vectors,
+                                 gsize                     n_vectors,
+                                 gsize                    *bytes_written,
+                                 GCancellable             *cancellable,
+                                 GError                  **error);
+
   /*< private >*/
   /* Padding for future expansion */
-  void (*_g_reserved1) (void);
   void (*_g_reserved2) (void);
   void (*_g_reserved3) (void);
   void (*_g_reserved4) (void);
@@ -146,6 +154,12 @@ gboolean g_output_stream_write_all     (GOutputStream             *stream,
 					gsize                     *bytes_written,
 					GCancellable              *cancellable,
 					GError                   **error);
+gboolean g_output_stream_writev        (GOutputStream             *stream,
+					const GOutputVector       *vectors,
+					gsize                      n_vectors,
+					gsize                     *bytes_written,
+					GCancellable              *cancellable,
+					GError                   **error);
 gssize   g_output_stream_splice        (GOutputStream             *stream,
 					GInputStream              *source,
 					GOutputStreamSpliceFlags   flags,
@@ -200,6 +214,10 @@ gboolean g_output_stream_set_pending   (GOutputStream             *stream,
 					GError                   **error);
 void     g_output_stream_clear_pending (GOutputStream             *stream);
 
+void     g_output_stream_set_splice_buffer_size (GOutputStream    *stream,
+						 gsize             size);
+gsize    g_output_stream_get_splice_buffer_size (GOutputStream    *stream);
+
 
 G_END_DECLS
 
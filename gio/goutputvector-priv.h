@@ -0,0 +1,49 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_OUTPUT_VECTOR_PRIV_H__
+#define __G_OUTPUT_VECTOR_PRIV_H__
+
+#include <limits.h>
+#include <sys/uio.h>
+
+#include "giotypes.h"
+
+G_BEGIN_DECLS
+
+/* GOutputVector has the layout of struct iovec on every platform we
+ * know of, but check to be safe.
+ */
+#define OUTPUT_VECTOR_IS_IOVEC \
+  (sizeof (GOutputVector) == sizeof (struct iovec) && \
+   G_STRUCT_OFFSET (GOutputVector, buffer) == G_STRUCT_OFFSET (struct iovec, iov_base) && \
+   G_STRUCT_OFFSET (GOutputVector, size) == G_STRUCT_OFFSET (struct iovec, iov_len))
+
+#ifndef IOV_MAX
+#ifdef UIO_MAXIOV
+#define IOV_MAX UIO_MAXIOV
+#else
+#define IOV_MAX 16		/* The POSIX minimum */
+#endif
+#endif
+
+G_END_DECLS
+
+#endif /* __G_OUTPUT_VECTOR_PRIV_H__ */
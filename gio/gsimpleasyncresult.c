@@ -132,6 +132,13 @@ struct _GSimpleAsyncResult
   } op_res;
 
   GDestroyNotify destroy_op_res;
+
+  /* Set while queued for completion in the main loop */
+  GSimpleAsyncResult *next_completion;
+  GCancellable *completion_cancellable;
+  gboolean queued;
+  gboolean check_cancellable;
+  GSimpleAsyncThreadFunc thread_func;
 };
 
 struct _GSimpleAsyncResultClass
@@ -160,6 +167,9 @@ g_simple_async_result_finalize (GObject *object)
   if (simple->error)
     g_error_free (simple->error);
 
+  if (simple->completion_cancellable)
+    g_object_unref (simple->completion_cancellable);
+
   G_OBJECT_CLASS (g_simple_async_result_parent_class)->finalize (object);
 }
 
@@ -569,16 +579,160 @@ g_simple_async_result_complete (GSimpleAsyncResult *simple)
 		      simple->user_data);
 }
 
+/* Results waiting to be completed in the main loop are kept on a
+ * single list, and one source on the default main context completes
+ * all of them in a single dispatch. This avoids creating, attaching
+ * and destroying an idle source for every operation.
+ */
+typedef struct {
+  GSource source;
+  GSimpleAsyncResult *head;
+  GSimpleAsyncResult *tail;
+} CompletionSource;
+
+G_LOCK_DEFINE_STATIC (completion);
+static CompletionSource *completion_source = NULL;
+
 static gboolean
-complete_in_idle_cb (gpointer data)
+completion_source_prepare (GSource *source,
+			   gint    *timeout)
 {
-  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (data);
+  CompletionSource *completion = (CompletionSource *)source;
+
+  *timeout = -1;
+  return g_atomic_pointer_get (&completion->head) != NULL;
+}
+
+static gboolean
+completion_source_check (GSource *source)
+{
+  CompletionSource *completion = (CompletionSource *)source;
+
+  return g_atomic_pointer_get (&completion->head) != NULL;
+}
+
+static void
+complete_queued (GSimpleAsyncResult *simple)
+{
+  if (simple->check_cancellable)
+    {
+      if (simple->handle_cancellation &&
+	  g_cancellable_is_cancelled (simple->completion_cancellable))
+	g_simple_async_result_set_error (simple,
+					 G_IO_ERROR,
+					 G_IO_ERROR_CANCELLED,
+					 "%s", _("Operation was cancelled"));
+      simple->check_cancellable = FALSE;
+    }
 
   g_simple_async_result_complete (simple);
 
+  if (simple->completion_cancellable)
+    {
+      g_object_unref (simple->completion_cancellable);
+      simple->completion_cancellable = NULL;
+    }
+  g_object_unref (simple);
+}
+
+static gboolean
+complete_in_idle_cb (gpointer data)
+{
+  complete_queued (data);
+
   return FALSE;
 }
 
+static gboolean
+completion_source_dispatch (GSource     *source,
+			    GSourceFunc  callback,
+			    gpointer     user_data)
+{
+  CompletionSource *completion = (CompletionSource *)source;
+  GSimpleAsyncResult *simple, *next;
+
+  /* Only complete what is queued now; results queued by the callbacks
+   * we run wait for the next iteration, like separate idles would.
+   */
+  G_LOCK (completion);
+  simple = completion->head;
+  completion->head = completion->tail = NULL;
+  for (next = simple; next != NULL; next = next->next_completion)
+    next->queued = FALSE;
+  G_UNLOCK (completion);
+
+  for (; simple != NULL; simple = next)
+    {
+      next = simple->next_completion;
+      simple->next_completion = NULL;
+      complete_queued (simple);
+    }
+
+  return TRUE;
+}
+
+static GSourceFuncs completion_source_funcs = {
+  completion_source_prepare,
+  completion_source_check,
+  completion_source_dispatch,
+  NULL
+};
+
+/* Takes over the caller's reference to @simple */
+static void
+queue_completion (GSimpleAsyncResult *simple)
+{
+  GMainContext *context;
+  gboolean wakeup;
+
+  context = g_main_context_default ();
+  wakeup = FALSE;
+
+  G_LOCK (completion);
+  if (completion_source == NULL)
+    {
+      GSource *source;
+
+      source = g_source_new (&completion_source_funcs,
+			     sizeof (CompletionSource));
+      g_source_set_priority (source, G_PRIORITY_DEFAULT);
+      g_source_attach (source, context);
+      completion_source = (CompletionSource *)source;
+    }
+
+  if (simple->queued)
+    {
+      GSource *source;
+
+      /* Completed in idle twice; it can only be on the list once */
+      G_UNLOCK (completion);
+
+      source = g_idle_source_new ();
+      g_source_set_priority (source, G_PRIORITY_DEFAULT);
+      g_source_set_callback (source, complete_in_idle_cb, simple, NULL);
+      g_source_attach (source, context);
+      g_source_unref (source);
+      return;
+    }
+  simple->queued = TRUE;
+
+  if (completion_source->tail)
+    completion_source->tail->next_completion = simple;
+  else
+    {
+      completion_source->head = simple;
+      wakeup = !g_main_context_is_owner (context);
+    }
+  completion_source->tail = simple;
+  G_UNLOCK (completion);
+
+  /* The main loop may be sleeping in poll() without having seen the
+   * list become non-empty.
+   */
+  if (wakeup)
+    g_main_context_wakeup (context);
+}
+
 /**
  * g_simple_async_result_complete_in_idle:
  * @simple: a #GSimpleAsyncResult.
@@ -589,51 +743,9 @@ complete_in_idle_cb (gpointer data)
 void
 g_simple_async_result_complete_in_idle (GSimpleAsyncResult *simple)
 {
-  GSource *source;
-  guint id;
-  
   g_return_if_fail (G_IS_SIMPLE_ASYNC_RESULT (simple));
-  
-  g_object_ref (simple);
-  
-  source = g_idle_source_new ();
-  g_source_set_priority (source, G_PRIORITY_DEFAULT);
-  g_source_set_callback (source, complete_in_idle_cb, simple, g_object_unref);
 
-  id = g_source_attach (source, NULL);
-  g_source_unref (source);
-}
-
-typedef struct {
-  GSimpleAsyncResult *simple;
-  GCancellable *cancellable;
-  GSimpleAsyncThreadFunc func;
-} RunInThreadData;
-
-
-static gboolean
-complete_in_idle_cb_for_thread (gpointer _data)
-{
-  RunInThreadData *data = _data;
-  GSimpleAsyncResult *simple;
-
-  simple = data->simple;
-  
-  if (simple->handle_cancellation &&
-      g_cancellable_is_cancelled (data->cancellable))
-    g_simple_async_result_set_error (simple,
-                                     G_IO_ERROR,
-                                     G_IO_ERROR_CANCELLED,
-                                     "%s", _("Operation was cancelled"));
-  
-  g_simple_async_result_complete (simple);
-
-  if (data->cancellable)
-    g_object_unref (data->cancellable);
-  g_object_unref (data->simple);
-  g_free (data);
-  
-  return FALSE;
+  queue_completion (g_object_ref (simple));
 }
 
 static gboolean
@@ -641,11 +753,8 @@ run_in_thread (GIOSchedulerJob *job,
                GCancellable    *c,
                gpointer         _data)
 {
-  RunInThreadData *data = _data;
-  GSimpleAsyncResult *simple = data->simple;
-  GSource *source;
-  guint id;
-  
+  GSimpleAsyncResult *simple = _data;
+
   if (simple->handle_cancellation &&
       g_cancellable_is_cancelled (c))
     g_simple_async_result_set_error (simple,
@@ -653,16 +762,15 @@ run_in_thread (GIOSchedulerJob *job,
                                      G_IO_ERROR_CANCELLED,
                                      "%s", _("Operation was cancelled"));
   else
-    data->func (simple,
-                simple->source_object,
-                c);
+    simple->thread_func (simple,
+                         simple->source_object,
+                         c);
 
-  source = g_idle_source_new ();
-  g_source_set_priority (source, G_PRIORITY_DEFAULT);
-  g_source_set_callback (source, complete_in_idle_cb_for_thread, data, NULL);
-
-  id = g_source_attach (source, NULL);
-  g_source_unref (source);
+  /* Re-check cancellation when completing, in case it happened
+   * while the result was waiting for the main loop.
+   */
+  simple->check_cancellable = TRUE;
+  queue_completion (simple);
 
   return FALSE;
 }
@@ -682,18 +790,14 @@ g_simple_async_result_run_in_thread (GSimpleAsyncResult     *simple,
                                      int                     io_priority, 
                                      GCancellable           *cancellable)
 {
-  RunInThreadData *data;
-  
   g_return_if_fail (G_IS_SIMPLE_ASYNC_RESULT (simple));
   g_return_if_fail (func != NULL);
 
-  data = g_new (RunInThreadData, 1);
-  data->func = func;
-  data->simple = g_object_ref (simple);
-  data->cancellable = cancellable;
+  simple->thread_func = func;
   if (cancellable)
-    g_object_ref (cancellable);
-  g_io_scheduler_push_job (run_in_thread, data, NULL, io_priority, cancellable);
+    simple->completion_cancellable = g_object_ref (cancellable);
+  g_io_scheduler_push_job (run_in_thread, g_object_ref (simple), NULL,
+			   io_priority, cancellable);
 }
 
 /**
@@ -34,6 +34,7 @@
 #include "gioerror.h"
 #include "gsimpleasyncresult.h"
 #include "gunixinputstream.h"
+#include "gfiledescriptorbased.h"
 #include "gcancellable.h"
 #include "gasynchelper.h"
 #include "glibintl.h"
@@ -61,7 +62,11 @@ enum {
   PROP_CLOSE_FD
 };
 
-G_DEFINE_TYPE (GUnixInputStream, g_unix_input_stream, G_TYPE_INPUT_STREAM);
+static void g_unix_input_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GUnixInputStream, g_unix_input_stream, G_TYPE_INPUT_STREAM,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_FILE_DESCRIPTOR_BASED,
+						g_unix_input_stream_file_descriptor_based_iface_init));
 
 struct _GUnixInputStreamPrivate {
   int fd;
@@ -237,6 +242,18 @@ g_unix_input_stream_init (GUnixInputStream *unix_stream)
   unix_stream->priv->close_fd = TRUE;
 }
 
+static int
+g_unix_input_stream_get_fd_based (GFileDescriptorBased *fd_based)
+{
+  return G_UNIX_INPUT_STREAM (fd_based)->priv->fd;
+}
+
+static void
+g_unix_input_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface)
+{
+  iface->get_fd = g_unix_input_stream_get_fd_based;
+}
+
 /**
  * g_unix_input_stream_new:
  * @fd: a UNIX file descriptor
@@ -33,9 +33,11 @@
 #include <glib/gstdio.h>
 #include "gioerror.h"
 #include "gunixoutputstream.h"
+#include "gfiledescriptorbased.h"
 #include "gcancellable.h"
 #include "gsimpleasyncresult.h"
 #include "gasynchelper.h"
+#include "goutputvector-priv.h"
 #include "glibintl.h"
 
 #include "gioalias.h"
@@ -61,7 +63,11 @@ enum {
   PROP_CLOSE_FD
 };
 
-G_DEFINE_TYPE (GUnixOutputStream, g_unix_output_stream, G_TYPE_OUTPUT_STREAM);
+static void g_unix_output_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GUnixOutputStream, g_unix_output_stream, G_TYPE_OUTPUT_STREAM,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_FILE_DESCRIPTOR_BASED,
+						g_unix_output_stream_file_descriptor_based_iface_init));
 
 
 struct _GUnixOutputStreamPrivate {
@@ -82,6 +88,12 @@ static gssize   g_unix_output_stream_write        (GOutputStream        *stream,
 						   gsize                 count,
 						   GCancellable         *cancellable,
 						   GError              **error);
+static gboolean g_unix_output_stream_writev       (GOutputStream        *stream,
+						   const GOutputVector  *vectors,
+						   gsize                 n_vectors,
+						   gsize                *bytes_written,
+						   GCancellable         *cancellable,
+						   GError              **error);
 static gboolean g_unix_output_stream_close        (GOutputStream        *stream,
 						   GCancellable         *cancellable,
 						   GError              **error);
@@ -128,6 +140,7 @@ g_unix_output_stream_class_init (GUnixOutputStreamClass *klass)
   gobject_class->finalize = g_unix_output_stream_finalize;
 
   stream_class->write_fn = g_unix_output_stream_write;
+  stream_class->writev_fn = g_unix_output_stream_writev;
   stream_class->close_fn = g_unix_output_stream_close;
   stream_class->write_async = g_unix_output_stream_write_async;
   stream_class->write_finish = g_unix_output_stream_write_finish;
@@ -223,6 +236,18 @@ g_unix_output_stream_init (GUnixOutputStream *unix_stream)
   unix_stream->priv->close_fd = TRUE;
 }
 
+static int
+g_unix_output_stream_get_fd_based (GFileDescriptorBased *fd_based)
+{
+  return G_UNIX_OUTPUT_STREAM (fd_based)->priv->fd;
+}
+
+static void
+g_unix_output_stream_file_descriptor_based_iface_init (GFileDescriptorBasedIface *iface)
+{
+  iface->get_fd = g_unix_output_stream_get_fd_based;
+}
+
 /**
  * g_unix_output_stream_new:
  * @fd: a UNIX file descriptor
@@ -372,6 +397,86 @@ g_unix_output_stream_write (GOutputStream  *stream,
   return res;
 }
 
+static gboolean
+g_unix_output_stream_writev (GOutputStream        *stream,
+			     const GOutputVector  *vectors,
+			     gsize                 n_vectors,
+			     gsize                *bytes_written,
+			     GCancellable         *cancellable,
+			     GError              **error)
+{
+  GUnixOutputStream *unix_stream;
+  struct iovec *iov;
+  gssize res;
+  gsize i;
+  GPollFD poll_fds[2];
+  int poll_ret;
+
+  unix_stream = G_UNIX_OUTPUT_STREAM (stream);
+
+  /* A short write is fine, so just write the first IOV_MAX vectors */
+  n_vectors = MIN (n_vectors, IOV_MAX);
+
+  if (OUTPUT_VECTOR_IS_IOVEC)
+    iov = (struct iovec *) vectors;
+  else
+    {
+      iov = g_newa (struct iovec, n_vectors);
+      for (i = 0; i < n_vectors; i++)
+	{
+	  iov[i].iov_base = (void *) vectors[i].buffer;
+	  iov[i].iov_len = vectors[i].size;
+	}
+    }
+
+  if (cancellable)
+    {
+      poll_fds[0].fd = unix_stream->priv->fd;
+      poll_fds[0].events = G_IO_OUT;
+      g_cancellable_make_pollfd (cancellable, &poll_fds[1]);
+      do
+	poll_ret = g_poll (poll_fds, 2, -1);
+      while (poll_ret == -1 && errno == EINTR);
+      
+      if (poll_ret == -1)
+	{
+          int errsv = errno;
+
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to unix: %s"),
+		       g_strerror (errsv));
+	  return FALSE;
+	}
+    }
+
+  while (1)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+	return FALSE;
+
+      res = writev (unix_stream->priv->fd, iov, n_vectors);
+      if (res == -1)
+	{
+          int errsv = errno;
+
+	  if (errsv == EINTR)
+	    continue;
+	  
+	  g_set_error (error, G_IO_ERROR,
+		       g_io_error_from_errno (errsv),
+		       _("Error writing to unix: %s"),
+		       g_strerror (errsv));
+	  return FALSE;
+	}
+      
+      break;
+    }
+
+  *bytes_written = res;
+  return TRUE;
+}
+
 static gboolean
 g_unix_output_stream_close (GOutputStream  *stream,
 			    GCancellable   *cancellable,
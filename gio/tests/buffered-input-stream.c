@@ -45,6 +45,123 @@ test_read_byte (void)
   g_assert_cmpint (g_buffered_input_stream_read_byte (G_BUFFERED_INPUT_STREAM (in), NULL, NULL), ==, 'g');
 }
 
+static void
+test_peek_consume (void)
+{
+  const gchar *data = "abcdefghijklmnopqrstuvwxyz";
+  GInputStream *base;
+  GBufferedInputStream *in;
+  GString *s;
+  const gchar *buffer;
+  gsize available;
+  gssize nread;
+
+  base = g_memory_input_stream_new_from_data (data, -1, NULL);
+  in = G_BUFFERED_INPUT_STREAM (g_buffered_input_stream_new_sized (base, 8));
+
+  g_assert_cmpint (g_buffered_input_stream_fill (in, -1, NULL, NULL), ==, 8);
+  buffer = g_buffered_input_stream_peek_buffer (in, &available);
+  g_assert_cmpint (available, ==, 8);
+  g_assert (strncmp (buffer, "abcdefgh", 8) == 0);
+
+  /* can't consume more than is there */
+  g_assert_cmpint (g_buffered_input_stream_consume (in, 3), ==, 3);
+  g_assert_cmpint (g_buffered_input_stream_get_available (in), ==, 5);
+  g_assert_cmpint (g_buffered_input_stream_consume (in, 100), ==, 5);
+  g_assert_cmpint (g_buffered_input_stream_get_available (in), ==, 0);
+
+  /* consume in odd-sized chunks, refilling as needed */
+  s = g_string_new ("abcdefgh");
+  do
+    {
+      nread = g_buffered_input_stream_fill (in, -1, NULL, NULL);
+      g_assert_cmpint (nread, >=, 0);
+      buffer = g_buffered_input_stream_peek_buffer (in, &available);
+      available = MIN (available, 3);
+      g_string_append_len (s, buffer, available);
+      g_assert_cmpint (g_buffered_input_stream_consume (in, available), ==, available);
+    }
+  while (nread > 0 || g_buffered_input_stream_get_available (in) > 0);
+
+  g_assert_cmpstr (s->str, ==, data);
+  g_string_free (s, TRUE);
+
+  /* consumed data is gone for reads as well */
+  g_assert_cmpint (g_buffered_input_stream_read_byte (in, NULL, NULL), ==, -1);
+
+  g_object_unref (in);
+  g_object_unref (base);
+}
+
+static void
+test_adaptive (void)
+{
+  GInputStream *base;
+  GInputStream *in;
+  GBufferedInputStream *bin;
+  GBufferedStreamStats stats;
+  guchar *data;
+  guchar buffer[100];
+  gssize nread;
+  gsize total;
+  gsize i;
+
+  data = g_malloc (65536);
+  for (i = 0; i < 65536; i++)
+    data[i] = i % 251;
+
+  /* Fills that fill the whole buffer make it grow */
+  base = g_memory_input_stream_new_from_data (data, 65536, NULL);
+  in = g_buffered_input_stream_new_sized (base, 1024);
+  bin = G_BUFFERED_INPUT_STREAM (in);
+  g_buffered_input_stream_set_adaptive (bin, TRUE);
+  g_assert (g_buffered_input_stream_get_adaptive (bin));
+
+  total = 0;
+  do
+    {
+      nread = g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL);
+      g_assert_cmpint (nread, >=, 0);
+      g_assert (memcmp (buffer, data + total, nread) == 0);
+      total += nread;
+    }
+  while (nread > 0);
+  g_assert_cmpint (total, ==, 65536);
+
+  g_buffered_input_stream_get_stats (bin, &stats);
+  g_assert_cmpint (stats.calls, ==, 65536 / 100 + 2);
+  g_assert_cmpint (stats.bytes, ==, 65536);
+  g_assert_cmpint (stats.base_calls, <, 10);
+  g_assert_cmpint (stats.peak_size, >=, 16384);
+  g_assert_cmpint (stats.resizes, >, 0);
+  g_assert_cmpint (stats.releases, >, 0);
+
+  g_object_unref (in);
+  g_object_unref (base);
+
+  /* Fills that only use a fraction of it make it shrink */
+  base = g_memory_input_stream_new_from_data (data, 3000, NULL);
+  in = g_buffered_input_stream_new_sized (base, 65536);
+  bin = G_BUFFERED_INPUT_STREAM (in);
+  g_buffered_input_stream_set_adaptive (bin, TRUE);
+
+  total = 0;
+  while (total < 3000)
+    {
+      nread = g_input_stream_read (in, buffer, sizeof (buffer), NULL, NULL);
+      g_assert_cmpint (nread, ==, 100);
+      total += nread;
+    }
+
+  g_assert_cmpint (g_buffered_input_stream_get_buffer_size (bin), ==, 1024);
+  g_buffered_input_stream_get_stats (bin, &stats);
+  g_assert_cmpint (stats.base_calls, ==, 1);
+  g_assert_cmpint (stats.releases, ==, 1);
+
+  g_object_unref (in);
+  g_object_unref (base);
+  g_free (data);
+}
 
 int
 main (int   argc,
@@ -55,6 +172,8 @@ main (int   argc,
   g_test_bug_base ("http://bugzilla.gnome.org/");
 
   g_test_add_func ("/buffered-input-stream/read-byte", test_read_byte);
+  g_test_add_func ("/buffered-input-stream/peek-consume", test_peek_consume);
+  g_test_add_func ("/buffered-input-stream/adaptive", test_adaptive);
 
   return g_test_run();
 }
@@ -0,0 +1,161 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+
+#include <glib/glib.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+test_adaptive (void)
+{
+  GOutputStream *mo;
+  GOutputStream *o;
+  GBufferedOutputStream *bo;
+  GBufferedStreamStats stats;
+  GError *error = NULL;
+  gchar chunk[100];
+  const gchar *data;
+  gsize i;
+
+  mo = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  o = g_buffered_output_stream_new_sized (mo, 1024);
+  bo = G_BUFFERED_OUTPUT_STREAM (o);
+  g_buffered_output_stream_set_adaptive (bo, TRUE);
+  g_assert (g_buffered_output_stream_get_adaptive (bo));
+
+  /* Small writes that keep filling the buffer make it grow */
+  for (i = 0; i < 1000; i++)
+    {
+      memset (chunk, i % 251, sizeof (chunk));
+      g_assert_cmpint (g_output_stream_write (o, chunk, sizeof (chunk), NULL, &error), ==, sizeof (chunk));
+      g_assert_no_error (error);
+    }
+  g_output_stream_flush (o, NULL, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 100000);
+  data = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo));
+  for (i = 0; i < 1000; i++)
+    g_assert_cmpint ((guchar) data[i * 100 + 99], ==, i % 251);
+
+  g_buffered_output_stream_get_stats (bo, &stats);
+  g_assert_cmpint (stats.calls, ==, 1000);
+  g_assert_cmpint (stats.bytes, ==, 100000);
+  g_assert_cmpint (stats.base_calls, <, 20);
+  g_assert_cmpint (stats.peak_size, >=, 16384);
+  g_assert_cmpint (stats.resizes, >, 0);
+  g_assert_cmpint (stats.releases, ==, stats.base_calls);
+
+  /* Small flushed writes make it shrink again */
+  for (i = 0; i < 30; i++)
+    {
+      g_assert_cmpint (g_output_stream_write (o, chunk, sizeof (chunk), NULL, &error), ==, sizeof (chunk));
+      g_output_stream_flush (o, NULL, &error);
+      g_assert_no_error (error);
+    }
+  g_assert_cmpint (g_buffered_output_stream_get_buffer_size (bo), ==, 1024);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 103000);
+
+  g_output_stream_close (o, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (o);
+  g_object_unref (mo);
+}
+
+/* An output stream that writes nothing, without reporting an error,
+ * for as long as it is stuck.
+ */
+typedef struct
+{
+  GOutputStream parent_instance;
+
+  gboolean stuck;
+} StuckStream;
+
+typedef GOutputStreamClass StuckStreamClass;
+
+G_DEFINE_TYPE (StuckStream, stuck_stream, G_TYPE_OUTPUT_STREAM)
+
+static gssize
+stuck_stream_write (GOutputStream  *stream,
+                    const void     *buffer,
+                    gsize           count,
+                    GCancellable   *cancellable,
+                    GError        **error)
+{
+  StuckStream *stuck = (StuckStream *) stream;
+
+  return stuck->stuck ? 0 : count;
+}
+
+static void
+stuck_stream_init (StuckStream *stuck)
+{
+  stuck->stuck = TRUE;
+}
+
+static void
+stuck_stream_class_init (StuckStreamClass *klass)
+{
+  klass->write_fn = stuck_stream_write;
+}
+
+static void
+test_write_nothing (void)
+{
+  GOutputStream *base;
+  GOutputStream *o;
+  GError *error = NULL;
+  gchar data[16];
+
+  base = g_object_new (stuck_stream_get_type (), NULL);
+  o = g_buffered_output_stream_new_sized (base, sizeof (data));
+  memset (data, 'x', sizeof (data));
+
+  g_assert_cmpint (g_output_stream_write (o, data, sizeof (data), NULL, &error), ==, sizeof (data));
+  g_assert_no_error (error);
+
+  /* The buffer is full and the base stream takes nothing */
+  g_assert_cmpint (g_output_stream_write (o, data, 1, NULL, &error), ==, -1);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_clear_error (&error);
+
+  ((StuckStream *) base)->stuck = FALSE;
+  g_output_stream_close (o, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (o);
+  g_object_unref (base);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+  g_test_bug_base ("http://bugzilla.gnome.org/");
+
+  g_test_add_func ("/buffered-output-stream/adaptive", test_adaptive);
+  g_test_add_func ("/buffered-output-stream/write-nothing", test_write_nothing);
+
+  return g_test_run();
+}
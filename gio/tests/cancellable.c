@@ -0,0 +1,265 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2009 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+
+#include <glib/glib.h>
+#include <gio/gio.h>
+
+static void
+count_cb (GCancellable *cancellable,
+	  gpointer      data)
+{
+  int *count = data;
+
+  g_assert (g_cancellable_is_cancelled (cancellable));
+  (*count)++;
+}
+
+static void
+destroy_cb (gpointer data)
+{
+  int *count = data;
+
+  *count += 100;
+}
+
+static gulong self_id;
+
+static void
+disconnect_self_cb (GCancellable *cancellable,
+		    gpointer      data)
+{
+  int *count = data;
+
+  (*count)++;
+  g_cancellable_disconnect (cancellable, self_id);
+}
+
+static gboolean
+fd_readable (int fd)
+{
+  GPollFD pollfd;
+
+  pollfd.fd = fd;
+  pollfd.events = G_IO_IN;
+  pollfd.revents = 0;
+
+  return g_poll (&pollfd, 1, 0) == 1;
+}
+
+static void
+test_callbacks (void)
+{
+  GCancellable *cancellable;
+  int a = 0, b = 0, c = 0, d = 0;
+  gulong id_a, id_b;
+
+  cancellable = g_cancellable_new ();
+
+  id_a = g_cancellable_connect (cancellable, count_cb, &a, destroy_cb);
+  id_b = g_cancellable_connect (cancellable, count_cb, &b, NULL);
+  self_id = g_cancellable_connect (cancellable, disconnect_self_cb, &c, destroy_cb);
+  g_assert (id_a != 0 && id_b != 0 && self_id != 0);
+  g_assert (id_a != id_b && id_b != self_id);
+
+  /* Disconnecting calls the destroy notify and the callback never runs */
+  g_cancellable_disconnect (cancellable, id_b);
+  g_assert_cmpint (b, ==, 0);
+
+  g_cancellable_cancel (cancellable);
+  g_assert_cmpint (a, ==, 1);
+  g_assert_cmpint (b, ==, 0);
+  g_assert_cmpint (c, ==, 101);
+
+  /* Cancelling twice only runs the callbacks once */
+  g_cancellable_cancel (cancellable);
+  g_assert_cmpint (a, ==, 1);
+
+  /* Connecting to a cancelled cancellable runs the callback at once */
+  g_assert_cmpuint (g_cancellable_connect (cancellable, count_cb, &d, destroy_cb), ==, 0);
+  g_assert_cmpint (d, ==, 101);
+
+  /* After a reset the remaining callbacks fire again */
+  g_cancellable_reset (cancellable);
+  g_assert (!g_cancellable_is_cancelled (cancellable));
+  g_cancellable_cancel (cancellable);
+  g_assert_cmpint (a, ==, 2);
+  g_assert_cmpint (c, ==, 101);
+
+  g_cancellable_disconnect (cancellable, id_a);
+  g_assert_cmpint (a, ==, 102);
+
+  g_object_unref (cancellable);
+}
+
+static void
+test_fd (void)
+{
+  GCancellable *cancellable;
+  int fd;
+
+  cancellable = g_cancellable_new ();
+
+  fd = g_cancellable_get_fd (cancellable);
+  g_assert_cmpint (fd, >=, 0);
+  g_assert_cmpint (g_cancellable_get_fd (cancellable), ==, fd);
+  g_assert (!fd_readable (fd));
+
+  g_cancellable_cancel (cancellable);
+  g_assert (fd_readable (fd));
+
+  g_cancellable_reset (cancellable);
+  g_assert (!fd_readable (fd));
+
+  g_object_unref (cancellable);
+
+  /* An fd created after cancelling is readable straight away */
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  fd = g_cancellable_get_fd (cancellable);
+  g_assert_cmpint (fd, >=, 0);
+  g_assert (fd_readable (fd));
+
+  g_cancellable_reset (cancellable);
+  g_assert (!fd_readable (fd));
+
+  g_object_unref (cancellable);
+}
+
+static void
+test_current (void)
+{
+  GCancellable *a, *b;
+
+  a = g_cancellable_new ();
+  b = g_cancellable_new ();
+
+  g_assert (g_cancellable_get_current () == NULL);
+
+  g_cancellable_push_current (a);
+  g_assert (g_cancellable_get_current () == a);
+  g_cancellable_push_current (b);
+  g_assert (g_cancellable_get_current () == b);
+  g_cancellable_pop_current (b);
+  g_assert (g_cancellable_get_current () == a);
+  g_cancellable_pop_current (a);
+  g_assert (g_cancellable_get_current () == NULL);
+
+  g_object_unref (a);
+  g_object_unref (b);
+}
+
+static gpointer
+cancel_thread (gpointer data)
+{
+  g_cancellable_cancel (data);
+  return NULL;
+}
+
+static void
+test_threaded (void)
+{
+  GCancellable *cancellable;
+  GThread *threads[4];
+  int count, i, n;
+
+  for (n = 0; n < 100; n++)
+    {
+      count = 0;
+      cancellable = g_cancellable_new ();
+      g_cancellable_connect (cancellable, count_cb, &count, NULL);
+
+      for (i = 0; i < G_N_ELEMENTS (threads); i++)
+	threads[i] = g_thread_create (cancel_thread, cancellable, TRUE, NULL);
+      g_cancellable_get_fd (cancellable);
+      for (i = 0; i < G_N_ELEMENTS (threads); i++)
+	g_thread_join (threads[i]);
+
+      g_assert_cmpint (count, ==, 1);
+      g_assert (fd_readable (g_cancellable_get_fd (cancellable)));
+      g_cancellable_reset (cancellable);
+      g_assert (!fd_readable (g_cancellable_get_fd (cancellable)));
+
+      g_object_unref (cancellable);
+    }
+}
+
+static volatile gint blocker_state;
+
+static void
+blocker_cb (GCancellable *cancellable,
+	    gpointer      data)
+{
+  g_atomic_int_set (&blocker_state, 1);
+  while (g_atomic_int_get (&blocker_state) != 2)
+    g_usleep (1000);
+  g_usleep (10000);
+  g_atomic_int_set (&blocker_state, 3);
+}
+
+static void
+test_disconnect_running (void)
+{
+  GCancellable *cancellable;
+  GThread *thread;
+  gulong id_blocker, id_b;
+  int b = 0;
+
+  cancellable = g_cancellable_new ();
+  blocker_state = 0;
+  id_blocker = g_cancellable_connect (cancellable, blocker_cb, NULL, NULL);
+  id_b = g_cancellable_connect (cancellable, count_cb, &b, NULL);
+
+  thread = g_thread_create (cancel_thread, cancellable, TRUE, NULL);
+  while (g_atomic_int_get (&blocker_state) != 1)
+    g_usleep (1000);
+
+  /* Callbacks run unlocked, so a callback that is not running can be
+   * disconnected while another one is
+   */
+  g_cancellable_disconnect (cancellable, id_b);
+
+  /* while the running one is waited for */
+  g_atomic_int_set (&blocker_state, 2);
+  g_cancellable_disconnect (cancellable, id_blocker);
+  g_assert_cmpint (g_atomic_int_get (&blocker_state), ==, 3);
+
+  g_thread_join (thread);
+  g_assert_cmpint (b, ==, 0);
+
+  g_object_unref (cancellable);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_thread_init (NULL);
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/cancellable/callbacks", test_callbacks);
+  g_test_add_func ("/cancellable/fd", test_fd);
+  g_test_add_func ("/cancellable/current", test_current);
+  g_test_add_func ("/cancellable/threaded", test_threaded);
+  g_test_add_func ("/cancellable/disconnect-running", test_disconnect_running);
+
+  return g_test_run();
+}
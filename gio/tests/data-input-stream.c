@@ -118,6 +118,207 @@ test_read_lines_CR_LF (void)
 }
 
 
+static void
+test_read_lines_any (void)
+{
+  const char *data = "a\nb\r\nc\rd\r\ne\n\n\r\rlast\n";
+  const char *lines[] = { "a", "b", "c", "d", "e", "", "", "", "last" };
+  gsize buffer_size;
+
+  /* small buffers put newlines, and CR LF pairs, across buffer fills */
+  for (buffer_size = 1; buffer_size < 8; buffer_size++)
+    {
+      GInputStream *base_stream;
+      GDataInputStream *stream;
+      GError *error = NULL;
+      char *line;
+      gsize length;
+      int i;
+
+      base_stream = g_memory_input_stream_new_from_data (data, -1, NULL);
+      stream = g_data_input_stream_new (base_stream);
+      g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (stream), buffer_size);
+      g_data_input_stream_set_newline_type (stream, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+      for (i = 0; i < G_N_ELEMENTS (lines); i++)
+	{
+	  line = g_data_input_stream_read_line (stream, &length, NULL, &error);
+	  g_assert_no_error (error);
+	  g_assert_cmpstr (line, ==, lines[i]);
+	  g_assert_cmpint (length, ==, strlen (lines[i]));
+	  g_free (line);
+	}
+      line = g_data_input_stream_read_line (stream, &length, NULL, &error);
+      g_assert_no_error (error);
+      g_assert (line == NULL);
+
+      g_object_unref (stream);
+      g_object_unref (base_stream);
+    }
+}
+
+static void
+test_peek_line (void)
+{
+  const char *data = "first\nsecond\n\nlast";
+  const char *lines[] = { "first", "second", "", "last" };
+  GInputStream *base_stream;
+  GDataInputStream *stream;
+  GError *error = NULL;
+  const char *line;
+  gsize length;
+  int i;
+
+  base_stream = g_memory_input_stream_new_from_data (data, -1, NULL);
+  stream = g_data_input_stream_new (base_stream);
+  g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (stream), 4);
+
+  for (i = 0; i < G_N_ELEMENTS (lines); i++)
+    {
+      line = g_data_input_stream_peek_line (stream, &length, NULL, &error);
+      g_assert_no_error (error);
+      g_assert (line != NULL);
+      g_assert_cmpint (length, ==, strlen (lines[i]));
+      g_assert (strncmp (line, lines[i], length) == 0);
+    }
+  line = g_data_input_stream_peek_line (stream, &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (line == NULL);
+
+  /* stop characters */
+  test_seek_to_start (base_stream);
+  line = g_data_input_stream_peek_until (stream, "\n", &length, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (length, ==, 5);
+  g_assert (strncmp (line, "first", 5) == 0);
+
+  g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+  line = g_data_input_stream_peek_line (stream, &length, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+  g_assert (line == NULL);
+  g_assert_cmpint (length, ==, 0);
+  g_error_free (error);
+
+  g_object_unref (stream);
+  g_object_unref (base_stream);
+}
+
+typedef struct
+{
+  GMainLoop *loop;
+  int n_lines;
+  int stop_after;
+  gsize total_length;
+  gboolean closed;
+} ReadLinesData;
+
+static gboolean
+read_lines_line_cb (GDataInputStream *stream,
+                    const char       *line,
+                    gsize             length,
+                    gpointer          user_data)
+{
+  ReadLinesData *data = user_data;
+
+  g_assert (g_input_stream_has_pending (G_INPUT_STREAM (stream)));
+  g_assert_cmpint (length, ==, 9);
+  g_assert (strncmp (line, "some line", length) == 0);
+  data->n_lines++;
+  data->total_length += length;
+
+  return data->n_lines != data->stop_after;
+}
+
+static void
+read_lines_done_cb (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  ReadLinesData *data = user_data;
+  GError *error = NULL;
+  gboolean res;
+
+  res = g_data_input_stream_read_lines_finish (G_DATA_INPUT_STREAM (object),
+                                               result, &error);
+  if (data->closed)
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+      g_assert (!res);
+      g_error_free (error);
+    }
+  else
+    {
+      g_assert_no_error (error);
+      g_assert (res);
+    }
+  g_assert (!g_input_stream_has_pending (G_INPUT_STREAM (object)));
+  g_main_loop_quit (data->loop);
+}
+
+static void
+test_read_lines_async (void)
+{
+  GInputStream *base_stream;
+  GDataInputStream *stream;
+  ReadLinesData data;
+  int i;
+
+  base_stream = g_memory_input_stream_new ();
+  for (i = 0; i < MAX_LINES; i++)
+    g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (base_stream),
+                                    "some line\n", -1, NULL);
+  g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (base_stream),
+                                  "some line", -1, NULL);
+
+  stream = g_data_input_stream_new (base_stream);
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  /* read everything, including the unterminated last line */
+  data.n_lines = 0;
+  data.stop_after = -1;
+  data.total_length = 0;
+  data.closed = FALSE;
+  g_data_input_stream_read_lines_async (stream, read_lines_line_cb, &data,
+                                        G_PRIORITY_DEFAULT, NULL,
+                                        read_lines_done_cb, &data);
+  g_main_loop_run (data.loop);
+  g_assert_cmpint (data.n_lines, ==, MAX_LINES + 1);
+  g_assert_cmpint (data.total_length, ==, 9 * (MAX_LINES + 1));
+
+  /* stop early; the rest of the lines stay in the stream */
+  test_seek_to_start (base_stream);
+  g_buffered_input_stream_consume (G_BUFFERED_INPUT_STREAM (stream),
+                                   g_buffered_input_stream_get_available (G_BUFFERED_INPUT_STREAM (stream)));
+  data.n_lines = 0;
+  data.stop_after = 10;
+  g_data_input_stream_read_lines_async (stream, read_lines_line_cb, &data,
+                                        G_PRIORITY_DEFAULT, NULL,
+                                        read_lines_done_cb, &data);
+  g_main_loop_run (data.loop);
+  g_assert_cmpint (data.n_lines, ==, 10);
+
+  data.stop_after = -1;
+  g_data_input_stream_read_lines_async (stream, read_lines_line_cb, &data,
+                                        G_PRIORITY_DEFAULT, NULL,
+                                        read_lines_done_cb, &data);
+  g_main_loop_run (data.loop);
+  g_assert_cmpint (data.n_lines, ==, MAX_LINES + 1);
+
+  /* a closed stream reads no lines */
+  g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+  data.n_lines = 0;
+  data.closed = TRUE;
+  g_data_input_stream_read_lines_async (stream, read_lines_line_cb, &data,
+                                        G_PRIORITY_DEFAULT, NULL,
+                                        read_lines_done_cb, &data);
+  g_main_loop_run (data.loop);
+  g_assert_cmpint (data.n_lines, ==, 0);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (stream);
+  g_object_unref (base_stream);
+}
+
 static void
 test_read_until (void)
 {
@@ -157,7 +358,31 @@ test_read_until (void)
     }
   g_assert_no_error (error);
   g_assert_cmpint (line, ==, DATA_PARTS_NUM);
-	
+
+  /*  Test a single stop character */
+  test_seek_to_start (base_stream);
+  error = NULL;
+  data = (char*)1;
+  line = 0;
+  while (data)
+    {
+      gsize length = -1;
+      data = g_data_input_stream_read_until (G_DATA_INPUT_STREAM (stream), "$", &length, NULL, &error);
+      if (data)
+	{
+	  if (line == 0)
+	    g_assert_cmpint (strlen (data), ==, 2 * DATA_PART_LEN + 1);
+	  else if (line < REPEATS)
+	    g_assert_cmpint (strlen (data), ==, 4 * DATA_PART_LEN + 3);
+	  else
+	    g_assert_cmpint (strlen (data), ==, 2 * DATA_PART_LEN + 2);
+	  g_assert_no_error (error);
+	  g_free (data);
+	  line++;
+	}
+    }
+  g_assert_no_error (error);
+  g_assert_cmpint (line, ==, REPEATS + 1);
 	
   g_object_unref (base_stream);
   g_object_unref (stream);
@@ -313,6 +538,58 @@ test_read_int (void)
 }
 
 
+static void
+test_read_array (void)
+{
+  const guchar data[] = {
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10
+  };
+  GInputStream *base_stream;
+  GDataInputStream *stream;
+  GError *error = NULL;
+  gint16 v16[8];
+  gint32 v32[4];
+  gint64 v64[2];
+  gboolean res;
+  int i;
+
+  base_stream = g_memory_input_stream_new_from_data (data, sizeof (data), NULL);
+  stream = g_data_input_stream_new (base_stream);
+
+  res = g_data_input_stream_read_int16_array (stream, v16, 8, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  for (i = 0; i < 8; i++)
+    g_assert_cmphex ((guint16) v16[i], ==, (data[2 * i] << 8) | data[2 * i + 1]);
+
+  test_seek_to_start (base_stream);
+  g_data_input_stream_set_byte_order (stream, G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN);
+  res = g_data_input_stream_read_int32_array (stream, v32, 4, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert_cmphex ((guint32) v32[0], ==, 0x04030201);
+  g_assert_cmphex ((guint32) v32[3], ==, 0x100f0e0d);
+
+  test_seek_to_start (base_stream);
+  g_data_input_stream_set_byte_order (stream, G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN);
+  res = g_data_input_stream_read_int64_array (stream, v64, 2, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert_cmphex ((guint64) v64[0], ==, G_GUINT64_CONSTANT (0x0102030405060708));
+  g_assert_cmphex ((guint64) v64[1], ==, G_GUINT64_CONSTANT (0x090a0b0c0d0e0f10));
+
+  /* not enough data */
+  test_seek_to_start (base_stream);
+  res = g_data_input_stream_read_int64_array (stream, v64, 3, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_assert (!res);
+  g_error_free (error);
+
+  g_object_unref (stream);
+  g_object_unref (base_stream);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -323,8 +600,12 @@ main (int   argc,
   g_test_add_func ("/data-input-stream/read-lines-LF", test_read_lines_LF);
   g_test_add_func ("/data-input-stream/read-lines-CR", test_read_lines_CR);
   g_test_add_func ("/data-input-stream/read-lines-CR-LF", test_read_lines_CR_LF);
+  g_test_add_func ("/data-input-stream/read-lines-any", test_read_lines_any);
+  g_test_add_func ("/data-input-stream/peek-line", test_peek_line);
+  g_test_add_func ("/data-input-stream/read-lines-async", test_read_lines_async);
   g_test_add_func ("/data-input-stream/read-until", test_read_until);
   g_test_add_func ("/data-input-stream/read-int", test_read_int);
+  g_test_add_func ("/data-input-stream/read-array", test_read_array);
 
   return g_test_run();
 }
@@ -277,6 +277,92 @@ test_read_int (void)
   g_free (buffer);
 }
 
+typedef struct
+{
+  guint32 magic;
+  guchar  flags;
+  guint16 version;
+  gint64  size;
+} TestHeader;
+
+static const GDataStreamField test_header_fields[] = {
+  { G_DATA_STREAM_FIELD_INT32, G_STRUCT_OFFSET (TestHeader, magic) },
+  { G_DATA_STREAM_FIELD_BYTE, G_STRUCT_OFFSET (TestHeader, flags) },
+  { G_DATA_STREAM_FIELD_INT16, G_STRUCT_OFFSET (TestHeader, version) },
+  { G_DATA_STREAM_FIELD_INT64, G_STRUCT_OFFSET (TestHeader, size) }
+};
+
+static void
+test_put_array (void)
+{
+  GOutputStream *base_stream;
+  GDataOutputStream *stream;
+  GDataInputStream *in_stream;
+  GInputStream *in_base_stream;
+  GError *error = NULL;
+  TestHeader header = { 0x01020304, 0x05, 0x0607, -2 }, header_read;
+  gint16 values16[3] = { 0x0102, 0x0304, -1 };
+  gint32 *values32, *values32_read;
+  const guchar *data;
+  gboolean res;
+  int i;
+
+  /* large enough to be converted in several chunks */
+  values32 = g_new (gint32, 5000);
+  values32_read = g_new (gint32, 5000);
+  for (i = 0; i < 5000; i++)
+    values32[i] = i * 0x01010101;
+
+  base_stream = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  stream = g_data_output_stream_new (base_stream);
+
+  res = g_data_output_stream_put_int16_array (stream, values16, 3, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  res = g_data_output_stream_put_struct (stream, test_header_fields,
+                                         G_N_ELEMENTS (test_header_fields),
+                                         &header, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  res = g_data_output_stream_put_int32_array (stream, values32, 5000, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (base_stream)), ==,
+                   3 * 2 + 15 + 5000 * 4);
+  data = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (base_stream));
+  g_assert (memcmp (data, "\x01\x02\x03\x04\xff\xff", 6) == 0);
+  g_assert (memcmp (data + 6, "\x01\x02\x03\x04\x05\x06\x07", 7) == 0);
+  g_assert (memcmp (data + 13, "\xff\xff\xff\xff\xff\xff\xff\xfe", 8) == 0);
+
+  /* read it all back */
+  in_base_stream = g_memory_input_stream_new_from_data (data, 3 * 2 + 15 + 5000 * 4, NULL);
+  in_stream = g_data_input_stream_new (in_base_stream);
+  for (i = 0; i < 3; i++)
+    g_assert_cmpint (g_data_input_stream_read_int16 (in_stream, NULL, &error), ==, values16[i]);
+  memset (&header_read, 0, sizeof (header_read));
+  res = g_data_input_stream_read_struct (in_stream, test_header_fields,
+                                         G_N_ELEMENTS (test_header_fields),
+                                         &header_read, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert_cmphex (header_read.magic, ==, header.magic);
+  g_assert_cmphex (header_read.flags, ==, header.flags);
+  g_assert_cmphex (header_read.version, ==, header.version);
+  g_assert_cmpint (header_read.size, ==, header.size);
+  res = g_data_input_stream_read_int32_array (in_stream, values32_read, 5000, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert (memcmp (values32, values32_read, 5000 * 4) == 0);
+
+  g_object_unref (in_stream);
+  g_object_unref (in_base_stream);
+  g_object_unref (stream);
+  g_object_unref (base_stream);
+  g_free (values32);
+  g_free (values32_read);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -288,6 +374,7 @@ main (int   argc,
   g_test_add_func ("/data-input-stream/read-lines-CR", test_read_lines_CR);
   g_test_add_func ("/data-input-stream/read-lines-CR-LF", test_read_lines_CR_LF);
   g_test_add_func ("/data-input-stream/read-int", test_read_int);
+  g_test_add_func ("/data-output-stream/put-array", test_put_array);
 
   return g_test_run();
 }
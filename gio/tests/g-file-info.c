@@ -112,6 +112,87 @@ test_g_file_info (void)
   g_object_unref (info_copy);
 }
 
+static gboolean
+strv_contains (char       **strv,
+	       const char  *str)
+{
+  int i;
+
+  for (i = 0; strv[i] != NULL; i++)
+    if (strcmp (strv[i], str) == 0)
+      return TRUE;
+  return FALSE;
+}
+
+static void
+test_attribute_storage (void)
+{
+  GFileAttributeMatcher *matcher;
+  GFileInfo *info, *copy;
+  char **attr_list;
+
+  info = g_file_info_new ();
+
+  /* Common attributes and rare ones are stored apart; they have to
+   * behave the same.
+   */
+  g_file_info_set_name (info, TEST_NAME);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE, 0644);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, 42);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_UID, 1000);
+  g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME, TEST_NAME);
+  g_file_info_set_attribute_string (info, "xattr::test", "value");
+
+  attr_list = g_file_info_list_attributes (info, NULL);
+  g_assert_cmpint (g_strv_length (attr_list), ==, 6);
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_STANDARD_NAME));
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_UNIX_MODE));
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_UNIX_UID));
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME));
+  g_assert (strv_contains (attr_list, "xattr::test"));
+  g_strfreev (attr_list);
+
+  attr_list = g_file_info_list_attributes (info, "unix");
+  g_assert_cmpint (g_strv_length (attr_list), ==, 2);
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_UNIX_MODE));
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_UNIX_UID));
+  g_strfreev (attr_list);
+
+  /* Copying replaces everything the destination had */
+  copy = g_file_info_new ();
+  g_file_info_set_size (copy, TEST_SIZE);
+  g_file_info_set_attribute_uint32 (copy, G_FILE_ATTRIBUTE_UNIX_GID, 1000);
+  g_file_info_copy_into (info, copy);
+  g_assert (!g_file_info_has_attribute (copy, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+  g_assert (!g_file_info_has_attribute (copy, G_FILE_ATTRIBUTE_UNIX_GID));
+  g_assert_cmpstr (g_file_info_get_name (copy), ==, TEST_NAME);
+  g_assert_cmpuint (g_file_info_get_attribute_uint32 (copy, G_FILE_ATTRIBUTE_UNIX_MODE), ==, 0644);
+  g_assert_cmpstr (g_file_info_get_attribute_string (copy, "xattr::test"), ==, "value");
+  g_object_unref (copy);
+
+  g_file_info_remove_attribute (info, G_FILE_ATTRIBUTE_UNIX_MODE);
+  g_assert (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_MODE));
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE, 0600);
+  g_assert_cmpuint (g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE), ==, 0600);
+
+  /* Setting a mask drops what it doesn't match */
+  matcher = g_file_attribute_matcher_new ("standard::name,xattr::*");
+  g_file_info_set_attribute_mask (info, matcher);
+  g_file_attribute_matcher_unref (matcher);
+
+  attr_list = g_file_info_list_attributes (info, NULL);
+  g_assert_cmpint (g_strv_length (attr_list), ==, 2);
+  g_assert (strv_contains (attr_list, G_FILE_ATTRIBUTE_STANDARD_NAME));
+  g_assert (strv_contains (attr_list, "xattr::test"));
+  g_strfreev (attr_list);
+
+  g_file_info_set_size (info, TEST_SIZE);
+  g_assert (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+
+  g_object_unref (info);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -120,6 +201,7 @@ main (int   argc,
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/g-file-info/test_g_file_info", test_g_file_info);
+  g_test_add_func ("/g-file-info/attribute-storage", test_attribute_storage);
   
   return g_test_run();
 }
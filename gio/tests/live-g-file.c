@@ -21,7 +21,10 @@
  */
 
 #include <glib/glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -793,6 +796,84 @@ test_copy_move (gconstpointer test_data)
   g_object_unref (root);
 }
 
+static void
+copy_progress_cb (goffset  current_num_bytes,
+                  goffset  total_num_bytes,
+                  gpointer user_data)
+{
+  goffset *last_num_bytes = user_data;
+
+  g_assert_cmpint (current_num_bytes, >=, *last_num_bytes);
+  g_assert_cmpint (current_num_bytes, <=, total_num_bytes);
+  *last_num_bytes = current_num_bytes;
+}
+
+static void
+test_copy_contents (gconstpointer test_data)
+{
+  GFile *root, *src_file, *dst_file;
+  char *contents, *copied;
+  gsize length, copied_length;
+  goffset last_num_bytes;
+  gboolean res;
+  GError *error;
+  int i;
+
+  log ("\n");
+
+  g_assert (test_data != NULL);
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+  g_assert (root != NULL);
+  src_file = g_file_get_child (root, "copy-contents-source");
+  dst_file = g_file_get_child (root, "copy-contents-target");
+
+  /*  large enough to need several transfers  */
+  length = 3 * 1024 * 1024 + 17;
+  contents = g_malloc (length);
+  for (i = 0; i < length; i++)
+    contents[i] = (char) (i * 7 + i / 4096);
+
+  error = NULL;
+  res = g_file_replace_contents (src_file, contents, length, NULL, FALSE,
+				 G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (res, ==, TRUE);
+
+  /*  copy, then copy again over the result  */
+  for (i = 0; i < 2; i++)
+    {
+      last_num_bytes = 0;
+      res = g_file_copy (src_file, dst_file,
+			 i == 0 ? G_FILE_COPY_NONE : G_FILE_COPY_OVERWRITE,
+			 NULL, copy_progress_cb, &last_num_bytes, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (res, ==, TRUE);
+      g_assert_cmpint (last_num_bytes, ==, length);
+
+      res = g_file_load_contents (dst_file, NULL, &copied, &copied_length,
+				  NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (res, ==, TRUE);
+      g_assert_cmpint (copied_length, ==, length);
+      g_assert (memcmp (copied, contents, length) == 0);
+      g_free (copied);
+    }
+
+  /*  the target exists now  */
+  res = g_file_copy (src_file, dst_file, G_FILE_COPY_NONE,
+		     NULL, NULL, NULL, &error);
+  g_assert_cmpint (res, ==, FALSE);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS);
+  g_error_free (error);
+
+  g_file_delete (src_file, NULL, NULL);
+  g_file_delete (dst_file, NULL, NULL);
+  g_free (contents);
+  g_object_unref (src_file);
+  g_object_unref (dst_file);
+  g_object_unref (root);
+}
+
 static void
 test_create (gconstpointer test_data)
 {
@@ -879,6 +960,529 @@ test_create (gconstpointer test_data)
   g_object_unref (root);
 }
 
+static GHashTable *
+enumerate_types (GFile               *dir,
+		 const char          *attributes,
+		 GFileQueryInfoFlags  flags)
+{
+  GFileEnumerator *enumerator;
+  GFileInfo *info;
+  GHashTable *types;
+  GError *error;
+  int type;
+
+  types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  error = NULL;
+  enumerator = g_file_enumerate_children (dir, attributes, flags, NULL, &error);
+  g_assert_no_error (error);
+
+  while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+    {
+      type = g_file_info_get_file_type (info);
+      if (g_file_info_get_is_symlink (info))
+	type |= 0x100;
+      g_hash_table_insert (types, g_strdup (g_file_info_get_name (info)),
+			   GINT_TO_POINTER (type));
+      g_object_unref (info);
+    }
+  g_assert_no_error (error);
+
+  g_file_enumerator_close (enumerator, NULL, NULL);
+  g_object_unref (enumerator);
+
+  return types;
+}
+
+static void
+compare_types (gpointer key, gpointer value, gpointer user_data)
+{
+  g_assert_cmpint (GPOINTER_TO_INT (value), ==,
+		   GPOINTER_TO_INT (g_hash_table_lookup (user_data, key)));
+}
+
+static void
+test_enumerate_types (gconstpointer test_data)
+{
+  GFileQueryInfoFlags flags[] = { 0, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS };
+  GHashTable *fast, *full;
+  GFile *root;
+  int i;
+
+  g_assert (test_data != NULL);
+  log ("\n  Test enumerating types '%s'...\n", (char *) test_data);
+
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+
+  /* Asking only for the name and type may skip stating the files;
+   * the result has to be the same as with a full stat.
+   */
+  for (i = 0; i < G_N_ELEMENTS (flags); i++)
+    {
+      fast = enumerate_types (root, "standard::name,standard::type,standard::is-symlink",
+			      flags[i]);
+      full = enumerate_types (root, "*", flags[i]);
+
+      g_assert_cmpint (g_hash_table_size (fast), >, 0);
+      g_assert_cmpint (g_hash_table_size (fast), ==, g_hash_table_size (full));
+      g_hash_table_foreach (fast, compare_types, full);
+
+      g_hash_table_destroy (fast);
+      g_hash_table_destroy (full);
+    }
+
+  g_object_unref (root);
+}
+
+static void
+got_async_result (GObject      *source,
+		  GAsyncResult *result,
+		  gpointer      user_data)
+{
+  *(GAsyncResult **) user_data = g_object_ref (result);
+}
+
+/* With @cancel, every other batch is cancelled right after it is
+ * started; entries that were already read must not get lost.
+ */
+static GPtrArray *
+enumerate_names (GFile    *dir,
+		 guint     parallelism,
+		 gboolean  cancel)
+{
+  GFileEnumerator *enumerator;
+  GMainContext *context;
+  GCancellable *cancellable;
+  GAsyncResult *result;
+  GPtrArray *names;
+  GList *files, *l;
+  GError *error;
+  gboolean cancelled;
+  int n_calls;
+
+  names = g_ptr_array_new ();
+  context = g_main_context_default ();
+
+  error = NULL;
+  enumerator = g_file_enumerate_children (dir, "standard::name,standard::size",
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  NULL, &error);
+  g_assert_no_error (error);
+
+  if (parallelism == 0)
+    {
+      GFileInfo *info;
+
+      while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+	{
+	  g_ptr_array_add (names, g_strdup (g_file_info_get_name (info)));
+	  g_object_unref (info);
+	}
+      g_assert_no_error (error);
+    }
+  else
+    {
+      g_file_enumerator_set_parallelism (enumerator, parallelism);
+      g_assert_cmpuint (g_file_enumerator_get_parallelism (enumerator), ==, parallelism);
+
+      /* Small batches so the order is checked across several of them */
+      n_calls = 0;
+      do
+	{
+	  cancellable = NULL;
+	  if (cancel && n_calls++ % 2 == 0)
+	    cancellable = g_cancellable_new ();
+
+	  result = NULL;
+	  g_file_enumerator_next_files_async (enumerator, 3, G_PRIORITY_DEFAULT,
+					      cancellable, got_async_result, &result);
+	  if (cancellable)
+	    g_cancellable_cancel (cancellable);
+	  while (result == NULL)
+	    g_main_context_iteration (context, TRUE);
+
+	  files = g_file_enumerator_next_files_finish (enumerator, result, &error);
+	  cancelled = g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	  if (cancelled)
+	    {
+	      g_assert (cancellable != NULL);
+	      g_clear_error (&error);
+	    }
+	  g_assert_no_error (error);
+	  g_object_unref (result);
+	  if (cancellable)
+	    g_object_unref (cancellable);
+
+	  for (l = files; l != NULL; l = l->next)
+	    {
+	      g_ptr_array_add (names, g_strdup (g_file_info_get_name (l->data)));
+	      g_object_unref (l->data);
+	    }
+	  g_list_free (files);
+	}
+      while (files != NULL || cancelled);
+    }
+
+  g_file_enumerator_close (enumerator, NULL, NULL);
+  g_object_unref (enumerator);
+
+  return names;
+}
+
+static void
+free_names (GPtrArray *names)
+{
+  g_ptr_array_foreach (names, (GFunc) g_free, NULL);
+  g_ptr_array_free (names, TRUE);
+}
+
+static void
+test_enumerate_async (gconstpointer test_data)
+{
+  guint parallelism[] = { 1, 4 };
+  GPtrArray *expected, *names;
+  GFile *root;
+  int i, j;
+
+  g_assert (test_data != NULL);
+  log ("\n  Test enumerating asynchronously '%s'...\n", (char *) test_data);
+
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+
+  /* However many threads gather the infos, they come back in the
+   * order the directory was read in, and cancelled batches lose none.
+   */
+  expected = enumerate_names (root, 0, FALSE);
+  g_assert_cmpint (expected->len, >, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (parallelism) * 2; i++)
+    {
+      names = enumerate_names (root, parallelism[i / 2], i % 2);
+      g_assert_cmpint (names->len, ==, expected->len);
+      for (j = 0; j < names->len; j++)
+	g_assert_cmpstr (g_ptr_array_index (names, j), ==,
+			 g_ptr_array_index (expected, j));
+      free_names (names);
+    }
+
+  free_names (expected);
+  g_object_unref (root);
+}
+
+static char *
+query_content_type (GFile *file)
+{
+  GFileInfo *info;
+  GError *error;
+  char *content_type;
+
+  error = NULL;
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+			    G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+  content_type = g_strdup (g_file_info_get_content_type (info));
+  g_object_unref (info);
+
+  return content_type;
+}
+
+static void
+set_mtime (GFile   *file,
+	   guint64  mtime)
+{
+  GFileInfo *info;
+  GError *error;
+
+  info = g_file_info_new ();
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, 0);
+
+  error = NULL;
+  g_file_set_attributes_from_info (file, info, G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (info);
+}
+
+/* Overwrites the start of @file, keeping its inode and size */
+static void
+rewrite_in_place (GFile      *file,
+		  const char *data,
+		  gsize       len)
+{
+  char *path;
+  FILE *f;
+
+  path = g_file_get_path (file);
+  f = g_fopen (path, "r+b");
+  g_assert (f != NULL);
+  g_assert_cmpint (fwrite (data, 1, len, f), ==, len);
+  g_assert_cmpint (fclose (f), ==, 0);
+  g_free (path);
+}
+
+static void
+test_content_type_cache (gconstpointer test_data)
+{
+  GFile *root, *file, *renamed;
+  GError *error;
+  char *png_type, *pdf_type, *txt_type, *content_type;
+  const char png[] = "\x89PNG\r\n\x1a\n\0\0\0\rIHDR";
+  const char pdf[] = "%PDF-1.4\n%\xe2\xe3\xcf\xd3\n\n";
+  const guint64 mtime = 1000000000;
+
+  g_assert (test_data != NULL);
+  log ("\n  Test content type caching '%s'...\n", (char *) test_data);
+
+  g_assert_cmpint (sizeof (png), ==, sizeof (pdf));
+  png_type = g_content_type_guess ("content_type_test", (const guchar *) png, sizeof (png) - 1, NULL);
+  pdf_type = g_content_type_guess ("content_type_test", (const guchar *) pdf, sizeof (pdf) - 1, NULL);
+  txt_type = g_content_type_guess ("content_type_test.txt", (const guchar *) pdf, sizeof (pdf) - 1, NULL);
+  g_assert_cmpstr (png_type, !=, pdf_type);
+  g_assert_cmpstr (pdf_type, !=, txt_type);
+
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+  file = g_file_get_child (root, "content_type_test");
+  renamed = g_file_get_child (root, "content_type_test.txt");
+
+  error = NULL;
+  g_file_replace_contents (file, png, sizeof (png) - 1, NULL, FALSE,
+			   G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error (error);
+  set_mtime (file, mtime);
+
+  content_type = query_content_type (file);
+  g_assert_cmpstr (content_type, ==, png_type);
+  g_free (content_type);
+
+  rewrite_in_place (file, pdf, sizeof (pdf) - 1);
+
+#ifndef G_OS_WIN32
+  /* Sniffed types are cached by inode, mtime and size, so with all
+   * three restored the next query is answered from the cache.
+   */
+  set_mtime (file, mtime);
+  content_type = query_content_type (file);
+  g_assert_cmpstr (content_type, ==, png_type);
+  g_free (content_type);
+#endif
+
+  /* A new mtime, as any real write gives, makes it a miss */
+  set_mtime (file, mtime + 1);
+  content_type = query_content_type (file);
+  g_assert_cmpstr (content_type, ==, pdf_type);
+  g_free (content_type);
+
+  /* Renaming keeps inode, mtime and size; the name check makes it a miss */
+  g_file_move (file, renamed, G_FILE_COPY_NONE, NULL, NULL, NULL, &error);
+  g_assert_no_error (error);
+  content_type = query_content_type (renamed);
+  g_assert_cmpstr (content_type, ==, txt_type);
+  g_free (content_type);
+
+  g_file_delete (renamed, NULL, &error);
+  g_assert_no_error (error);
+
+  g_free (png_type);
+  g_free (pdf_type);
+  g_free (txt_type);
+  g_object_unref (renamed);
+  g_object_unref (file);
+  g_object_unref (root);
+}
+
+static gboolean
+strv_contains (char       **strv,
+	       const char  *str)
+{
+  int i;
+
+  for (i = 0; strv[i] != NULL; i++)
+    if (strcmp (strv[i], str) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+test_xattr_from_fd (gconstpointer test_data)
+{
+  GFile *root, *file;
+  GFileInputStream *stream;
+  GFileInfo *info;
+  GError *error;
+  char **names;
+  gboolean res;
+
+  g_assert (test_data != NULL);
+  log ("\n  Test xattrs queried on a stream '%s'...\n", (char *) test_data);
+
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+  file = g_file_get_child (root, "xattr_test");
+
+  error = NULL;
+  g_file_replace_contents (file, "x", 1, NULL, FALSE,
+			   G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  res = g_file_set_attribute_string (file, "xattr::gio-test", "value",
+				     G_FILE_QUERY_INFO_NONE, NULL, &error);
+  if (!res)
+    {
+      /* No xattr support here, either in GIO or in the file system */
+      log ("  Skipping, xattrs not supported: %s\n", error->message);
+      g_error_free (error);
+      g_file_delete (file, NULL, NULL);
+      g_object_unref (file);
+      g_object_unref (root);
+      return;
+    }
+
+  stream = g_file_read (file, NULL, &error);
+  g_assert_no_error (error);
+
+  /* Listing the whole namespace */
+  info = g_file_input_stream_query_info (stream, "xattr::*", NULL, &error);
+  g_assert_no_error (error);
+  names = g_file_info_list_attributes (info, "xattr");
+  g_assert (strv_contains (names, "xattr::gio-test"));
+  g_assert_cmpstr (g_file_info_get_attribute_string (info, "xattr::gio-test"), ==, "value");
+  g_strfreev (names);
+  g_object_unref (info);
+
+  /* Naming the attribute */
+  info = g_file_input_stream_query_info (stream, "xattr::gio-test", NULL, &error);
+  g_assert_no_error (error);
+  names = g_file_info_list_attributes (info, "xattr");
+  g_assert (strv_contains (names, "xattr::gio-test"));
+  g_assert_cmpstr (g_file_info_get_attribute_string (info, "xattr::gio-test"), ==, "value");
+  g_strfreev (names);
+  g_object_unref (info);
+
+  g_input_stream_close (G_INPUT_STREAM (stream), NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (stream);
+
+  g_file_delete (file, NULL, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (file);
+  g_object_unref (root);
+}
+
+#ifndef G_OS_WIN32
+/* Set up by main() before anything looks at the home directory */
+static char *thumbnail_base_dir;
+
+static void
+check_thumbnail_attributes (GFile      *file,
+			    const char *thumbnail_path,
+			    gboolean    failed)
+{
+  GFileInfo *info;
+  GError *error;
+
+  error = NULL;
+  info = g_file_query_info (file, "thumbnail::*",
+			    G_FILE_QUERY_INFO_NONE, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH), ==, thumbnail_path);
+  g_assert_cmpint (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAILING_FAILED), ==, failed);
+  g_object_unref (info);
+}
+
+static void
+test_thumbnail_cache (gconstpointer test_data)
+{
+  GFile *root, *file;
+  GError *error;
+  char *uri, *basename, *normal_dir, *fail_dir, *normal, *fail;
+  int i;
+
+  g_assert (test_data != NULL);
+  log ("\n  Test thumbnail caching '%s'...\n", (char *) test_data);
+
+  root = g_file_new_for_commandline_arg ((char *) test_data);
+  file = g_file_get_child (root, "thumbnail_test");
+
+  error = NULL;
+  g_file_replace_contents (file, "x", 1, NULL, FALSE,
+			   G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  uri = g_file_get_uri (file);
+  basename = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  normal_dir = g_build_filename (thumbnail_base_dir,
+				 ".thumbnails", "normal", NULL);
+  fail_dir = g_build_filename (thumbnail_base_dir, ".thumbnails", "fail",
+			       "gnome-thumbnail-factory", NULL);
+  normal = g_strconcat (normal_dir, G_DIR_SEPARATOR_S, basename, ".png", NULL);
+  fail = g_strconcat (fail_dir, G_DIR_SEPARATOR_S, basename, ".png", NULL);
+
+  /* No thumbnail directories yet, so nothing can be watched */
+  check_thumbnail_attributes (file, NULL, FALSE);
+
+  g_assert_cmpint (g_mkdir_with_parents (normal_dir, 0700), ==, 0);
+  g_assert_cmpint (g_mkdir_with_parents (fail_dir, 0700), ==, 0);
+
+  /* Each state is queried twice: the second query may come from the
+   * cache, and must still see the change made before the first one.
+   */
+  for (i = 0; i < 2; i++)
+    check_thumbnail_attributes (file, NULL, FALSE);
+
+  g_assert (g_file_set_contents (normal, "", 0, NULL));
+  for (i = 0; i < 2; i++)
+    check_thumbnail_attributes (file, normal, FALSE);
+
+  g_assert_cmpint (g_remove (normal), ==, 0);
+  g_assert (g_file_set_contents (fail, "", 0, NULL));
+  for (i = 0; i < 2; i++)
+    check_thumbnail_attributes (file, NULL, TRUE);
+
+  g_assert_cmpint (g_remove (fail), ==, 0);
+  for (i = 0; i < 2; i++)
+    check_thumbnail_attributes (file, NULL, FALSE);
+
+  g_file_delete (file, NULL, &error);
+  g_assert_no_error (error);
+
+  g_free (fail);
+  g_free (normal);
+  g_free (fail_dir);
+  g_free (normal_dir);
+  g_free (basename);
+  g_free (uri);
+  g_object_unref (file);
+  g_object_unref (root);
+}
+
+static void
+remove_tree (const char *path)
+{
+  const char *name;
+  char *child;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+	{
+	  child = g_build_filename (path, name, NULL);
+	  if (g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+	    g_remove (child);
+	  else
+	    remove_tree (child);
+	  g_free (child);
+	}
+      g_dir_close (dir);
+      g_rmdir (path);
+    }
+  else
+    g_remove (path);
+}
+#endif
+
 static void
 test_open (gconstpointer test_data)
 {
@@ -1095,6 +1699,7 @@ main (int argc, char *argv[])
   static char *target_path;
   GError *error;
   GOptionContext *context;
+  int res;
 
   static GOptionEntry cmd_entries[] = {
     {"read-write", 'w', 0, G_OPTION_ARG_NONE, &write_test,
@@ -1113,7 +1718,16 @@ main (int argc, char *argv[])
   target_path = NULL;
   posix_compat = FALSE;
 
+#ifndef G_OS_WIN32
+  /*  private thumbnail directories for test_thumbnail_cache()  */
+  thumbnail_base_dir = g_build_filename (g_get_tmp_dir (), "live-g-file-XXXXXX", NULL);
+  if (mkdtemp (thumbnail_base_dir) == NULL)
+    g_error ("mkdtemp: %s", g_strerror (errno));
+  g_setenv ("GIO_THUMBNAIL_BASE_DIR", thumbnail_base_dir, TRUE);
+#endif
+
   /*  strip all gtester-specific args  */
+  g_thread_init (NULL);
   g_type_init ();
   g_test_init (&argc, &argv, NULL);
 
@@ -1179,10 +1793,37 @@ main (int argc, char *argv[])
     g_test_add_data_func ("/live-g-file/test_enumerate", target_path,
 			  test_enumerate);
 
+  /*  Read test - enumerate with and without stating the files  */
+  if (!only_create_struct)
+    g_test_add_data_func ("/live-g-file/test_enumerate_types", target_path,
+			  test_enumerate_types);
+
+  /*  Read test - enumerate asynchronously with several threads  */
+  if (!only_create_struct)
+    g_test_add_data_func ("/live-g-file/test_enumerate_async", target_path,
+			  test_enumerate_async);
+
   /*  Read test - open (g_file_read())  */
   if (!only_create_struct)
     g_test_add_data_func ("/live-g-file/test_open", target_path, test_open);
 
+  /*  Write test - content types follow file changes  */
+  if (write_test && (!only_create_struct))
+    g_test_add_data_func ("/live-g-file/test_content_type_cache", target_path,
+			  test_content_type_cache);
+
+  /*  Write test - xattrs queried on an open stream  */
+  if (write_test && (!only_create_struct))
+    g_test_add_data_func ("/live-g-file/test_xattr_from_fd", target_path,
+			  test_xattr_from_fd);
+
+#ifndef G_OS_WIN32
+  /*  Write test - thumbnail states follow the thumbnail directories  */
+  if (write_test && (!only_create_struct))
+    g_test_add_data_func ("/live-g-file/test_thumbnail_cache", target_path,
+			  test_thumbnail_cache);
+#endif
+
   /*  Write test - create  */
   if (write_test && (!only_create_struct))
     g_test_add_data_func ("/live-g-file/test_create", target_path,
@@ -1192,6 +1833,9 @@ main (int argc, char *argv[])
   if (write_test && (!only_create_struct))
     g_test_add_data_func ("/live-g-file/test_copy_move", target_path,
 			  test_copy_move);
+  if (write_test && (!only_create_struct))
+    g_test_add_data_func ("/live-g-file/test_copy_contents", target_path,
+			  test_copy_contents);
 
   /*  Write test - delete, trash  */
   if (write_test && (!only_create_struct))
@@ -1202,6 +1846,12 @@ main (int argc, char *argv[])
     g_test_add_data_func ("/live-g-file/final_clean", target_path,
     	  	  prep_clean_structure);
 
-  return g_test_run ();
+  res = g_test_run ();
+
+#ifndef G_OS_WIN32
+  remove_tree (thumbnail_base_dir);
+  g_free (thumbnail_base_dir);
+#endif
 
+  return res;
 }
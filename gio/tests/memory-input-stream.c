@@ -65,6 +65,75 @@ test_read_chunks (void)
     }
 }
 
+static void
+test_many_chunks (void)
+{
+  GInputStream *stream;
+  GMemoryInputStream *mstream;
+  gchar *data;
+  const gchar *chunk;
+  gchar buffer[16];
+  GError *error = NULL;
+  gsize count;
+  gsize pos;
+  guint i;
+
+  /* 1000 chunks of 1 to 10 bytes, and some empty ones */
+  data = g_malloc (10000);
+  for (i = 0; i < 10000; i++)
+    data[i] = i % 251;
+
+  stream = g_memory_input_stream_new ();
+  mstream = G_MEMORY_INPUT_STREAM (stream);
+  pos = 0;
+  for (i = 0; i < 1000; i++)
+    {
+      g_memory_input_stream_add_data (mstream, data + pos, i % 10 + 1, NULL);
+      if (i % 100 == 0)
+        g_memory_input_stream_add_data (mstream, data, 0, NULL);
+      pos += i % 10 + 1;
+    }
+  g_memory_input_stream_add_data (mstream, data + pos, 10000 - pos, NULL);
+
+  /* Seek around and read across chunk boundaries */
+  for (i = 0; i < 2000; i++)
+    {
+      pos = (i * 7919) % 9990;
+      g_assert (g_seekable_seek (G_SEEKABLE (stream), pos, G_SEEK_SET, NULL, &error));
+      g_assert_cmpint (g_input_stream_read (stream, buffer, 10, NULL, &error), ==, 10);
+      g_assert_no_error (error);
+      g_assert (memcmp (buffer, data + pos, 10) == 0);
+    }
+
+  /* Borrowed chunks end at chunk boundaries */
+  g_assert (g_seekable_seek (G_SEEKABLE (stream), 2, G_SEEK_SET, NULL, &error));
+  chunk = g_memory_input_stream_borrow_chunk (mstream, 100, &count, &error);
+  g_assert_no_error (error);
+  g_assert (chunk == data + 2);
+  g_assert_cmpint (count, ==, 1);
+
+  pos = 3;
+  while ((chunk = g_memory_input_stream_borrow_chunk (mstream, 5, &count, &error)) != NULL)
+    {
+      g_assert_cmpint (count, <=, 5);
+      g_assert (chunk == data + pos);
+      pos += count;
+    }
+  g_assert_no_error (error);
+  g_assert_cmpint (count, ==, 0);
+  g_assert_cmpint (pos, ==, 10000);
+  g_assert_cmpint (g_seekable_tell (G_SEEKABLE (stream)), ==, 10000);
+
+  g_input_stream_close (stream, NULL, NULL);
+  chunk = g_memory_input_stream_borrow_chunk (mstream, 5, &count, &error);
+  g_assert (chunk == NULL);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+  g_error_free (error);
+
+  g_object_unref (stream);
+  g_free (data);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -73,6 +142,7 @@ main (int   argc,
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/memory-input-stream/read-chunks", test_read_chunks);
+  g_test_add_func ("/memory-input-stream/many-chunks", test_many_chunks);
 
   return g_test_run();
 }
@@ -85,6 +85,133 @@ test_data_size (void)
   g_object_unref (mo);
 }
 
+static void
+test_writev (void)
+{
+  GOutputStream *mo;
+  GOutputStream *o;
+  GOutputVector vectors[3];
+  char big[1000];
+  gsize bytes_written;
+  gboolean res;
+  GError *error = NULL;
+  gsize i;
+
+  mo = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+
+  vectors[0].buffer = "abc";
+  vectors[0].size = 3;
+  vectors[1].buffer = NULL;
+  vectors[1].size = 0;
+  vectors[2].buffer = "defgh";
+  vectors[2].size = 5;
+  res = g_output_stream_writev (mo, vectors, 3, &bytes_written, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (res);
+  g_assert_cmpint (bytes_written, ==, 8);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 8);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)), "abcdefgh", 8) == 0);
+
+  /* Writes that don't fit in the buffer go out together with it */
+  o = g_buffered_output_stream_new_sized (mo, 16);
+  for (i = 0; i < sizeof (big); i++)
+    big[i] = i % 251;
+  g_assert_cmpint (g_output_stream_write (o, "0123456789", 10, NULL, &error), ==, 10);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 8);
+  g_assert_cmpint (g_output_stream_write (o, big, sizeof (big), NULL, &error), ==, sizeof (big));
+  g_assert_no_error (error);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 8 + 10 + sizeof (big));
+  g_assert (memcmp ((char *)g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)) + 18, big, sizeof (big)) == 0);
+
+  g_output_stream_close (o, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (o);
+  g_object_unref (mo);
+}
+
+static void
+test_chunked (void)
+{
+  GOutputStream *mo;
+  GOutputStream *target;
+  const GOutputVector *vectors;
+  GError *error = NULL;
+  gchar data[100];
+  gsize bytes_written;
+  guint n_vectors;
+  gsize size;
+  guint i;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i;
+
+  mo = g_memory_output_stream_new_chunked (16);
+  g_assert (!g_seekable_can_seek (G_SEEKABLE (mo)));
+
+  g_assert_cmpint (g_output_stream_write (mo, data, 10, NULL, &error), ==, 10);
+  g_assert_cmpint (g_output_stream_write (mo, data + 10, 90, NULL, &error), ==, 90);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 100);
+  g_assert_cmpint (g_memory_output_stream_get_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 112);
+
+  /* The data stays in chunks until it is asked for in one piece */
+  vectors = g_memory_output_stream_get_vectors (G_MEMORY_OUTPUT_STREAM (mo), &n_vectors);
+  g_assert_cmpint (n_vectors, ==, 7);
+  size = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      g_assert (memcmp (vectors[i].buffer, data + size, vectors[i].size) == 0);
+      size += vectors[i].size;
+    }
+  g_assert_cmpint (size, ==, 100);
+
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)), data, 100) == 0);
+  vectors = g_memory_output_stream_get_vectors (G_MEMORY_OUTPUT_STREAM (mo), &n_vectors);
+  g_assert_cmpint (n_vectors, ==, 1);
+  g_assert_cmpint (vectors[0].size, ==, 100);
+
+  /* Draining moves the data to another stream */
+  g_assert_cmpint (g_output_stream_write (mo, data, 20, NULL, &error), ==, 20);
+  target = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  g_assert (g_memory_output_stream_drain (G_MEMORY_OUTPUT_STREAM (mo), target,
+                                          &bytes_written, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (bytes_written, ==, 120);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 0);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (target)), ==, 120);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (target)), data, 100) == 0);
+  g_assert (memcmp ((gchar *)g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (target)) + 100, data, 20) == 0);
+
+  /* A partial drain leaves the rest of the data in place */
+  g_object_unref (target);
+  target = g_memory_output_stream_new (g_malloc (50), 50, NULL, g_free);
+  g_assert_cmpint (g_output_stream_write (mo, data, 100, NULL, &error), ==, 100);
+  g_assert (!g_memory_output_stream_drain (G_MEMORY_OUTPUT_STREAM (mo), target,
+                                           &bytes_written, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_clear_error (&error);
+  g_assert_cmpint (bytes_written, ==, 50);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (target)), data, 50) == 0);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 50);
+  vectors = g_memory_output_stream_get_vectors (G_MEMORY_OUTPUT_STREAM (mo), &n_vectors);
+  g_assert (memcmp (vectors[0].buffer, data + 50, vectors[0].size) == 0);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)), data + 50, 50) == 0);
+
+  g_object_unref (target);
+  target = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  g_assert (g_memory_output_stream_drain (G_MEMORY_OUTPUT_STREAM (mo), target,
+                                          &bytes_written, NULL, &error));
+  g_assert_cmpint (bytes_written, ==, 50);
+
+  /* Writing goes on after the drained data */
+  g_assert_cmpint (g_output_stream_write (mo, data, 5, NULL, &error), ==, 5);
+  g_assert_cmpint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (mo)), ==, 5);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (mo)), data, 5) == 0);
+
+  g_object_unref (target);
+  g_object_unref (mo);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -95,6 +222,8 @@ main (int   argc,
 
   g_test_add_func ("/memory-output-stream/truncate", test_truncate);
   g_test_add_func ("/memory-output-stream/get-data-size", test_data_size);
+  g_test_add_func ("/memory-output-stream/writev", test_writev);
+  g_test_add_func ("/memory-output-stream/chunked", test_chunked);
 
   return g_test_run();
 }
@@ -95,6 +95,52 @@ test_simple_async (void)
   ensure_destroyed (c);
 }
 
+static void
+order_callback (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  GArray *order = user_data;
+  gint tag;
+
+  tag = GPOINTER_TO_INT (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (result)));
+  g_array_append_val (order, tag);
+}
+
+static void
+test_complete_in_idle_batch (void)
+{
+  GSimpleAsyncResult *results[10];
+  GArray *order;
+  gint i;
+
+  order = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  for (i = 0; i < G_N_ELEMENTS (results); i++)
+    {
+      results[i] = g_simple_async_result_new (NULL, order_callback, order,
+                                              GINT_TO_POINTER (i));
+      g_simple_async_result_complete_in_idle (results[i]);
+    }
+
+  /* Completing the same result twice still calls back twice */
+  g_simple_async_result_complete_in_idle (results[3]);
+
+  g_assert_cmpint (order->len, ==, 0);
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+  g_assert_cmpint (order->len, ==, G_N_ELEMENTS (results) + 1);
+
+  /* The ones on the shared list complete in order */
+  for (i = 0; i < G_N_ELEMENTS (results); i++)
+    g_assert_cmpint (g_array_index (order, gint, i), ==, i);
+  g_assert_cmpint (g_array_index (order, gint, i), ==, 3);
+
+  for (i = 0; i < G_N_ELEMENTS (results); i++)
+    ensure_destroyed (results[i]);
+  g_array_free (order, TRUE);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -102,6 +148,8 @@ main (int argc, char **argv)
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/gio/simple-async-result/test", test_simple_async);
+  g_test_add_func ("/gio/simple-async-result/complete-in-idle-batch",
+                   test_complete_in_idle_batch);
 
   return g_test_run();
 }
@@ -23,6 +23,9 @@
 #include <gio/gio.h>
 #include <gio/gunixinputstream.h>
 #include <gio/gunixoutputstream.h>
+#include <gio/gfiledescriptorbased.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -242,6 +245,467 @@ test_pipe_io (void)
   g_object_unref (out);
 }
 
+static GFile *
+splice_tmp_file (void)
+{
+  GFile *file;
+  char *path;
+  int fd;
+
+  fd = g_file_open_tmp ("unix-streams-XXXXXX", &path, NULL);
+  g_assert (fd != -1);
+  close (fd);
+  file = g_file_new_for_path (path);
+  g_free (path);
+
+  return file;
+}
+
+static void
+check_file_contents (GFile      *file,
+                     const char *data,
+                     gsize       length)
+{
+  char *contents;
+  gsize contents_length;
+  gboolean res;
+
+  res = g_file_load_contents (file, NULL, &contents, &contents_length, NULL, NULL);
+  g_assert (res);
+  g_assert_cmpint (contents_length, ==, length);
+  g_assert (memcmp (contents, data, length) == 0);
+  g_free (contents);
+}
+
+static gpointer
+splice_writer_thread (gpointer user_data)
+{
+  GOutputStream *out = user_data;
+  GError *err = NULL;
+  gboolean res;
+  int i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      res = g_output_stream_write_all (out, DATA, sizeof (DATA), NULL, NULL, &err);
+      g_assert_no_error (err);
+      g_assert (res);
+    }
+  g_output_stream_close (out, NULL, NULL);
+
+  return NULL;
+}
+
+static void
+test_splice (void)
+{
+  GFile *src_file, *dst_file;
+  GInputStream *in;
+  GOutputStream *out;
+  GThread *writer;
+  GError *err = NULL;
+  char *data;
+  gsize length;
+  gssize res;
+  int pipe_fds[2];
+  int i;
+
+  length = 256 * 1024 + 13;
+  data = g_malloc (length);
+  for (i = 0; i < length; i++)
+    data[i] = DATA[i % (sizeof (DATA) - 1)];
+
+  src_file = splice_tmp_file ();
+  dst_file = splice_tmp_file ();
+  g_file_replace_contents (src_file, data, length, NULL, FALSE,
+                           G_FILE_CREATE_NONE, NULL, NULL, &err);
+  g_assert_no_error (err);
+
+  /* file to file */
+  in = G_INPUT_STREAM (g_file_read (src_file, NULL, &err));
+  g_assert_no_error (err);
+  out = G_OUTPUT_STREAM (g_file_replace (dst_file, NULL, FALSE,
+                                         G_FILE_CREATE_NONE, NULL, &err));
+  g_assert_no_error (err);
+  g_assert (G_IS_FILE_DESCRIPTOR_BASED (in));
+  g_assert (G_IS_FILE_DESCRIPTOR_BASED (out));
+
+  res = g_output_stream_splice (out, in,
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (res, ==, length);
+  check_file_contents (dst_file, data, length);
+  g_object_unref (in);
+  g_object_unref (out);
+
+  /* pipe to file */
+  g_assert (pipe (pipe_fds) == 0);
+  in = g_unix_input_stream_new (pipe_fds[0], TRUE);
+  out = g_unix_output_stream_new (pipe_fds[1], TRUE);
+  writer = g_thread_create (splice_writer_thread, out, TRUE, NULL);
+
+  g_object_unref (dst_file);
+  dst_file = splice_tmp_file ();
+  out = G_OUTPUT_STREAM (g_file_replace (dst_file, NULL, FALSE,
+                                         G_FILE_CREATE_NONE, NULL, &err));
+  g_assert_no_error (err);
+  res = g_output_stream_splice (out, in,
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (res, ==, 1000 * sizeof (DATA));
+  g_thread_join (writer);
+  g_object_unref (in);
+  g_object_unref (out);
+
+  /* copied through memory, with a small buffer */
+  in = g_memory_input_stream_new_from_data (data, length, NULL);
+  out = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  g_assert_cmpint (g_output_stream_get_splice_buffer_size (out), ==, 64 * 1024);
+  g_output_stream_set_splice_buffer_size (out, 7);
+  g_assert_cmpint (g_output_stream_get_splice_buffer_size (out), ==, 7);
+  res = g_output_stream_splice (out, in, 0, NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (res, ==, length);
+  g_assert (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out)),
+                    data, length) == 0);
+  g_object_unref (in);
+  g_object_unref (out);
+
+  g_file_delete (src_file, NULL, NULL);
+  g_file_delete (dst_file, NULL, NULL);
+  g_object_unref (src_file);
+  g_object_unref (dst_file);
+  g_free (data);
+}
+
+static void
+async_done (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  GAsyncResult **result = user_data;
+
+  *result = g_object_ref (res);
+}
+
+static GFile *
+pipe_end_file (int fd)
+{
+  GFile *file;
+  char *path;
+
+  path = g_strdup_printf ("/dev/fd/%d", fd);
+  file = g_file_new_for_path (path);
+  g_free (path);
+
+  return file;
+}
+
+static void
+set_nonblocking (GObject *stream)
+{
+  int fd;
+
+  fd = g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream));
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void
+test_nonblocking_async (void)
+{
+  GFile *file;
+  GInputStream *in;
+  GOutputStream *out;
+  GCancellable *cancellable;
+  GAsyncResult *result;
+  GError *err = NULL;
+  char buffer[sizeof (DATA)];
+  char fill[4096];
+  gssize res;
+  int p[2];
+  int i;
+
+  if (!g_file_test ("/dev/fd", G_FILE_TEST_IS_DIR))
+    return;
+
+  g_assert (pipe (p) == 0);
+
+  /* Reopen both ends of the pipe as local file streams */
+  file = pipe_end_file (p[0]);
+  in = G_INPUT_STREAM (g_file_read (file, NULL, &err));
+  g_assert_no_error (err);
+  g_object_unref (file);
+
+  file = pipe_end_file (p[1]);
+  out = G_OUTPUT_STREAM (g_file_append_to (file, G_FILE_CREATE_NONE, NULL, &err));
+  g_assert_no_error (err);
+  g_object_unref (file);
+
+  set_nonblocking (G_OBJECT (in));
+  set_nonblocking (G_OBJECT (out));
+
+  /* The read waits for the pipe to become readable instead of
+   * failing with G_IO_ERROR_WOULD_BLOCK.
+   */
+  result = NULL;
+  g_input_stream_read_async (in, buffer, sizeof (buffer), G_PRIORITY_DEFAULT,
+                             NULL, async_done, &result);
+  for (i = 0; i < 10; i++)
+    g_main_context_iteration (NULL, FALSE);
+  g_assert (result == NULL);
+
+  g_assert_cmpint (write (p[1], DATA, sizeof (DATA)), ==, sizeof (DATA));
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  res = g_input_stream_read_finish (in, result, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (res, ==, sizeof (DATA));
+  g_assert (memcmp (buffer, DATA, sizeof (DATA)) == 0);
+  g_object_unref (result);
+
+  /* Cancelling wakes up a waiting read */
+  cancellable = g_cancellable_new ();
+  result = NULL;
+  g_input_stream_read_async (in, buffer, sizeof (buffer), G_PRIORITY_DEFAULT,
+                             cancellable, async_done, &result);
+  g_main_context_iteration (NULL, FALSE);
+  g_cancellable_cancel (cancellable);
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  res = g_input_stream_read_finish (in, result, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpint (res, ==, -1);
+  g_clear_error (&err);
+  g_object_unref (result);
+  g_object_unref (cancellable);
+
+  /* Fill the pipe, then the write waits for it to drain */
+  fcntl (p[1], F_SETFL, fcntl (p[1], F_GETFL) | O_NONBLOCK);
+  memset (fill, 'x', sizeof (fill));
+  while (write (p[1], fill, sizeof (fill)) > 0)
+    ;
+  g_assert_cmpint (errno, ==, EAGAIN);
+
+  result = NULL;
+  g_output_stream_write_async (out, DATA, sizeof (DATA), G_PRIORITY_DEFAULT,
+                               NULL, async_done, &result);
+  for (i = 0; i < 10; i++)
+    g_main_context_iteration (NULL, FALSE);
+  g_assert (result == NULL);
+
+  while (result == NULL)
+    {
+      read (p[0], fill, sizeof (fill));
+      g_main_context_iteration (NULL, FALSE);
+    }
+
+  res = g_output_stream_write_finish (out, result, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (res, ==, sizeof (DATA));
+  g_object_unref (result);
+
+  g_object_unref (in);
+  g_object_unref (out);
+  close (p[0]);
+  close (p[1]);
+}
+
+static void
+test_writev (void)
+{
+  GFile *file;
+  GOutputStream *base, *out;
+  GOutputVector vectors[2];
+  char *data;
+  gsize length, bytes_written;
+  GError *err = NULL;
+  gboolean res;
+  int p[2];
+  char buffer[sizeof (DATA) * 2];
+
+  /* A pipe gets both vectors in one write */
+  g_assert (pipe (p) == 0);
+  base = g_unix_output_stream_new (p[1], TRUE);
+  vectors[0].buffer = DATA;
+  vectors[0].size = sizeof (DATA);
+  vectors[1].buffer = DATA;
+  vectors[1].size = sizeof (DATA);
+  res = g_output_stream_writev (base, vectors, 2, &bytes_written, NULL, &err);
+  g_assert_no_error (err);
+  g_assert (res);
+  g_assert_cmpint (bytes_written, ==, sizeof (buffer));
+  g_assert_cmpint (read (p[0], buffer, sizeof (buffer)), ==, sizeof (buffer));
+  g_assert (memcmp (buffer, DATA, sizeof (DATA)) == 0);
+  g_assert (memcmp (buffer + sizeof (DATA), DATA, sizeof (DATA)) == 0);
+  g_object_unref (base);
+  close (p[0]);
+
+  /* A buffered local file flushes its buffer with large writes */
+  file = splice_tmp_file ();
+  base = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE,
+                                          NULL, &err));
+  g_assert_no_error (err);
+  out = g_buffered_output_stream_new_sized (base, 64);
+
+  length = 100000;
+  data = g_malloc (length);
+  memset (data, 'x', length);
+  memcpy (data, DATA, sizeof (DATA));
+
+  res = g_output_stream_write_all (out, data, 10, NULL, NULL, &err);
+  g_assert_no_error (err);
+  res = g_output_stream_write_all (out, data + 10, length - 10, NULL, NULL, &err);
+  g_assert_no_error (err);
+  g_assert (res);
+  g_output_stream_close (out, NULL, &err);
+  g_assert_no_error (err);
+
+  check_file_contents (file, data, length);
+
+  g_object_unref (out);
+  g_object_unref (base);
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+  g_free (data);
+}
+
+#define N_ASYNC_FILES 64
+
+typedef struct {
+  GFile *file;
+  GInputStream *in;
+  char buffer[64];
+  char *expected;
+  int *pending;
+} AsyncFileData;
+
+static void
+async_file_closed (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  AsyncFileData *data = user_data;
+  GError *err = NULL;
+  gboolean ret;
+
+  ret = g_input_stream_close_finish (G_INPUT_STREAM (source), res, &err);
+  g_assert_no_error (err);
+  g_assert (ret);
+
+  (*data->pending)--;
+}
+
+static void
+async_file_read (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  AsyncFileData *data = user_data;
+  GError *err = NULL;
+  gssize nread;
+
+  nread = g_input_stream_read_finish (G_INPUT_STREAM (source), res, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (nread, ==, strlen (data->expected));
+  g_assert (memcmp (data->buffer, data->expected, nread) == 0);
+
+  g_input_stream_close_async (data->in, G_PRIORITY_DEFAULT, NULL,
+                              async_file_closed, data);
+}
+
+static void
+async_file_opened (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  AsyncFileData *data = user_data;
+  GError *err = NULL;
+
+  data->in = G_INPUT_STREAM (g_file_read_finish (G_FILE (source), res, &err));
+  g_assert_no_error (err);
+
+  g_input_stream_read_async (data->in, data->buffer, sizeof (data->buffer),
+                             G_PRIORITY_DEFAULT, NULL, async_file_read, data);
+}
+
+static void
+async_file_written (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  AsyncFileData *data = user_data;
+  GError *err = NULL;
+  gssize written;
+
+  written = g_output_stream_write_finish (G_OUTPUT_STREAM (source), res, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (written, ==, strlen (data->expected));
+
+  (*data->pending)--;
+}
+
+static void
+test_local_file_async (void)
+{
+  AsyncFileData data[N_ASYNC_FILES];
+  GOutputStream *out[N_ASYNC_FILES];
+  GAsyncResult *result;
+  GFile *dir_file;
+  GError *err = NULL;
+  int pending;
+  int i;
+
+  /* Many small files written, opened, read and closed concurrently */
+  pending = N_ASYNC_FILES;
+  for (i = 0; i < N_ASYNC_FILES; i++)
+    {
+      data[i].file = splice_tmp_file ();
+      data[i].expected = g_strdup_printf ("file %d: " DATA, i);
+      data[i].pending = &pending;
+
+      out[i] = G_OUTPUT_STREAM (g_file_replace (data[i].file, NULL, FALSE,
+                                                G_FILE_CREATE_NONE, NULL, &err));
+      g_assert_no_error (err);
+      g_output_stream_write_async (out[i], data[i].expected,
+                                   strlen (data[i].expected),
+                                   G_PRIORITY_DEFAULT, NULL,
+                                   async_file_written, &data[i]);
+    }
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  for (i = 0; i < N_ASYNC_FILES; i++)
+    {
+      g_output_stream_close (out[i], NULL, &err);
+      g_assert_no_error (err);
+      g_object_unref (out[i]);
+    }
+
+  pending = N_ASYNC_FILES;
+  for (i = 0; i < N_ASYNC_FILES; i++)
+    g_file_read_async (data[i].file, G_PRIORITY_DEFAULT, NULL,
+                       async_file_opened, &data[i]);
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  for (i = 0; i < N_ASYNC_FILES; i++)
+    {
+      g_object_unref (data[i].in);
+      g_file_delete (data[i].file, NULL, NULL);
+      g_object_unref (data[i].file);
+      g_free (data[i].expected);
+    }
+
+  /* Opening a directory fails like the synchronous call does */
+  dir_file = g_file_new_for_path (g_get_tmp_dir ());
+  result = NULL;
+  g_file_read_async (dir_file, G_PRIORITY_DEFAULT, NULL, async_done, &result);
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (g_file_read_finish (dir_file, result, &err) == NULL);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_IS_DIRECTORY);
+  g_clear_error (&err);
+  g_object_unref (result);
+
+  g_object_unref (dir_file);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -251,6 +715,10 @@ main (int   argc,
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/unix-streams/pipe-io-test", test_pipe_io);
+  g_test_add_func ("/unix-streams/splice", test_splice);
+  g_test_add_func ("/unix-streams/nonblocking-async", test_nonblocking_async);
+  g_test_add_func ("/unix-streams/local-file-async", test_local_file_async);
+  g_test_add_func ("/unix-streams/writev", test_writev);
 
   return g_test_run();
 }
@@ -63,6 +63,8 @@ static void	g_enum_class_init		(GEnumClass	*class,
 						 gpointer	 class_data);
 static void	g_flags_class_init		(GFlagsClass	*class,
 						 gpointer	 class_data);
+static void	g_enum_flags_class_finalize	(GTypeClass	*class,
+						 gpointer	 class_data);
 static void	value_flags_enum_init		(GValue		*value);
 static void	value_flags_enum_copy_value	(const GValue	*src_value,
 						 GValue		*dest_value);
@@ -75,6 +77,30 @@ static gchar*	value_flags_enum_lcopy_value	(const GValue	*value,
 						 GTypeCValue    *collect_values,
 						 guint           collect_flags);
 
+
+/* --- lookup tables --- */
+/* classes with fewer values than this are searched linearly, building
+ * hash tables for them costs more than it saves
+ */
+#define	LOOKUP_MIN_VALUES	(8)
+/* a value range of at most LOOKUP_DENSE_FACTOR times n_values gets a
+ * value indexed table, sparser ranges get a value sorted array
+ */
+#define	LOOKUP_DENSE_FACTOR	(4)
+
+typedef struct
+{
+  GHashTable  *names;	/* value_name -> value struct */
+  GHashTable  *nicks;	/* value_nick -> value struct */
+  /* enums only */
+  gint	       base;	/* value of by_value[0] */
+  guint	       n_dense;	/* != 0 if by_value is value indexed */
+  guint	       n_sorted;	/* != 0 if by_value is sorted by value */
+  GEnumValue **by_value;
+} ValueLookup;
+
+static GQuark quark_value_lookup = 0;
+
 /* --- functions --- */
 void
 g_enum_types_init (void)
@@ -109,6 +135,8 @@ g_enum_types_init (void)
   
   g_return_if_fail (initialized == FALSE);
   initialized = TRUE;
+
+  quark_value_lookup = g_quark_from_static_string ("-g-enum-flags-value-lookup");
   
   /* G_TYPE_ENUM
    */
@@ -296,7 +324,7 @@ g_enum_complete_type_info (GType	     g_enum_type,
   info->base_init = NULL;
   info->base_finalize = NULL;
   info->class_init = (GClassInitFunc) g_enum_class_init;
-  info->class_finalize = NULL;
+  info->class_finalize = (GClassFinalizeFunc) g_enum_flags_class_finalize;
   info->class_data = const_values;
 }
 
@@ -325,10 +353,137 @@ g_flags_complete_type_info (GType	       g_flags_type,
   info->base_init = NULL;
   info->base_finalize = NULL;
   info->class_init = (GClassInitFunc) g_flags_class_init;
-  info->class_finalize = NULL;
+  info->class_finalize = (GClassFinalizeFunc) g_enum_flags_class_finalize;
   info->class_data = const_values;
 }
 
+static void
+value_lookup_free (gpointer data)
+{
+  ValueLookup *lookup = data;
+
+  g_hash_table_destroy (lookup->names);
+  g_hash_table_destroy (lookup->nicks);
+  g_free (lookup->by_value);
+  g_free (lookup);
+}
+
+static void
+value_lookup_add_names (ValueLookup *lookup,
+			gpointer     value_struct,
+			const gchar *value_name,
+			const gchar *value_nick)
+{
+  /* the linear lookups always returned the first match, so never
+   * replace an entry that is already present
+   */
+  if (!g_hash_table_lookup (lookup->names, value_name))
+    g_hash_table_insert (lookup->names, (gchar*) value_name, value_struct);
+  if (value_nick && !g_hash_table_lookup (lookup->nicks, value_nick))
+    g_hash_table_insert (lookup->nicks, (gchar*) value_nick, value_struct);
+}
+
+static ValueLookup*
+value_lookup_new (void)
+{
+  ValueLookup *lookup = g_new0 (ValueLookup, 1);
+
+  lookup->names = g_hash_table_new (g_str_hash, g_str_equal);
+  lookup->nicks = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return lookup;
+}
+
+static void
+value_lookup_install (GType        type,
+		      ValueLookup *lookup)
+{
+  ValueLookup *old_lookup = g_type_get_qdata (type, quark_value_lookup);
+
+  /* dynamic types may be reinitialized after their plugin got reloaded */
+  if (lookup || old_lookup)
+    g_type_set_qdata (type, quark_value_lookup, lookup);
+  if (old_lookup)
+    value_lookup_free (old_lookup);
+}
+
+static gint
+enum_values_cmp (gconstpointer a,
+		 gconstpointer b,
+		 gpointer      user_data)
+{
+  const GEnumValue *value1 = *(GEnumValue* const*) a;
+  const GEnumValue *value2 = *(GEnumValue* const*) b;
+
+  if (value1->value != value2->value)
+    return value1->value < value2->value ? -1 : 1;
+  /* keep duplicates in declaration order, g_enum_get_value() returns the first */
+  return value1 < value2 ? -1 : value1 > value2;
+}
+
+static void
+enum_lookup_setup (GEnumClass *class)
+{
+  ValueLookup *lookup;
+  GEnumValue *value;
+  guint64 range;
+  guint i;
+
+  if (class->n_values < LOOKUP_MIN_VALUES)
+    {
+      value_lookup_install (G_ENUM_CLASS_TYPE (class), NULL);
+      return;
+    }
+
+  lookup = value_lookup_new ();
+  for (value = class->values; value->value_name; value++)
+    value_lookup_add_names (lookup, value, value->value_name, value->value_nick);
+
+  range = (guint64) ((gint64) class->maximum - class->minimum) + 1;
+  if (range <= (guint64) class->n_values * LOOKUP_DENSE_FACTOR)
+    {
+      lookup->base = class->minimum;
+      lookup->n_dense = range;
+      lookup->by_value = g_new0 (GEnumValue*, lookup->n_dense);
+      for (value = class->values; value->value_name; value++)
+	{
+	  i = value->value - lookup->base;
+	  if (!lookup->by_value[i])
+	    lookup->by_value[i] = value;
+	}
+    }
+  else
+    {
+      lookup->n_sorted = class->n_values;
+      lookup->by_value = g_new (GEnumValue*, lookup->n_sorted);
+      for (i = 0; i < class->n_values; i++)
+	lookup->by_value[i] = class->values + i;
+      g_qsort_with_data (lookup->by_value, lookup->n_sorted, sizeof (GEnumValue*),
+			 enum_values_cmp, NULL);
+    }
+
+  value_lookup_install (G_ENUM_CLASS_TYPE (class), lookup);
+}
+
+static void
+flags_lookup_setup (GFlagsClass *class)
+{
+  ValueLookup *lookup;
+  GFlagsValue *value;
+
+  if (class->n_values < LOOKUP_MIN_VALUES)
+    {
+      value_lookup_install (G_FLAGS_CLASS_TYPE (class), NULL);
+      return;
+    }
+
+  lookup = value_lookup_new ();
+  for (value = class->values; value->value_name; value++)
+    value_lookup_add_names (lookup, value, value->value_name, value->value_nick);
+
+  value_lookup_install (G_FLAGS_CLASS_TYPE (class), lookup);
+}
+
 static void
 g_enum_class_init (GEnumClass *class,
 		   gpointer    class_data)
@@ -353,6 +508,8 @@ g_enum_class_init (GEnumClass *class,
 	  class->n_values++;
 	}
     }
+
+  enum_lookup_setup (class);
 }
 
 static void
@@ -375,6 +532,15 @@ g_flags_class_init (GFlagsClass *class,
 	  class->n_values++;
 	}
     }
+
+  flags_lookup_setup (class);
+}
+
+static void
+g_enum_flags_class_finalize (GTypeClass *class,
+			     gpointer    class_data)
+{
+  value_lookup_install (G_TYPE_FROM_CLASS (class), NULL);
 }
 
 /**
@@ -391,8 +557,15 @@ GEnumValue*
 g_enum_get_value_by_name (GEnumClass  *enum_class,
 			  const gchar *name)
 {
+  ValueLookup *lookup;
+
   g_return_val_if_fail (G_IS_ENUM_CLASS (enum_class), NULL);
   g_return_val_if_fail (name != NULL, NULL);
+
+  lookup = enum_class->n_values >= LOOKUP_MIN_VALUES ?
+    g_type_get_qdata (G_ENUM_CLASS_TYPE (enum_class), quark_value_lookup) : NULL;
+  if (lookup)
+    return g_hash_table_lookup (lookup->names, name);
   
   if (enum_class->n_values)
     {
@@ -420,8 +593,15 @@ GFlagsValue*
 g_flags_get_value_by_name (GFlagsClass *flags_class,
 			   const gchar *name)
 {
+  ValueLookup *lookup;
+
   g_return_val_if_fail (G_IS_FLAGS_CLASS (flags_class), NULL);
   g_return_val_if_fail (name != NULL, NULL);
+
+  lookup = flags_class->n_values >= LOOKUP_MIN_VALUES ?
+    g_type_get_qdata (G_FLAGS_CLASS_TYPE (flags_class), quark_value_lookup) : NULL;
+  if (lookup)
+    return g_hash_table_lookup (lookup->names, name);
   
   if (flags_class->n_values)
     {
@@ -449,8 +629,15 @@ GEnumValue*
 g_enum_get_value_by_nick (GEnumClass  *enum_class,
 			  const gchar *nick)
 {
+  ValueLookup *lookup;
+
   g_return_val_if_fail (G_IS_ENUM_CLASS (enum_class), NULL);
   g_return_val_if_fail (nick != NULL, NULL);
+
+  lookup = enum_class->n_values >= LOOKUP_MIN_VALUES ?
+    g_type_get_qdata (G_ENUM_CLASS_TYPE (enum_class), quark_value_lookup) : NULL;
+  if (lookup)
+    return g_hash_table_lookup (lookup->nicks, nick);
   
   if (enum_class->n_values)
     {
@@ -478,8 +665,15 @@ GFlagsValue*
 g_flags_get_value_by_nick (GFlagsClass *flags_class,
 			   const gchar *nick)
 {
+  ValueLookup *lookup;
+
   g_return_val_if_fail (G_IS_FLAGS_CLASS (flags_class), NULL);
   g_return_val_if_fail (nick != NULL, NULL);
+
+  lookup = flags_class->n_values >= LOOKUP_MIN_VALUES ?
+    g_type_get_qdata (G_FLAGS_CLASS_TYPE (flags_class), quark_value_lookup) : NULL;
+  if (lookup)
+    return g_hash_table_lookup (lookup->nicks, nick);
   
   if (flags_class->n_values)
     {
@@ -507,7 +701,36 @@ GEnumValue*
 g_enum_get_value (GEnumClass *enum_class,
 		  gint	      value)
 {
+  ValueLookup *lookup;
+
   g_return_val_if_fail (G_IS_ENUM_CLASS (enum_class), NULL);
+
+  lookup = enum_class->n_values >= LOOKUP_MIN_VALUES ?
+    g_type_get_qdata (G_ENUM_CLASS_TYPE (enum_class), quark_value_lookup) : NULL;
+  if (lookup && lookup->n_dense)
+    {
+      if (value < enum_class->minimum || value > enum_class->maximum)
+	return NULL;
+      return lookup->by_value[(guint) (value - lookup->base)];
+    }
+  else if (lookup)
+    {
+      guint lo = 0, hi = lookup->n_sorted;
+
+      /* find the first entry >= value */
+      while (lo < hi)
+	{
+	  guint mid = lo + (hi - lo) / 2;
+
+	  if (lookup->by_value[mid]->value < value)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+      if (lo < lookup->n_sorted && lookup->by_value[lo]->value == value)
+	return lookup->by_value[lo];
+      return NULL;
+    }
   
   if (enum_class->n_values)
     {
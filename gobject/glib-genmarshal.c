@@ -122,6 +122,8 @@ static FILE             *fout = NULL;
 static gboolean		 gen_cheader = FALSE;
 static gboolean		 gen_cbody = FALSE;
 static gboolean          gen_internal = FALSE;
+static gboolean          gen_direct = FALSE;
+static gboolean          gen_emitters = FALSE;
 static gboolean		 skip_ploc = FALSE;
 static gboolean		 std_includes = TRUE;
 static gint              exit_status = 0;
@@ -319,6 +321,234 @@ indent (guint n_spaces)
   return buffer;
 }
 
+static const gchar*
+valist_ctype (const gchar *ctype)
+{
+  /* types that undergo default argument promotion when passed through "..." */
+  if (strcmp (ctype, "gboolean") == 0 ||
+      strcmp (ctype, "gchar") == 0 ||
+      strcmp (ctype, "guchar") == 0)
+    return "gint";
+  if (strcmp (ctype, "gfloat") == 0)
+    return "gdouble";
+  return ctype;
+}
+
+static void
+put_marshal_func_typedef (const gchar *signame,
+			  Signature   *sig)
+{
+  GList *node;
+  guint ind, a;
+
+  ind = g_fprintf (fout, "  typedef %s (*GMarshalFunc_%s) (", sig->rarg->ctype, signame);
+  g_fprintf (fout, "%s data1,\n", pad ("gpointer"));
+  for (a = 1, node = sig->args; node; node = node->next)
+    {
+      InArgument *iarg = node->data;
+
+      if (iarg->getter)
+	g_fprintf (fout, "%s%s arg_%d,\n", indent (ind), pad (iarg->ctype), a++);
+    }
+  g_fprintf (fout, "%s%s data2);\n", indent (ind), pad ("gpointer"));
+}
+
+static void
+put_closure_data_setup (const gchar *signame)
+{
+  g_fprintf (fout, "  if (G_CCLOSURE_SWAP_DATA (closure))\n    {\n");
+  g_fprintf (fout, "      data1 = closure->data;\n");
+  g_fprintf (fout, "      data2 = instance;\n");
+  g_fprintf (fout, "    }\n  else\n    {\n");
+  g_fprintf (fout, "      data1 = instance;\n");
+  g_fprintf (fout, "      data2 = closure->data;\n");
+  g_fprintf (fout, "    }\n");
+  g_fprintf (fout, "  callback = (GMarshalFunc_%s) cc->callback;\n", signame);
+}
+
+/* direct-call trampolines: invoke the callback of a GCClosure with
+ * native C arguments, either passed explicitly or from a va_list,
+ * without boxing them into GValues
+ */
+static void
+generate_direct (const gchar *signame,
+		 Signature   *sig)
+{
+  guint ind, a;
+  GList *node;
+
+  if (gen_cheader)
+    {
+      ind = g_fprintf (fout, gen_internal ? "G_GNUC_INTERNAL " : "extern ");
+      ind += g_fprintf (fout, "%s ", sig->rarg->ctype);
+      ind += g_fprintf (fout, "%s_%s_direct (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s closure,\n", pad ("GClosure*"));
+      g_fprintf (fout, "%s%s instance", indent (ind), pad ("gpointer"));
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, ",\n%s%s arg_%d", indent (ind), pad (iarg->ctype), a++);
+	}
+      g_fprintf (fout, ");\n");
+
+      ind = g_fprintf (fout, gen_internal ? "G_GNUC_INTERNAL " : "extern ");
+      ind += g_fprintf (fout, "%s ", sig->rarg->ctype);
+      ind += g_fprintf (fout, "%s_%s_valist (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s closure,\n", pad ("GClosure*"));
+      g_fprintf (fout, "%s%s instance,\n", indent (ind), pad ("gpointer"));
+      g_fprintf (fout, "%s%s args);\n", indent (ind), pad ("va_list"));
+    }
+  if (gen_cbody)
+    {
+      /* native arguments */
+      g_fprintf (fout, "\n%s\n", sig->rarg->ctype);
+      ind = g_fprintf (fout, "%s_%s_direct (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s closure,\n", pad ("GClosure*"));
+      g_fprintf (fout, "%s%s instance", indent (ind), pad ("gpointer"));
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, ",\n%s%s arg_%d", indent (ind), pad (iarg->ctype), a++);
+	}
+      g_fprintf (fout, ")\n{\n");
+      put_marshal_func_typedef (signame, sig);
+      g_fprintf (fout, "  register GMarshalFunc_%s callback;\n", signame);
+      g_fprintf (fout, "  register GCClosure *cc = (GCClosure*) closure;\n");
+      g_fprintf (fout, "  register gpointer data1, data2;\n");
+      g_fprintf (fout, "\n");
+      put_closure_data_setup (signame);
+      g_fprintf (fout, "\n");
+      ind = g_fprintf (fout, "  %scallback (", sig->rarg->setter ? "return " : "");
+      g_fprintf (fout, "data1,\n");
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    {
+	      g_fprintf (fout, "%sarg_%d,\n", indent (ind), a);
+	      a++;
+	    }
+	}
+      g_fprintf (fout, "%sdata2);\n", indent (ind));
+      g_fprintf (fout, "}\n");
+
+      /* va_list arguments */
+      g_fprintf (fout, "\n%s\n", sig->rarg->ctype);
+      ind = g_fprintf (fout, "%s_%s_valist (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s closure,\n", pad ("GClosure*"));
+      g_fprintf (fout, "%s%s instance,\n", indent (ind), pad ("gpointer"));
+      g_fprintf (fout, "%s%s args)\n{\n", indent (ind), pad ("va_list"));
+      put_marshal_func_typedef (signame, sig);
+      g_fprintf (fout, "  register GMarshalFunc_%s callback;\n", signame);
+      g_fprintf (fout, "  register GCClosure *cc = (GCClosure*) closure;\n");
+      g_fprintf (fout, "  register gpointer data1, data2;\n");
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, "  %s arg_%d;\n", pad (iarg->ctype), a++);
+	}
+      g_fprintf (fout, "\n");
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    {
+	      g_fprintf (fout, "  arg_%d = (%s) va_arg (args, %s);\n",
+			 a, iarg->ctype, valist_ctype (iarg->ctype));
+	      a++;
+	    }
+	}
+      if (a > 1)
+	g_fprintf (fout, "\n");
+      put_closure_data_setup (signame);
+      g_fprintf (fout, "\n");
+      ind = g_fprintf (fout, "  %scallback (", sig->rarg->setter ? "return " : "");
+      g_fprintf (fout, "data1,\n");
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    {
+	      g_fprintf (fout, "%sarg_%d,\n", indent (ind), a);
+	      a++;
+	    }
+	}
+      g_fprintf (fout, "%sdata2);\n", indent (ind));
+      g_fprintf (fout, "}\n");
+    }
+}
+
+/* typed emission wrappers around g_signal_emit(), so the compiler
+ * checks the number and types of the arguments passed for a signal
+ */
+static void
+generate_emitter (const gchar *signame,
+		  Signature   *sig)
+{
+  guint ind, a;
+  GList *node;
+
+  if (gen_cheader)
+    {
+      ind = g_fprintf (fout, gen_internal ? "G_GNUC_INTERNAL " : "extern ");
+      ind += g_fprintf (fout, "%s ", sig->rarg->ctype);
+      ind += g_fprintf (fout, "%s_emit_%s (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s instance,\n", pad ("gpointer"));
+      g_fprintf (fout, "%s%s signal_id,\n", indent (ind), pad ("guint"));
+      g_fprintf (fout, "%s%s detail", indent (ind), pad ("GQuark"));
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, ",\n%s%s arg_%d", indent (ind), pad (iarg->ctype), a++);
+	}
+      g_fprintf (fout, ");\n");
+    }
+  if (gen_cbody)
+    {
+      g_fprintf (fout, "\n%s\n", sig->rarg->ctype);
+      ind = g_fprintf (fout, "%s_emit_%s (", marshaller_prefix, signame);
+      g_fprintf (fout, "%s instance,\n", pad ("gpointer"));
+      g_fprintf (fout, "%s%s signal_id,\n", indent (ind), pad ("guint"));
+      g_fprintf (fout, "%s%s detail", indent (ind), pad ("GQuark"));
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, ",\n%s%s arg_%d", indent (ind), pad (iarg->ctype), a++);
+	}
+      g_fprintf (fout, ")\n{\n");
+      if (sig->rarg->setter)
+	g_fprintf (fout, "  %s v_return = 0;\n\n", sig->rarg->ctype);
+      ind = g_fprintf (fout, "  g_signal_emit (");
+      g_fprintf (fout, "instance, signal_id, detail");
+      for (a = 1, node = sig->args; node; node = node->next)
+	{
+	  InArgument *iarg = node->data;
+
+	  if (iarg->getter)
+	    g_fprintf (fout, ",\n%sarg_%d", indent (ind), a++);
+	}
+      if (sig->rarg->setter)
+	g_fprintf (fout, ",\n%s&v_return", indent (ind));
+      g_fprintf (fout, ");\n");
+      if (sig->rarg->setter)
+	g_fprintf (fout, "\n  return v_return;\n");
+      g_fprintf (fout, "}\n");
+    }
+}
+
 static void
 generate_marshal (const gchar *signame,
 		  Signature   *sig)
@@ -384,16 +614,7 @@ generate_marshal (const gchar *signame,
       g_fprintf (fout, "{\n");
 
       /* cfile GMarshalFunc typedef */
-      ind = g_fprintf (fout, "  typedef %s (*GMarshalFunc_%s) (", sig->rarg->ctype, signame);
-      g_fprintf (fout, "%s data1,\n", pad ("gpointer"));
-      for (a = 1, node = sig->args; node; node = node->next)
-	{
-	  InArgument *iarg = node->data;
-
-	  if (iarg->getter)
-	    g_fprintf (fout, "%s%s arg_%d,\n", indent (ind), pad (iarg->ctype), a++);
-	}
-      g_fprintf (fout, "%s%s data2);\n", indent (ind), pad ("gpointer"));
+      put_marshal_func_typedef (signame, sig);
 
       /* cfile marshal variables */
       g_fprintf (fout, "  register GMarshalFunc_%s callback;\n", signame);
@@ -455,6 +676,14 @@ generate_marshal (const gchar *signame,
       /* cfile marshal footer */
       g_fprintf (fout, "}\n");
     }
+
+  /* the standard marshallers come without these, so they are
+   * generated regardless of have_std_marshaller
+   */
+  if (gen_direct)
+    generate_direct (signame, sig);
+  if (gen_emitters)
+    generate_emitter (signame, sig);
 }
 
 static void
@@ -519,6 +748,18 @@ process_signature (Signature *sig)
     {
       g_fprintf (fout, "#define %s_%s\t%s_%s\n", marshaller_prefix, pname, marshaller_prefix, sname);
 
+      /* and for the functions generated along with it */
+      if (gen_direct)
+	{
+	  g_fprintf (fout, "#define %s_%s_direct\t%s_%s_direct\n",
+		     marshaller_prefix, pname, marshaller_prefix, sname);
+	  g_fprintf (fout, "#define %s_%s_valist\t%s_%s_valist\n",
+		     marshaller_prefix, pname, marshaller_prefix, sname);
+	}
+      if (gen_emitters)
+	g_fprintf (fout, "#define %s_emit_%s\t%s_emit_%s\n",
+		   marshaller_prefix, pname, marshaller_prefix, sname);
+
       g_hash_table_insert (marshallers, tmp, tmp);
     }
   else
@@ -798,6 +1039,16 @@ parse_args (gint    *argc_p,
 	  gen_internal = TRUE;
 	  argv[i] = NULL;
 	}
+      else if (strcmp ("--direct", argv[i]) == 0)
+	{
+	  gen_direct = TRUE;
+	  argv[i] = NULL;
+	}
+      else if (strcmp ("--emitters", argv[i]) == 0)
+	{
+	  gen_emitters = TRUE;
+	  argv[i] = NULL;
+	}
       else if ((strcmp ("--prefix", argv[i]) == 0) ||
 	       (strncmp ("--prefix=", argv[i], 9) == 0))
 	{
@@ -886,6 +1137,8 @@ print_blurb (FILE    *bout,
       g_fprintf (bout, "  --skip-source              Skip source location comments\n");
       g_fprintf (bout, "  --stdinc, --nostdinc       Include/use standard marshallers\n");
       g_fprintf (bout, "  --internal                 Mark generated functions as internal\n");
+      g_fprintf (bout, "  --direct                   Generate direct-call and va_list trampolines\n");
+      g_fprintf (bout, "  --emitters                 Generate typed g_signal_emit() wrappers\n");
       g_fprintf (bout, "  -v, --version              Print version informations\n");
       g_fprintf (bout, "  --g-fatal-warnings         Make warnings fatal (abort)\n");
     }
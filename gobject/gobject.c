@@ -172,6 +172,8 @@ static inline void	   object_set_property		(GObject        *object,
 							 GObjectNotifyQueue *nqueue);
 static guint               object_floating_flag_handler (GObject        *object,
                                                          gint            job);
+static void                toggle_refs_notify           (GObject        *object,
+                                                         gboolean        is_last_ref);
 
 static void object_interface_check_properties           (gpointer        func_data,
 							 gpointer        g_iface);
@@ -181,11 +183,15 @@ static void object_interface_check_properties           (gpointer        func_da
 static GQuark	            quark_closure_array = 0;
 static GQuark	            quark_weak_refs = 0;
 static GQuark	            quark_toggle_refs = 0;
+static GQuark	            quark_weak_locations = 0;
+static GQuark	            quark_property_redirects = 0;
 static GParamSpecPool      *pspec_pool = NULL;
 static GObjectNotifyContext property_notify_context = { 0, };
 static gulong	            gobject_signals[LAST_SIGNAL] = { 0, };
 static guint (*floating_flag_handler) (GObject*, gint) = object_floating_flag_handler;
 G_LOCK_DEFINE_STATIC (construction_mutex);
+G_LOCK_DEFINE_STATIC (property_redirects);
+static GStaticRWLock        weak_locations_lock = G_STATIC_RW_LOCK_INIT;
 static GSList *construction_objects = NULL;
 
 /* --- functions --- */
@@ -286,10 +292,18 @@ g_object_base_class_init (GObjectClass *class)
 static void
 g_object_base_class_finalize (GObjectClass *class)
 {
+  GHashTable *redirects;
   GList *list, *node;
   
   _g_signals_destroy (G_OBJECT_CLASS_TYPE (class));
 
+  redirects = g_type_get_qdata (G_OBJECT_CLASS_TYPE (class), quark_property_redirects);
+  if (redirects)
+    {
+      g_type_set_qdata (G_OBJECT_CLASS_TYPE (class), quark_property_redirects, NULL);
+      g_hash_table_destroy (redirects);
+    }
+
   g_slist_free (class->construct_properties);
   class->construct_properties = NULL;
   list = g_param_spec_pool_list_owned (pspec_pool, G_OBJECT_CLASS_TYPE (class));
@@ -320,6 +334,8 @@ g_object_do_class_init (GObjectClass *class)
 
   quark_weak_refs = g_quark_from_static_string ("GObject-weak-references");
   quark_toggle_refs = g_quark_from_static_string ("GObject-toggle-references");
+  quark_weak_locations = g_quark_from_static_string ("GObject-weak-locations");
+  quark_property_redirects = g_quark_from_static_string ("GObject-property-redirects");
   pspec_pool = g_param_spec_pool_new (TRUE);
   property_notify_context.quark_notify_queue = g_quark_from_static_string ("GObject-notify-queue");
   property_notify_context.dispatcher = g_object_notify_dispatcher;
@@ -1713,6 +1729,260 @@ g_object_get_property (GObject	   *object,
   g_object_unref (object);
 }
 
+/* g_object_class_find_property() and g_object_class_list_properties()
+ * hand out the redirect targets of overridden properties, while setting
+ * and getting has to go through the spec installed on the implementing
+ * class. To avoid a lookup by name for each property, every class gets
+ * a table mapping the specs visible to the application to the specs
+ * actually installed, for those that differ. Properties can only be
+ * installed during class initialization, so once built the table never
+ * changes.
+ */
+static void
+property_redirects_add (GHashTable *redirects,
+			GType       type,
+			GList      *list)
+{
+  GList *node;
+
+  for (node = list; node; node = node->next)
+    {
+      GParamSpec *pspec = node->data;
+      GParamSpec *installed, *redirect;
+
+      installed = g_param_spec_pool_lookup (pspec_pool, pspec->name, type, TRUE);
+      if (installed && installed != pspec)
+	g_hash_table_insert (redirects, pspec, installed);
+      redirect = g_param_spec_get_redirect_target (pspec);
+      if (installed && redirect && redirect != installed &&
+	  !g_hash_table_lookup (redirects, redirect))
+	g_hash_table_insert (redirects, redirect, installed);
+    }
+  g_list_free (list);
+}
+
+static GHashTable*
+object_class_get_property_redirects (GObjectClass *class)
+{
+  GType type = G_OBJECT_CLASS_TYPE (class);
+  GHashTable *redirects;
+
+  redirects = g_type_get_qdata (type, quark_property_redirects);
+  if (G_LIKELY (redirects))
+    return redirects;
+
+  G_LOCK (property_redirects);
+  redirects = g_type_get_qdata (type, quark_property_redirects);
+  if (!redirects)
+    {
+      GType *ifaces, ancestor;
+      guint i, n_ifaces;
+
+      redirects = g_hash_table_new (NULL, NULL);
+      for (ancestor = type; ancestor; ancestor = g_type_parent (ancestor))
+	property_redirects_add (redirects, type,
+				g_param_spec_pool_list_owned (pspec_pool, ancestor));
+      ifaces = g_type_interfaces (type, &n_ifaces);
+      for (i = 0; i < n_ifaces; i++)
+	property_redirects_add (redirects, type,
+				g_param_spec_pool_list_owned (pspec_pool, ifaces[i]));
+      g_free (ifaces);
+      g_type_set_qdata (type, quark_property_redirects, redirects);
+    }
+  G_UNLOCK (property_redirects);
+
+  return redirects;
+}
+
+static inline GParamSpec*
+object_resolve_pspec (GObject    *object,
+		      GHashTable *redirects,
+		      GParamSpec *pspec)
+{
+  GParamSpec *installed;
+
+  if (!G_IS_PARAM_SPEC (pspec) ||
+      !g_type_is_a (G_OBJECT_TYPE (object), pspec->owner_type))
+    return NULL;
+  installed = g_hash_table_lookup (redirects, pspec);
+
+  return installed ? installed : pspec;
+}
+
+/**
+ * g_object_set_properties:
+ * @object: a #GObject
+ * @n_properties: the number of properties to set
+ * @pspecs: the #GParamSpec<!-- -->s of the properties to set, as
+ *  returned by g_object_class_find_property() or
+ *  g_object_class_list_properties()
+ * @values: the @n_properties values to set
+ *
+ * Sets several properties on an object at once. This works like calling
+ * g_object_set_property() for each property in turn, but avoids looking
+ * up the properties by name and emits the resulting
+ * #GObject::notify signals only once all properties have been set.
+ *
+ * All properties are checked before any of them is set: if one of them
+ * does not belong to @object, cannot be written, or has a value that
+ * cannot be converted to its type, a warning is printed and @object is
+ * left unchanged.
+ *
+ * Since: 2.22
+ */
+void
+g_object_set_properties (GObject	 *object,
+			 guint		  n_properties,
+			 GParamSpec	**pspecs,
+			 const GValue	 *values)
+{
+  GObjectNotifyQueue *nqueue;
+  GHashTable *redirects;
+  GParamSpec **installed;
+  guint i;
+
+  g_return_if_fail (G_IS_OBJECT (object));
+  g_return_if_fail (n_properties == 0 || pspecs != NULL);
+  g_return_if_fail (n_properties == 0 || values != NULL);
+
+  g_object_ref (object);
+  redirects = object_class_get_property_redirects (G_OBJECT_GET_CLASS (object));
+  installed = g_new (GParamSpec*, n_properties);
+
+  /* check everything first, so that an invalid property sets nothing */
+  for (i = 0; i < n_properties; i++)
+    {
+      GParamSpec *pspec = object_resolve_pspec (object, redirects, pspecs[i]);
+
+      if (!pspec)
+	{
+	  g_warning ("%s: invalid property %u for object class `%s'",
+		     G_STRFUNC,
+		     i,
+		     G_OBJECT_TYPE_NAME (object));
+	  goto out;
+	}
+      if (!(pspec->flags & G_PARAM_WRITABLE))
+	{
+	  g_warning ("%s: property `%s' of object class `%s' is not writable",
+		     G_STRFUNC,
+		     pspec->name,
+		     G_OBJECT_TYPE_NAME (object));
+	  goto out;
+	}
+      if ((pspec->flags & G_PARAM_CONSTRUCT_ONLY) && !object_in_construction_list (object))
+        {
+          g_warning ("%s: construct property \"%s\" for object `%s' can't be set after construction",
+                     G_STRFUNC, pspec->name, G_OBJECT_TYPE_NAME (object));
+          goto out;
+        }
+      if (!g_value_type_transformable (G_VALUE_TYPE (&values[i]), G_PARAM_SPEC_VALUE_TYPE (pspec)))
+	{
+	  g_warning ("%s: can't set property `%s' of type `%s' from value of type `%s'",
+		     G_STRFUNC, pspec->name,
+		     g_type_name (G_PARAM_SPEC_VALUE_TYPE (pspec)),
+		     G_VALUE_TYPE_NAME (&values[i]));
+	  goto out;
+	}
+      installed[i] = pspec;
+    }
+
+  nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
+  for (i = 0; i < n_properties; i++)
+    object_set_property (object, installed[i], &values[i], nqueue);
+  g_object_notify_queue_thaw (object, nqueue);
+
+ out:
+  g_free (installed);
+  g_object_unref (object);
+}
+
+/**
+ * g_object_get_properties:
+ * @object: a #GObject
+ * @n_properties: the number of properties to get
+ * @pspecs: the #GParamSpec<!-- -->s of the properties to get, as
+ *  returned by g_object_class_find_property() or
+ *  g_object_class_list_properties()
+ * @values: @n_properties return locations for the property values
+ *
+ * Gets several properties of an object at once, without looking them
+ * up by name.
+ *
+ * Each of @values may either be zero-filled, in which case it is
+ * initialized to the type of its property, or already be initialized
+ * to a type the property can be converted to, as with
+ * g_object_get_property(). The caller is responsible for calling
+ * g_value_unset() on the returned values.
+ *
+ * Since: 2.22
+ */
+void
+g_object_get_properties (GObject	 *object,
+			 guint		  n_properties,
+			 GParamSpec	**pspecs,
+			 GValue		 *values)
+{
+  GHashTable *redirects;
+  guint i;
+
+  g_return_if_fail (G_IS_OBJECT (object));
+  g_return_if_fail (n_properties == 0 || pspecs != NULL);
+  g_return_if_fail (n_properties == 0 || values != NULL);
+
+  g_object_ref (object);
+  redirects = object_class_get_property_redirects (G_OBJECT_GET_CLASS (object));
+
+  for (i = 0; i < n_properties; i++)
+    {
+      GParamSpec *pspec = object_resolve_pspec (object, redirects, pspecs[i]);
+      GValue *value = &values[i];
+      GValue tmp_value = { 0, };
+
+      if (!pspec)
+	{
+	  g_warning ("%s: invalid property %u for object class `%s'",
+		     G_STRFUNC,
+		     i,
+		     G_OBJECT_TYPE_NAME (object));
+	  break;
+	}
+      if (!(pspec->flags & G_PARAM_READABLE))
+	{
+	  g_warning ("%s: property `%s' of object class `%s' is not readable",
+		     G_STRFUNC,
+		     pspec->name,
+		     G_OBJECT_TYPE_NAME (object));
+	  break;
+	}
+
+      if (G_VALUE_TYPE (value) == 0)
+	g_value_init (value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+      else if (G_VALUE_TYPE (value) == G_PARAM_SPEC_VALUE_TYPE (pspec))
+	g_value_reset (value);
+      else if (g_value_type_transformable (G_PARAM_SPEC_VALUE_TYPE (pspec), G_VALUE_TYPE (value)))
+	{
+	  g_value_init (&tmp_value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+	  object_get_property (object, pspec, &tmp_value);
+	  g_value_transform (&tmp_value, value);
+	  g_value_unset (&tmp_value);
+	  continue;
+	}
+      else
+	{
+	  g_warning ("%s: can't retrieve property `%s' of type `%s' as value of type `%s'",
+		     G_STRFUNC, pspec->name,
+		     g_type_name (G_PARAM_SPEC_VALUE_TYPE (pspec)),
+		     G_VALUE_TYPE_NAME (value));
+	  break;
+	}
+
+      object_get_property (object, pspec, value);
+    }
+
+  g_object_unref (object);
+}
+
 /**
  * g_object_connect:
  * @object: a #GObject
@@ -1931,12 +2201,17 @@ g_object_disconnect (gpointer     _object,
 typedef struct {
   GObject *object;
   guint n_weak_refs;
+  guint n_allocated;
   struct {
     GWeakNotify notify;
     gpointer    data;
   } weak_refs[1];  /* flexible array */
 } WeakRefStack;
 
+#define WEAK_REF_STACK_PREALLOC         (4)
+#define WEAK_REF_STACK_SIZE(n_allocated) \
+  (sizeof (WeakRefStack) + sizeof (((WeakRefStack*) 0)->weak_refs[0]) * ((n_allocated) - 1))
+
 static void
 weak_refs_notify (gpointer data)
 {
@@ -1972,17 +2247,32 @@ g_object_weak_ref (GObject    *object,
   g_return_if_fail (notify != NULL);
   g_return_if_fail (object->ref_count >= 1);
 
+  /* fast path: append into the spare room left by a previous resize,
+   * without having to re-register the stack with the datalist
+   */
+  wstack = g_datalist_id_get_data (&object->qdata, quark_weak_refs);
+  if (wstack && wstack->n_weak_refs < wstack->n_allocated)
+    {
+      i = wstack->n_weak_refs++;
+      wstack->weak_refs[i].notify = notify;
+      wstack->weak_refs[i].data = data;
+      return;
+    }
+
+  /* grow geometrically, so adding n weak refs costs O(n) overall */
   wstack = g_datalist_id_remove_no_notify (&object->qdata, quark_weak_refs);
   if (wstack)
     {
       i = wstack->n_weak_refs++;
-      wstack = g_realloc (wstack, sizeof (*wstack) + sizeof (wstack->weak_refs[0]) * i);
+      wstack->n_allocated *= 2;
+      wstack = g_realloc (wstack, WEAK_REF_STACK_SIZE (wstack->n_allocated));
     }
   else
     {
-      wstack = g_renew (WeakRefStack, NULL, 1);
+      wstack = g_malloc (WEAK_REF_STACK_SIZE (WEAK_REF_STACK_PREALLOC));
       wstack->object = object;
       wstack->n_weak_refs = 1;
+      wstack->n_allocated = WEAK_REF_STACK_PREALLOC;
       i = 0;
     }
   wstack->weak_refs[i].notify = notify;
@@ -2073,6 +2363,288 @@ g_object_remove_weak_pointer (GObject  *object,
                        weak_pointer_location);
 }
 
+/* GWeakRef locations registered on an object are kept in a list hanging
+ * off the object's qdata; each GWeakRef remembers its own link, so that
+ * setting or clearing a reference never needs to search the list.
+ * All reads and writes of GWeakRef contents happen under
+ * weak_locations_lock, which g_object_unref() also takes (for writing)
+ * to atomically clear the locations before the object gets disposed.
+ */
+typedef struct {
+  GList *list;
+} WeakLocations;
+
+static void
+weak_locations_free (gpointer data)
+{
+  WeakLocations *locations = data;
+  GList *node;
+
+  /* only reached if the object gets finalized behind our back,
+   * e.g. via g_type_free_instance() without going through unref
+   */
+  g_static_rw_lock_writer_lock (&weak_locations_lock);
+  for (node = locations->list; node; node = node->next)
+    {
+      GWeakRef *weak_ref = node->data;
+
+      weak_ref->object = NULL;
+      weak_ref->link = NULL;
+    }
+  g_list_free (locations->list);
+  g_static_rw_lock_writer_unlock (&weak_locations_lock);
+  g_slice_free (WeakLocations, locations);
+}
+
+/* called with weak_locations_lock held for writing */
+static void
+weak_ref_set_unlocked (GWeakRef *weak_ref,
+                       GObject  *new_object)
+{
+  GObject *old_object = weak_ref->object;
+  WeakLocations *locations;
+
+  if (old_object == new_object)
+    return;
+
+  if (old_object)
+    {
+      locations = g_datalist_id_get_data (&old_object->qdata, quark_weak_locations);
+      locations->list = g_list_delete_link (locations->list, weak_ref->link);
+      weak_ref->link = NULL;
+    }
+
+  weak_ref->object = new_object;
+
+  if (new_object)
+    {
+      locations = g_datalist_id_get_data (&new_object->qdata, quark_weak_locations);
+      if (!locations)
+        {
+          locations = g_slice_new (WeakLocations);
+          locations->list = NULL;
+          g_datalist_id_set_data_full (&new_object->qdata, quark_weak_locations,
+                                       locations, weak_locations_free);
+        }
+      locations->list = g_list_prepend (locations->list, weak_ref);
+      weak_ref->link = locations->list;
+    }
+}
+
+/* called with weak_locations_lock held for writing */
+static void
+weak_locations_clear_unlocked (WeakLocations *locations)
+{
+  GList *node;
+
+  for (node = locations->list; node; node = node->next)
+    {
+      GWeakRef *weak_ref = node->data;
+
+      weak_ref->object = NULL;
+      weak_ref->link = NULL;
+    }
+  g_list_free (locations->list);
+  locations->list = NULL;
+}
+
+/* called from g_object_unref() when the last reference is about to be
+ * dropped; returns %FALSE if the object was re-referenced through a
+ * weak reference meanwhile and disposal has to be retried
+ */
+static gboolean
+weak_locations_clear (GObject *object)
+{
+  WeakLocations *locations;
+
+  locations = g_datalist_id_get_data (&object->qdata, quark_weak_locations);
+  if (!locations)
+    return TRUE;
+
+  g_static_rw_lock_writer_lock (&weak_locations_lock);
+  if (g_atomic_int_get ((int *)&object->ref_count) != 1)
+    {
+      g_static_rw_lock_writer_unlock (&weak_locations_lock);
+      return FALSE;
+    }
+  weak_locations_clear_unlocked (locations);
+  g_static_rw_lock_writer_unlock (&weak_locations_lock);
+
+  return TRUE;
+}
+
+/* called from g_object_unref() after dispose; drops the last reference
+ * with the weak locations cleared once more (dispose may have set new
+ * ones) and with no g_weak_ref_get() in progress. Returns %FALSE if the
+ * object was re-referenced meanwhile, leaving the reference alone.
+ */
+static gboolean
+weak_locations_release_last (GObject  *object,
+                             gboolean *is_zero)
+{
+  WeakLocations *locations;
+
+  locations = g_datalist_id_get_data (&object->qdata, quark_weak_locations);
+  if (!locations)
+    {
+      *is_zero = g_atomic_int_dec_and_test ((int *)&object->ref_count);
+      return TRUE;
+    }
+
+  g_static_rw_lock_writer_lock (&weak_locations_lock);
+  if (g_atomic_int_get ((int *)&object->ref_count) != 1)
+    {
+      g_static_rw_lock_writer_unlock (&weak_locations_lock);
+      return FALSE;
+    }
+  weak_locations_clear_unlocked (locations);
+  *is_zero = g_atomic_int_dec_and_test ((int *)&object->ref_count);
+  g_static_rw_lock_writer_unlock (&weak_locations_lock);
+
+  return TRUE;
+}
+
+/**
+ * GWeakRef:
+ *
+ * A structure containing a weak reference to a #GObject. It can
+ * either be empty (i.e. point to %NULL), or point to an object for as
+ * long as at least one "strong" reference to that object exists.
+ * Before the object's #GObjectClass.dispose method is called, every
+ * #GWeakRef associated with it becomes empty.
+ *
+ * Unlike g_object_add_weak_pointer(), a #GWeakRef can be safely read
+ * from one thread while the last reference to the object is dropped
+ * in another; use g_weak_ref_get() to do so.
+ *
+ * A #GWeakRef must be initialized with g_weak_ref_init() and released
+ * with g_weak_ref_clear(). Adding and removing a #GWeakRef are
+ * constant time operations, regardless of how many weak references
+ * the object has.
+ *
+ * Since: 2.22
+ */
+
+/**
+ * g_weak_ref_init:
+ * @weak_ref: uninitialized or empty location for a weak reference
+ * @object: a #GObject or %NULL
+ *
+ * Initialise a non-statically-allocated #GWeakRef and set it to
+ * point to @object.
+ *
+ * This function also calls g_weak_ref_set() with @object on the
+ * freshly-initialised weak reference.
+ *
+ * This function should always be matched with a call to
+ * g_weak_ref_clear().
+ *
+ * Since: 2.22
+ */
+void
+g_weak_ref_init (GWeakRef *weak_ref,
+                 gpointer  object)
+{
+  g_return_if_fail (weak_ref != NULL);
+  g_return_if_fail (object == NULL || G_IS_OBJECT (object));
+
+  weak_ref->object = NULL;
+  weak_ref->link = NULL;
+
+  if (object)
+    g_weak_ref_set (weak_ref, object);
+}
+
+/**
+ * g_weak_ref_clear:
+ * @weak_ref: location of a weak reference, which may be empty
+ *
+ * Frees resources associated with a non-statically-allocated #GWeakRef.
+ * After this call, the #GWeakRef is left in an undefined state.
+ *
+ * Since: 2.22
+ */
+void
+g_weak_ref_clear (GWeakRef *weak_ref)
+{
+  g_return_if_fail (weak_ref != NULL);
+
+  g_weak_ref_set (weak_ref, NULL);
+}
+
+/**
+ * g_weak_ref_get:
+ * @weak_ref: location of a weak reference to a #GObject
+ *
+ * If @weak_ref is not empty, atomically acquire a strong reference
+ * to the object it points to, and return that reference.
+ *
+ * This function is needed because of the potential race between
+ * taking the pointer value and g_object_ref() on it, if the object
+ * was losing its last reference at the same time in a different
+ * thread.
+ *
+ * The caller should release the resulting reference in the usual way,
+ * by using g_object_unref().
+ *
+ * Returns: the object pointed to by @weak_ref, or %NULL if it was empty
+ *
+ * Since: 2.22
+ */
+gpointer
+g_weak_ref_get (GWeakRef *weak_ref)
+{
+  GObject *object;
+  gint old_val = 0;
+
+  g_return_val_if_fail (weak_ref != NULL, NULL);
+
+  g_static_rw_lock_reader_lock (&weak_locations_lock);
+  object = weak_ref->object;
+  /* never resurrect an object whose last reference is already gone */
+  while (object)
+    {
+      old_val = g_atomic_int_get ((int *)&object->ref_count);
+      if (old_val == 0)
+        object = NULL;
+      else if (g_atomic_int_compare_and_exchange ((int *)&object->ref_count,
+                                                  old_val, old_val + 1))
+        break;
+    }
+  g_static_rw_lock_reader_unlock (&weak_locations_lock);
+
+  /* toggle notification must not happen with the lock held */
+  if (old_val == 1 && OBJECT_HAS_TOGGLE_REF (object))
+    toggle_refs_notify (object, FALSE);
+
+  return object;
+}
+
+/**
+ * g_weak_ref_set:
+ * @weak_ref: location for a weak reference
+ * @object: a #GObject or %NULL
+ *
+ * Change the object to which @weak_ref points, or set it to
+ * %NULL.
+ *
+ * You must own a strong reference on @object while calling this
+ * function.
+ *
+ * Since: 2.22
+ */
+void
+g_weak_ref_set (GWeakRef *weak_ref,
+                gpointer  object)
+{
+  g_return_if_fail (weak_ref != NULL);
+  g_return_if_fail (object == NULL || G_IS_OBJECT (object));
+
+  g_static_rw_lock_writer_lock (&weak_locations_lock);
+  weak_ref_set_unlocked (weak_ref, object);
+  g_static_rw_lock_writer_unlock (&weak_locations_lock);
+}
+
 static guint
 object_floating_flag_handler (GObject        *object,
                               gint            job)
@@ -2389,6 +2961,12 @@ g_object_unref (gpointer _object)
     }
   else
     {
+      /* empty the weak locations first, a concurrent g_weak_ref_get()
+       * may have re-referenced the object meanwhile
+       */
+      if (!weak_locations_clear (object))
+        goto retry_atomic_decrement1;
+
       /* we are about tp remove the last reference */
       G_OBJECT_GET_CLASS (object)->dispose (object);
 
@@ -2413,7 +2991,8 @@ g_object_unref (gpointer _object)
       g_datalist_id_set_data (&object->qdata, quark_weak_refs, NULL);
       
       /* decrement the last reference */
-      is_zero = g_atomic_int_dec_and_test ((int *)&object->ref_count);
+      if (!weak_locations_release_last (object, &is_zero))
+        goto retry_atomic_decrement2;
       
       /* may have been re-referenced meanwhile */
       if (G_LIKELY (is_zero)) 
@@ -430,6 +430,14 @@ void        g_object_set_property             (GObject        *object,
 void        g_object_get_property             (GObject        *object,
 					       const gchar    *property_name,
 					       GValue         *value);
+void        g_object_set_properties           (GObject        *object,
+					       guint           n_properties,
+					       GParamSpec    **pspecs,
+					       const GValue   *values);
+void        g_object_get_properties           (GObject        *object,
+					       guint           n_properties,
+					       GParamSpec    **pspecs,
+					       GValue         *values);
 void        g_object_freeze_notify            (GObject        *object);
 void        g_object_notify                   (GObject        *object,
 					       const gchar    *property_name);
@@ -449,6 +457,19 @@ void        g_object_add_weak_pointer         (GObject        *object,
 void        g_object_remove_weak_pointer      (GObject        *object, 
                                                gpointer       *weak_pointer_location);
 
+typedef struct {
+    /*< private >*/
+    gpointer object;
+    GList   *link;
+} GWeakRef;
+
+void        g_weak_ref_init                   (GWeakRef       *weak_ref,
+                                               gpointer        object);
+void        g_weak_ref_clear                  (GWeakRef       *weak_ref);
+gpointer    g_weak_ref_get                    (GWeakRef       *weak_ref);
+void        g_weak_ref_set                    (GWeakRef       *weak_ref,
+                                               gpointer        object);
+
 /**
  * GToggleNotify:
  * @data: Callback data passed to g_object_add_toggle_ref()
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "gtype.h"
+#include "gtype-private.h"
 #include "gtypeplugin.h"
 #include "gvaluecollector.h"
 #include "gbsearcharray.h"
@@ -170,6 +171,7 @@ typedef struct _CommonData      CommonData;
 typedef struct _IFaceData       IFaceData;
 typedef struct _ClassData       ClassData;
 typedef struct _InstanceData    InstanceData;
+typedef struct _BoxedData       BoxedData;
 typedef union  _TypeData        TypeData;
 typedef struct _IFaceEntry      IFaceEntry;
 typedef struct _IFaceHolder	IFaceHolder;
@@ -328,9 +330,17 @@ struct _InstanceData
   GInstanceInitFunc  instance_init;
 };
 
+struct _BoxedData
+{
+  CommonData         common;
+  GBoxedCopyFunc     copy_func;
+  GBoxedFreeFunc     free_func;
+};
+
 union _TypeData
 {
   CommonData         common;
+  BoxedData          boxed;
   IFaceData          iface;
   ClassData          class;
   InstanceData       instance;
@@ -1056,6 +1066,12 @@ type_data_make_W (TypeNode              *node,
       data->iface.dflt_data = info->class_data;
       data->iface.dflt_vtable = NULL;
     }
+  else if (NODE_FUNDAMENTAL_TYPE (node) == G_TYPE_BOXED)
+    {
+      data = g_malloc0 (sizeof (BoxedData) + vtable_size);
+      if (vtable_size)
+	vtable = G_STRUCT_MEMBER_P (data, sizeof (BoxedData));
+    }
   else
     {
       data = g_malloc0 (sizeof (CommonData) + vtable_size);
@@ -4231,5 +4247,40 @@ g_type_instance_get_private (GTypeInstance *instance,
   return G_STRUCT_MEMBER_P (instance, offset);
 }
 
+/* --- boxed types --- */
+void
+_g_type_boxed_init (GType          type,
+		    GBoxedCopyFunc copy_func,
+		    GBoxedFreeFunc free_func)
+{
+  TypeNode *node = lookup_type_node_I (type);
+
+  G_WRITE_LOCK (&type_rw_lock);
+  node->data->boxed.copy_func = copy_func;
+  node->data->boxed.free_func = free_func;
+  G_WRITE_UNLOCK (&type_rw_lock);
+}
+
+/* boxed types are static and their data is never released, so
+ * the copy and free functions can be fetched without locking
+ */
+gpointer
+_g_type_boxed_copy (GType         type,
+		    gconstpointer value)
+{
+  TypeNode *node = lookup_type_node_I (type);
+
+  return node->data->boxed.copy_func ((gpointer) value);
+}
+
+void
+_g_type_boxed_free (GType    type,
+		    gpointer value)
+{
+  TypeNode *node = lookup_type_node_I (type);
+
+  node->data->boxed.free_func (value);
+}
+
 #define __G_TYPE_C__
 #include "gobjectaliasdef.c"
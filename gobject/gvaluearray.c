@@ -50,6 +50,22 @@
 #  define	GROUP_N_VALUES	(8)	/* power of 2 !! */
 #endif
 
+/* number of values stored within the array allocation itself, most
+ * arrays built for signal emissions and the like never exceed this
+ */
+#define	INLINE_N_VALUES	(4)
+
+
+/* --- structures --- */
+typedef struct
+{
+  GValueArray array;
+  GValue      inline_values[INLINE_N_VALUES];
+} RealValueArray;
+
+#define	VALUE_ARRAY_INLINE_VALUES(va)	(((RealValueArray*) (va))->inline_values)
+#define	VALUE_ARRAY_IS_INLINE(va)	((va)->values == VALUE_ARRAY_INLINE_VALUES (va))
+
 
 /* --- functions --- */
 /**
@@ -82,9 +98,19 @@ value_array_grow (GValueArray *value_array,
   if (value_array->n_values > value_array->n_prealloced)
     {
       guint i = value_array->n_prealloced;
-
-      value_array->n_prealloced = (value_array->n_values + GROUP_N_VALUES - 1) & ~(GROUP_N_VALUES - 1);
-      value_array->values = g_renew (GValue, value_array->values, value_array->n_prealloced);
+      guint n_prealloced = MAX (value_array->n_values, value_array->n_prealloced * 2);
+
+      /* grow geometrically, so appending n values costs O(n) */
+      n_prealloced = (n_prealloced + GROUP_N_VALUES - 1) & ~(GROUP_N_VALUES - 1);
+      if (VALUE_ARRAY_IS_INLINE (value_array))
+	{
+	  value_array->values = g_new (GValue, n_prealloced);
+	  memcpy (value_array->values, VALUE_ARRAY_INLINE_VALUES (value_array),
+		  value_array->n_prealloced * sizeof (value_array->values[0]));
+	}
+      else
+	value_array->values = g_renew (GValue, value_array->values, n_prealloced);
+      value_array->n_prealloced = n_prealloced;
       if (!zero_init)
 	i = value_array->n_values;
       memset (value_array->values + i, 0,
@@ -96,7 +122,8 @@ static inline void
 value_array_shrink (GValueArray *value_array)
 {
 #ifdef  DISABLE_MEM_POOLS
-  if (value_array->n_prealloced >= value_array->n_values + GROUP_N_VALUES)
+  if (!VALUE_ARRAY_IS_INLINE (value_array) &&
+      value_array->n_prealloced >= value_array->n_values + GROUP_N_VALUES)
     {
       value_array->n_prealloced = (value_array->n_values + GROUP_N_VALUES - 1) & ~(GROUP_N_VALUES - 1);
       value_array->values = g_renew (GValue, value_array->values, value_array->n_prealloced);
@@ -104,6 +131,22 @@ value_array_shrink (GValueArray *value_array)
 #endif
 }
 
+static GValueArray*
+value_array_alloc (guint n_prealloced)
+{
+  RealValueArray *rarray = g_slice_new (RealValueArray);
+  GValueArray *value_array = &rarray->array;
+
+  value_array->n_values = 0;
+  value_array->n_prealloced = INLINE_N_VALUES;
+  value_array->values = rarray->inline_values;
+  memset (rarray->inline_values, 0, sizeof (rarray->inline_values));
+  value_array_grow (value_array, n_prealloced, TRUE);
+  value_array->n_values = 0;
+
+  return value_array;
+}
+
 /**
  * g_value_array_new:
  * @n_prealloced: number of values to preallocate space for
@@ -117,15 +160,7 @@ value_array_shrink (GValueArray *value_array)
 GValueArray*
 g_value_array_new (guint n_prealloced)
 {
-  GValueArray *value_array = g_slice_new (GValueArray);
-
-  value_array->n_values = 0;
-  value_array->n_prealloced = 0;
-  value_array->values = NULL;
-  value_array_grow (value_array, n_prealloced, TRUE);
-  value_array->n_values = 0;
-
-  return value_array;
+  return value_array_alloc (n_prealloced);
 }
 
 /**
@@ -148,8 +183,42 @@ g_value_array_free (GValueArray *value_array)
       if (G_VALUE_TYPE (value) != 0) /* we allow unset values in the array */
 	g_value_unset (value);
     }
-  g_free (value_array->values);
-  g_slice_free (GValueArray, value_array);
+  if (!VALUE_ARRAY_IS_INLINE (value_array))
+    g_free (value_array->values);
+  g_slice_free (RealValueArray, (RealValueArray*) value_array);
+}
+
+/* Values of the fundamental types below own no resources, and the
+ * value tables GObject installs for them copy nothing but the GValue
+ * structure. Any other type may have a value_copy() that does more,
+ * so only these are duplicated by a plain structure copy.
+ */
+static gboolean
+value_type_is_plain_data (GType type)
+{
+  GType fundamental = G_TYPE_FUNDAMENTAL (type);
+
+  switch (fundamental)
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+    case G_TYPE_POINTER:
+      /* derived enum and flags types could bring their own table */
+      return g_type_value_table_peek (type) == g_type_value_table_peek (fundamental);
+    default:
+      return FALSE;
+    }
 }
 
 /**
@@ -165,23 +234,35 @@ GValueArray*
 g_value_array_copy (const GValueArray *value_array)
 {
   GValueArray *new_array;
+  GType last_type = 0;
+  gboolean plain_data = FALSE;
   guint i;
 
   g_return_val_if_fail (value_array != NULL, NULL);
 
-  new_array = g_slice_new (GValueArray);
-  new_array->n_values = 0;
-  new_array->values = NULL;
-  new_array->n_prealloced = 0;
+  new_array = value_array_alloc (value_array->n_values);
   value_array_grow (new_array, value_array->n_values, TRUE);
   for (i = 0; i < new_array->n_values; i++)
-    if (G_VALUE_TYPE (value_array->values + i) != 0)
-      {
-	GValue *value = new_array->values + i;
-	
-	g_value_init (value, G_VALUE_TYPE (value_array->values + i));
-	g_value_copy (value_array->values + i, value);
-      }
+    {
+      const GValue *src_value = value_array->values + i;
+      GValue *value = new_array->values + i;
+      GType type = G_VALUE_TYPE (src_value);
+
+      if (type == 0)
+	continue;
+      if (type != last_type)
+	{
+	  last_type = type;
+	  plain_data = value_type_is_plain_data (type);
+	}
+      if (plain_data)
+	*value = *src_value;
+      else
+	{
+	  g_value_init (value, type);
+	  g_value_copy (src_value, value);
+	}
+    }
   return new_array;
 }
 
@@ -221,6 +302,21 @@ g_value_array_append (GValueArray  *value_array,
   return g_value_array_insert (value_array, value_array->n_values, value);
 }
 
+static GValue*
+value_array_insert_unset (GValueArray *value_array,
+			  guint        index)
+{
+  guint i = value_array->n_values;
+
+  value_array_grow (value_array, value_array->n_values + 1, FALSE);
+  if (index + 1 < value_array->n_values)
+    g_memmove (value_array->values + index + 1, value_array->values + index,
+	       (i - index) * sizeof (value_array->values[0]));
+  memset (value_array->values + index, 0, sizeof (value_array->values[0]));
+
+  return value_array->values + index;
+}
+
 /**
  * g_value_array_insert:
  * @value_array: #GValueArray to add an element to
@@ -236,27 +332,89 @@ g_value_array_insert (GValueArray  *value_array,
 		      guint         index,
 		      const GValue *value)
 {
-  guint i;
+  GValue *slot;
 
   g_return_val_if_fail (value_array != NULL, NULL);
   g_return_val_if_fail (index <= value_array->n_values, value_array);
 
   /* we support NULL for "value" as a shortcut for an unset value */
 
-  i = value_array->n_values;
-  value_array_grow (value_array, value_array->n_values + 1, FALSE);
-  if (index + 1 < value_array->n_values)
-    g_memmove (value_array->values + index + 1, value_array->values + index,
-	       (i - index) * sizeof (value_array->values[0]));
-  memset (value_array->values + index, 0, sizeof (value_array->values[0]));
+  slot = value_array_insert_unset (value_array, index);
   if (value)
     {
-      g_value_init (value_array->values + index, G_VALUE_TYPE (value));
-      g_value_copy (value, value_array->values + index);
+      g_value_init (slot, G_VALUE_TYPE (value));
+      g_value_copy (value, slot);
     }
   return value_array;
 }
 
+/**
+ * g_value_array_insert_take:
+ * @value_array: #GValueArray to add an element to
+ * @index_: insertion position, must be &lt;= value_array-&gt;n_values
+ * @value: #GValue to move into @value_array
+ *
+ * Insert @value at specified position into @value_array, like
+ * g_value_array_insert(), but transfers the contents of @value into
+ * the array instead of copying them. Afterwards @value is unset and
+ * zero-filled, it does not need to be passed to g_value_unset().
+ *
+ * Returns: the #GValueArray passed in as @value_array
+ *
+ * Since: 2.22
+ */
+GValueArray*
+g_value_array_insert_take (GValueArray *value_array,
+			   guint        index,
+			   GValue      *value)
+{
+  GValue *slot;
+
+  g_return_val_if_fail (value_array != NULL, NULL);
+  g_return_val_if_fail (index <= value_array->n_values, value_array);
+  g_return_val_if_fail (value != NULL, value_array);
+
+  slot = value_array_insert_unset (value_array, index);
+  *slot = *value;
+  memset (value, 0, sizeof (*value));
+
+  return value_array;
+}
+
+/**
+ * g_value_array_append_take:
+ * @value_array: #GValueArray to add an element to
+ * @value: #GValue to move into @value_array
+ *
+ * Moves the contents of @value to the end of @value_array, see
+ * g_value_array_insert_take().
+ *
+ * Returns: the #GValueArray passed in as @value_array
+ *
+ * Since: 2.22
+ */
+GValueArray*
+g_value_array_append_take (GValueArray *value_array,
+			   GValue      *value)
+{
+  g_return_val_if_fail (value_array != NULL, NULL);
+
+  return g_value_array_insert_take (value_array, value_array->n_values, value);
+}
+
+static void
+value_array_remove_unset (GValueArray *value_array,
+			  guint        index)
+{
+  value_array->n_values--;
+  if (index < value_array->n_values)
+    g_memmove (value_array->values + index, value_array->values + index + 1,
+	       (value_array->n_values - index) * sizeof (value_array->values[0]));
+  value_array_shrink (value_array);
+  if (value_array->n_prealloced > value_array->n_values)
+    memset (value_array->values + value_array->n_values, 0, sizeof (value_array->values[0]));
+}
+
 /**
  * g_value_array_remove:
  * @value_array: #GValueArray to remove an element from
@@ -275,13 +433,38 @@ g_value_array_remove (GValueArray *value_array,
 
   if (G_VALUE_TYPE (value_array->values + index) != 0)
     g_value_unset (value_array->values + index);
-  value_array->n_values--;
-  if (index < value_array->n_values)
-    g_memmove (value_array->values + index, value_array->values + index + 1,
-	       (value_array->n_values - index) * sizeof (value_array->values[0]));
-  value_array_shrink (value_array);
-  if (value_array->n_prealloced > value_array->n_values)
-    memset (value_array->values + value_array->n_values, 0, sizeof (value_array->values[0]));
+  value_array_remove_unset (value_array, index);
+
+  return value_array;
+}
+
+/**
+ * g_value_array_steal:
+ * @value_array: #GValueArray to remove an element from
+ * @index_: position of value to remove, must be &lt; value_array->n_values
+ * @value: an uninitialized #GValue to receive the removed element
+ *
+ * Remove the value at position @index_ from @value_array and move its
+ * contents into @value without copying them. The caller has to unset
+ * @value with g_value_unset() once done with it. If the element was an
+ * unset value, @value is left zero-filled.
+ *
+ * Returns: the #GValueArray passed in as @value_array
+ *
+ * Since: 2.22
+ */
+GValueArray*
+g_value_array_steal (GValueArray *value_array,
+		     guint        index,
+		     GValue      *value)
+{
+  g_return_val_if_fail (value_array != NULL, NULL);
+  g_return_val_if_fail (index < value_array->n_values, value_array);
+  g_return_val_if_fail (value != NULL, value_array);
+  g_return_val_if_fail (G_VALUE_TYPE (value) == 0, value_array);
+
+  *value = value_array->values[index];
+  value_array_remove_unset (value_array, index);
 
   return value_array;
 }
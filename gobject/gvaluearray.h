@@ -65,6 +65,14 @@ GValueArray*	g_value_array_insert	     (GValueArray	*value_array,
 					      const GValue	*value);
 GValueArray*	g_value_array_remove	     (GValueArray	*value_array,
 					      guint		 index_);
+GValueArray*	g_value_array_append_take    (GValueArray	*value_array,
+					      GValue		*value);
+GValueArray*	g_value_array_insert_take    (GValueArray	*value_array,
+					      guint		 index_,
+					      GValue		*value);
+GValueArray*	g_value_array_steal	     (GValueArray	*value_array,
+					      guint		 index_,
+					      GValue		*value);
 GValueArray*	g_value_array_sort	     (GValueArray	*value_array,
 					      GCompareFunc	 compare_func);
 GValueArray*	g_value_array_sort_with_data (GValueArray	*value_array,
@@ -227,6 +227,47 @@ test_threaded_object_init (void)
   g_thread_join (creator);
 }
 
+static volatile gint weak_ref_readers_done = 0;
+
+static gpointer
+weak_ref_reader (gpointer data)
+{
+  GWeakRef *weak_ref = data;
+  GObject *obj;
+
+  while ((obj = g_weak_ref_get (weak_ref)) != NULL)
+    g_object_unref (obj);
+
+  g_atomic_int_inc (&weak_ref_readers_done);
+  return NULL;
+}
+
+static void
+test_threaded_weak_ref (void)
+{
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    {
+      GWeakRef weak_ref;
+      GThread *reader;
+      GObject *obj;
+
+      obj = g_object_new (G_TYPE_OBJECT, NULL);
+      g_weak_ref_init (&weak_ref, obj);
+      reader = g_thread_create (weak_ref_reader, &weak_ref, TRUE, NULL);
+      g_thread_yield ();
+
+      /* races against the reader re-referencing the object */
+      g_object_unref (obj);
+
+      g_thread_join (reader);
+      g_assert (g_weak_ref_get (&weak_ref) == NULL);
+      g_weak_ref_clear (&weak_ref);
+    }
+  g_assert_cmpint (weak_ref_readers_done, ==, 100);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -240,6 +281,7 @@ main (int   argc,
 
   g_test_add_func ("/GObject/threaded-class-init", test_threaded_class_init);
   g_test_add_func ("/GObject/threaded-object-init", test_threaded_object_init);
+  g_test_add_func ("/GObject/threaded-weak-ref", test_threaded_weak_ref);
 
   return g_test_run();
 }
@@ -181,11 +181,27 @@ static DEFINE_TYPE(TestObject, test_object,
 		   test_object_class_init, NULL, NULL,
 		   G_TYPE_OBJECT)
 
+static gboolean
+test_closure_valist (GClosure *closure,
+		     gpointer  instance,
+		     ...)
+{
+  gboolean result;
+  va_list args;
+
+  va_start (args, instance);
+  result = test_marshal_BOOLEAN__INT_valist (closure, instance, args);
+  va_end (args);
+
+  return result;
+}
+
 int
 main (int   argc,
       char *argv[])
 {
   TestObject *object;
+  GClosure *closure;
   gchar *string_result;
   gboolean bool_result;
 	
@@ -223,5 +239,30 @@ main (int   argc,
   g_signal_emit_by_name (object, "test-signal2", 4, &bool_result);
   g_assert (bool_result == FALSE);
 
+  /* typed emission wrappers */
+  string_result = test_marshal_emit_STRING__INT (object, g_signal_lookup ("test-signal1", TEST_TYPE_OBJECT), 0, 0);
+  g_assert (strcmp (string_result, "<before><default><after>") == 0);
+  g_free (string_result);
+  bool_result = test_marshal_emit_BOOLEAN__INT (object, g_signal_lookup ("test-signal2", TEST_TYPE_OBJECT), 0, 3);
+  g_assert (bool_result == TRUE);
+
+  /* direct closure invocation */
+  closure = g_cclosure_new (G_CALLBACK (test_object_signal1_callback_after), NULL, NULL);
+  string_result = test_marshal_STRING__INT_direct (closure, object, 0);
+  g_assert (strcmp (string_result, "<after>") == 0);
+  g_free (string_result);
+  g_closure_unref (closure);
+  closure = g_cclosure_new_swap (G_CALLBACK (test_object_signal2_callback_before), object, NULL);
+  g_assert (test_closure_valist (closure, GINT_TO_POINTER (1), 1) == TRUE);
+  g_assert (test_closure_valist (closure, GINT_TO_POINTER (1), 2) == FALSE);
+  g_closure_unref (closure);
+
+  /* the BOOL alias keyword gets the same functions */
+  bool_result = test_marshal_emit_BOOL__INT (object, g_signal_lookup ("test-signal2", TEST_TYPE_OBJECT), 0, 4);
+  g_assert (bool_result == FALSE);
+  closure = g_cclosure_new_swap (G_CALLBACK (test_object_signal2_callback_before), object, NULL);
+  g_assert (test_marshal_BOOL__INT_direct (closure, GINT_TO_POINTER (1), 1) == TRUE);
+  g_closure_unref (closure);
+
   return 0;
 }
@@ -87,6 +87,65 @@ test_enum_transformation (void)
  g_assert (g_value_get_uint64 (&xform) == 1);
 }
 
+static void
+test_enum_lookup (void)
+{
+  static const GEnumValue dense_values[] = {
+    { 2, "DENSE_2", "two" }, { 3, "DENSE_3", "three" }, { 4, "DENSE_4", "four" },
+    { 5, "DENSE_5", "five" }, { 7, "DENSE_7", "seven" }, { 8, "DENSE_8", "eight" },
+    { 9, "DENSE_9", "nine" }, { 10, "DENSE_10", "ten" }, { 3, "DENSE_THREE", "drei" },
+    { 0, NULL, NULL }
+  };
+  static const GEnumValue sparse_values[] = {
+    { 1000000, "SPARSE_M", "m" }, { -5, "SPARSE_NEG", "neg" }, { 0, "SPARSE_0", "zero" },
+    { 64, "SPARSE_64", "64" }, { G_MAXINT, "SPARSE_MAX", "max" }, { G_MININT, "SPARSE_MIN", "min" },
+    { 7, "SPARSE_7", NULL }, { 64, "SPARSE_ALIAS", "alias" }, { 12, "SPARSE_12", "12" },
+    { 0, NULL, NULL }
+  };
+  static const GFlagsValue flags_values[] = {
+    { 1 << 0, "F_0", "f0" }, { 1 << 1, "F_1", "f1" }, { 1 << 2, "F_2", NULL },
+    { 1 << 3, "F_3", "f3" }, { 1 << 4, "F_4", "f4" }, { 1 << 5, "F_5", "f5" },
+    { 1 << 6, "F_6", "f6" }, { 1 << 7, "F_7", "f7" }, { 1 << 8, "F_8", "f0" },
+    { 0, NULL, NULL }
+  };
+  GEnumClass *eclass;
+  GFlagsClass *fclass;
+
+  eclass = g_type_class_ref (g_enum_register_static ("TestDenseEnum", dense_values));
+  g_assert (g_enum_get_value (eclass, 2) == &dense_values[0]);
+  g_assert (g_enum_get_value (eclass, 3) == &dense_values[1]);
+  g_assert (g_enum_get_value (eclass, 10) == &dense_values[7]);
+  g_assert (g_enum_get_value (eclass, 6) == NULL);
+  g_assert (g_enum_get_value (eclass, 1) == NULL);
+  g_assert (g_enum_get_value (eclass, 11) == NULL);
+  g_assert (g_enum_get_value (eclass, G_MININT) == NULL);
+  g_assert (g_enum_get_value_by_name (eclass, "DENSE_THREE") == &dense_values[8]);
+  g_assert (g_enum_get_value_by_name (eclass, "DENSE_6") == NULL);
+  g_assert (g_enum_get_value_by_nick (eclass, "drei") == &dense_values[8]);
+  g_assert (g_enum_get_value_by_nick (eclass, "DENSE_2") == NULL);
+  g_type_class_unref (eclass);
+
+  eclass = g_type_class_ref (g_enum_register_static ("TestSparseEnum", sparse_values));
+  g_assert (g_enum_get_value (eclass, G_MININT) == &sparse_values[5]);
+  g_assert (g_enum_get_value (eclass, G_MAXINT) == &sparse_values[4]);
+  g_assert (g_enum_get_value (eclass, 64) == &sparse_values[3]);
+  g_assert (g_enum_get_value (eclass, 0) == &sparse_values[2]);
+  g_assert (g_enum_get_value (eclass, 1) == NULL);
+  g_assert (g_enum_get_value (eclass, 999999) == NULL);
+  g_assert (g_enum_get_value_by_name (eclass, "SPARSE_ALIAS") == &sparse_values[7]);
+  g_assert (g_enum_get_value_by_nick (eclass, "neg") == &sparse_values[1]);
+  g_assert (g_enum_get_value_by_nick (eclass, "SPARSE_7") == NULL);
+  g_type_class_unref (eclass);
+
+  fclass = g_type_class_ref (g_flags_register_static ("TestManyFlags", flags_values));
+  g_assert (g_flags_get_value_by_name (fclass, "F_8") == &flags_values[8]);
+  g_assert (g_flags_get_value_by_name (fclass, "F_9") == NULL);
+  g_assert (g_flags_get_value_by_nick (fclass, "f0") == &flags_values[0]);
+  g_assert (g_flags_get_value_by_nick (fclass, "f7") == &flags_values[7]);
+  g_assert (g_flags_get_value_by_nick (fclass, "F_2") == NULL);
+  g_assert (g_flags_get_first_value (fclass, 1 << 5 | 1 << 7) == &flags_values[5]);
+  g_type_class_unref (fclass);
+}
 
 static void
 test_gtype_value (void)
@@ -359,6 +418,170 @@ test_copying (void)
   }  
 }
 
+static void
+test_value_array (void)
+{
+  GValueArray *array, *copy;
+  GValue value = { 0, };
+  gchar *str;
+  guint i;
+
+  array = g_value_array_new (0);
+  for (i = 0; i < 20; i++)
+    {
+      g_value_init (&value, G_TYPE_STRING);
+      g_value_take_string (&value, g_strdup_printf ("%u", i));
+      if (i % 2)
+        g_value_array_append (array, &value);
+      else
+        g_value_array_append_take (array, &value);
+      if (G_IS_VALUE (&value))
+        g_value_unset (&value);
+      g_assert (G_VALUE_TYPE (&value) == 0);
+    }
+  g_value_array_insert (array, 3, NULL);
+  g_value_init (&value, G_TYPE_INT);
+  g_value_set_int (&value, 42);
+  g_value_array_insert_take (array, 0, &value);
+  g_assert (array->n_values == 22);
+
+  copy = g_value_array_copy (array);
+  g_value_array_free (array);
+  g_assert (copy->n_values == 22);
+  g_assert (g_value_get_int (g_value_array_get_nth (copy, 0)) == 42);
+  g_assert (strcmp (g_value_get_string (g_value_array_get_nth (copy, 1)), "0") == 0);
+  g_assert (G_VALUE_TYPE (g_value_array_get_nth (copy, 4)) == 0);
+  g_assert (strcmp (g_value_get_string (g_value_array_get_nth (copy, 21)), "19") == 0);
+
+  g_value_array_steal (copy, 21, &value);
+  str = g_value_dup_string (&value);
+  g_value_unset (&value);
+  g_assert (strcmp (str, "19") == 0);
+  g_free (str);
+  while (copy->n_values > 2)
+    g_value_array_remove (copy, 1);
+  g_assert (g_value_get_int (g_value_array_get_nth (copy, 0)) == 42);
+  g_assert (strcmp (g_value_get_string (g_value_array_get_nth (copy, 1)), "18") == 0);
+  g_value_array_free (copy);
+
+  array = g_value_array_new (2);
+  g_value_array_append (array, NULL);
+  copy = g_value_array_copy (array);
+  g_assert (copy->n_values == 1);
+  g_value_array_free (copy);
+  g_value_array_free (array);
+}
+
+static gint counted_copies = 0;
+
+static void
+counted_value_init (GValue *value)
+{
+  value->data[0].v_int = 0;
+}
+
+static void
+counted_value_copy (const GValue *src_value,
+                    GValue       *dest_value)
+{
+  counted_copies++;
+  dest_value->data[0].v_int = src_value->data[0].v_int;
+}
+
+/* A type without value_free() whose value_copy() must still be called */
+static void
+test_value_array_copy_table (void)
+{
+  static const GTypeValueTable value_table = {
+    counted_value_init,
+    NULL,
+    counted_value_copy,
+  };
+  static const GTypeFundamentalInfo finfo = { 0, };
+  GTypeInfo info = { 0, };
+  GValueArray *array, *copy;
+  GValue value = { 0, };
+  GType type;
+
+  info.value_table = &value_table;
+  type = g_type_register_fundamental (g_type_fundamental_next (),
+                                      "TestCountedCopy", &info, &finfo, 0);
+
+  array = g_value_array_new (0);
+  g_value_init (&value, type);
+  g_value_array_append (array, &value);
+  g_value_array_append (array, &value);
+  g_value_unset (&value);
+  g_assert (counted_copies == 2);
+
+  copy = g_value_array_copy (array);
+  g_assert (copy->n_values == 2);
+  g_assert (counted_copies == 4);
+
+  g_value_array_free (copy);
+  g_value_array_free (array);
+}
+
+typedef struct {
+  gint refs;
+} TestBoxed;
+
+static gint boxed_copies = 0;
+static gint boxed_frees = 0;
+
+static gpointer
+test_boxed_copy (gpointer boxed)
+{
+  TestBoxed *b = boxed;
+
+  boxed_copies++;
+  b->refs++;
+  return b;
+}
+
+static void
+test_boxed_free (gpointer boxed)
+{
+  TestBoxed *b = boxed;
+
+  boxed_frees++;
+  b->refs--;
+}
+
+static void
+test_boxed (void)
+{
+  GType type;
+  GValue value = { 0, };
+  GValue copy = { 0, };
+  TestBoxed boxed = { 1 };
+  gpointer p;
+
+  type = g_boxed_type_register_static ("TestBoxed", test_boxed_copy, test_boxed_free);
+  g_assert (type != 0);
+
+  p = g_boxed_copy (type, &boxed);
+  g_assert (p == &boxed && boxed.refs == 2);
+  g_boxed_free (type, p);
+  g_assert (boxed.refs == 1);
+
+  g_value_init (&value, type);
+  g_value_set_boxed (&value, &boxed);
+  g_assert (boxed.refs == 2);
+  g_value_init (&copy, type);
+  g_value_copy (&value, &copy);
+  g_assert (boxed.refs == 3);
+  p = g_value_dup_boxed (&copy);
+  g_assert (p == &boxed && boxed.refs == 4);
+  g_boxed_free (type, p);
+  g_value_set_static_boxed (&copy, &boxed);
+  g_assert (boxed.refs == 2);
+  g_value_unset (&copy);
+  g_value_unset (&value);
+  g_assert (boxed.refs == 1);
+  g_assert (boxed_copies == 4 && boxed_frees == 4);
+}
+
 
 int
 main (int argc, char *argv[])
@@ -366,9 +589,13 @@ main (int argc, char *argv[])
   g_type_init (); 
   
   test_enum_transformation ();
+  test_enum_lookup ();
   test_gtype_value ();
   test_collection ();
   test_copying ();
+  test_value_array ();
+  test_value_array_copy_table ();
+  test_boxed ();
 
   return 0;
 }
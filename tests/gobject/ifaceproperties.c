@@ -417,6 +417,17 @@ assert_in_properties (GParamSpec  *param_spec,
   g_assert (found);
 }
 
+static void
+count_warnings (const gchar    *log_domain,
+		GLogLevelFlags  log_level,
+		const gchar    *message,
+		gpointer        user_data)
+{
+  guint *n_warnings = user_data;
+
+  (*n_warnings)++;
+}
+
 int
 main (gint   argc,
       gchar *argv[])
@@ -456,6 +467,73 @@ main (gint   argc,
   g_assert (val3 == 0x0303);
   g_assert (val4 == 0x0404);
 
+  /* Test setting and getting the properties by spec
+   */
+  {
+    static const gchar *names[] = { "prop1", "prop2", "prop3", "prop4" };
+    GParamSpec *pspecs[G_N_ELEMENTS (names)];
+    GValue values[G_N_ELEMENTS (names)] = { { 0, }, };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+      {
+        pspecs[i] = g_object_class_find_property (G_OBJECT_GET_CLASS (object), names[i]);
+        g_value_init (&values[i], G_TYPE_INT);
+        g_value_set_int (&values[i], 0x1010 * (i + 1));
+      }
+    /* converted to the property type on the way in */
+    g_value_unset (&values[3]);
+    g_value_init (&values[3], G_TYPE_UINT);
+    g_value_set_uint (&values[3], 0x4040);
+
+    g_object_set_properties (G_OBJECT (object), G_N_ELEMENTS (names), pspecs, values);
+
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+      g_value_unset (&values[i]);
+    /* and on the way out */
+    g_value_init (&values[1], G_TYPE_STRING);
+
+    g_object_get_properties (G_OBJECT (object), G_N_ELEMENTS (names), pspecs, values);
+
+    g_assert (g_value_get_int (&values[0]) == 0x1010);
+    g_assert (strcmp (g_value_get_string (&values[1]), "8224") == 0);
+    g_assert (g_value_get_int (&values[2]) == 0x3030);
+    g_assert (g_value_get_int (&values[3]) == 0x4040);
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+      g_value_unset (&values[i]);
+  }
+
+  /* Test that nothing is set if one of the values has the wrong type
+   */
+  {
+    static const gchar *names[] = { "prop1", "prop2" };
+    GParamSpec *pspecs[G_N_ELEMENTS (names)];
+    GValue values[G_N_ELEMENTS (names)] = { { 0, }, };
+    GLogLevelFlags fatal_mask;
+    guint n_warnings = 0, handler;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+      pspecs[i] = g_object_class_find_property (G_OBJECT_GET_CLASS (object), names[i]);
+    g_value_init (&values[0], G_TYPE_INT);
+    g_value_set_int (&values[0], 0x5050);
+    g_value_init (&values[1], G_TYPE_STRING);
+    g_value_set_static_string (&values[1], "not an int");
+
+    fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+    handler = g_log_set_handler ("GLib-GObject", G_LOG_LEVEL_WARNING,
+				 count_warnings, &n_warnings);
+    g_object_set_properties (G_OBJECT (object), G_N_ELEMENTS (names), pspecs, values);
+    g_log_remove_handler ("GLib-GObject", handler);
+    g_log_set_always_fatal (fatal_mask);
+
+    g_assert (n_warnings == 1);
+    g_object_get (object, "prop1", &val1, NULL);
+    g_assert (val1 == 0x1010);
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+      g_value_unset (&values[i]);
+  }
+
   /* Test that the right spec is passed on explicit notifications
    */
   g_object_freeze_notify (G_OBJECT (object));
@@ -40,6 +40,7 @@ static gboolean toggle_ref2_weakened;
 static gboolean toggle_ref2_strengthened;
 static gboolean toggle_ref3_weakened;
 static gboolean toggle_ref3_strengthened;
+static GWeakRef *dispose_weak_ref;
 
 /*
  * TestObject, a parent class for TestObject
@@ -59,6 +60,16 @@ struct _TestObjectClass
 
 G_DEFINE_TYPE (TestObject, test_object, G_TYPE_OBJECT);
 
+static void
+test_object_dispose (GObject *object)
+{
+  /* weak references set again during dispose must not survive it */
+  if (dispose_weak_ref)
+    g_weak_ref_set (dispose_weak_ref, object);
+
+  G_OBJECT_CLASS (test_object_parent_class)->dispose (object);
+}
+
 static void
 test_object_finalize (GObject *object)
 {
@@ -72,6 +83,7 @@ test_object_class_init (TestObjectClass *class)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (class);
 
+  object_class->dispose = test_object_dispose;
   object_class->finalize = test_object_finalize;
 }
 
@@ -208,6 +220,70 @@ main (int   argc,
   g_assert (weak_ref2_notified == TRUE);
   g_assert (object_destroyed == TRUE);
 
+  /* Test many weak references, removed out of order
+   */
+  global_object = object = g_object_new (TEST_TYPE_OBJECT, NULL);
+  {
+    gpointer locations[100];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (locations); i++)
+      {
+        locations[i] = object;
+        g_object_add_weak_pointer (object, &locations[i]);
+      }
+    for (i = 0; i < G_N_ELEMENTS (locations); i += 3)
+      g_object_remove_weak_pointer (object, &locations[i]);
+
+    clear_flags ();
+    g_object_unref (object);
+    g_assert (object_destroyed == TRUE);
+    for (i = 0; i < G_N_ELEMENTS (locations); i++)
+      g_assert (locations[i] == (i % 3 ? NULL : global_object));
+  }
+
+  /* Test GWeakRef
+   */
+  global_object = object = g_object_new (TEST_TYPE_OBJECT, NULL);
+  {
+    GWeakRef weak1, weak2, weak3;
+    GObject *tmp;
+
+    g_weak_ref_init (&weak1, object);
+    g_weak_ref_init (&weak2, object);
+    g_weak_ref_init (&weak3, NULL);
+    g_assert (g_weak_ref_get (&weak3) == NULL);
+    g_weak_ref_set (&weak3, object);
+    g_weak_ref_clear (&weak2);
+
+    tmp = g_weak_ref_get (&weak1);
+    g_assert (tmp == object);
+    g_assert (object->ref_count == 2);
+    g_object_unref (tmp);
+
+    clear_flags ();
+    g_object_unref (object);
+    g_assert (object_destroyed == TRUE);
+    g_assert (g_weak_ref_get (&weak1) == NULL);
+    g_assert (g_weak_ref_get (&weak3) == NULL);
+    g_weak_ref_clear (&weak1);
+    g_weak_ref_clear (&weak3);
+
+    global_object = object = g_object_new (TEST_TYPE_OBJECT, NULL);
+    g_weak_ref_init (&weak1, object);
+    g_weak_ref_init (&weak2, NULL);
+    dispose_weak_ref = &weak2;
+
+    clear_flags ();
+    g_object_unref (object);
+    dispose_weak_ref = NULL;
+    g_assert (object_destroyed == TRUE);
+    g_assert (g_weak_ref_get (&weak1) == NULL);
+    g_assert (g_weak_ref_get (&weak2) == NULL);
+    g_weak_ref_clear (&weak1);
+    g_weak_ref_clear (&weak2);
+  }
+
   /* Test basic toggle reference operation
    */
   global_object = object = g_object_new (TEST_TYPE_OBJECT, NULL);